@@ -3,8 +3,13 @@
 
 #include "common/DataHelper.h"
 #include "common/Exception.hpp"
+#include "common/LoadProgress.h"
 #include "common/MathFuncs.h"
+#include "common/ThreadPool.h"
 
+#include "image/BrickedBuffer.h"
+#include "image/Gzip.h"
+#include "image/ImagePyramid.h"
 #include "image/ImageUtility.h"
 
 #include "logic/annotation/Annotation.h"
@@ -25,11 +30,15 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <unordered_set>
 
 // Without undefining min and max, there are some errors compiling in Visual Studio
@@ -95,15 +104,89 @@ serialize::AntropyProject createProjectFromInputParams( const InputParams& param
         exit( EXIT_FAILURE );
     }
 
+    if ( params.quantizeFloatImages )
+    {
+        // The command line option applies to all images of the project
+        project.m_referenceImage.m_quantizeFloatValues = true;
+
+        for ( auto& image : project.m_additionalImages )
+        {
+            image.m_quantizeFloatValues = true;
+        }
+    }
+
     return project;
 }
 
+/// Maximum number of images whose files are read ahead of the image that is being added. An image that
+/// has been read is held in full until it is added and its voxels become subject to the memory budget.
+constexpr size_t sk_maxImagesReadAhead = 4;
+
+/// Create a read that is submitted to a thread pool later and get the future of its result
+template< class Func >
+auto deferRead( Func&& read, std::vector< std::function<void()> >& deferredReads )
+{
+    using ResultType = std::invoke_result_t< std::decay_t<Func> >;
+
+    // Packaged tasks are move-only, so share ownership with the type-erased read
+    auto task = std::make_shared< std::packaged_task<ResultType()> >( std::forward<Func>( read ) );
+    deferredReads.emplace_back( [task] () { ( *task )(); } );
+    return task->get_future();
+}
+
+/// Read an image from disk, optionally holding floating-point values as quantized integers
+Image readImageFile( const std::string& fileName, Image::FloatStorageType floatStorage,
+                     const FileLoadProgress* progress, ThreadPool* statsPool )
+{
+    return Image( fileName, Image::ImageRepresentation::Image,
+                  Image::MultiComponentBufferType::SeparateImages, floatStorage, progress, statsPool );
+}
+
+/// Get how to hold the floating-point values of a serialized image in memory
+Image::FloatStorageType floatStorageType( const serialize::Image& serializedImage )
+{
+    return serializedImage.m_quantizeFloatValues
+            ? Image::FloatStorageType::QuantizedUInt16
+            : Image::FloatStorageType::Float32;
+}
+
+/// Read a segmentation from disk. Creating an image as a segmentation will convert
+/// the pixel components to the most suitable unsigned integer type.
+Image readSegmentationFile( const std::string& fileName, const FileLoadProgress* progress, ThreadPool* statsPool )
+{
+    return Image( fileName, Image::ImageRepresentation::Segmentation,
+                  Image::MultiComponentBufferType::SeparateImages,
+                  Image::FloatStorageType::Float32, progress, statsPool );
+}
+
+/// Read a deformation field from disk. Its components are loaded as interleaved images.
+Image readDeformationFieldFile( const std::string& fileName, const FileLoadProgress* progress, ThreadPool* statsPool )
+{
+    return Image( fileName, Image::ImageRepresentation::Image,
+                  Image::MultiComponentBufferType::InterleavedImage,
+                  Image::FloatStorageType::Float32, progress, statsPool );
+}
+
+/// Read an affine transformation from a text file
+std::optional<glm::dmat4> readAffineTxFile( const std::string& fileName )
+{
+    glm::dmat4 affine_T_subject( 1.0 );
+
+    if ( ! serialize::openAffineTxFile( affine_T_subject, fileName ) )
+    {
+        return std::nullopt;
+    }
+
+    return affine_T_subject;
+}
+
 } // anonymous
 
 
 AntropyApp::AntropyApp()
     :
       m_imagesReady( false ),
+      m_exactStatsCancelled( false ),
       m_imageLoadFailed( false ),
 
       // GLFW creates the OpenGL contex
@@ -111,7 +194,12 @@ AntropyApp::AntropyApp()
 
       m_data(), // Requires OpenGL context
       m_rendering( m_data ), // Requires OpenGL context
-      m_callbackHandler( m_data, m_glfw, m_rendering ),
+      m_imageResidency( m_data, m_rendering, [this] () { m_glfw.postEmptyEvent(); } ),
+      m_segJournal( m_data ),
+      m_segHistory( m_data ),
+      m_cinePlayback( m_data ),
+      m_cineAnimating( false ),
+      m_callbackHandler( m_data, m_glfw, m_rendering, m_segJournal, m_segHistory ),
       m_imgui( m_glfw.window(), m_data, m_callbackHandler ) // Requires OpenGL context
 //      m_IPCHandler()
 {   
@@ -129,7 +217,30 @@ AntropyApp::AntropyApp()
 
 AntropyApp::~AntropyApp()
 {
-    m_futureLoadProject.wait();
+    // Do not wait for files that are still being read
+    cancelImageLoading();
+
+    if ( m_futureLoadProject.valid() )
+    {
+        m_futureLoadProject.wait();
+    }
+
+    // Skip the statistics that have not started and wait for those that are being computed
+    m_exactStatsCancelled = true;
+
+    for ( auto& futureStats : m_futureExactStats )
+    {
+        futureStats.wait();
+    }
+
+    // Finish saving segmentations, so that no temporary files are left behind
+    for ( auto& pendingSave : m_pendingSegSaves )
+    {
+        pendingSave.second.m_task.wait();
+    }
+
+    // All edits are either saved or deliberately left unsaved on a normal exit
+    m_segJournal.close();
 
 //    if ( m_IPCHandler.IsAttached() )
 //    {
@@ -138,6 +249,27 @@ AntropyApp::~AntropyApp()
 }
 
 
+bool AntropyApp::cancelImageLoading()
+{
+    bool cancelled = false;
+
+    if ( m_loadProgress && m_futureLoadProject.valid() &&
+         std::future_status::ready != m_futureLoadProject.wait_for( std::chrono::seconds( 0 ) ) )
+    {
+        m_loadProgress->cancel();
+        cancelled = true;
+    }
+
+    if ( m_imageReadProgress && ! m_pendingImages.empty() )
+    {
+        m_imageReadProgress->cancel();
+        cancelled = true;
+    }
+
+    return cancelled;
+}
+
+
 void AntropyApp::init()
 {
     spdlog::debug( "Begin initializing application" );
@@ -187,6 +319,7 @@ void AntropyApp::run()
         }
 
         m_rendering.initTextures();
+        replaySegJournal();
         m_rendering.updateImageUniforms( m_data.imageUidsOrdered() );
 
         spdlog::debug( "Textures and uniforms ready; rendering enabled" );
@@ -290,28 +423,54 @@ void AntropyApp::logPreamble()
 
 
 std::pair< std::optional<uuids::uuid>, bool >
-AntropyApp::loadImage( const std::string& fileName, bool ignoreIfAlreadyLoaded )
+AntropyApp::loadImage(
+        const std::string& fileName,
+        bool ignoreIfAlreadyLoaded,
+        Image::FloatStorageType floatStorage,
+        std::optional<Image> preloadedImage )
 {
-    if ( ignoreIfAlreadyLoaded )
+    // Has this image already been loaded? Search for its file name:
+    const Image* loadedImage = nullptr;
+
+    for ( const auto& imageUid : m_data.imageUidsOrdered() )
     {
-        // Has this image already been loaded? Search for its file name:
-        for ( const auto& imageUid : m_data.imageUidsOrdered() )
-        {
-            const Image* image = m_data.image( imageUid );
-            if ( ! image ) continue;
+        const Image* image = m_data.image( imageUid );
+        if ( ! image ) continue;
 
-            if ( image->header().fileName() == fileName )
+        if ( image->header().fileName() == fileName )
+        {
+            if ( ignoreIfAlreadyLoaded )
             {
                 spdlog::info( "Image {} has already been loaded as {}", fileName, imageUid );
                 return { imageUid, false };
             }
+
+            loadedImage = image;
+            break;
+        }
+    }
+
+    std::optional<Image> newImage = std::move( preloadedImage );
+
+    if ( ! newImage && loadedImage )
+    {
+        // Share the voxels of the image that was already loaded from this file instead of reading
+        // it again. The settings and transformations of the loaded image are not shared.
+        newImage = Image::shareVoxelsOf( *loadedImage, floatStorage );
+
+        if ( newImage )
+        {
+            spdlog::info( "Image {} has already been loaded, so its voxels are shared", fileName );
         }
     }
 
-    Image image( fileName, Image::ImageRepresentation::Image,
-                 Image::MultiComponentBufferType::SeparateImages );
+    if ( ! newImage )
+    {
+        newImage.emplace( readImageFile( fileName, floatStorage, nullptr, &statsWorkerPool() ) );
+        spdlog::info( "Read image from file {}", fileName );
+    }
 
-    spdlog::info( "Read image from file {}", fileName );
+    Image& image = *newImage;
 
     std::ostringstream ss;
     image.metaData( ss );
@@ -321,14 +480,616 @@ AntropyApp::loadImage( const std::string& fileName, bool ignoreIfAlreadyLoaded )
     spdlog::info( "Transformation:\n{}", image.transformations() );
     spdlog::info( "Settings:\n{}", image.settings() );
 
-    return { m_data.addImage( std::move(image) ), true };
+    const auto imageUid = m_data.addImage( std::move(image) );
+
+    if ( const Image* addedImage = m_data.image( imageUid ) )
+    {
+        computeExactStatisticsAsync( imageUid, *addedImage );
+    }
+
+    return { imageUid, true };
+}
+
+
+FileLoadProgress::SlabHandler AntropyApp::createLoadingPreviewSlabHandler()
+{
+    // Downsample by at least this factor along each axis
+    static constexpr uint32_t sk_minFactor = 4;
+
+    // Maximum number of voxels in the preview, so that it is updated in a few milliseconds
+    static constexpr size_t sk_maxNumVoxels = ( 1u << 22 );
+
+    // Minimum time between updates of the preview
+    static constexpr std::chrono::milliseconds sk_updateInterval( 100 );
+
+    struct PreviewState
+    {
+        std::optional<ImagePyramidBuilder> m_builder;
+        std::optional<std::chrono::steady_clock::time_point> m_lastUpdateTime;
+    };
+
+    auto state = std::make_shared<PreviewState>();
+
+    return [this, state] ( const ImageSlab& slab )
+    {
+        const glm::uvec3 dims{ slab.m_imageDims[0], slab.m_imageDims[1], slab.m_imageDims[2] };
+
+        // A file that is read again starts a new preview
+        if ( ! state->m_builder || 0 == slab.m_firstSlice )
+        {
+            const glm::vec3 spacing{ slab.m_imageSpacing[0], slab.m_imageSpacing[1], slab.m_imageSpacing[2] };
+            state->m_builder.emplace( dims, spacing, imagePyramidFactor( dims, sk_minFactor, sk_maxNumVoxels ) );
+            state->m_lastUpdateTime = std::nullopt;
+        }
+
+        if ( ! state->m_builder->addSlab( slab.m_componentType, slab.m_voxels, slab.m_firstSlice, slab.m_numSlices ) )
+        {
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+
+        // The first slabs are shown at once; later ones at most once per interval and when all are read
+        if ( state->m_lastUpdateTime && now - *state->m_lastUpdateTime < sk_updateInterval &&
+             state->m_builder->numSlicesAdded() < dims.z )
+        {
+            return;
+        }
+
+        state->m_lastUpdateTime = now;
+
+        const ImagePyramidLevel level = state->m_builder->level();
+
+        // Window the preview over the range of the values read so far, since the statistics and
+        // display settings of the image do not exist until it has been read
+        float minValue = std::numeric_limits<float>::max();
+        float maxValue = std::numeric_limits<float>::lowest();
+
+        for ( const float value : level.m_values )
+        {
+            if ( std::isfinite( value ) )
+            {
+                minValue = std::min( minValue, value );
+                maxValue = std::max( maxValue, value );
+            }
+        }
+
+        const double slope = ( maxValue > minValue ) ? 1.0 / ( static_cast<double>( maxValue ) - minValue ) : 1.0;
+
+        m_rendering.setLoadingPreview( level, { slope, -slope * minValue } );
+        m_glfw.postEmptyEvent(); // Wake the render thread to draw the preview
+    };
+}
+
+
+void AntropyApp::computeExactStatisticsAsync( const uuids::uuid& imageUid, const Image& image )
+{
+    if ( ! image.settings().hasProvisionalStatistics() )
+    {
+        return;
+    }
+
+    spdlog::debug( "Computing exact statistics of image {} in the background", imageUid );
+
+    ThreadPool& workers = statsWorkerPool();
+
+    // Images are never removed from the app data, and the voxels of an image with provisional
+    // statistics are never released (see Image::canReleaseVoxels), so the image can be read while
+    // the task runs
+    auto task = [this, imageUid, &image, &workers] ()
+    {
+        if ( m_exactStatsCancelled )
+        {
+            return;
+        }
+
+        auto stats = image.computeStatistics( &workers );
+
+        // Cache the exact statistics, so that they are not computed when the image is opened again
+        image.saveStatisticsToCache( stats );
+
+        {
+            std::lock_guard<std::mutex> lock( m_exactStatsMutex );
+            m_exactStats.emplace_back( imageUid, std::move( stats ) );
+        }
+
+        m_glfw.postEmptyEvent(); // Wake the render thread to apply the statistics
+    };
+
+    std::lock_guard<std::mutex> lock( m_exactStatsMutex );
+
+    // Images are computed one at a time, each with its pass split across the worker pool,
+    // so that the number of threads is bounded however many images are loaded
+    if ( ! m_exactStatsPool )
+    {
+        m_exactStatsPool = std::make_unique<ThreadPool>( 1 );
+    }
+
+    m_futureExactStats.emplace_back( m_exactStatsPool->submit( task ) );
+}
+
+
+ThreadPool& AntropyApp::statsWorkerPool()
+{
+    std::lock_guard<std::mutex> lock( m_exactStatsMutex );
+
+    if ( ! m_statsWorkerPool )
+    {
+        m_statsWorkerPool = std::make_unique<ThreadPool>();
+    }
+
+    return *m_statsWorkerPool;
+}
+
+
+void AntropyApp::applyExactStatistics()
+{
+    // Images are added to the app data on the project loading thread,
+    // so do not touch them until project loading is done
+    if ( m_futureLoadProject.valid() &&
+         std::future_status::ready != m_futureLoadProject.wait_for( std::chrono::seconds( 0 ) ) )
+    {
+        return;
+    }
+
+    std::vector< std::pair< uuids::uuid, std::vector< ComponentStats<double> > > > exactStats;
+
+    {
+        std::lock_guard<std::mutex> lock( m_exactStatsMutex );
+        exactStats.swap( m_exactStats );
+
+        // Drop the tasks that are done, reporting those that failed
+        auto it = std::begin( m_futureExactStats );
+
+        while ( std::end( m_futureExactStats ) != it )
+        {
+            if ( std::future_status::ready != it->wait_for( std::chrono::seconds( 0 ) ) )
+            {
+                ++it;
+                continue;
+            }
+
+            try
+            {
+                it->get();
+            }
+            catch ( const std::exception& e )
+            {
+                spdlog::error( "Exception computing exact image statistics: {}", e.what() );
+            }
+
+            it = m_futureExactStats.erase( it );
+        }
+    }
+
+    for ( auto& [imageUid, stats] : exactStats )
+    {
+        if ( Image* image = m_data.image( imageUid ) )
+        {
+            image->settings().setExactStatistics( std::move( stats ) );
+            m_rendering.updateImageUniforms( imageUid );
+        }
+        else if ( Image* def = m_data.def( imageUid ) )
+        {
+            def->settings().setExactStatistics( std::move( stats ) );
+        }
+        else
+        {
+            continue;
+        }
+
+        spdlog::debug( "Applied exact statistics of image {}", imageUid );
+    }
+}
+
+
+void AntropyApp::updateCinePlayback()
+{
+    if ( ! m_rendering.texturesInitialized() )
+    {
+        return;
+    }
+
+    if ( const std::optional<double> secondsToNextFrame = m_cinePlayback.update() )
+    {
+        // Wake the render loop when the next frame is due, even without events
+        m_glfw.setWaitTimeout( *secondsToNextFrame );
+        m_glfw.setEventProcessingMode( EventProcessingMode::WaitTimeout );
+        m_data.state().setAnimating( true );
+        m_cineAnimating = true;
+    }
+    else if ( m_cineAnimating )
+    {
+        m_glfw.setEventProcessingMode( EventProcessingMode::Wait );
+        m_data.state().setAnimating( false );
+        m_cineAnimating = false;
+    }
+}
+
+
+void AntropyApp::updateImageResidency()
+{
+    // Images are added to the app data on the project loading thread,
+    // so do not touch them until project loading is done
+    if ( m_futureLoadProject.valid() &&
+         std::future_status::ready != m_futureLoadProject.wait_for( std::chrono::seconds( 0 ) ) )
+    {
+        return;
+    }
+
+    if ( m_rendering.texturesInitialized() )
+    {
+        m_imageResidency.update();
+    }
+}
+
+
+bool AntropyApp::saveSegmentationAsync( const uuids::uuid& segUid, const std::string& fileName )
+{
+    const Image* seg = m_data.seg( segUid );
+
+    if ( ! seg )
+    {
+        spdlog::error( "Segmentation {} does not exist and cannot be saved", segUid );
+        return false;
+    }
+
+    if ( m_pendingSegSaves.count( segUid ) > 0 )
+    {
+        spdlog::warn( "Segmentation {} is already being saved to file {}",
+                      segUid, m_pendingSegSaves.at( segUid ).m_fileName );
+        return false;
+    }
+
+    // The snapshot shares the voxel buffers of the segmentation, which gets its own buffers
+    // if it is edited while the snapshot is saved. Editing a bricked segmentation copies only
+    // the bricks that are modified into the snapshot.
+    auto snapshot = std::make_shared<Image>( seg->snapshot() );
+
+    // The render thread is notified after the result is set, so that it is ready when the thread wakes
+    auto promise = std::make_shared< std::promise<bool> >();
+
+    PendingSegSave pendingSave;
+    pendingSave.m_fileName = fileName;
+    pendingSave.m_saved = promise->get_future();
+
+    pendingSave.m_task = std::async( std::launch::async, [this, snapshot, promise, fileName] ()
+    {
+        promise->set_value( snapshot->saveToDisk( fileName ) );
+        m_glfw.postEmptyEvent();
+    } );
+
+    m_pendingSegSaves.emplace( segUid, std::move( pendingSave ) );
+    m_segJournal.beginSave( segUid );
+    m_data.guiData().m_segSaveStatus[segUid] = "Saving...";
+
+    spdlog::info( "Saving segmentation {} to file {}", segUid, fileName );
+    return true;
+}
+
+
+void AntropyApp::applySavedSegmentations()
+{
+    for ( auto it = std::begin( m_pendingSegSaves ); it != std::end( m_pendingSegSaves ); )
+    {
+        auto& [segUid, pendingSave] = *it;
+
+        if ( std::future_status::ready != pendingSave.m_saved.wait_for( std::chrono::seconds( 0 ) ) )
+        {
+            ++it;
+            continue;
+        }
+
+        const bool saved = pendingSave.m_saved.get();
+
+        if ( saved )
+        {
+            spdlog::info( "Saved segmentation image to file {}", pendingSave.m_fileName );
+            m_data.guiData().m_segSaveStatus[segUid] = "Saved";
+
+            // The segmentation may have been removed while it was saved
+            if ( Image* seg = m_data.seg( segUid ) )
+            {
+                seg->header().setFileName( pendingSave.m_fileName );
+            }
+        }
+        else
+        {
+            spdlog::error( "Error saving segmentation image to file {}", pendingSave.m_fileName );
+            m_data.guiData().m_segSaveStatus[segUid] = "Save failed";
+        }
+
+        // Called after the file name is set, so that later edits are journaled under it
+        m_segJournal.endSave( segUid, saved );
+
+        it = m_pendingSegSaves.erase( it );
+    }
+}
+
+
+void AntropyApp::replaySegJournal()
+{
+    static constexpr uint32_t sk_comp0 = 0;
+
+    // Edits that cannot be replayed are returned to the journal, which keeps them for a later session
+    for ( SegJournal::RecoveredSeg& recovered : m_segJournal.takeRecoveredSegs() )
+    {
+        const SegJournal::SegKey& key = recovered.m_key;
+
+        std::optional<uuids::uuid> imageUid;
+
+        for ( const auto& uid : m_data.imageUidsOrdered() )
+        {
+            const Image* image = m_data.image( uid );
+            if ( image && image->header().fileName() == key.m_imageFileName )
+            {
+                imageUid = uid;
+                break;
+            }
+        }
+
+        if ( ! imageUid )
+        {
+            spdlog::warn( "Image {} of recovered segmentation '{}' is not in the project; "
+                          "its edits are kept in the journal", key.m_imageFileName, key.m_segDisplayName );
+            m_segJournal.keepUnreplayed( std::move( recovered ) );
+            continue;
+        }
+
+        // Segmentations with files are matched by file and blank ones are matched by display name
+        std::optional<uuids::uuid> segUid;
+
+        for ( const auto& uid : m_data.imageToSegUids( *imageUid ) )
+        {
+            const Image* seg = m_data.seg( uid );
+            if ( seg && seg->header().fileName() == key.m_segFileName &&
+                 ( ! key.m_segFileName.empty() || seg->settings().displayName() == key.m_segDisplayName ) )
+            {
+                segUid = uid;
+                break;
+            }
+        }
+
+        if ( ! segUid && ! key.m_segFileName.empty() )
+        {
+            const auto loaded = loadSegmentation( key.m_segFileName, *imageUid );
+            segUid = loaded.first;
+
+            if ( segUid && loaded.second )
+            {
+                const auto tableUid = data::createLabelColorTableForSegmentation( m_data, *segUid );
+
+                if ( ! tableUid || ! m_rendering.createLabelColorTableTexture( *tableUid ) ||
+                     ! m_data.assignSegUidToImage( *imageUid, *segUid ) ||
+                     ! m_rendering.createSegTexture( *segUid ) )
+                {
+                    spdlog::error( "Unable to add recovered segmentation {} to image {}", *segUid, *imageUid );
+                    m_data.removeSeg( *segUid );
+                    m_rendering.removeSegTexture( *segUid );
+                    segUid = std::nullopt;
+                }
+                else if ( Image* seg = m_data.seg( *segUid ) )
+                {
+                    seg->transformations().set_affine_T_subject(
+                                m_data.image( *imageUid )->transformations().get_affine_T_subject() );
+                }
+            }
+        }
+        else if ( ! segUid )
+        {
+            segUid = createBlankSegWithColorTable( *imageUid, key.m_segDisplayName );
+        }
+
+        Image* seg = segUid ? m_data.seg( *segUid ) : nullptr;
+
+        if ( ! seg )
+        {
+            spdlog::error( "Unable to recover edits of segmentation '{}' of image {}; they are kept in the journal",
+                           key.m_segDisplayName, key.m_imageFileName );
+            m_segJournal.keepUnreplayed( std::move( recovered ) );
+            continue;
+        }
+
+        const ComponentType compType = seg->header().memoryComponentType();
+
+        if ( seg->header().pixelDimensions() != recovered.m_dims || compType != recovered.m_componentType )
+        {
+            spdlog::error( "Segmentation {} no longer matches its journaled edits, which are kept in the journal",
+                           *segUid );
+            m_segJournal.keepUnreplayed( std::move( recovered ) );
+            continue;
+        }
+
+        size_t numBricksRecovered = 0;
+
+        for ( const SegJournal::Brick& brick : recovered.m_bricks )
+        {
+            std::vector<char> voxels( static_cast<size_t>( brick.m_size.x ) * brick.m_size.y * brick.m_size.z *
+                                      seg->header().memoryComponentSizeInBytes() );
+
+            if ( ! inflateBuffer( brick.m_compressedVoxels.data(), brick.m_compressedVoxels.size(),
+                                  voxels.data(), voxels.size() ) )
+            {
+                spdlog::error( "Corrupt journaled brick at {} of segmentation {}", glm::to_string( brick.m_offset ), *segUid );
+                continue;
+            }
+
+            const bool written = seg->visitBlock( sk_comp0, brick.m_offset, brick.m_size, [&voxels] ( const auto& view )
+            {
+                using T = typename std::decay_t<decltype( view )>::ValueType;
+
+                const T* source = reinterpret_cast<const T*>( voxels.data() );
+
+                view.forEachVoxel( [&source] ( T& value, uint32_t, uint32_t, uint32_t )
+                {
+                    value = *source++;
+                } );
+            } );
+
+            if ( written )
+            {
+                m_rendering.updateSegTexture( *segUid, compType, brick.m_offset, brick.m_size,
+                                              static_cast<const void*>( voxels.data() ) );
+                ++numBricksRecovered;
+            }
+        }
+
+        // Later edits are journaled under the same key, so that they supersede the recovered ones
+        m_segJournal.setKey( *segUid, key );
+
+        spdlog::info( "Recovered {} edited brick(s) of segmentation {} ('{}') from the journal",
+                      numBricksRecovered, *segUid, key.m_segDisplayName );
+    }
+}
+
+
+void AntropyApp::loadImagesAsync( const std::vector<std::string>& fileNames )
+{
+    if ( fileNames.empty() )
+    {
+        return;
+    }
+
+    if ( ! m_imageReadPool )
+    {
+        m_imageReadPool = std::make_unique<ThreadPool>();
+    }
+
+    // Start tracking progress anew once all earlier requests are done or have been cancelled
+    if ( m_pendingImages.empty() || ! m_imageReadProgress || m_imageReadProgress->isCancelled() )
+    {
+        m_imageReadProgress = std::make_shared<LoadProgress>();
+    }
+
+    std::vector<serialize::Image> serializedImages( fileNames.size() );
+    std::vector< const serialize::Image* > serializedImagePtrs;
+
+    for ( size_t i = 0; i < fileNames.size(); ++i )
+    {
+        serializedImages[i].m_imageFileName = fileNames[i];
+        serializedImagePtrs.push_back( &serializedImages[i] );
+    }
+
+    // The files are read concurrently, a few images ahead of the one being added. Their images are
+    // added in applyLoadedImages.
+    std::vector<PendingImageFiles> pendingFiles = planImageFileReads( serializedImagePtrs, m_imageReadProgress, &statsWorkerPool() );
+
+    for ( size_t i = 0; i < fileNames.size(); ++i )
+    {
+        m_pendingImages.push_back( PendingImage{ std::move( serializedImages[i] ), std::move( pendingFiles[i] ) } );
+    }
+
+    submitPendingImageReads();
+
+    spdlog::debug( "Reading {} image file(s) with {} threads", fileNames.size(), m_imageReadPool->numThreads() );
+
+    // Render continuously until all images have been added, so that they are added as soon as they are read
+    m_glfw.setEventProcessingMode( EventProcessingMode::Poll );
+}
+
+
+void AntropyApp::applyLoadedImages()
+{
+    if ( m_pendingImages.empty() )
+    {
+        return;
+    }
+
+    // Images are added to the app data on the project loading thread,
+    // so do not touch them until project loading is done
+    if ( m_futureLoadProject.valid() &&
+         std::future_status::ready != m_futureLoadProject.wait_for( std::chrono::seconds( 0 ) ) )
+    {
+        return;
+    }
+
+    // Add the images in request order, so that image indices do not depend on the order in which
+    // the reads complete and so that a file requested twice shares the voxels of its first image
+    while ( ! m_pendingImages.empty() )
+    {
+        submitPendingImageReads();
+
+        PendingImage& pending = m_pendingImages.front();
+
+        if ( pending.m_files.m_image.valid() &&
+             std::future_status::ready != pending.m_files.m_image.wait_for( std::chrono::seconds( 0 ) ) )
+        {
+            break;
+        }
+
+        const std::string& fileName = pending.m_serializedImage.m_imageFileName;
+        const size_t numImages = m_data.numImages();
+
+        if ( loadSerializedImage( pending.m_serializedImage, &pending.m_files ) &&
+             m_data.numImages() > numImages )
+        {
+            if ( const auto imageUid = m_data.imageUid( m_data.numImages() - 1 ) )
+            {
+                createTexturesForAddedImage( *imageUid );
+            }
+        }
+        else if ( m_imageReadProgress && m_imageReadProgress->isCancelled() )
+        {
+            spdlog::info( "Loading image {} was cancelled", fileName );
+        }
+        else
+        {
+            spdlog::error( "Could not load image {}", fileName );
+        }
+
+        m_pendingImages.pop_front();
+    }
+
+    if ( m_pendingImages.empty() )
+    {
+        m_imageReadProgress->logStageTimes();
+
+        m_rendering.updateImageUniforms( m_data.imageUidsOrdered() );
+        m_data.windowData().updateImageOrdering( m_data.imageUidsOrdered() );
+        m_glfw.setWindowTitleStatus( m_data.getAllImageDisplayNames() );
+
+        // Go back to rendering only on events
+        m_glfw.setEventProcessingMode( EventProcessingMode::Wait );
+    }
+}
+
+
+void AntropyApp::submitPendingImageReads()
+{
+    const size_t numImages = std::min( sk_maxImagesReadAhead, m_pendingImages.size() );
+
+    for ( size_t i = 0; i < numImages; ++i )
+    {
+        submitImageFileReads( m_pendingImages[i].m_files, *m_imageReadPool );
+    }
+}
+
+
+void AntropyApp::createTexturesForAddedImage( const uuids::uuid& imageUid )
+{
+    if ( ! m_rendering.createImageTextures( imageUid ) )
+    {
+        spdlog::error( "Unable to create textures for image {}", imageUid );
+    }
+
+    // Textures of tables and segmentations that already exist are not created again
+    for ( const auto& tableUid : m_data.labelTableUidsOrdered() )
+    {
+        m_rendering.createLabelColorTableTexture( tableUid );
+    }
+
+    for ( const auto& segUid : m_data.imageToSegUids( imageUid ) )
+    {
+        m_rendering.createSegTexture( segUid );
+    }
 }
 
 
 std::pair< std::optional<uuids::uuid>, bool >
 AntropyApp::loadSegmentation(
         const std::string& fileName,
-        const std::optional<uuids::uuid>& matchingImageUid )
+        const std::optional<uuids::uuid>& matchingImageUid,
+        std::optional<Image> preloadedSeg )
 {
     static constexpr float EPS = glm::epsilon<float>();
 
@@ -348,11 +1109,7 @@ AntropyApp::loadSegmentation(
         }
     }
 
-    // Creating an image as a segmentation will convert the pixel components to the most
-    // suitable unsigned integer type
-    Image seg( fileName,
-               Image::ImageRepresentation::Segmentation,
-               Image::MultiComponentBufferType::SeparateImages );
+    Image seg = ( preloadedSeg ) ? std::move( *preloadedSeg ) : readSegmentationFile( fileName, nullptr, &statsWorkerPool() );
 
     // Set the default opacity:
     seg.settings().setOpacity( 0.5 );
@@ -453,7 +1210,9 @@ AntropyApp::loadSegmentation(
 
 
 std::pair< std::optional<uuids::uuid>, bool >
-AntropyApp::loadDeformationField( const std::string& fileName )
+AntropyApp::loadDeformationField(
+        const std::string& fileName,
+        std::optional<Image> preloadedDef )
 {
     // Return value indicating that deformation field was not loaded:
     static const std::pair< std::optional<uuids::uuid>, bool >
@@ -473,9 +1232,7 @@ AntropyApp::loadDeformationField( const std::string& fileName )
         }
     }
 
-    // Components of a deformation field image are loaded as interleaved images
-    Image def( fileName, Image::ImageRepresentation::Image,
-               Image::MultiComponentBufferType::InterleavedImage );
+    Image def = ( preloadedDef ) ? std::move( *preloadedDef ) : readDeformationFieldFile( fileName, nullptr, &statsWorkerPool() );
 
     spdlog::info( "Read deformation field image from file {}", fileName );
 
@@ -500,6 +1257,12 @@ AntropyApp::loadDeformationField( const std::string& fileName )
     {
         spdlog::info( "Loaded deformation field image from file {} as {}",
                       fileName, *defUid );
+
+        if ( const Image* addedDef = m_data.def( *defUid ) )
+        {
+            computeExactStatisticsAsync( *defUid, *addedDef );
+        }
+
         return { *defUid, true };
     }
 
@@ -635,6 +1398,106 @@ std::optional<uuids::uuid> AntropyApp::createBlankSegWithColorTable(
 
 
 bool AntropyApp::loadSerializedImage( const serialize::Image& serializedImage )
+{
+    return loadSerializedImage( serializedImage, nullptr );
+}
+
+
+std::vector<AntropyApp::PendingImageFiles> AntropyApp::planImageFileReads(
+        const std::vector< const serialize::Image* >& serializedImages,
+        const std::shared_ptr<LoadProgress>& progress,
+        ThreadPool* statsPool,
+        FileLoadProgress::SlabHandler referenceSlabHandler )
+{
+    // Register a file with the load progress and get the handle with which its reader reports
+    auto fileProgress = [&progress] ( const std::string& fileName, FileLoadProgress::SlabHandler slabHandler = nullptr )
+    {
+        return FileLoadProgress( progress, progress->addFile( fileName ), std::move( slabHandler ) );
+    };
+
+    std::vector<PendingImageFiles> allPendingFiles( serializedImages.size() );
+
+    // Image, segmentation, and deformation files that have been planned for reading
+    std::unordered_set<std::string> imageFileNames;
+    std::unordered_set<std::string> segFileNames;
+    std::unordered_set<std::string> defFileNames;
+
+    // Plan in project order, so that the reference image is read first
+    for ( size_t i = 0; i < serializedImages.size(); ++i )
+    {
+        if ( ! serializedImages[i] ) continue;
+
+        const serialize::Image& serializedImage = *serializedImages[i];
+        PendingImageFiles& pendingFiles = allPendingFiles[i];
+
+        // An image file that is referenced more than once is read only once. The later references
+        // share the voxels of the first one when they are loaded.
+        if ( imageFileNames.insert( serializedImage.m_imageFileName ).second )
+        {
+            pendingFiles.m_image = deferRead(
+                        [fileName = serializedImage.m_imageFileName, statsPool,
+                         floatStorage = floatStorageType( serializedImage ),
+                         fp = fileProgress( serializedImage.m_imageFileName,
+                                            ( 0 == i ) ? std::move( referenceSlabHandler ) : nullptr )] ()
+            {
+                return readImageFile( fileName, floatStorage, &fp, statsPool );
+            }, pendingFiles.m_deferredReads );
+        }
+
+        if ( serializedImage.m_affineTxFileName )
+        {
+            pendingFiles.m_affine_T_subject = deferRead(
+                        [fileName = *serializedImage.m_affineTxFileName] () { return readAffineTxFile( fileName ); },
+                        pendingFiles.m_deferredReads );
+        }
+
+        if ( serializedImage.m_deformationFileName &&
+             defFileNames.insert( *serializedImage.m_deformationFileName ).second )
+        {
+            pendingFiles.m_deformation = deferRead(
+                        [fileName = *serializedImage.m_deformationFileName, statsPool,
+                         fp = fileProgress( *serializedImage.m_deformationFileName )] ()
+            {
+                return readDeformationFieldFile( fileName, &fp, statsPool );
+            }, pendingFiles.m_deferredReads );
+        }
+
+        pendingFiles.m_segs.resize( serializedImage.m_segmentations.size() );
+
+        for ( size_t s = 0; s < serializedImage.m_segmentations.size(); ++s )
+        {
+            const std::string& segFileName = serializedImage.m_segmentations[s].m_segFileName;
+
+            if ( segFileNames.insert( segFileName ).second )
+            {
+                pendingFiles.m_segs[s] = deferRead(
+                            [fileName = segFileName, statsPool, fp = fileProgress( segFileName )] ()
+                {
+                    return readSegmentationFile( fileName, &fp, statsPool );
+                }, pendingFiles.m_deferredReads );
+            }
+        }
+    }
+
+    return allPendingFiles;
+}
+
+
+void AntropyApp::submitImageFileReads( PendingImageFiles& pendingFiles, ThreadPool& pool )
+{
+    // The results and exceptions of the reads are held by their packaged tasks
+    for ( auto& read : pendingFiles.m_deferredReads )
+    {
+        pool.submit( std::move( read ) );
+    }
+
+    pendingFiles.m_deferredReads.clear();
+}
+
+
+bool AntropyApp::loadSerializedImage(
+        const serialize::Image& serializedImage,
+        PendingImageFiles* pendingFiles )
 {
     constexpr size_t sk_defaultImageColorMapIndex = 0;
 
@@ -650,8 +1513,18 @@ bool AntropyApp::loadSerializedImage( const serialize::Image& serializedImage )
     {
         spdlog::debug( "Attempting to load image from {}", serializedImage.m_imageFileName );
 
+        std::optional<Image> preloadedImage;
+
+        if ( pendingFiles && pendingFiles->m_image.valid() )
+        {
+            // Wait for the worker thread to finish reading the image.
+            // This rethrows any exception that occurred while reading.
+            preloadedImage.emplace( pendingFiles->m_image.get() );
+        }
+
         std::tie( imageUid, isNewImage ) = loadImage(
-                    serializedImage.m_imageFileName, k_ignoreImageIfAlreadyLoaded );
+                    serializedImage.m_imageFileName, k_ignoreImageIfAlreadyLoaded,
+                    floatStorageType( serializedImage ), std::move( preloadedImage ) );
     }
     catch ( const std::exception& e )
     {
@@ -697,9 +1570,12 @@ bool AntropyApp::loadSerializedImage( const serialize::Image& serializedImage )
     // Load and set affine transformation from file:
     if ( serializedImage.m_affineTxFileName )
     {
-        glm::dmat4 affine_T_subject( 1.0 );
+        const std::optional<glm::dmat4> affine_T_subject =
+                ( pendingFiles && pendingFiles->m_affine_T_subject.valid() )
+                ? pendingFiles->m_affine_T_subject.get()
+                : readAffineTxFile( *serializedImage.m_affineTxFileName );
 
-        if ( ! serialize::openAffineTxFile( affine_T_subject, *serializedImage.m_affineTxFileName ) )
+        if ( ! affine_T_subject )
         {
             image->transformations().set_affine_T_subject_fileName( std::nullopt );
 
@@ -708,7 +1584,8 @@ bool AntropyApp::loadSerializedImage( const serialize::Image& serializedImage )
         }
 
         image->transformations().set_affine_T_subject_fileName( serializedImage.m_affineTxFileName );
-        image->transformations().set_affine_T_subject( glm::mat4{ affine_T_subject } );
+        image->transformations().set_affine_T_subject(
+                    glm::mat4{ affine_T_subject.value_or( glm::dmat4{ 1.0 } ) } );
     }
     else
     {
@@ -728,8 +1605,16 @@ bool AntropyApp::loadSerializedImage( const serialize::Image& serializedImage )
             spdlog::debug( "Attempting to load deformation field image from {}",
                            *serializedImage.m_deformationFileName );
 
+            std::optional<Image> preloadedDef;
+
+            if ( pendingFiles && pendingFiles->m_deformation.valid() )
+            {
+                preloadedDef.emplace( pendingFiles->m_deformation.get() );
+            }
+
             std::tie( deformationUid, isDeformationNewImage ) =
-                    loadDeformationField( *serializedImage.m_deformationFileName );
+                    loadDeformationField( *serializedImage.m_deformationFileName,
+                                          std::move( preloadedDef ) );
         }
         catch ( const std::exception& e )
         {
@@ -914,8 +1799,9 @@ bool AntropyApp::loadSerializedImage( const serialize::Image& serializedImage )
     // Holds info about all segmentations being loaded:
     std::vector< SegInfo > allSegInfos;
 
-    for ( const auto& serializedSeg : serializedImage.m_segmentations )
+    for ( size_t s = 0; s < serializedImage.m_segmentations.size(); ++s )
     {
+        const auto& serializedSeg = serializedImage.m_segmentations[s];
         SegInfo segInfo;
 
         try
@@ -923,8 +1809,15 @@ bool AntropyApp::loadSerializedImage( const serialize::Image& serializedImage )
             spdlog::debug( "Attempting to load segmentation image from {}",
                            serializedSeg.m_segFileName );
 
+            std::optional<Image> preloadedSeg;
+
+            if ( pendingFiles && s < pendingFiles->m_segs.size() && pendingFiles->m_segs[s].valid() )
+            {
+                preloadedSeg.emplace( pendingFiles->m_segs[s].get() );
+            }
+
             std::tie( segInfo.uid, segInfo.isNewSeg ) =
-                    loadSegmentation( serializedSeg.m_segFileName, *imageUid );
+                    loadSegmentation( serializedSeg.m_segFileName, *imageUid, std::move( preloadedSeg ) );
         }
         catch ( const std::exception& e )
         {
@@ -1060,10 +1953,25 @@ void AntropyApp::loadImagesFromParams( const InputParams& params )
 {
     spdlog::debug( "Begin loading images from parameters" );
 
+    // By default, the voxels of images may use half of the physical memory and textures are unlimited
+    static constexpr uint64_t sk_bytesPerMiB = 1024 * 1024;
+    const std::optional<size_t> physicalMemorySize = physicalMemorySizeInBytes();
+
+    m_imageResidency.setBudgets(
+                params.imageRamBudgetMiB ? *params.imageRamBudgetMiB * sk_bytesPerMiB
+                                         : ( physicalMemorySize ? *physicalMemorySize / 2 : 0 ),
+                params.imageVramBudgetMiB ? *params.imageVramBudgetMiB * sk_bytesPerMiB : 0 );
+
+    if ( params.segUndoBudgetMiB )
+    {
+        m_segHistory.setBudget( *params.segUndoBudgetMiB * sk_bytesPerMiB );
+    }
+
     // The image loader function is called from a new thread
     auto projectLoader = [this]
             ( const serialize::AntropyProject& project,
-              const std::function< void( bool projectLoadedSuccessfully ) >& onProjectLoadingDone )
+              const std::function< void( bool projectLoadedSuccessfully ) >& onProjectLoadingDone,
+              std::shared_ptr<LoadProgress> progress )
     {
         static constexpr size_t sk_defaultReferenceImageIndex = 0;
         static constexpr size_t sk_defaultActiveImageIndex = 1;
@@ -1074,22 +1982,84 @@ void AntropyApp::loadImagesFromParams( const InputParams& params )
 
         spdlog::debug( "Begin loading images" );
 
-        if ( ! loadSerializedImage( project.m_referenceImage ) )
+        // The reference image is at index 0, followed by the additional images:
+        std::vector< const serialize::Image* > serializedImages{ &project.m_referenceImage };
+        size_t numFiles = 0;
+
+        for ( const auto& additionalImage : project.m_additionalImages )
         {
-            spdlog::critical( "Could not load reference image {}",
-                              project.m_referenceImage.m_imageFileName );
-            onProjectLoadingDone( false );
+            serializedImages.push_back( &additionalImage );
         }
 
-        for ( const auto& additionalImage : project.m_additionalImages )
+        for ( const serialize::Image* serializedImage : serializedImages )
+        {
+            numFiles += 1 + serializedImage->m_segmentations.size() +
+                    ( serializedImage->m_affineTxFileName ? 1 : 0 ) +
+                    ( serializedImage->m_deformationFileName ? 1 : 0 );
+        }
+
+        // Read files concurrently on a bounded pool of worker threads. The images are added
+        // to the app data on this thread in project order as soon as each one has been read,
+        // so that image indices do not depend on the order in which the reads complete.
+        // Only the files of a few images are read ahead of the image being added, so that images
+        // that have been read but not yet added do not exceed the memory budget.
+        ThreadPool pool( ThreadPool::defaultNumThreads( numFiles ) );
+        std::vector<PendingImageFiles> pendingFiles = planImageFileReads(
+                    serializedImages, progress, &statsWorkerPool(), createLoadingPreviewSlabHandler() );
+
+        for ( size_t i = 0; i < std::min( sk_maxImagesReadAhead, pendingFiles.size() ); ++i )
+        {
+            submitImageFileReads( pendingFiles[i], pool );
+        }
+
+        spdlog::debug( "Reading {} files with {} threads", numFiles, pool.numThreads() );
+
+        for ( size_t i = 0; i < serializedImages.size(); ++i )
         {
-            if ( ! loadSerializedImage( additionalImage ) )
+            const bool loaded = loadSerializedImage( *serializedImages[i], &pendingFiles[i] );
+
+            // This image is done with its files, so start reading the files of one more image
+            if ( i + sk_maxImagesReadAhead < pendingFiles.size() )
+            {
+                submitImageFileReads( pendingFiles[i + sk_maxImagesReadAhead], pool );
+            }
+
+            if ( loaded )
+            {
+                // Keep the voxels of loaded images within the memory budget. Later images are
+                // released first, so that the reference and active images stay resident.
+                m_imageResidency.releaseVoxelsOverBudget();
+                continue;
+            }
+
+            if ( progress->isCancelled() )
+            {
+                // Reads that have not started yet throw as soon as they start, so the pool drains quickly
+                spdlog::warn( "Loading images was cancelled" );
+                onProjectLoadingDone( false );
+                return;
+            }
+
+            if ( 0 == i )
+            {
+                spdlog::critical( "Could not load reference image {}",
+                                  serializedImages[i]->m_imageFileName );
+
+                // Reads that were submitted but have not started throw as soon as they start,
+                // so that the pool drains quickly. Reads that were not submitted are dropped.
+                progress->cancel();
+                onProjectLoadingDone( false );
+                return;
+            }
+            else
             {
                 spdlog::error( "Could not load additional image {}; skipping it",
-                               additionalImage.m_imageFileName );
+                               serializedImages[i]->m_imageFileName );
             }
         }
 
+        progress->logStageTimes();
+
         const auto refImageUid = m_data.imageUid( sk_defaultReferenceImageIndex );
         if ( refImageUid && m_data.setRefImageUid( *refImageUid ) )
         {           
@@ -1097,8 +2067,9 @@ void AntropyApp::loadImagesFromParams( const InputParams& params )
         }
         else
         {
-            spdlog::critical( "Unable to set {} as the reference image", *refImageUid );
+            spdlog::critical( "Unable to set the reference image" );
             onProjectLoadingDone( false );
+            return;
         }
 
         const auto desiredActiveImageUid =
@@ -1137,9 +2108,10 @@ void AntropyApp::loadImagesFromParams( const InputParams& params )
         }
         else
         {
+            // The render loop exits when it sees that loading failed
             spdlog::critical( "Failed to load images" );
-            m_imagesReady = true;
-            m_imageLoadFailed = false;
+            m_imageLoadFailed = true;
+            m_glfw.postEmptyEvent();
         }
     };
 
@@ -1148,9 +2120,23 @@ void AntropyApp::loadImagesFromParams( const InputParams& params )
     // Create a project to be loaded in from the input parameters
     m_data.setProject( createProjectFromInputParams( params ) );
 
+    // Edits of segmentations are journaled next to the reference image or project file, where they
+    // are recovered from if the application did not exit normally
+    const std::string segJournalFileName =
+            ( params.imageFiles.empty() ? *params.projectFile : params.imageFiles.front().first ) + ".segjournal";
+
+    if ( ! m_segJournal.open( segJournalFileName ) )
+    {
+        spdlog::warn( "Segmentation edits will not be recoverable after a crash" );
+    }
+
+    // Progress is shown in the loading overlay, from which loading can be cancelled
+    m_loadProgress = std::make_shared<LoadProgress>();
+    m_rendering.setLoadProgress( m_loadProgress );
+
     m_futureLoadProject = std::async(
                 std::launch::async, projectLoader,
-                m_data.project(), onProjectLoadingDone );
+                m_data.project(), onProjectLoadingDone, m_loadProgress );
 
     spdlog::debug( "Done loading images from parameters" );
 }
@@ -1159,7 +2145,7 @@ void AntropyApp::loadImagesFromParams( const InputParams& params )
 void AntropyApp::setCallbacks()
 {
     m_glfw.setCallbacks(
-                [this](){ m_rendering.render(); },
+                [this](){ applyExactStatistics(); applyLoadedImages(); applySavedSegmentations(); updateImageResidency(); updateCinePlayback(); m_callbackHandler.flushSegStrokes(); m_segJournal.update(); m_rendering.render(); },
                 [this](){ m_imgui.render(); } );
 
     m_imgui.setCallbacks(
@@ -1255,7 +2241,8 @@ void AntropyApp::setCallbacks()
                      data::getImageVoxelCoordsAtCrosshairs( m_data, imageIndex ) )
                 {
                     const uint32_t activeComp = image->settings().activeComponent();
-                    return image->valueAsDouble( activeComp, coords->x, coords->y, coords->z );
+                    const uint32_t activeFrame = image->settings().activeFrame();
+                    return image->valueAsDouble( activeComp, coords->x, coords->y, coords->z, activeFrame );
                 }
 
                 return std::nullopt;
@@ -1294,11 +2281,18 @@ void AntropyApp::setCallbacks()
             [this] ( const uuids::uuid& segUid ) -> bool
             {
                 bool success = false;
+                m_segJournal.forget( segUid );
+                m_segHistory.forget( segUid );
                 success |= m_data.removeSeg( segUid );
                 success |= m_rendering.removeSegTexture( segUid );
                 return success;
             },
 
+            [this] ( const uuids::uuid& segUid, const std::string& fileName ) -> bool
+            {
+                return saveSegmentationAsync( segUid, fileName );
+            },
+
             [this] ( const uuids::uuid& imageUid, const uuids::uuid& seedSegUid, const uuids::uuid& resultSegUid ) -> bool
             {
                 return m_callbackHandler.executeGridCutSegmentation( imageUid, seedSegUid, resultSegUid );
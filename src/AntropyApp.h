@@ -2,10 +2,16 @@
 #define ANTROPY_APP_H
 
 #include "common/InputParams.h"
+#include "common/LoadProgress.h"
+#include "common/ThreadPool.h"
 #include "common/Types.h"
 
 #include "logic/app/CallbackHandler.h"
+#include "logic/app/CinePlayback.h"
 #include "logic/app/Data.h"
+#include "logic/app/ImageResidency.h"
+#include "logic/app/SegHistory.h"
+#include "logic/app/SegJournal.h"
 #include "logic/app/Settings.h"
 #include "logic/app/State.h"
 
@@ -14,14 +20,21 @@
 
 #include "windowing/GlfwWrapper.h"
 
+#include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 
 #include <uuid.h>
 
 #include <atomic>
+#include <deque>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 struct GLFWcursor;
 
@@ -57,21 +70,36 @@ public:
     /// Asynchronously load images and notify render loop when done
     void loadImagesFromParams( const InputParams& );
 
+    /// Cancel loading of images. Files that are being read are abandoned at their next
+    /// cancellation check. If the project was being loaded, then the render loop exits
+    /// once loading has stopped.
+    /// @return True iff images were being loaded
+    bool cancelImageLoading();
+
+    /// Read image files on worker threads, so that the UI stays responsive. Once each file has
+    /// been read, its image is added to the project and its textures are created on the render thread.
+    /// @note This must be called on the render thread
+    void loadImagesAsync( const std::vector<std::string>& fileNames );
+
     bool loadSerializedImage( const serialize::Image& );
 
     /// Load a segmentation from disk. If its header does not match the given image, then it is not loaded
+    /// @param[in] preloadedSeg Segmentation already read from the file, if any
     /// @return Uid and flag if loaded.
     /// False indcates that it was already loaded and that we are returning an existing image.
     std::pair< std::optional<uuids::uuid>, bool >
     loadSegmentation( const std::string& fileName,
-                      const std::optional<uuids::uuid>& imageUid = std::nullopt );
+                      const std::optional<uuids::uuid>& imageUid = std::nullopt,
+                      std::optional<Image> preloadedSeg = std::nullopt );
 
     /// Load a deformation field from disk.
     /// @todo If its header does not match the given image, then it is not loaded
+    /// @param[in] preloadedDef Deformation field already read from the file, if any
     /// @return Uid and flag if loaded.
     /// False indcates that it was already loaded and that we are returning an existing image.
     std::pair< std::optional<uuids::uuid>, bool >
-    loadDeformationField( const std::string& fileName );
+    loadDeformationField( const std::string& fileName,
+                          std::optional<Image> preloadedDef = std::nullopt );
 
 
     CallbackHandler& callbackHandler();
@@ -106,11 +134,111 @@ private:
 
     void setCallbacks();
 
-    /// Load an image from disk.
+    /// Files of a serialized image that are being read from disk on worker threads.
+    /// A future that is not valid indicates a file that is read when the image is loaded.
+    struct PendingImageFiles
+    {
+        std::future<Image> m_image;
+        std::future< std::optional<glm::dmat4> > m_affine_T_subject;
+        std::future<Image> m_deformation;
+        std::vector< std::future<Image> > m_segs; //!< One per serialized segmentation
+
+        /// Reads of the files above that have not been submitted to a thread pool yet.
+        /// They must be submitted before any of the futures is waited on.
+        std::vector< std::function<void()> > m_deferredReads;
+    };
+
+    /// Plan reads of the image, segmentation, deformation, and affine files of serialized images.
+    /// An image, segmentation, or deformation file that is referenced more than once is read only
+    /// for its first reference. Each file is added to the load progress. The reads are deferred
+    /// until submitted with submitImageFileReads, so that only the files of a few images are read
+    /// (and held in memory) ahead of the image that is being added.
+    /// The statistics passes of the reads are split across statsPool, which must not be the pool
+    /// that the reads are submitted to. The slabs of the first image file are passed to
+    /// referenceSlabHandler, if it is not null.
+    static std::vector<PendingImageFiles> planImageFileReads(
+            const std::vector< const serialize::Image* >& serializedImages,
+            const std::shared_ptr<LoadProgress>& progress,
+            ThreadPool* statsPool,
+            FileLoadProgress::SlabHandler referenceSlabHandler = nullptr );
+
+    /// Submit the deferred reads of the files of an image to a thread pool, if not yet submitted
+    static void submitImageFileReads( PendingImageFiles& pendingFiles, ThreadPool& pool );
+
+    /// Submit the reads of the first images requested by loadImagesAsync that are pending
+    void submitPendingImageReads();
+
+    /// Load a serialized image, using files that are being read by worker threads if provided
+    bool loadSerializedImage( const serialize::Image&, PendingImageFiles* pendingFiles );
+
+    /// Image that was requested by loadImagesAsync and whose files are being read
+    struct PendingImage
+    {
+        serialize::Image m_serializedImage;
+        PendingImageFiles m_files;
+    };
+
+    /// Add images that have been read since the last frame by loadImagesAsync to the project and
+    /// create their textures. This is called on the render thread before each frame.
+    void applyLoadedImages();
+
+    /// Create the textures of an image that was added to the project after the textures were
+    /// initialized, along with the textures of its segmentations and of new label color tables
+    void createTexturesForAddedImage( const uuids::uuid& imageUid );
+
+    /// Load an image from disk. If an image from the same file is already loaded and is not
+    /// ignored, then the new image is a copy that shares its voxel buffers.
+    /// @param[in] floatStorage How to hold the values of a floating-point image read from the file
+    /// @param[in] preloadedImage Image already read from the file, if any
     /// @return Uid and flag if loaded.
     /// False indcates that it was already loaded and that we are returning an existing image.
     std::pair< std::optional<uuids::uuid>, bool >
-    loadImage( const std::string& fileName, bool ignoreIfAlreadyLoaded );
+    loadImage( const std::string& fileName, bool ignoreIfAlreadyLoaded,
+               Image::FloatStorageType floatStorage,
+               std::optional<Image> preloadedImage = std::nullopt );
+
+    /// If an image or deformation field was loaded with provisional statistics, then start computing
+    /// its exact statistics on a worker thread. The render thread is notified when they are done.
+    void computeExactStatisticsAsync( const uuids::uuid& imageUid, const Image& image );
+
+    /// Get the worker pool across which statistics passes are split, creating it when first needed.
+    /// It is shared by the exact statistics tasks and the file reads, so that concurrent passes do
+    /// not oversubscribe the CPU.
+    ThreadPool& statsWorkerPool();
+
+    /// Create a handler of the slabs of the reference image as they are read, which shows a
+    /// downsampled preview of the slabs read so far in the loading overlay. Image data are then
+    /// visible early in the load of a large image, rather than only once it has been read.
+    /// The handler is called on the thread that reads the reference image.
+    FileLoadProgress::SlabHandler createLoadingPreviewSlabHandler();
+
+    /// Swap exact statistics that have been computed on worker threads into the settings of their
+    /// images and update the image uniforms. This is called on the render thread before each frame.
+    void applyExactStatistics();
+
+    /// Make the images used in the current frame resident and evict least-recently-used images
+    /// that exceed the memory budgets. This is called on the render thread before each frame.
+    void updateImageResidency();
+
+    /// Advance cine playback of time series images. While any image plays, events are processed
+    /// with a timeout, so that frames are rendered when they are due.
+    void updateCinePlayback();
+
+    /// Save a segmentation to disk on a worker thread, so that the UI stays responsive. A snapshot of
+    /// the segmentation that shares its voxel buffers is saved, so the segmentation can be edited while
+    /// it is saved. The save status is shown in the UI.
+    /// @return True iff the save was started; false if the segmentation does not exist or is
+    /// already being saved
+    bool saveSegmentationAsync( const uuids::uuid& segUid, const std::string& fileName );
+
+    /// Report the segmentations that have been saved since the last frame and set their file names.
+    /// This is called on the render thread before each frame.
+    void applySavedSegmentations();
+
+    /// Replay the segmentation edits that were recovered from the journal of an earlier session that
+    /// did not exit normally. Segmentations that are not in the project are loaded or created.
+    /// This is called on the render thread once the images are loaded and their textures exist.
+    void replaySegJournal();
 
     /// Create a blank segmentation with the same header as the given image
     std::optional<uuids::uuid> createBlankSeg(
@@ -124,9 +252,52 @@ private:
 
     std::future<void> m_futureLoadProject;
 
+    // Progress of loading the project, which is shown while loading and may be cancelled
+    std::shared_ptr<LoadProgress> m_loadProgress;
+
     // Set true when images are loaded from disk and ready to be loaded into textures
     std::atomic<bool> m_imagesReady;
 
+    // Worker tasks that compute exact image statistics. Tasks that are done are dropped
+    // when their statistics are applied.
+    std::vector< std::future<void> > m_futureExactStats;
+
+    // Exact statistics that have been computed, but not yet applied to their images
+    std::vector< std::pair< uuids::uuid, std::vector< ComponentStats<double> > > > m_exactStats;
+
+    // Guards m_futureExactStats, m_exactStats, and creation of the statistics pools
+    std::mutex m_exactStatsMutex;
+
+    // Runs the exact statistics tasks one image at a time
+    std::unique_ptr<ThreadPool> m_exactStatsPool;
+
+    // Worker threads across which the pass over the voxels of an image is split
+    std::unique_ptr<ThreadPool> m_statsWorkerPool;
+
+    // Set true to skip exact statistics tasks that have not started
+    std::atomic<bool> m_exactStatsCancelled;
+
+    // Images requested by loadImagesAsync, in request order. Only accessed on the render thread.
+    std::deque<PendingImage> m_pendingImages;
+
+    // Worker threads that read the files of images requested by loadImagesAsync
+    std::unique_ptr<ThreadPool> m_imageReadPool;
+
+    // Progress of reading the files of the pending images
+    std::shared_ptr<LoadProgress> m_imageReadProgress;
+
+    /// Save of a segmentation that runs on a worker thread
+    struct PendingSegSave
+    {
+        std::string m_fileName;
+        std::future<bool> m_saved; //!< Ready once the save is done; true iff it succeeded
+        std::future<void> m_task;
+    };
+
+    // Saves of segmentations that are in progress, keyed by segmentation.
+    // Only accessed on the render thread.
+    std::unordered_map< uuids::uuid, PendingSegSave > m_pendingSegSaves;
+
     // Set true when images could not be loaded.
     // If true, this flag will cause the render loop to exit.
     std::atomic<bool> m_imageLoadFailed;
@@ -134,6 +305,22 @@ private:
     GlfwWrapper m_glfw;
     AppData m_data;
     Rendering m_rendering;
+
+    // Keeps only recently used images resident in memory and textures
+    ImageResidency m_imageResidency;
+
+    // Journals segmentation edits, so that they can be recovered after a crash
+    SegJournal m_segJournal;
+
+    // Undo/redo history of segmentation edits
+    SegHistory m_segHistory;
+
+    // Plays the frames of time series images
+    CinePlayback m_cinePlayback;
+
+    // Is cine playback animating the render loop?
+    bool m_cineAnimating;
+
     CallbackHandler m_callbackHandler;
     ImGuiWrapper m_imgui;
 };
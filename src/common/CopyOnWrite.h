@@ -0,0 +1,56 @@
+#ifndef COPY_ON_WRITE_H
+#define COPY_ON_WRITE_H
+
+#include <memory>
+#include <utility>
+
+
+/**
+ * @brief Reference-counted value with copy-on-write semantics. Copies of a CopyOnWrite share
+ * a single value until one of them requests write access with mutableValue(), at which point
+ * that copy is given its own copy of the value if the value is shared.
+ *
+ * @note Reading a shared value is thread-safe. Requesting write access must not race with
+ * copying the same CopyOnWrite object on another thread.
+ */
+template< class T >
+class CopyOnWrite
+{
+public:
+
+    explicit CopyOnWrite( T value )
+        : m_value( std::make_shared<T>( std::move( value ) ) ) {}
+
+    CopyOnWrite( const CopyOnWrite& ) = default;
+    CopyOnWrite& operator=( const CopyOnWrite& ) = default;
+
+    CopyOnWrite( CopyOnWrite&& ) = default;
+    CopyOnWrite& operator=( CopyOnWrite&& ) = default;
+
+    ~CopyOnWrite() = default;
+
+    /// @brief Get read access to the value, which may be shared with other copies
+    const T& value() const { return *m_value; }
+
+    /// @brief Get write access to the value. The value is first copied if it is shared,
+    /// so that writes are not seen by other copies.
+    T& mutableValue()
+    {
+        if ( isShared() )
+        {
+            m_value = std::make_shared<T>( std::as_const( *m_value ) );
+        }
+
+        return *m_value;
+    }
+
+    /// @brief Is the value shared with other copies?
+    bool isShared() const { return ( m_value.use_count() > 1 ); }
+
+
+private:
+
+    std::shared_ptr<T> m_value;
+};
+
+#endif // COPY_ON_WRITE_H
@@ -14,6 +14,10 @@ std::ostream& operator<<( std::ostream& os, const InputParams& p )
     }
 
     if ( p.projectFile ) os << "\nProject file: " << *p.projectFile;
+    os << "\nQuantize floating-point images: " << std::boolalpha << p.quantizeFloatImages;
+    if ( p.imageRamBudgetMiB ) os << "\nImage memory budget: " << *p.imageRamBudgetMiB << " MiB";
+    if ( p.imageVramBudgetMiB ) os << "\nImage texture budget: " << *p.imageVramBudgetMiB << " MiB";
+    if ( p.segUndoBudgetMiB ) os << "\nSegmentation undo budget: " << *p.segUndoBudgetMiB << " MiB";
     os << "\nConsole log level: " << p.consoleLogLevel;
 
     return os;
@@ -3,6 +3,7 @@
 
 #include <spdlog/spdlog.h>
 
+#include <cstddef>
 #include <optional>
 #include <ostream>
 #include <string>
@@ -23,6 +24,17 @@ struct InputParams
     // An optional project file with the images.
     std::optional< std::string > projectFile;
 
+    // Hold floating-point images as quantized 16-bit integers in memory?
+    bool quantizeFloatImages = false;
+
+    // Budgets in MiB for the voxels of images held in memory and in textures. Least-recently-used
+    // images are evicted when a budget is exceeded. If not set, then default budgets are used.
+    std::optional<size_t> imageRamBudgetMiB;
+    std::optional<size_t> imageVramBudgetMiB;
+
+    // Memory budget in MiB for the undo history of segmentation edits. If not set, then the default is used.
+    std::optional<size_t> segUndoBudgetMiB;
+
     spdlog::level::level_enum consoleLogLevel;
 
     // Have the parameters been successfully set?
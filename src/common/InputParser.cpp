@@ -104,10 +104,31 @@ int parseCommandLine( const int argc, char* argv[], InputParams& params )
     program.add_argument( "-p", "--project" )
             .help( "project file in JSON format" );
 
+    program.add_argument( "-q", "--quantize" )
+            .default_value( false )
+            .implicit_value( true )
+            .help( "hold scalar floating-point images as 16-bit integers scaled to their value range, "
+                   "which halves their memory use at the cost of precision" );
+
+    program.add_argument( "--ram-budget" )
+            .action( [] ( const std::string& value ) { return static_cast<size_t>( std::stoull( value ) ); } )
+            .help( "memory budget in MiB for image voxels; least-recently-used images beyond it are "
+                   "released and read again when used (default: half of the physical memory)" );
+
+    program.add_argument( "--vram-budget" )
+            .action( [] ( const std::string& value ) { return static_cast<size_t>( std::stoull( value ) ); } )
+            .help( "texture memory budget in MiB for images; textures of least-recently-used images "
+                   "beyond it are removed and created again when used (default: unlimited)" );
+
+    program.add_argument( "--undo-budget" )
+            .action( [] ( const std::string& value ) { return static_cast<size_t>( std::stoull( value ) ); } )
+            .help( "memory budget in MiB for the undo history of segmentation edits; the oldest edits "
+                   "beyond it cannot be undone, and 0 disables undo (default: 256)" );
+
     program.add_argument( "images" )
             .remaining() // so that a list of images can be provided
             .action( parseImageSegPair )
-            .help( "list of paths to images and optional segmentations: "
+            .help( "list of paths to images (or DICOM series directories) and optional segmentations: "
                    "a corresponding image and segmentation pair is separated by a comma "
                    "and images are separated by a space (i.e. img0[,seg0] img1 img2[,seg2] ...)" );
 
@@ -153,6 +174,11 @@ int parseCommandLine( const int argc, char* argv[], InputParams& params )
             params.projectFile = *projectFile;
         }
 
+        params.quantizeFloatImages = program.get<bool>( "-q" );
+        params.imageRamBudgetMiB = program.present<size_t>( "--ram-budget" );
+        params.imageVramBudgetMiB = program.present<size_t>( "--vram-budget" );
+        params.segUndoBudgetMiB = program.present<size_t>( "--undo-budget" );
+
         logLevel = program.get<std::string>( "-l" );
     }
     catch ( const std::exception& e )
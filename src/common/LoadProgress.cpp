@@ -0,0 +1,225 @@
+#include "common/LoadProgress.h"
+
+#include <spdlog/spdlog.h>
+
+// On Apple platforms, we must use the alternative ghc::filesystem,
+// because it is not fully implemented or supported prior to macOS 10.15.
+#if !defined(__APPLE__)
+#if defined(__cplusplus) && __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<filesystem>)
+#define GHC_USE_STD_FS
+#include <filesystem>
+namespace fs = std::filesystem;
+#endif
+#endif
+#endif
+
+#ifndef GHC_USE_STD_FS
+#include <ghc/filesystem.hpp>
+namespace fs = ghc::filesystem;
+#endif
+
+#include <algorithm>
+#include <system_error>
+#include <utility>
+
+
+namespace
+{
+
+static constexpr double sk_bytesPerMegabyte = 1024.0 * 1024.0;
+
+}
+
+
+double LoadProgress::Summary::fraction() const
+{
+    if ( 0 == m_bytesTotal )
+    {
+        return ( 0 == m_numFiles ) ? 0.0 : static_cast<double>( m_numFilesDone ) / m_numFiles;
+    }
+
+    return static_cast<double>( m_bytesDone ) / static_cast<double>( m_bytesTotal );
+}
+
+double LoadProgress::Summary::megabytesPerSecond() const
+{
+    if ( m_elapsedSeconds <= 0.0 )
+    {
+        return 0.0;
+    }
+
+    return static_cast<double>( m_bytesDone ) / sk_bytesPerMegabyte / m_elapsedSeconds;
+}
+
+
+LoadProgress::LoadProgress()
+    :
+      m_startTime( std::chrono::steady_clock::now() ),
+      m_files(),
+      m_nextFile( 0 ),
+      m_stageTimes(),
+      m_cancelled( false ),
+      m_mutex()
+{
+    m_stageTimes.fill( std::chrono::duration<double>::zero() );
+}
+
+size_t LoadProgress::addFile( const std::string& fileName )
+{
+    std::error_code error;
+    const auto size = fs::file_size( fs::path( fileName ), error );
+
+    if ( error )
+    {
+        spdlog::warn( "Unable to get the size of file {}: {}", fileName, error.message() );
+    }
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_files.emplace( m_nextFile, File{ fileName, error ? 0 : static_cast<uint64_t>( size ), 0.0 } );
+    return m_nextFile++;
+}
+
+void LoadProgress::removeFile( size_t file )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_files.erase( file );
+}
+
+void LoadProgress::setFileFraction( size_t file, double fraction )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    const auto it = m_files.find( file );
+
+    if ( std::end( m_files ) != it )
+    {
+        it->second.m_fraction = std::clamp( fraction, 0.0, 1.0 );
+    }
+}
+
+void LoadProgress::addStageTime( LoadStage stage, std::chrono::duration<double> time )
+{
+    const size_t s = static_cast<size_t>( stage );
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    if ( s < m_stageTimes.size() )
+    {
+        m_stageTimes[s] += time;
+    }
+}
+
+LoadProgress::Summary LoadProgress::summary() const
+{
+    Summary summary;
+    summary.m_cancelled = m_cancelled;
+    summary.m_elapsedSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - m_startTime ).count();
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    summary.m_numFiles = m_files.size();
+
+    for ( const auto& entry : m_files )
+    {
+        const File& file = entry.second;
+
+        summary.m_bytesTotal += file.m_sizeInBytes;
+        summary.m_bytesDone += static_cast<uint64_t>( file.m_fraction * file.m_sizeInBytes );
+
+        if ( file.m_fraction >= 1.0 )
+        {
+            ++summary.m_numFilesDone;
+        }
+    }
+
+    return summary;
+}
+
+void LoadProgress::logStageTimes() const
+{
+    const Summary s = summary();
+
+    std::array< std::chrono::duration<double>, static_cast<size_t>( LoadStage::NumStages ) > stageTimes;
+
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        stageTimes = m_stageTimes;
+    }
+
+    spdlog::info( "Loaded {} of {} files ({:.1f} MB) in {:.2f} s at {:.1f} MB/s",
+                  s.m_numFilesDone, s.m_numFiles, s.m_bytesDone / sk_bytesPerMegabyte,
+                  s.m_elapsedSeconds, s.megabytesPerSecond() );
+
+    // Files are loaded concurrently, so the stage times may sum to more than the elapsed time
+    spdlog::info( "Time summed over files: reading {:.2f} s, casting {:.2f} s, statistics {:.2f} s",
+                  stageTimes[static_cast<size_t>( LoadStage::Read )].count(),
+                  stageTimes[static_cast<size_t>( LoadStage::Cast )].count(),
+                  stageTimes[static_cast<size_t>( LoadStage::Statistics )].count() );
+}
+
+void LoadProgress::cancel()
+{
+    if ( ! m_cancelled.exchange( true ) )
+    {
+        spdlog::info( "Cancelling loading" );
+    }
+}
+
+bool LoadProgress::isCancelled() const
+{
+    return m_cancelled;
+}
+
+
+FileLoadProgress::FileLoadProgress( std::shared_ptr<LoadProgress> progress, size_t file, SlabHandler slabHandler )
+    :
+      m_progress( std::move( progress ) ),
+      m_file( file ),
+      m_slabHandler( std::move( slabHandler ) )
+{}
+
+void FileLoadProgress::setFraction( double fraction ) const
+{
+    if ( m_progress )
+    {
+        m_progress->setFileFraction( m_file, fraction );
+    }
+}
+
+void FileLoadProgress::addStageTime( LoadStage stage, std::chrono::duration<double> time ) const
+{
+    if ( m_progress )
+    {
+        m_progress->addStageTime( stage, time );
+    }
+}
+
+bool FileLoadProgress::isCancelled() const
+{
+    return ( m_progress && m_progress->isCancelled() );
+}
+
+void FileLoadProgress::addSlab( const ImageSlab& slab ) const
+{
+    if ( m_slabHandler )
+    {
+        m_slabHandler( slab );
+    }
+}
+
+
+LoadStageTimer::LoadStageTimer( const FileLoadProgress* progress, LoadStage stage )
+    :
+      m_progress( progress ),
+      m_stage( stage ),
+      m_startTime( std::chrono::steady_clock::now() )
+{}
+
+LoadStageTimer::~LoadStageTimer()
+{
+    if ( m_progress )
+    {
+        m_progress->addStageTime( m_stage, std::chrono::steady_clock::now() - m_startTime );
+    }
+}
@@ -0,0 +1,179 @@
+#ifndef LOAD_PROGRESS_H
+#define LOAD_PROGRESS_H
+
+#include "common/Types.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/// Stages of loading an image file that are timed
+enum class LoadStage
+{
+    Read, //!< Reading and decoding the file
+    Cast, //!< Casting and copying voxels into the image buffers
+    Statistics, //!< Computing image statistics
+    NumStages
+};
+
+
+/**
+ * @brief Progress of loading a set of files, which are read concurrently on worker threads.
+ * Workers report the fraction of each file that has been read and the time spent in each loading
+ * stage. The UI queries a summary of the progress and may cancel the load, which workers check
+ * between stages. All member functions are thread-safe.
+ */
+class LoadProgress
+{
+public:
+
+    /// Summary of the progress of all files
+    struct Summary
+    {
+        size_t m_numFiles = 0; //!< Number of files to load
+        size_t m_numFilesDone = 0; //!< Number of files that are done loading
+        uint64_t m_bytesTotal = 0; //!< Size on disk of all files
+        uint64_t m_bytesDone = 0; //!< Size on disk of the parts of files that have been read
+        double m_elapsedSeconds = 0.0; //!< Time since loading started
+        bool m_cancelled = false; //!< Has loading been cancelled?
+
+        /// @brief Get the fraction of all bytes that have been read, in [0, 1]
+        double fraction() const;
+
+        /// @brief Get the read throughput in megabytes per second
+        double megabytesPerSecond() const;
+    };
+
+    LoadProgress();
+
+    LoadProgress( const LoadProgress& ) = delete;
+    LoadProgress& operator=( const LoadProgress& ) = delete;
+
+    /// @brief Add a file to load. Its size is read from disk.
+    /// @return Index of the file
+    size_t addFile( const std::string& fileName );
+
+    /// @brief Remove a file from the progress, so that progress that is tracked over a long time
+    /// (such as that of reading evicted images again) does not hold every file that was ever read
+    void removeFile( size_t file );
+
+    /// @brief Set the fraction of a file that has been read, in [0, 1].
+    /// A file is done when its fraction is one.
+    void setFileFraction( size_t file, double fraction );
+
+    /// @brief Add time spent in a stage of loading
+    void addStageTime( LoadStage stage, std::chrono::duration<double> time );
+
+    /// @brief Get a summary of the progress
+    Summary summary() const;
+
+    /// @brief Log the summary and the time spent in each stage, summed over all files
+    void logStageTimes() const;
+
+    /// @brief Request that loading be cancelled
+    void cancel();
+
+    /// @brief Has loading been cancelled?
+    bool isCancelled() const;
+
+
+private:
+
+    struct File
+    {
+        std::string m_fileName;
+        uint64_t m_sizeInBytes = 0;
+        double m_fraction = 0.0;
+    };
+
+    const std::chrono::steady_clock::time_point m_startTime;
+
+    std::map<size_t, File> m_files; //!< Files keyed by index
+    size_t m_nextFile; //!< Index of the next file that is added
+    std::array< std::chrono::duration<double>, static_cast<size_t>( LoadStage::NumStages ) > m_stageTimes;
+    std::atomic<bool> m_cancelled;
+
+    mutable std::mutex m_mutex; //!< Guards m_files and m_stageTimes
+};
+
+
+/// Slab of whole slices of a scalar 3D image that has been read from a file
+struct ImageSlab
+{
+    ComponentType m_componentType = ComponentType::Undefined; //!< Type of the voxels
+    const void* m_voxels = nullptr; //!< Voxels of the slab, with the x index varying fastest
+    std::array<uint32_t, 3> m_imageDims{ { 0, 0, 0 } }; //!< Dimensions of the whole image in voxels
+    std::array<double, 3> m_imageSpacing{ { 1.0, 1.0, 1.0 } }; //!< Voxel spacing of the image (mm)
+    uint32_t m_firstSlice = 0; //!< Index of the first slice of the slab
+    uint32_t m_numSlices = 0; //!< Number of slices in the slab
+};
+
+
+/**
+ * @brief Handle with which a worker reports the progress of loading one file of a LoadProgress
+ */
+class FileLoadProgress
+{
+public:
+
+    /// Function that receives the slabs of an image as they are read, in order of their slices.
+    /// It is called on the thread that reads the file.
+    using SlabHandler = std::function< void ( const ImageSlab& ) >;
+
+    FileLoadProgress( std::shared_ptr<LoadProgress> progress, size_t file, SlabHandler slabHandler = nullptr );
+
+    /// @brief Set the fraction of the file that has been read, in [0, 1]
+    void setFraction( double fraction ) const;
+
+    /// @brief Add time spent in a stage of loading the file
+    void addStageTime( LoadStage stage, std::chrono::duration<double> time ) const;
+
+    /// @brief Has loading been cancelled?
+    bool isCancelled() const;
+
+    /// @brief Pass a slab of the image that has been read to the slab handler, if there is one.
+    /// Only images that are read in slabs report them.
+    void addSlab( const ImageSlab& slab ) const;
+
+
+private:
+
+    std::shared_ptr<LoadProgress> m_progress;
+    size_t m_file;
+    SlabHandler m_slabHandler;
+};
+
+
+/**
+ * @brief Adds the time from its construction to its destruction to a stage of loading a file
+ */
+class LoadStageTimer
+{
+public:
+
+    /// @param[in] progress Progress of the file; if null, then nothing is timed
+    LoadStageTimer( const FileLoadProgress* progress, LoadStage stage );
+
+    LoadStageTimer( const LoadStageTimer& ) = delete;
+    LoadStageTimer& operator=( const LoadStageTimer& ) = delete;
+
+    ~LoadStageTimer();
+
+
+private:
+
+    const FileLoadProgress* m_progress;
+    LoadStage m_stage;
+    std::chrono::steady_clock::time_point m_startTime;
+};
+
+#endif // LOAD_PROGRESS_H
@@ -0,0 +1,83 @@
+#include "common/ThreadPool.h"
+
+#include <algorithm>
+
+
+ThreadPool::ThreadPool( size_t numThreads )
+    :
+      m_workers(),
+      m_tasks(),
+      m_mutex(),
+      m_condition(),
+      m_stopping( false )
+{
+    if ( 0 == numThreads )
+    {
+        numThreads = std::max( std::thread::hardware_concurrency(), 1u );
+    }
+
+    m_workers.reserve( numThreads );
+
+    for ( size_t i = 0; i < numThreads; ++i )
+    {
+        m_workers.emplace_back( [this] () { workerLoop(); } );
+    }
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_stopping = true;
+    }
+
+    m_condition.notify_all();
+
+    for ( auto& worker : m_workers )
+    {
+        if ( worker.joinable() )
+        {
+            worker.join();
+        }
+    }
+}
+
+
+size_t ThreadPool::numThreads() const
+{
+    return m_workers.size();
+}
+
+
+size_t ThreadPool::defaultNumThreads( size_t numTasks )
+{
+    const size_t numHardwareThreads = std::max( std::thread::hardware_concurrency(), 1u );
+    return std::max( std::min( numHardwareThreads, numTasks ), size_t( 1 ) );
+}
+
+
+void ThreadPool::workerLoop()
+{
+    while ( true )
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_condition.wait( lock, [this] () { return m_stopping || ! m_tasks.empty(); } );
+
+            if ( m_tasks.empty() )
+            {
+                // Stopping and no tasks remain
+                return;
+            }
+
+            task = std::move( m_tasks.front() );
+            m_tasks.pop();
+        }
+
+        // Exceptions thrown by the task are stored in its future
+        task();
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @brief Fixed-size pool of worker threads that execute submitted tasks in FIFO order.
+ * The pool bounds the number of tasks that run concurrently, regardless of how many are submitted.
+ * On destruction, the pool finishes all queued tasks and then joins its threads.
+ */
+class ThreadPool
+{
+public:
+
+    /// @brief Construct the pool
+    /// @param[in] numThreads Number of worker threads. If zero, then the number of
+    /// hardware threads is used.
+    explicit ThreadPool( size_t numThreads = 0 );
+
+    ThreadPool( const ThreadPool& ) = delete;
+    ThreadPool& operator=( const ThreadPool& ) = delete;
+
+    ~ThreadPool();
+
+    /// @brief Submit a task to the pool
+    /// @return Future that holds the result of the task or the exception that it threw
+    template< class Func >
+    std::future< std::invoke_result_t< std::decay_t<Func> > > submit( Func&& func )
+    {
+        using ResultType = std::invoke_result_t< std::decay_t<Func> >;
+
+        // Packaged tasks are move-only, so share ownership with the type-erased queue entry
+        auto task = std::make_shared< std::packaged_task<ResultType()> >( std::forward<Func>( func ) );
+        std::future<ResultType> future = task->get_future();
+
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_tasks.emplace( [task] () { ( *task )(); } );
+        }
+
+        m_condition.notify_one();
+        return future;
+    }
+
+    /// @brief Get the number of worker threads
+    size_t numThreads() const;
+
+    /// @brief Get the default number of threads to use for a number of tasks:
+    /// the number of hardware threads, but no more than the number of tasks and no fewer than one
+    static size_t defaultNumThreads( size_t numTasks );
+
+
+private:
+
+    void workerLoop();
+
+    std::vector< std::thread > m_workers;
+    std::queue< std::function<void()> > m_tasks;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping;
+};
+
+#endif // THREAD_POOL_H
@@ -82,8 +82,22 @@ struct ComponentStats
     T m_variance;
     T m_sum;
 
-    std::vector<double> m_histogram;
-    std::array<T, 101> m_quantiles;
+    std::vector<double> m_histogram; //!< Bin frequencies of a histogram spanning [m_minimum, m_maximum]
+    std::array<T, 101> m_quantiles; //!< Quantiles 0.00, 0.01, ..., 1.00
+};
+
+
+/**
+ * @brief Linear quantization of floating-point image values to the integers that are stored
+ * in memory, where value = m_slope * storedValue + m_intercept
+ */
+struct ValueQuantization
+{
+    double m_slope = 1.0;
+    double m_intercept = 0.0;
+
+    double m_maxError = 0.0; //!< Maximum absolute error of the quantized values
+    double m_rmsError = 0.0; //!< Root mean square error of the quantized values
 };
 
 
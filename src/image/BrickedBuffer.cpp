@@ -0,0 +1,525 @@
+#include "image/BrickedBuffer.h"
+#include "image/ImageInfoCache.h"
+
+#include "common/Exception.hpp"
+
+#include <glm/common.hpp>
+
+#include <spdlog/spdlog.h>
+
+// On Apple platforms, we must use the alternative ghc::filesystem,
+// because it is not fully implemented or supported prior to macOS 10.15.
+#if !defined(__APPLE__)
+#if defined(__cplusplus) && __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<filesystem>)
+#define GHC_USE_STD_FS
+#include <filesystem>
+namespace fs = std::filesystem;
+#endif
+#endif
+#endif
+
+#ifndef GHC_USE_STD_FS
+#include <ghc/filesystem.hpp>
+namespace fs = ghc::filesystem;
+#endif
+
+#if ! defined( _WIN32 )
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <list>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+/// Voxels of the bricks of a snapshot as they were when it was taken, which are copied from
+/// the buffer before they are modified. Guarded by the mutex of the state of the buffer.
+struct BrickedBuffer::SnapshotBricks
+{
+    std::unordered_map< size_t, std::vector<char> > m_bricks; //!< Voxels of the bricks, by index
+};
+
+
+/// Cache file and resident bricks of a BrickedBuffer. The cache file is deleted with the state.
+struct BrickedBuffer::State
+{
+    struct Brick
+    {
+        std::vector<char> m_data; //!< Voxels of the brick
+        bool m_modified = false; //!< Has the brick been modified since it was last written to the file?
+        std::list<size_t>::iterator m_lruPosition; //!< Position of the brick in the LRU list
+    };
+
+    ~State()
+    {
+        m_file.close();
+
+        std::error_code error;
+        fs::remove( m_filePath, error );
+    }
+
+    /// Create an empty cache file with a unique name
+    static std::unique_ptr<State> createCacheFile( size_t numBricks )
+    {
+        const std::optional<std::string> cacheDir = cache::createCacheDirectory( "bricks" );
+
+        std::error_code error;
+        const fs::path dir = cacheDir ? fs::path( *cacheDir ) : fs::temp_directory_path( error );
+
+        if ( error )
+        {
+            spdlog::error( "Unable to find a directory for the brick cache file: {}", error.message() );
+            return nullptr;
+        }
+
+        std::random_device random;
+        std::ostringstream name;
+        name << std::hex << std::setw( 8 ) << std::setfill( '0' ) << random()
+             << std::setw( 8 ) << std::setfill( '0' ) << random() << ".bricks";
+
+        auto state = std::make_unique<State>();
+        state->m_filePath = dir / name.str();
+        state->m_file.open( state->m_filePath.string(),
+                            std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc );
+
+        if ( ! state->m_file )
+        {
+            spdlog::error( "Unable to create brick cache file {}", state->m_filePath.string() );
+            return nullptr;
+        }
+
+        state->m_brickInFile.resize( numBricks, false );
+        return state;
+    }
+
+    /// Write the voxels of a brick to its chunk of the cache file
+    bool writeBrick( size_t index, const std::vector<char>& data )
+    {
+        m_file.seekp( static_cast<std::streamoff>( index * data.size() ) );
+        m_file.write( data.data(), static_cast<std::streamsize>( data.size() ) );
+
+        if ( ! m_file )
+        {
+            spdlog::error( "Unable to write brick {} to cache file {}", index, m_filePath.string() );
+            m_file.clear();
+            return false;
+        }
+
+        m_brickInFile[index] = true;
+        return true;
+    }
+
+    /// Get a brick, which is read from the cache file if it is not resident. If the resident set
+    /// is full, then its least recently used brick is evicted first. Returns null on error.
+    Brick* residentBrick( size_t index, size_t brickSizeInBytes, size_t maxNumResidentBricks )
+    {
+        if ( auto it = m_residentBricks.find( index ); std::end( m_residentBricks ) != it )
+        {
+            m_lru.splice( std::begin( m_lru ), m_lru, it->second.m_lruPosition );
+            return &( it->second );
+        }
+
+        // The voxels of an evicted brick are recycled for the new one
+        std::vector<char> data;
+
+        while ( m_residentBricks.size() >= maxNumResidentBricks && ! m_lru.empty() )
+        {
+            const size_t evictedIndex = m_lru.back();
+            auto evicted = m_residentBricks.find( evictedIndex );
+
+            if ( evicted->second.m_modified && ! writeBrick( evictedIndex, evicted->second.m_data ) )
+            {
+                return nullptr;
+            }
+
+            data = std::move( evicted->second.m_data );
+            m_residentBricks.erase( evicted );
+            m_lru.pop_back();
+        }
+
+        data.resize( brickSizeInBytes );
+
+        if ( m_brickInFile[index] )
+        {
+            m_file.seekg( static_cast<std::streamoff>( index * brickSizeInBytes ) );
+            m_file.read( data.data(), static_cast<std::streamsize>( brickSizeInBytes ) );
+
+            if ( ! m_file )
+            {
+                spdlog::error( "Unable to read brick {} from cache file {}", index, m_filePath.string() );
+                m_file.clear();
+                return nullptr;
+            }
+        }
+        else
+        {
+            // Bricks that have never been written are zero
+            std::fill( std::begin( data ), std::end( data ), 0 );
+        }
+
+        m_lru.push_front( index );
+
+        Brick& brick = m_residentBricks[index];
+        brick.m_data = std::move( data );
+        brick.m_modified = false;
+        brick.m_lruPosition = std::begin( m_lru );
+        return &brick;
+    }
+
+    /// Copy the voxels of a brick that is about to be modified into the snapshots that do not
+    /// yet hold it. Snapshots that no longer exist are dropped.
+    void preserveBrick( size_t index, const std::vector<char>& data )
+    {
+        for ( auto it = std::begin( m_snapshots ); it != std::end( m_snapshots ); )
+        {
+            if ( const auto snapshotBricks = it->lock() )
+            {
+                snapshotBricks->m_bricks.try_emplace( index, data );
+                ++it;
+            }
+            else
+            {
+                it = m_snapshots.erase( it );
+            }
+        }
+    }
+
+    /// Write all modified resident bricks to the cache file
+    bool flush()
+    {
+        bool flushed = true;
+
+        for ( auto& [index, brick] : m_residentBricks )
+        {
+            if ( brick.m_modified && writeBrick( index, brick.m_data ) )
+            {
+                brick.m_modified = false;
+            }
+            else if ( brick.m_modified )
+            {
+                flushed = false;
+            }
+        }
+
+        m_file.flush();
+        return flushed;
+    }
+
+    fs::path m_filePath; //!< Path of the cache file
+    std::fstream m_file; //!< Cache file, in which brick i is held at offset i * brick size
+
+    std::vector<bool> m_brickInFile; //!< Has each brick been written to the cache file?
+    std::unordered_map<size_t, Brick> m_residentBricks; //!< Bricks held in memory, by index
+    std::list<size_t> m_lru; //!< Indices of the resident bricks, from most to least recently used
+    std::vector< std::weak_ptr<SnapshotBricks> > m_snapshots; //!< Snapshots taken of the buffer
+
+    std::mutex m_mutex; //!< Guards the members above
+};
+
+
+std::optional<BrickedBuffer> BrickedBuffer::create(
+        const glm::uvec3& dims, size_t voxelSizeInBytes, size_t maxResidentSizeInBytes )
+{
+    if ( 0 == voxelSizeInBytes )
+    {
+        return std::nullopt;
+    }
+
+    const glm::uvec3 numBricks = ( dims + ( sk_brickSize - 1 ) ) / sk_brickSize;
+
+    std::unique_ptr<State> state = State::createCacheFile(
+                static_cast<size_t>( numBricks.x ) * numBricks.y * numBricks.z );
+
+    if ( ! state )
+    {
+        return std::nullopt;
+    }
+
+    return BrickedBuffer( dims, voxelSizeInBytes, maxResidentSizeInBytes, std::move( state ) );
+}
+
+
+BrickedBuffer::BrickedBuffer(
+        const glm::uvec3& dims, size_t voxelSizeInBytes,
+        size_t maxResidentSizeInBytes, std::shared_ptr<State> state )
+    :
+      m_dims( dims ),
+      m_numBricks( ( dims + ( sk_brickSize - 1 ) ) / sk_brickSize ),
+      m_voxelSizeInBytes( voxelSizeInBytes ),
+      m_brickSizeInBytes( voxelSizeInBytes * sk_brickSize * sk_brickSize * sk_brickSize ),
+      m_maxNumResidentBricks( std::max<size_t>( maxResidentSizeInBytes / m_brickSizeInBytes, 1 ) ),
+      m_state( std::move( state ) ),
+      m_snapshotBricks( nullptr )
+{}
+
+BrickedBuffer::BrickedBuffer( const BrickedBuffer& other )
+    :
+      m_dims( other.m_dims ),
+      m_numBricks( other.m_numBricks ),
+      m_voxelSizeInBytes( other.m_voxelSizeInBytes ),
+      m_brickSizeInBytes( other.m_brickSizeInBytes ),
+      m_maxNumResidentBricks( other.m_maxNumResidentBricks ),
+      m_state( nullptr ),
+      m_snapshotBricks( nullptr )
+{
+    std::lock_guard<std::mutex> lock( other.m_state->m_mutex );
+
+    m_state = State::createCacheFile( other.m_state->m_brickInFile.size() );
+
+    if ( ! m_state || ! other.m_state->flush() )
+    {
+        throw_debug( "Unable to copy bricked buffer" )
+    }
+
+    // Copy the chunks of the bricks, all of which are up to date in the cache file after the flush
+    m_state->m_file.close();
+
+    std::error_code error;
+    fs::copy_file( other.m_state->m_filePath, m_state->m_filePath,
+                   fs::copy_options::overwrite_existing, error );
+
+    m_state->m_file.open( m_state->m_filePath.string(), std::ios::in | std::ios::out | std::ios::binary );
+
+    if ( error || ! m_state->m_file )
+    {
+        spdlog::error( "Unable to copy brick cache file {}", other.m_state->m_filePath.string() );
+        throw_debug( "Unable to copy bricked buffer" )
+    }
+
+    m_state->m_brickInFile = other.m_state->m_brickInFile;
+
+    // A copy of a snapshot holds the voxels of the bricks that were modified after the snapshot
+    if ( other.m_snapshotBricks )
+    {
+        for ( const auto& [index, data] : other.m_snapshotBricks->m_bricks )
+        {
+            if ( ! m_state->writeBrick( index, data ) )
+            {
+                throw_debug( "Unable to copy bricked buffer" )
+            }
+        }
+    }
+}
+
+BrickedBuffer& BrickedBuffer::operator=( const BrickedBuffer& other )
+{
+    if ( this != &other )
+    {
+        *this = BrickedBuffer( other );
+    }
+    return *this;
+}
+
+BrickedBuffer::BrickedBuffer( BrickedBuffer&& ) noexcept = default;
+BrickedBuffer& BrickedBuffer::operator=( BrickedBuffer&& ) noexcept = default;
+
+BrickedBuffer::~BrickedBuffer() = default;
+
+
+BrickedBuffer BrickedBuffer::snapshot() const
+{
+    BrickedBuffer snapshot( m_dims, m_voxelSizeInBytes, maxResidentSizeInBytes(), m_state );
+
+    // A snapshot of a snapshot has the same voxels, since snapshots are never modified
+    if ( m_snapshotBricks )
+    {
+        snapshot.m_snapshotBricks = m_snapshotBricks;
+        return snapshot;
+    }
+
+    snapshot.m_snapshotBricks = std::make_shared<SnapshotBricks>();
+
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    m_state->m_snapshots.push_back( snapshot.m_snapshotBricks );
+
+    return snapshot;
+}
+
+
+const glm::uvec3& BrickedBuffer::dims() const
+{
+    return m_dims;
+}
+
+size_t BrickedBuffer::voxelSizeInBytes() const
+{
+    return m_voxelSizeInBytes;
+}
+
+size_t BrickedBuffer::sizeInBytes() const
+{
+    return m_voxelSizeInBytes * m_dims.x * m_dims.y * m_dims.z;
+}
+
+size_t BrickedBuffer::residentSizeInBytes() const
+{
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    return m_brickSizeInBytes * m_state->m_residentBricks.size();
+}
+
+size_t BrickedBuffer::maxResidentSizeInBytes() const
+{
+    return m_brickSizeInBytes * m_maxNumResidentBricks;
+}
+
+
+bool BrickedBuffer::containsBlock( const glm::uvec3& offset, const glm::uvec3& size ) const
+{
+    return ( static_cast<uint64_t>( offset.x ) + size.x <= m_dims.x &&
+             static_cast<uint64_t>( offset.y ) + size.y <= m_dims.y &&
+             static_cast<uint64_t>( offset.z ) + size.z <= m_dims.z );
+}
+
+
+template< class CopyRow >
+bool BrickedBuffer::forEachBrickRow(
+        const glm::uvec3& offset, const glm::uvec3& size,
+        bool modify, CopyRow&& copyRow ) const
+{
+    if ( ! containsBlock( offset, size ) )
+    {
+        return false;
+    }
+
+    if ( 0 == size.x || 0 == size.y || 0 == size.z )
+    {
+        return true;
+    }
+
+    const glm::uvec3 end = offset + size;
+    const glm::uvec3 firstBrick = offset / sk_brickSize;
+    const glm::uvec3 lastBrick = ( end - 1u ) / sk_brickSize;
+
+    for ( uint32_t bk = firstBrick.z; bk <= lastBrick.z; ++bk )
+    {
+        for ( uint32_t bj = firstBrick.y; bj <= lastBrick.y; ++bj )
+        {
+            for ( uint32_t bi = firstBrick.x; bi <= lastBrick.x; ++bi )
+            {
+                const size_t index = bi + m_numBricks.x * ( bj + static_cast<size_t>( m_numBricks.y ) * bk );
+
+                char* brickData = nullptr;
+
+                // Bricks that were modified after this snapshot was taken are read from the snapshot
+                if ( m_snapshotBricks )
+                {
+                    if ( auto it = m_snapshotBricks->m_bricks.find( index ); std::end( m_snapshotBricks->m_bricks ) != it )
+                    {
+                        brickData = it->second.data();
+                    }
+                }
+
+                if ( ! brickData )
+                {
+                    State::Brick* brick = m_state->residentBrick( index, m_brickSizeInBytes, m_maxNumResidentBricks );
+
+                    if ( ! brick )
+                    {
+                        return false;
+                    }
+
+                    if ( modify )
+                    {
+                        m_state->preserveBrick( index, brick->m_data );
+                        brick->m_modified = true;
+                    }
+
+                    brickData = brick->m_data.data();
+                }
+
+                // Intersection of the block with the brick
+                const glm::uvec3 brickOrigin = sk_brickSize * glm::uvec3{ bi, bj, bk };
+                const glm::uvec3 lo = glm::max( offset, brickOrigin );
+                const glm::uvec3 hi = glm::min( end, brickOrigin + sk_brickSize );
+
+                const size_t rowSizeInBytes = m_voxelSizeInBytes * ( hi.x - lo.x );
+
+                for ( uint32_t k = lo.z; k < hi.z; ++k )
+                {
+                    for ( uint32_t j = lo.y; j < hi.y; ++j )
+                    {
+                        const size_t brickVoxel = ( lo.x - brickOrigin.x ) + sk_brickSize *
+                                ( ( j - brickOrigin.y ) + sk_brickSize * static_cast<size_t>( k - brickOrigin.z ) );
+
+                        const size_t blockVoxel = ( lo.x - offset.x ) + size.x *
+                                ( ( j - offset.y ) + size.y * static_cast<size_t>( k - offset.z ) );
+
+                        copyRow( brickData + m_voxelSizeInBytes * brickVoxel,
+                                 m_voxelSizeInBytes * blockVoxel, rowSizeInBytes );
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+
+bool BrickedBuffer::readBlock( const glm::uvec3& offset, const glm::uvec3& size, void* dest ) const
+{
+    char* blockData = static_cast<char*>( dest );
+
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+
+    return forEachBrickRow( offset, size, false,
+                            [blockData] ( const char* brickRow, size_t blockOffset, size_t rowSize )
+    {
+        std::memcpy( blockData + blockOffset, brickRow, rowSize );
+    } );
+}
+
+
+bool BrickedBuffer::writeBlock( const glm::uvec3& offset, const glm::uvec3& size, const void* source )
+{
+    if ( m_snapshotBricks )
+    {
+        spdlog::error( "Unable to write to a read-only snapshot of a bricked buffer" );
+        return false;
+    }
+
+    const char* blockData = static_cast<const char*>( source );
+
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+
+    return forEachBrickRow( offset, size, true,
+                            [blockData] ( char* brickRow, size_t blockOffset, size_t rowSize )
+    {
+        std::memcpy( brickRow, blockData + blockOffset, rowSize );
+    } );
+}
+
+
+bool BrickedBuffer::flush() const
+{
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    return m_state->flush();
+}
+
+
+std::optional<size_t> physicalMemorySizeInBytes()
+{
+#if defined( _WIN32 )
+    return std::nullopt;
+#else
+    const long numPages = ::sysconf( _SC_PHYS_PAGES );
+    const long pageSize = ::sysconf( _SC_PAGESIZE );
+
+    if ( numPages <= 0 || pageSize <= 0 )
+    {
+        return std::nullopt;
+    }
+
+    return static_cast<size_t>( numPages ) * static_cast<size_t>( pageSize );
+#endif
+}
@@ -0,0 +1,130 @@
+#ifndef BRICKED_BUFFER_H
+#define BRICKED_BUFFER_H
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+
+/**
+ * @brief Buffer of the voxels of a 3D image component that is divided into cubic bricks, which are
+ * held in a chunked cache file on disk. Bricks are read into memory on demand and are kept in a
+ * resident set of limited size. When the set is full, its least recently used brick is evicted and,
+ * if it was modified, written back to its chunk of the cache file. This lets images that are larger
+ * than memory be loaded, displayed, and edited.
+ *
+ * @note Voxels that have never been written are zero. Bricks that have never been written
+ * take no space in the cache file. All member functions are thread-safe.
+ */
+class BrickedBuffer
+{
+public:
+
+    /// Number of voxels along each side of a brick
+    static constexpr uint32_t sk_brickSize = 64;
+
+    /**
+     * @brief Create a bricked buffer with all voxels set to zero
+     * @param[in] dims Dimensions of the buffer in voxels
+     * @param[in] voxelSizeInBytes Size of each voxel in bytes
+     * @param[in] maxResidentSizeInBytes Maximum size in bytes of the bricks held in memory.
+     * At least one brick is always held in memory.
+     * @return The buffer; std::nullopt if its cache file could not be created
+     */
+    static std::optional<BrickedBuffer> create(
+            const glm::uvec3& dims, size_t voxelSizeInBytes, size_t maxResidentSizeInBytes );
+
+    /// Copying a bricked buffer copies its cache file, so that copies never alias each other
+    BrickedBuffer( const BrickedBuffer& );
+    BrickedBuffer& operator=( const BrickedBuffer& );
+
+    BrickedBuffer( BrickedBuffer&& ) noexcept;
+    BrickedBuffer& operator=( BrickedBuffer&& ) noexcept;
+
+    /// The cache file is deleted with the last buffer or snapshot that shares it
+    ~BrickedBuffer();
+
+    /**
+     * @brief Take a read-only snapshot of the voxels of the buffer as they are now. The snapshot
+     * shares the bricks and cache file of the buffer. Before a brick of the buffer is first modified
+     * after the snapshot is taken, its voxels are copied into the snapshot, so the snapshot only holds
+     * the bricks that are modified while it exists. This lets a buffer be saved while it is edited.
+     *
+     * @note Writes to a snapshot fail. A copy of a snapshot is a writable buffer with its voxels.
+     */
+    BrickedBuffer snapshot() const;
+
+    /// @brief Get the dimensions of the buffer in voxels
+    const glm::uvec3& dims() const;
+
+    /// @brief Get the size of a voxel in bytes
+    size_t voxelSizeInBytes() const;
+
+    /// @brief Get the size in bytes of all voxels of the buffer
+    size_t sizeInBytes() const;
+
+    /// @brief Get the size in bytes of the bricks that are held in memory
+    size_t residentSizeInBytes() const;
+
+    /// @brief Get the maximum size in bytes of the bricks that are held in memory
+    size_t maxResidentSizeInBytes() const;
+
+    /**
+     * @brief Copy a block of voxels into a dense buffer, in which voxel (i, j, k) of the block
+     * is at index i + size.x * ( j + size.y * k )
+     * @param[in] offset Voxel offset of the block
+     * @param[in] size Size of the block in voxels
+     * @param[out] dest Buffer of at least size.x * size.y * size.z voxels
+     * @return True iff the block lies within the buffer and was read
+     */
+    bool readBlock( const glm::uvec3& offset, const glm::uvec3& size, void* dest ) const;
+
+    /// @brief Copy a dense buffer into a block of voxels. The buffer is laid out as in readBlock.
+    /// @return True iff the block lies within the buffer and was written
+    bool writeBlock( const glm::uvec3& offset, const glm::uvec3& size, const void* source );
+
+    /// @brief Write all modified bricks that are held in memory to the cache file
+    /// @return True iff all modified bricks were written
+    bool flush() const;
+
+
+private:
+
+    struct State;
+    struct SnapshotBricks;
+
+    BrickedBuffer( const glm::uvec3& dims, size_t voxelSizeInBytes,
+                   size_t maxResidentSizeInBytes, std::shared_ptr<State> state );
+
+    /// Does a block lie within the buffer?
+    bool containsBlock( const glm::uvec3& offset, const glm::uvec3& size ) const;
+
+    /// Call copyRow( brickRow, blockRowOffsetInBytes, rowSizeInBytes ) for each row of each brick
+    /// that intersects a block. The state mutex must be held.
+    template< class CopyRow >
+    bool forEachBrickRow( const glm::uvec3& offset, const glm::uvec3& size,
+                          bool modify, CopyRow&& copyRow ) const;
+
+    glm::uvec3 m_dims; //!< Dimensions in voxels
+    glm::uvec3 m_numBricks; //!< Number of bricks along each dimension
+    size_t m_voxelSizeInBytes; //!< Size of a voxel in bytes
+    size_t m_brickSizeInBytes; //!< Size of a brick in bytes
+    size_t m_maxNumResidentBricks; //!< Maximum number of bricks held in memory
+
+    /// Cache file, resident bricks, and their mutex, which are shared with snapshots
+    std::shared_ptr<State> m_state;
+
+    /// Voxels of the bricks that were modified after this snapshot was taken;
+    /// null if this buffer is not a snapshot
+    std::shared_ptr<SnapshotBricks> m_snapshotBricks;
+};
+
+
+/// @brief Get the size of the physical memory of the system in bytes
+/// @return The size; std::nullopt if it cannot be queried on this platform
+std::optional<size_t> physicalMemorySizeInBytes();
+
+#endif // BRICKED_BUFFER_H
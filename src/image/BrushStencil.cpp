@@ -0,0 +1,270 @@
+#include "image/BrushStencil.h"
+
+#include "logic/camera/MathUtility.h"
+
+#include <glm/glm.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <queue>
+
+
+namespace
+{
+
+/// Number of quantization steps per unit of the spacing coefficients and the plane normal
+constexpr float sk_directionQuanta = 4096.0f;
+
+/// Number of quantization steps per voxel of the plane offset from the center voxel
+constexpr float sk_offsetQuanta = 256.0f;
+
+/// Maximum number of cached stencils. The cache is cleared when it grows beyond this,
+/// which only happens when painting on many oblique planes.
+constexpr size_t sk_maxCachedStencils = 512;
+
+using StencilKey = std::array<int64_t, 10>;
+
+int64_t quantize( float value, float quanta )
+{
+    return static_cast<int64_t>( std::llround( static_cast<double>( value ) * quanta ) );
+}
+
+/// Does the voxel intersect the plane?
+bool voxelIntersectsPlane( const glm::vec4& plane, const glm::vec3& voxelPos )
+{
+    static const glm::vec3 sk_cornerOffset{ 0.5f, 0.5f, 0.5f };
+    return math::testAABBoxPlaneIntersection( voxelPos, voxelPos + sk_cornerOffset, plane );
+}
+
+/// Dense mask of the voxels of the bounding box of a brush, relative to its center voxel
+class BrushMask
+{
+public:
+
+    explicit BrushMask( const glm::ivec3& halfExtent )
+        : m_halfExtent( halfExtent ),
+          m_dims( 2 * halfExtent + 1 ),
+          m_mask( static_cast<size_t>( m_dims.x ) * m_dims.y * m_dims.z, 0 )
+    {}
+
+    bool contains( const glm::ivec3& p ) const
+    {
+        return glm::all( glm::lessThanEqual( glm::abs( p ), m_halfExtent ) );
+    }
+
+    uint8_t& operator()( const glm::ivec3& p )
+    {
+        const glm::ivec3 q = p + m_halfExtent;
+        return m_mask[static_cast<size_t>( q.x ) + static_cast<size_t>( m_dims.x ) *
+                ( static_cast<size_t>( q.y ) + static_cast<size_t>( m_dims.y ) * static_cast<size_t>( q.z ) )];
+    }
+
+    /// Convert the voxels whose mask value equals the given value into runs
+    BrushStencil toStencil( uint8_t value )
+    {
+        BrushStencil stencil;
+        stencil.m_min = glm::ivec3{ std::numeric_limits<int>::max() };
+        stencil.m_max = glm::ivec3{ std::numeric_limits<int>::lowest() };
+
+        for ( int k = -m_halfExtent.z; k <= m_halfExtent.z; ++k )
+        {
+            for ( int j = -m_halfExtent.y; j <= m_halfExtent.y; ++j )
+            {
+                int i = -m_halfExtent.x;
+
+                while ( i <= m_halfExtent.x )
+                {
+                    if ( value != ( *this )( { i, j, k } ) )
+                    {
+                        ++i;
+                        continue;
+                    }
+
+                    const int start = i;
+                    while ( i <= m_halfExtent.x && value == ( *this )( { i, j, k } ) ) { ++i; }
+
+                    const BrushStencil::Run run{ glm::ivec3{ start, j, k }, i - start };
+                    stencil.m_runs.push_back( run );
+                    stencil.m_numVoxels += static_cast<size_t>( run.m_length );
+
+                    stencil.m_min = glm::min( stencil.m_min, run.m_start );
+                    stencil.m_max = glm::max( stencil.m_max, run.m_start + glm::ivec3{ run.m_length - 1, 0, 0 } );
+                }
+            }
+        }
+
+        if ( stencil.m_runs.empty() )
+        {
+            stencil.m_min = glm::ivec3{ 0 };
+            stencil.m_max = glm::ivec3{ -1 };
+        }
+
+        return stencil;
+    }
+
+private:
+
+    glm::ivec3 m_halfExtent;
+    glm::ivec3 m_dims;
+    std::vector<uint8_t> m_mask;
+};
+
+
+BrushStencil computeStencil(
+        int brushSizeInVoxels,
+        bool brushIsRound,
+        bool brushIs3d,
+        const glm::vec3& spacings,
+        const glm::vec4& plane )
+{
+    static constexpr uint8_t sk_painted = 1;
+    static constexpr uint8_t sk_ignored = 2;
+
+    // Set the brush radius (not including the central voxel): Radius = (brush width - 1)
+    const int radius = std::max( brushSizeInVoxels - 1, 0 );
+    const float radius_f = static_cast<float>( radius );
+
+    const glm::ivec3 coeffs = glm::max( glm::ivec3{ glm::ceil( spacings ) }, glm::ivec3{ 1 } );
+
+    auto isInBrush = [&] ( const glm::ivec3& p )
+    {
+        const glm::vec3 d = glm::vec3{ p } / spacings;
+
+        if ( ! brushIsRound )
+        {
+            // Square brush:
+            return ( std::max( std::max( std::abs( d.x ), std::abs( d.y ) ), std::abs( d.z ) ) <= radius_f );
+        }
+
+        // Round brush:
+        return ( glm::dot( d, d ) <= radius_f * radius_f );
+    };
+
+    BrushMask mask( coeffs * radius );
+
+    if ( brushIs3d )
+    {
+        for ( int k = -coeffs.z * radius; k <= coeffs.z * radius; ++k )
+        {
+            for ( int j = -coeffs.y * radius; j <= coeffs.y * radius; ++j )
+            {
+                for ( int i = -coeffs.x * radius; i <= coeffs.x * radius; ++i )
+                {
+                    if ( isInBrush( { i, j, k } ) ) { mask( { i, j, k } ) = sk_painted; }
+                }
+            }
+        }
+
+        return mask.toStencil( sk_painted );
+    }
+
+    // The 2D brush is flood filled from the center voxel through voxels that intersect the plane
+    static const glm::ivec3 sk_center{ 0, 0, 0 };
+
+    if ( ! voxelIntersectsPlane( plane, sk_center ) )
+    {
+        return mask.toStencil( sk_painted );
+    }
+
+    static const std::array< glm::ivec3, 6 > sk_neighborOffsets{ {
+        { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } } };
+
+    std::queue< glm::ivec3 > voxelsToTest;
+    voxelsToTest.push( sk_center );
+    mask( sk_center ) = sk_painted;
+
+    while ( ! voxelsToTest.empty() )
+    {
+        const glm::ivec3 q = voxelsToTest.front();
+        voxelsToTest.pop();
+
+        for ( const glm::ivec3& offset : sk_neighborOffsets )
+        {
+            const glm::ivec3 n = q + offset;
+
+            if ( ! mask.contains( n ) || 0 != mask( n ) )
+            {
+                continue;
+            }
+
+            if ( isInBrush( n ) && voxelIntersectsPlane( plane, n ) )
+            {
+                mask( n ) = sk_painted;
+                voxelsToTest.push( n );
+            }
+            else
+            {
+                mask( n ) = sk_ignored;
+            }
+        }
+    }
+
+    return mask.toStencil( sk_painted );
+}
+
+} // anonymous
+
+
+std::shared_ptr<const BrushStencil> brushStencil(
+        int brushSizeInVoxels,
+        bool brushIsRound,
+        bool brushIs3d,
+        const std::array<float, 3>& mmToVoxelSpacings,
+        const glm::vec4& voxelViewPlane )
+{
+    static std::mutex s_mutex;
+    static std::map< StencilKey, std::shared_ptr<const BrushStencil> > s_stencils;
+
+    StencilKey key{};
+    key[0] = brushSizeInVoxels;
+    key[1] = brushIsRound ? 1 : 0;
+    key[2] = brushIs3d ? 1 : 0;
+
+    for ( size_t i = 0; i < 3; ++i )
+    {
+        key[3 + i] = quantize( mmToVoxelSpacings[i], sk_directionQuanta );
+    }
+
+    if ( ! brushIs3d )
+    {
+        // Normalize the plane, so that its offset is a distance in voxels
+        const float length = glm::length( glm::vec3{ voxelViewPlane } );
+        const glm::vec4 plane = ( length > 0.0f ) ? voxelViewPlane / length : voxelViewPlane;
+
+        key[6] = quantize( plane.x, sk_directionQuanta );
+        key[7] = quantize( plane.y, sk_directionQuanta );
+        key[8] = quantize( plane.z, sk_directionQuanta );
+        key[9] = quantize( plane.w, sk_offsetQuanta );
+    }
+
+    std::lock_guard<std::mutex> lock( s_mutex );
+
+    if ( auto it = s_stencils.find( key ); std::end( s_stencils ) != it )
+    {
+        return it->second;
+    }
+
+    // The stencil is computed from the quantized key, so that it depends only on the key
+    const glm::vec3 spacings{ key[3] / sk_directionQuanta, key[4] / sk_directionQuanta, key[5] / sk_directionQuanta };
+
+    const glm::vec4 plane{ key[6] / sk_directionQuanta, key[7] / sk_directionQuanta,
+                           key[8] / sk_directionQuanta, key[9] / sk_offsetQuanta };
+
+    auto stencil = std::make_shared<const BrushStencil>(
+                computeStencil( brushSizeInVoxels, brushIsRound, brushIs3d, spacings, plane ) );
+
+    if ( s_stencils.size() >= sk_maxCachedStencils )
+    {
+        s_stencils.clear();
+    }
+
+    s_stencils.emplace( key, stencil );
+
+    spdlog::trace( "Computed brush stencil of {} voxels in {} runs", stencil->m_numVoxels, stencil->m_runs.size() );
+    return stencil;
+}
@@ -0,0 +1,68 @@
+#ifndef BRUSH_STENCIL_H
+#define BRUSH_STENCIL_H
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+/**
+ * @brief Footprint of a segmentation brush: the voxels that it paints, relative to its center voxel.
+ * The voxels are held as runs along the x (row) axis, so that the stencil is stamped into a
+ * segmentation a row segment at a time. Stencils are computed once for each brush configuration
+ * and then reused by every paint event (see brushStencil).
+ */
+struct BrushStencil
+{
+    /// Run of consecutive voxels along a row
+    struct Run
+    {
+        glm::ivec3 m_start; //!< First voxel of the run, relative to the center voxel
+        int m_length; //!< Number of voxels in the run
+    };
+
+    std::vector<Run> m_runs; //!< Runs, ordered by slice, row, and then column
+
+    glm::ivec3 m_min{ 0 }; //!< Minimum voxel corner of the runs, relative to the center voxel
+    glm::ivec3 m_max{ -1 }; //!< Maximum voxel corner of the runs, relative to the center voxel
+
+    size_t m_numVoxels = 0; //!< Number of voxels painted by the brush
+
+    /// Does the stencil paint no voxels?
+    bool empty() const { return m_runs.empty(); }
+};
+
+
+/**
+ * @brief Get the stencil of a segmentation brush. Stencils are cached by brush configuration,
+ * so that they are only computed the first time that a configuration is used.
+ *
+ * A 3D brush paints the voxels inside a sphere (round brush) or cube (square brush). A 2D brush
+ * paints the voxels inside the sphere or cube that intersect the view plane and that are connected
+ * to the center voxel through such voxels. The 2D stencil depends only on the orientation of the
+ * plane and its offset from the center voxel, which are quantized to key the cache.
+ *
+ * @param[in] brushSizeInVoxels Brush width in voxels, such that the brush radius is one less than the width
+ * @param[in] brushIsRound Is the brush round (true) or square (false)?
+ * @param[in] brushIs3d Is the brush 3D (true) or 2D (false)?
+ * @param[in] mmToVoxelSpacings Coefficients that make the brush isotropic in physical space
+ * (all ones for a brush that is isotropic in voxel space)
+ * @param[in] voxelViewPlane View plane in Voxel space, relative to the center voxel: the plane passes
+ * through voxel v (relative to the center) iff dot( plane, vec4{ v, 1 } ) = 0. Ignored for 3D brushes.
+ *
+ * @return The brush stencil, which is never null. The voxels are not clipped to the segmentation.
+ * @note Thread-safe
+ */
+std::shared_ptr<const BrushStencil> brushStencil(
+        int brushSizeInVoxels,
+        bool brushIsRound,
+        bool brushIs3d,
+        const std::array<float, 3>& mmToVoxelSpacings,
+        const glm::vec4& voxelViewPlane );
+
+#endif // BRUSH_STENCIL_H
@@ -0,0 +1,1030 @@
+#include "image/DicomSeries.h"
+
+#include "common/ThreadPool.h"
+#include "common/UuidUtility.h"
+
+#include "image/ImageInfoCache.h"
+
+#include <gdcmAttribute.h>
+#include <gdcmDataSet.h>
+#include <gdcmImage.h>
+#include <gdcmImageReader.h>
+#include <gdcmReader.h>
+#include <gdcmTag.h>
+
+#include <glm/gtc/epsilon.hpp>
+
+#include <itkGDCMImageIO.h>
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+// On Apple platforms, we must use the alternative ghc::filesystem,
+// because it is not fully implemented or supported prior to macOS 10.15.
+#if !defined(__APPLE__)
+#if defined(__cplusplus) && __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<filesystem>)
+#define GHC_USE_STD_FS
+#include <filesystem>
+namespace fs = std::filesystem;
+#endif
+#endif
+#endif
+
+#ifndef GHC_USE_STD_FS
+#include <ghc/filesystem.hpp>
+namespace fs = ghc::filesystem;
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <type_traits>
+#include <unordered_map>
+
+
+namespace
+{
+
+using json = nlohmann::json;
+
+/// Sub-directory of the local cache directory that holds the header cache entries
+static const std::string sk_headerCacheSubDirectory( "dicom" );
+
+/// Version of the header cache entry format. Entries with other versions are ignored.
+static constexpr int sk_headerCacheVersion = 1;
+
+/// Offset of the "DICM" prefix in a DICOM file, which follows the preamble
+static constexpr size_t sk_preambleSize = 128;
+
+/// Tolerance for comparing slice orientations (direction cosines)
+static constexpr double sk_orientationTolerance = 1.0e-4;
+
+/// Relative tolerance of the spacing between slices, beyond which the spacing is reported as non-uniform
+static constexpr double sk_sliceSpacingTolerance = 0.01;
+
+static constexpr uint64_t sk_fnvOffsetBasis = 14695981039346656037ull;
+static constexpr uint64_t sk_fnvPrime = 1099511628211ull;
+
+
+/// Is the value an integer, up to the precision of doubles?
+bool isIntegral( double value )
+{
+    return std::abs( value - std::round( value ) ) < glm::epsilon<double>();
+}
+
+
+/// Size and modification time of a file, which identify the version of its header in the cache
+struct FileStamp
+{
+    uint64_t m_sizeInBytes = 0;
+    int64_t m_modifiedTime = 0;
+
+    bool operator==( const FileStamp& other ) const
+    {
+        return m_sizeInBytes == other.m_sizeInBytes && m_modifiedTime == other.m_modifiedTime;
+    }
+};
+
+
+/// Header of a file in the cache. Files that are not DICOM slices are cached without slice information.
+struct CachedHeader
+{
+    FileStamp m_stamp;
+    std::optional<DicomSliceInfo> m_slice;
+};
+
+
+bool isDicomFile( const std::string& fileName )
+{
+    std::ifstream file( fileName, std::ios::in | std::ios::binary );
+
+    char prefix[4] = { 0, 0, 0, 0 };
+    file.seekg( static_cast<std::streamoff>( sk_preambleSize ) );
+    file.read( prefix, 4 );
+
+    return ( file && 0 == std::strncmp( prefix, "DICM", 4 ) );
+}
+
+
+std::optional<FileStamp> fileStamp( const fs::path& path )
+{
+    std::error_code error;
+    FileStamp stamp;
+
+    stamp.m_sizeInBytes = static_cast<uint64_t>( fs::file_size( path, error ) );
+    if ( error ) return std::nullopt;
+
+    const auto modifiedTime = fs::last_write_time( path, error );
+    if ( error ) return std::nullopt;
+
+    stamp.m_modifiedTime = static_cast<int64_t>( modifiedTime.time_since_epoch().count() );
+    return stamp;
+}
+
+
+/// Get the value of a string element, without its padding; empty if the element is missing
+std::string tagString( const gdcm::DataSet& ds, const gdcm::Tag& tag )
+{
+    if ( ! ds.FindDataElement( tag ) )
+    {
+        return std::string();
+    }
+
+    const gdcm::ByteValue* value = ds.GetDataElement( tag ).GetByteValue();
+
+    if ( ! value )
+    {
+        return std::string();
+    }
+
+    std::string s( value->GetPointer(), value->GetLength() );
+    s.erase( s.find_last_not_of( std::string( " \0", 2 ) ) + 1 );
+    s.erase( 0, std::min( s.find_first_not_of( ' ' ), s.size() ) );
+    return s;
+}
+
+
+/// Get the values of a decimal or integer string element, which are separated by backslashes
+std::vector<double> tagNumbers( const gdcm::DataSet& ds, const gdcm::Tag& tag )
+{
+    std::vector<double> numbers;
+    std::istringstream values( tagString( ds, tag ) );
+    std::string value;
+
+    while ( std::getline( values, value, '\\' ) )
+    {
+        try
+        {
+            numbers.push_back( std::stod( value ) );
+        }
+        catch ( const std::exception& )
+        {
+            return {};
+        }
+    }
+
+    return numbers;
+}
+
+
+/// Get the value of an unsigned short element; the default value if the element is missing
+template< uint16_t Group, uint16_t Element >
+uint16_t tagUShort( const gdcm::DataSet& ds, uint16_t defaultValue )
+{
+    gdcm::Attribute<Group, Element> attribute;
+
+    if ( ! ds.FindDataElement( attribute.GetTag() ) || ds.GetDataElement( attribute.GetTag() ).IsEmpty() )
+    {
+        return defaultValue;
+    }
+
+    attribute.SetFromDataSet( ds );
+    return attribute.GetValue();
+}
+
+
+/// Read the header of a DICOM slice file, up to its pixel data
+std::optional<DicomSliceInfo> readSliceInfo( const std::string& fileName )
+{
+    if ( ! isDicomFile( fileName ) )
+    {
+        return std::nullopt;
+    }
+
+    gdcm::Reader reader;
+    reader.SetFileName( fileName.c_str() );
+
+    if ( ! reader.ReadUpToTag( gdcm::Tag( 0x7fe0, 0x0010 ), std::set<gdcm::Tag>() ) )
+    {
+        spdlog::debug( "Unable to read DICOM header of file {}", fileName );
+        return std::nullopt;
+    }
+
+    const gdcm::DataSet& ds = reader.GetFile().GetDataSet();
+
+    DicomSliceInfo slice;
+    slice.m_fileName = fileName;
+    slice.m_seriesUid = tagString( ds, gdcm::Tag( 0x0020, 0x000e ) );
+    slice.m_seriesDescription = tagString( ds, gdcm::Tag( 0x0008, 0x103e ) );
+
+    slice.m_dims[0] = tagUShort<0x0028, 0x0011>( ds, 0 );
+    slice.m_dims[1] = tagUShort<0x0028, 0x0010>( ds, 0 );
+    slice.m_numComponents = tagUShort<0x0028, 0x0002>( ds, 1 );
+
+    slice.m_bitsAllocated = tagUShort<0x0028, 0x0100>( ds, 0 );
+    slice.m_bitsStored = tagUShort<0x0028, 0x0101>( ds, slice.m_bitsAllocated );
+    slice.m_highBit = tagUShort<0x0028, 0x0102>( ds, static_cast<uint16_t>( slice.m_bitsStored - 1 ) );
+    slice.m_pixelRepresentation = tagUShort<0x0028, 0x0103>( ds, 0 );
+
+    const std::vector<double> instanceNumber = tagNumbers( ds, gdcm::Tag( 0x0020, 0x0013 ) );
+    const std::vector<double> numFrames = tagNumbers( ds, gdcm::Tag( 0x0028, 0x0008 ) );
+    const std::vector<double> position = tagNumbers( ds, gdcm::Tag( 0x0020, 0x0032 ) );
+    const std::vector<double> orientation = tagNumbers( ds, gdcm::Tag( 0x0020, 0x0037 ) );
+    const std::vector<double> pixelSpacing = tagNumbers( ds, gdcm::Tag( 0x0028, 0x0030 ) );
+    const std::vector<double> intercept = tagNumbers( ds, gdcm::Tag( 0x0028, 0x1052 ) );
+    const std::vector<double> slope = tagNumbers( ds, gdcm::Tag( 0x0028, 0x1053 ) );
+
+    if ( ! instanceNumber.empty() ) slice.m_instanceNumber = static_cast<int32_t>( instanceNumber[0] );
+    if ( ! numFrames.empty() ) slice.m_numFrames = static_cast<uint32_t>( std::max( numFrames[0], 1.0 ) );
+    if ( 3 == position.size() ) std::copy( std::begin( position ), std::end( position ), std::begin( slice.m_position ) );
+    if ( 6 == orientation.size() ) std::copy( std::begin( orientation ), std::end( orientation ), std::begin( slice.m_orientation ) );
+
+    // Pixel Spacing holds the spacing between rows, followed by the spacing between columns
+    if ( 2 == pixelSpacing.size() ) slice.m_spacing = { { pixelSpacing[1], pixelSpacing[0] } };
+
+    if ( ! intercept.empty() ) slice.m_rescaleIntercept = intercept[0];
+    if ( ! slope.empty() && glm::epsilonNotEqual( slope[0], 0.0, glm::epsilon<double>() ) )
+    {
+        slice.m_rescaleSlope = slope[0];
+    }
+
+    // Files without pixel data, such as structured reports and presentation states, are not slices
+    if ( 0 == slice.m_dims[0] || 0 == slice.m_dims[1] || 0 == slice.m_bitsAllocated || slice.m_seriesUid.empty() )
+    {
+        return std::nullopt;
+    }
+
+    return slice;
+}
+
+
+json toJson( const DicomSliceInfo& slice )
+{
+    return json
+    {
+        { "seriesUid", slice.m_seriesUid },
+        { "seriesDescription", slice.m_seriesDescription },
+        { "instanceNumber", slice.m_instanceNumber },
+        { "dims", slice.m_dims },
+        { "numFrames", slice.m_numFrames },
+        { "numComponents", slice.m_numComponents },
+        { "position", slice.m_position },
+        { "orientation", slice.m_orientation },
+        { "spacing", slice.m_spacing },
+        { "bitsAllocated", slice.m_bitsAllocated },
+        { "bitsStored", slice.m_bitsStored },
+        { "highBit", slice.m_highBit },
+        { "pixelRepresentation", slice.m_pixelRepresentation },
+        { "rescaleIntercept", slice.m_rescaleIntercept },
+        { "rescaleSlope", slice.m_rescaleSlope }
+    };
+}
+
+
+void fromJson( const json& j, DicomSliceInfo& slice )
+{
+    j.at( "seriesUid" ).get_to( slice.m_seriesUid );
+    j.at( "seriesDescription" ).get_to( slice.m_seriesDescription );
+    j.at( "instanceNumber" ).get_to( slice.m_instanceNumber );
+    j.at( "dims" ).get_to( slice.m_dims );
+    j.at( "numFrames" ).get_to( slice.m_numFrames );
+    j.at( "numComponents" ).get_to( slice.m_numComponents );
+    j.at( "position" ).get_to( slice.m_position );
+    j.at( "orientation" ).get_to( slice.m_orientation );
+    j.at( "spacing" ).get_to( slice.m_spacing );
+    j.at( "bitsAllocated" ).get_to( slice.m_bitsAllocated );
+    j.at( "bitsStored" ).get_to( slice.m_bitsStored );
+    j.at( "highBit" ).get_to( slice.m_highBit );
+    j.at( "pixelRepresentation" ).get_to( slice.m_pixelRepresentation );
+    j.at( "rescaleIntercept" ).get_to( slice.m_rescaleIntercept );
+    j.at( "rescaleSlope" ).get_to( slice.m_rescaleSlope );
+}
+
+
+/// Get the path of the header cache entry of a scanned directory
+std::optional<fs::path> headerCachePath( const std::string& directory, bool recursive )
+{
+    const auto dir = cache::cacheDirectory( sk_headerCacheSubDirectory );
+
+    if ( ! dir )
+    {
+        return std::nullopt;
+    }
+
+    uint64_t hash = sk_fnvOffsetBasis;
+
+    for ( const char c : directory + ( recursive ? "/**" : "/*" ) )
+    {
+        hash ^= static_cast<uint8_t>( c );
+        hash *= sk_fnvPrime;
+    }
+
+    std::ostringstream name;
+    name << std::hex << std::setw( 16 ) << std::setfill( '0' ) << hash << ".json";
+
+    return fs::path( *dir ) / name.str();
+}
+
+
+std::unordered_map<std::string, CachedHeader> loadHeaderCache( const fs::path& cachePath, const std::string& directory )
+{
+    std::unordered_map<std::string, CachedHeader> headers;
+    std::ifstream file( cachePath );
+
+    if ( ! file )
+    {
+        return headers;
+    }
+
+    try
+    {
+        const json j = json::parse( file );
+
+        if ( sk_headerCacheVersion != j.at( "version" ).get<int>() ||
+             directory != j.at( "directory" ).get<std::string>() )
+        {
+            return headers;
+        }
+
+        for ( const json& entry : j.at( "files" ) )
+        {
+            CachedHeader header;
+            entry.at( "sizeInBytes" ).get_to( header.m_stamp.m_sizeInBytes );
+            entry.at( "modifiedTime" ).get_to( header.m_stamp.m_modifiedTime );
+
+            std::string fileName = entry.at( "path" ).get<std::string>();
+
+            if ( entry.contains( "slice" ) )
+            {
+                header.m_slice.emplace();
+                fromJson( entry.at( "slice" ), *header.m_slice );
+                header.m_slice->m_fileName = fileName;
+            }
+
+            headers.emplace( std::move( fileName ), std::move( header ) );
+        }
+    }
+    catch ( const std::exception& e )
+    {
+        spdlog::warn( "Invalid DICOM header cache entry {}: {}", cachePath.string(), e.what() );
+        headers.clear();
+    }
+
+    return headers;
+}
+
+
+bool saveHeaderCache( const fs::path& cachePath, const std::string& directory,
+                      const std::unordered_map<std::string, CachedHeader>& headers )
+{
+    if ( ! cache::createCacheDirectory( sk_headerCacheSubDirectory ) )
+    {
+        return false;
+    }
+
+    json files = json::array();
+
+    for ( const auto& [fileName, header] : headers )
+    {
+        json entry{
+            { "path", fileName },
+            { "sizeInBytes", header.m_stamp.m_sizeInBytes },
+            { "modifiedTime", header.m_stamp.m_modifiedTime } };
+
+        if ( header.m_slice )
+        {
+            entry["slice"] = toJson( *header.m_slice );
+        }
+
+        files.push_back( std::move( entry ) );
+    }
+
+    const json j{
+        { "version", sk_headerCacheVersion },
+        { "directory", directory },
+        { "files", files } };
+
+    // Write to a uniquely named temporary file that replaces the entry, so that other instances of
+    // the application neither read a partially written entry nor write to the same temporary file
+    fs::path tempPath = cachePath;
+    tempPath += "." + uuids::to_string( generateRandomUuid() ) + ".tmp";
+
+    try
+    {
+        std::error_code error;
+
+        {
+            std::ofstream file( tempPath );
+            file << j;
+
+            if ( ! file )
+            {
+                file.close();
+                fs::remove( tempPath, error );
+                return false;
+            }
+        }
+
+        fs::rename( tempPath, cachePath, error );
+
+        if ( error )
+        {
+            fs::remove( tempPath, error );
+            return false;
+        }
+    }
+    catch ( const std::exception& e )
+    {
+        spdlog::warn( "Exception saving DICOM header cache entry {}: {}", cachePath.string(), e.what() );
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Read the headers of the DICOM slice files in a directory. Headers of files that are unchanged
+ * since they were cached are taken from the cache; the others are read on multiple threads and cached.
+ */
+std::vector<DicomSliceInfo> scanSliceHeaders( const fs::path& directory, bool recursive )
+{
+    std::error_code error;
+    std::vector< std::pair<std::string, FileStamp> > files;
+
+    auto addFile = [&files] ( const fs::directory_entry& entry )
+    {
+        std::error_code fileError;
+
+        if ( ! entry.is_regular_file( fileError ) || "DICOMDIR" == entry.path().filename() )
+        {
+            return;
+        }
+
+        if ( const auto stamp = fileStamp( entry.path() ) )
+        {
+            files.emplace_back( entry.path().string(), *stamp );
+        }
+    };
+
+    if ( recursive )
+    {
+        for ( auto it = fs::recursive_directory_iterator( directory, fs::directory_options::skip_permission_denied, error );
+              ! error && it != fs::recursive_directory_iterator(); it.increment( error ) )
+        {
+            addFile( *it );
+        }
+    }
+    else
+    {
+        for ( auto it = fs::directory_iterator( directory, error );
+              ! error && it != fs::directory_iterator(); it.increment( error ) )
+        {
+            addFile( *it );
+        }
+    }
+
+    if ( error )
+    {
+        spdlog::warn( "Error listing files of directory {}: {}", directory.string(), error.message() );
+    }
+
+    const std::string directoryName = directory.string();
+    const std::optional<fs::path> cachePath = headerCachePath( directoryName, recursive );
+
+    std::unordered_map<std::string, CachedHeader> cachedHeaders =
+            cachePath ? loadHeaderCache( *cachePath, directoryName ) : std::unordered_map<std::string, CachedHeader>();
+
+    std::unordered_map<std::string, CachedHeader> headers;
+    std::vector< std::pair< std::string, FileStamp > > filesToRead;
+
+    for ( const auto& [fileName, stamp] : files )
+    {
+        auto it = cachedHeaders.find( fileName );
+
+        if ( std::end( cachedHeaders ) != it && it->second.m_stamp == stamp )
+        {
+            headers.emplace( fileName, std::move( it->second ) );
+        }
+        else
+        {
+            filesToRead.emplace_back( fileName, stamp );
+        }
+    }
+
+    if ( ! filesToRead.empty() )
+    {
+        ThreadPool pool( ThreadPool::defaultNumThreads( filesToRead.size() ) );
+        std::vector< std::future< std::optional<DicomSliceInfo> > > futureSlices;
+
+        for ( const auto& file : filesToRead )
+        {
+            futureSlices.push_back( pool.submit( [fileName = file.first] () { return readSliceInfo( fileName ); } ) );
+        }
+
+        for ( size_t i = 0; i < filesToRead.size(); ++i )
+        {
+            std::optional<DicomSliceInfo> slice;
+
+            try
+            {
+                slice = futureSlices[i].get();
+            }
+            catch ( const std::exception& e )
+            {
+                spdlog::debug( "Exception reading DICOM header of file {}: {}", filesToRead[i].first, e.what() );
+            }
+
+            headers.emplace( filesToRead[i].first, CachedHeader{ filesToRead[i].second, std::move( slice ) } );
+        }
+    }
+
+    spdlog::debug( "Scanned {} files in directory {}, of which {} headers were cached",
+                   files.size(), directoryName, files.size() - filesToRead.size() );
+
+    // The cache is rewritten if files were read, added, or removed
+    if ( cachePath && ( ! filesToRead.empty() || headers.size() != cachedHeaders.size() ) )
+    {
+        saveHeaderCache( *cachePath, directoryName, headers );
+    }
+
+    std::vector<DicomSliceInfo> slices;
+
+    for ( auto& header : headers )
+    {
+        if ( header.second.m_slice )
+        {
+            slices.push_back( std::move( *header.second.m_slice ) );
+        }
+    }
+
+    return slices;
+}
+
+
+std::array<double, 3> sliceNormal( const std::array<double, 6>& o )
+{
+    return { { o[1] * o[5] - o[2] * o[4],
+               o[2] * o[3] - o[0] * o[5],
+               o[0] * o[4] - o[1] * o[3] } };
+}
+
+
+double dot( const std::array<double, 3>& a, const std::array<double, 3>& b )
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+
+/// Do two slices have the same geometry and pixel format, so that they can be stacked into a volume?
+bool isStackable( const DicomSliceInfo& a, const DicomSliceInfo& b )
+{
+    for ( size_t i = 0; i < 6; ++i )
+    {
+        if ( std::abs( a.m_orientation[i] - b.m_orientation[i] ) > sk_orientationTolerance )
+        {
+            return false;
+        }
+    }
+
+    return ( a.m_dims == b.m_dims && 1 == b.m_numFrames &&
+             a.m_numComponents == b.m_numComponents &&
+             a.m_bitsAllocated == b.m_bitsAllocated &&
+             a.m_bitsStored == b.m_bitsStored &&
+             a.m_pixelRepresentation == b.m_pixelRepresentation );
+}
+
+
+/**
+ * @brief Get the smallest component type that holds the rescaled values of all slices. Integer types are
+ * used if all slopes and intercepts are integers; otherwise, values are held as 32-bit floating point.
+ */
+itk::IOComponentEnum rescaledComponentType( const std::vector<DicomSliceInfo>& slices )
+{
+    using CType = itk::IOComponentEnum;
+
+    const DicomSliceInfo& first = slices.front();
+    const bool isSigned = ( 1 == first.m_pixelRepresentation );
+    const uint16_t bits = std::min<uint16_t>( first.m_bitsStored, 32 );
+
+    const double storedMin = isSigned ? -std::ldexp( 1.0, bits - 1 ) : 0.0;
+    const double storedMax = isSigned ? std::ldexp( 1.0, bits - 1 ) - 1.0 : std::ldexp( 1.0, bits ) - 1.0;
+
+    double minValue = std::numeric_limits<double>::max();
+    double maxValue = std::numeric_limits<double>::lowest();
+    bool isInteger = true;
+
+    for ( const auto& slice : slices )
+    {
+        const double a = slice.m_rescaleSlope * storedMin + slice.m_rescaleIntercept;
+        const double b = slice.m_rescaleSlope * storedMax + slice.m_rescaleIntercept;
+
+        minValue = std::min( { minValue, a, b } );
+        maxValue = std::max( { maxValue, a, b } );
+
+        isInteger &= ( isIntegral( slice.m_rescaleSlope ) && isIntegral( slice.m_rescaleIntercept ) );
+    }
+
+    auto fits = [minValue, maxValue] ( auto zero )
+    {
+        using T = decltype( zero );
+        return ( minValue >= static_cast<double>( std::numeric_limits<T>::lowest() ) &&
+                 maxValue <= static_cast<double>( std::numeric_limits<T>::max() ) );
+    };
+
+    if ( ! isInteger ) return CType::FLOAT;
+    if ( fits( uint8_t{} ) ) return CType::UCHAR;
+    if ( fits( int8_t{} ) ) return CType::CHAR;
+    if ( fits( uint16_t{} ) ) return CType::USHORT;
+    if ( fits( int16_t{} ) ) return CType::SHORT;
+    if ( fits( uint32_t{} ) ) return CType::UINT;
+    if ( fits( int32_t{} ) ) return CType::INT;
+    return CType::FLOAT;
+}
+
+
+/// Call func( zero ) with a zero value of the type of rescaled components
+template< class Func >
+bool visitRescaledType( itk::IOComponentEnum componentType, Func&& func )
+{
+    using CType = itk::IOComponentEnum;
+
+    switch ( componentType )
+    {
+    case CType::UCHAR:  func( uint8_t{} ); return true;
+    case CType::CHAR:   func( int8_t{} ); return true;
+    case CType::USHORT: func( uint16_t{} ); return true;
+    case CType::SHORT:  func( int16_t{} ); return true;
+    case CType::UINT:   func( uint32_t{} ); return true;
+    case CType::INT:    func( int32_t{} ); return true;
+    case CType::FLOAT:  func( float{} ); return true;
+    default: return false;
+    }
+}
+
+
+/// Call func( zero ) with a zero value of the type of stored components
+template< class Func >
+bool visitStoredType( uint16_t bitsAllocated, bool isSigned, Func&& func )
+{
+    switch ( bitsAllocated )
+    {
+    case 8:  isSigned ? func( int8_t{} ) : func( uint8_t{} ); return true;
+    case 16: isSigned ? func( int16_t{} ) : func( uint16_t{} ); return true;
+    case 32: isSigned ? func( int32_t{} ) : func( uint32_t{} ); return true;
+    default: return false;
+    }
+}
+
+
+/**
+ * @brief Decode the pixel data of a slice, which is decompressed if its transfer syntax is compressed,
+ * and rescale its stored values into the slice of the series buffer
+ */
+template< class T >
+bool decodeSlice( const DicomSliceInfo& slice, T* dest )
+{
+    gdcm::ImageReader reader;
+    reader.SetFileName( slice.m_fileName.c_str() );
+
+    if ( ! reader.Read() )
+    {
+        spdlog::error( "Unable to read DICOM file {}", slice.m_fileName );
+        return false;
+    }
+
+    const gdcm::Image& image = reader.GetImage();
+
+    std::vector<char> raw( image.GetBufferLength() );
+
+    if ( ! image.GetBuffer( raw.data() ) )
+    {
+        spdlog::error( "Unable to decode pixel data of DICOM file {} with transfer syntax {}",
+                       slice.m_fileName, image.GetTransferSyntax().GetString() );
+        return false;
+    }
+
+    const size_t numPixels = static_cast<size_t>( slice.m_dims[0] ) * slice.m_dims[1];
+    const size_t numComps = slice.m_numComponents;
+    const size_t storedSize = slice.m_bitsAllocated / 8u;
+
+    if ( raw.size() < numPixels * numComps * storedSize )
+    {
+        spdlog::error( "DICOM file {} has {} bytes of pixel data, but {} were expected",
+                       slice.m_fileName, raw.size(), numPixels * numComps * storedSize );
+        return false;
+    }
+
+    // Components of color slices with planar configuration are held plane by plane
+    const bool isPlanar = ( numComps > 1 && 1 == image.GetPlanarConfiguration() );
+
+    const bool isSigned = ( 1 == slice.m_pixelRepresentation );
+    const bool isIdentity = ( glm::epsilonEqual( slice.m_rescaleSlope, 1.0, glm::epsilon<double>() ) &&
+                              glm::epsilonEqual( slice.m_rescaleIntercept, 0.0, glm::epsilon<double>() ) );
+
+    return visitStoredType( slice.m_bitsAllocated, isSigned, [&] ( auto zero )
+    {
+        using S = decltype( zero );
+
+        // Bits above the stored bits may hold overlays, so they are masked out or replaced by the sign
+        const int unusedBits = static_cast<int>( 8 * sizeof( S ) ) - std::min<int>( slice.m_bitsStored, 8 * sizeof( S ) );
+
+        auto storedValue = [unusedBits] ( S v ) -> S
+        {
+            if ( 0 == unusedBits ) return v;
+
+            using U = std::make_unsigned_t<S>;
+            const U shifted = static_cast<U>( static_cast<U>( v ) << unusedBits );
+
+            if constexpr ( std::is_signed_v<S> )
+            {
+                return static_cast<S>( static_cast<S>( shifted ) >> unusedBits );
+            }
+            else
+            {
+                return static_cast<S>( shifted >> unusedBits );
+            }
+        };
+
+        const S* source = reinterpret_cast<const S*>( raw.data() );
+
+        for ( size_t p = 0; p < numPixels; ++p )
+        {
+            for ( size_t c = 0; c < numComps; ++c )
+            {
+                const S v = storedValue( source[isPlanar ? c * numPixels + p : p * numComps + c] );
+
+                dest[p * numComps + c] = isIdentity
+                        ? static_cast<T>( v )
+                        : static_cast<T>( slice.m_rescaleSlope * static_cast<double>( v ) + slice.m_rescaleIntercept );
+            }
+        }
+    } );
+}
+
+} // anonymous
+
+
+bool isDicomSeriesPath( const std::string& path )
+{
+    std::error_code error;
+
+    if ( fs::is_directory( path, error ) )
+    {
+        return true;
+    }
+
+    return ( fs::is_regular_file( path, error ) && isDicomFile( path ) );
+}
+
+
+std::optional<DicomSeries> findDicomSeries( const std::string& path )
+{
+    std::error_code error;
+
+    const fs::path absolutePath = fs::absolute( fs::path( path ), error ).lexically_normal();
+    const bool isDirectory = fs::is_directory( absolutePath, error );
+
+    // The series of a file is found among the other files of its directory
+    const fs::path directory = isDirectory ? absolutePath : absolutePath.parent_path();
+
+    std::vector<DicomSliceInfo> slices = scanSliceHeaders( directory, isDirectory );
+
+    if ( slices.empty() )
+    {
+        spdlog::debug( "No DICOM slices found in directory {}", directory.string() );
+        return std::nullopt;
+    }
+
+    // Group the slices by series
+    std::map< std::string, std::vector<DicomSliceInfo> > seriesSlices;
+
+    for ( auto& slice : slices )
+    {
+        seriesSlices[slice.m_seriesUid].push_back( std::move( slice ) );
+    }
+
+    // Choose the series of the file, or else the series with the most slices
+    const std::string fileName = absolutePath.string();
+    auto chosen = std::end( seriesSlices );
+
+    for ( auto it = std::begin( seriesSlices ); it != std::end( seriesSlices ); ++it )
+    {
+        if ( ! isDirectory )
+        {
+            const auto& s = it->second;
+            if ( std::any_of( std::begin( s ), std::end( s ), [&fileName] ( const DicomSliceInfo& slice ) {
+                 return slice.m_fileName == fileName; } ) )
+            {
+                chosen = it;
+                break;
+            }
+        }
+        else if ( std::end( seriesSlices ) == chosen || it->second.size() > chosen->second.size() )
+        {
+            chosen = it;
+        }
+    }
+
+    if ( std::end( seriesSlices ) == chosen )
+    {
+        return std::nullopt;
+    }
+
+    if ( isDirectory && seriesSlices.size() > 1 )
+    {
+        spdlog::info( "Directory {} holds {} DICOM series; loading series {} with the most slices ({})",
+                      directory.string(), seriesSlices.size(), chosen->first, chosen->second.size() );
+    }
+
+    std::vector<DicomSliceInfo>& candidates = chosen->second;
+
+    // The reference slice is the file itself, or else the slice with the lowest instance number
+    auto reference = std::min_element( std::begin( candidates ), std::end( candidates ),
+                                       [&fileName, isDirectory] ( const DicomSliceInfo& a, const DicomSliceInfo& b )
+    {
+        if ( ! isDirectory ) return ( a.m_fileName == fileName && b.m_fileName != fileName );
+        return a.m_instanceNumber < b.m_instanceNumber;
+    } );
+
+    const DicomSliceInfo referenceSlice = *reference;
+
+    if ( referenceSlice.m_numFrames > 1 )
+    {
+        // Multi-frame files hold a whole volume and are read by ITK
+        return std::nullopt;
+    }
+
+    // Slices with other geometries, such as localizers, are not part of the volume
+    std::vector<DicomSliceInfo> stack;
+
+    for ( auto& slice : candidates )
+    {
+        if ( isStackable( referenceSlice, slice ) )
+        {
+            stack.push_back( std::move( slice ) );
+        }
+    }
+
+    if ( stack.size() < candidates.size() )
+    {
+        spdlog::warn( "Ignoring {} slices of DICOM series {} whose geometry or pixel format differs from "
+                      "that of the series", candidates.size() - stack.size(), chosen->first );
+    }
+
+    // Sort the slices by their position along the slice normal
+    const std::array<double, 3> normal = sliceNormal( referenceSlice.m_orientation );
+
+    std::stable_sort( std::begin( stack ), std::end( stack ), [&normal] ( const DicomSliceInfo& a, const DicomSliceInfo& b )
+    {
+        return dot( a.m_position, normal ) < dot( b.m_position, normal );
+    } );
+
+    // Slices at the same position (such as other echoes or time points) are not part of the volume
+    const double minSliceDistance = 1.0e-3 * std::min( referenceSlice.m_spacing[0], referenceSlice.m_spacing[1] );
+
+    const auto duplicates = std::unique( std::begin( stack ), std::end( stack ),
+                                         [&normal, minSliceDistance] ( const DicomSliceInfo& a, const DicomSliceInfo& b )
+    {
+        return std::abs( dot( b.m_position, normal ) - dot( a.m_position, normal ) ) < minSliceDistance;
+    } );
+
+    if ( duplicates != std::end( stack ) )
+    {
+        spdlog::warn( "Ignoring {} slices of DICOM series {} at duplicate positions",
+                      std::distance( duplicates, std::end( stack ) ), chosen->first );
+        stack.erase( duplicates, std::end( stack ) );
+    }
+
+    if ( stack.size() < 2 )
+    {
+        return std::nullopt;
+    }
+
+    const double firstPosition = dot( stack.front().m_position, normal );
+    const double sliceSpacing = ( dot( stack.back().m_position, normal ) - firstPosition ) / ( stack.size() - 1 );
+
+    for ( size_t k = 1; k < stack.size(); ++k )
+    {
+        const double gap = dot( stack[k].m_position, normal ) - dot( stack[k - 1].m_position, normal );
+
+        if ( std::abs( gap - sliceSpacing ) > sk_sliceSpacingTolerance * sliceSpacing )
+        {
+            spdlog::warn( "Slices of DICOM series {} are not uniformly spaced; using their mean spacing of {} mm",
+                          chosen->first, sliceSpacing );
+            break;
+        }
+    }
+
+    DicomSeries series;
+    series.m_seriesUid = chosen->first;
+    series.m_description = referenceSlice.m_seriesDescription;
+    series.m_dims = { { referenceSlice.m_dims[0], referenceSlice.m_dims[1], static_cast<uint32_t>( stack.size() ) } };
+    series.m_origin = stack.front().m_position;
+    series.m_spacing = { { referenceSlice.m_spacing[0], referenceSlice.m_spacing[1], sliceSpacing } };
+
+    series.m_directions = { {
+        { { referenceSlice.m_orientation[0], referenceSlice.m_orientation[1], referenceSlice.m_orientation[2] } },
+        { { referenceSlice.m_orientation[3], referenceSlice.m_orientation[4], referenceSlice.m_orientation[5] } },
+        normal } };
+
+    series.m_numComponents = referenceSlice.m_numComponents;
+    series.m_componentType = rescaledComponentType( stack );
+    series.m_slices = std::move( stack );
+
+    spdlog::info( "Found DICOM series {} ('{}') with {} slices of {} x {} pixels",
+                  series.m_seriesUid, series.m_description, series.m_dims[2], series.m_dims[0], series.m_dims[1] );
+
+    return series;
+}
+
+
+itk::ImageIOBase::Pointer createDicomSeriesImageIo( const DicomSeries& series, const std::string& path )
+{
+    try
+    {
+        itk::GDCMImageIO::Pointer imageIo = itk::GDCMImageIO::New();
+        imageIo->SetFileName( series.m_slices.front().m_fileName );
+        imageIo->ReadImageInformation();
+
+        imageIo->SetNumberOfDimensions( 3 );
+
+        for ( uint32_t i = 0; i < 3; ++i )
+        {
+            imageIo->SetDimensions( i, series.m_dims[i] );
+            imageIo->SetOrigin( i, series.m_origin[i] );
+            imageIo->SetSpacing( i, series.m_spacing[i] );
+            imageIo->SetDirection( i, std::vector<double>( std::begin( series.m_directions[i] ),
+                                                           std::end( series.m_directions[i] ) ) );
+        }
+
+        imageIo->SetNumberOfComponents( series.m_numComponents );
+        imageIo->SetPixelType( 1 == series.m_numComponents ? itk::IOPixelEnum::SCALAR
+                                                           : ( 3 == series.m_numComponents ? itk::IOPixelEnum::RGB
+                                                                                           : itk::IOPixelEnum::VECTOR ) );
+        imageIo->SetComponentType( series.m_componentType );
+        imageIo->SetFileName( path );
+
+        return imageIo;
+    }
+    catch ( const std::exception& e )
+    {
+        spdlog::error( "Exception reading DICOM series {} from {}: {}", series.m_seriesUid, path, e.what() );
+        return nullptr;
+    }
+}
+
+
+bool readDicomSeries( const DicomSeries& series, void* buffer, const FileLoadProgress* progress )
+{
+    const size_t numSlices = series.m_slices.size();
+    const size_t sliceSize = static_cast<size_t>( series.m_dims[0] ) * series.m_dims[1] * series.m_numComponents;
+
+    std::atomic<size_t> numDecoded( 0 );
+    bool decoded = true;
+
+    const bool visited = visitRescaledType( series.m_componentType, [&] ( auto zero )
+    {
+        using T = decltype( zero );
+
+        ThreadPool pool( ThreadPool::defaultNumThreads( numSlices ) );
+        std::vector< std::future<bool> > futures;
+        futures.reserve( numSlices );
+
+        for ( size_t k = 0; k < numSlices; ++k )
+        {
+            T* dest = static_cast<T*>( buffer ) + k * sliceSize;
+
+            futures.push_back( pool.submit( [&series, &numDecoded, numSlices, progress, k, dest] ()
+            {
+                if ( progress && progress->isCancelled() )
+                {
+                    return false;
+                }
+
+                const bool sliceDecoded = decodeSlice<T>( series.m_slices[k], dest );
+
+                if ( progress )
+                {
+                    progress->setFraction( static_cast<double>( ++numDecoded ) / numSlices );
+                }
+
+                return sliceDecoded;
+            } ) );
+        }
+
+        for ( auto& future : futures )
+        {
+            try
+            {
+                decoded &= future.get();
+            }
+            catch ( const std::exception& e )
+            {
+                spdlog::error( "Exception decoding slice of DICOM series {}: {}", series.m_seriesUid, e.what() );
+                decoded = false;
+            }
+        }
+    } );
+
+    return ( visited && decoded );
+}
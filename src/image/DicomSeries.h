@@ -0,0 +1,103 @@
+#ifndef DICOM_SERIES_H
+#define DICOM_SERIES_H
+
+#include "common/LoadProgress.h"
+
+#include <itkCommonEnums.h>
+#include <itkImageIOBase.h>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+/// Header fields of a DICOM slice file that are used to assemble its series
+struct DicomSliceInfo
+{
+    std::string m_fileName;
+    std::string m_seriesUid; //!< Series Instance UID
+    std::string m_seriesDescription;
+    int32_t m_instanceNumber = 0;
+
+    std::array<uint32_t, 2> m_dims{ { 0, 0 } }; //!< Columns and rows
+    uint32_t m_numFrames = 1;
+    uint32_t m_numComponents = 1; //!< Samples per pixel
+
+    std::array<double, 3> m_position{ { 0.0, 0.0, 0.0 } }; //!< Image Position (Patient)
+    std::array<double, 6> m_orientation{ { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0 } }; //!< Row and column cosines
+    std::array<double, 2> m_spacing{ { 1.0, 1.0 } }; //!< Spacing between columns and between rows
+
+    uint16_t m_bitsAllocated = 0;
+    uint16_t m_bitsStored = 0;
+    uint16_t m_highBit = 0;
+    uint16_t m_pixelRepresentation = 0; //!< 0 for unsigned and 1 for signed stored values
+
+    double m_rescaleIntercept = 0.0;
+    double m_rescaleSlope = 1.0;
+};
+
+
+/**
+ * @brief Series of single-frame DICOM slices with the same geometry that form a 3D image.
+ * The slices are sorted by their position along the slice normal.
+ */
+struct DicomSeries
+{
+    std::string m_seriesUid;
+    std::string m_description;
+
+    std::vector<DicomSliceInfo> m_slices;
+
+    std::array<uint32_t, 3> m_dims; //!< Pixel dimensions of the image
+    std::array<double, 3> m_origin; //!< Position of the first voxel of the first slice
+    std::array<double, 3> m_spacing;
+    std::array< std::array<double, 3>, 3 > m_directions; //!< Directions of the image axes
+    uint32_t m_numComponents;
+
+    /// Type of the voxel values after rescaling by the slope and intercept of the series
+    itk::IOComponentEnum m_componentType;
+};
+
+
+/**
+ * @brief Is a path a directory or a DICOM file, either of which may hold a DICOM series?
+ * DICOM files are recognized by the "DICM" prefix that follows their 128-byte preamble.
+ */
+bool isDicomSeriesPath( const std::string& path );
+
+/**
+ * @brief Find the DICOM series at a path. For a directory, it and its sub-directories are scanned and
+ * the series with the most slices is chosen. For a file, the series of the file is found among the
+ * files of its directory.
+ *
+ * The headers of the files are read on multiple threads. They are cached, so that scanning a directory
+ * again only reads the headers of files that were added or changed since it was last scanned.
+ *
+ * @return The series; std::nullopt if no series with at least two slices of the same geometry is found,
+ * in which case a DICOM file can still be read on its own by ITK
+ */
+std::optional<DicomSeries> findDicomSeries( const std::string& path );
+
+/**
+ * @brief Create image IO information for a DICOM series. The header of its first slice is read by ITK,
+ * and then the dimensions, geometry, and component type are set to those of the series.
+ * @param[in] path Path of the series, which is set as the file name of the image IO
+ */
+itk::ImageIOBase::Pointer createDicomSeriesImageIo( const DicomSeries& series, const std::string& path );
+
+/**
+ * @brief Decode the slices of a DICOM series into a buffer on multiple threads. Slices with compressed
+ * transfer syntaxes (such as JPEG, JPEG-LS, JPEG 2000, and RLE) are decompressed, and stored values are
+ * rescaled by the slope and intercept of their slice.
+ *
+ * @param[out] buffer Buffer of the series' voxels, with interleaved components of type
+ * series.m_componentType
+ * @param[in] progress If not null, then the fraction of decoded slices is reported to it and
+ * decoding stops if loading has been cancelled
+ * @return True iff all slices were decoded
+ */
+bool readDicomSeries( const DicomSeries& series, void* buffer, const FileLoadProgress* progress = nullptr );
+
+#endif // DICOM_SERIES_H
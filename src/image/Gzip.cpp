@@ -0,0 +1,854 @@
+#include "image/Gzip.h"
+
+#include "common/ThreadPool.h"
+#include "image/MappedFileBuffer.h"
+
+#include <itk_zlib.h>
+
+#include <spdlog/spdlog.h>
+
+// On Apple platforms, we must use the alternative ghc::filesystem,
+// because it is not fully implemented or supported prior to macOS 10.15.
+#if !defined(__APPLE__)
+#if defined(__cplusplus) && __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<filesystem>)
+#define GHC_USE_STD_FS
+#include <filesystem>
+namespace fs = std::filesystem;
+#endif
+#endif
+#endif
+
+#ifndef GHC_USE_STD_FS
+#include <ghc/filesystem.hpp>
+namespace fs = ghc::filesystem;
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <optional>
+#include <system_error>
+#include <thread>
+
+
+namespace
+{
+
+static constexpr unsigned char sk_gzipId1 = 0x1f;
+static constexpr unsigned char sk_gzipId2 = 0x8b;
+
+/// Largest number of bytes passed to zlib at once, since its sizes are 32-bit
+static constexpr size_t sk_maxZlibChunkSize = size_t( 1 ) << 30;
+
+/// Number of uncompressed bytes inflated between progress updates of a single stream
+static constexpr size_t sk_progressInterval = size_t( 1 ) << 24;
+
+/// Distance in bytes by which compressed data are read ahead of the single-stream inflater
+static constexpr size_t sk_readAheadSize = size_t( 1 ) << 26;
+
+/// Number of groups of BGZF blocks inflated per thread, which balances the load across threads
+static constexpr size_t sk_numBlockGroupsPerThread = 4;
+
+/// Largest number of uncompressed bytes deflated into one BGZF block, as written by bgzip,
+/// so that the compressed block always fits in the 64 KiB limit of the format
+static constexpr size_t sk_bgzfBlockDataSize = 0xff00;
+
+/// Number of BGZF blocks deflated by each task, which is about 4 MiB of uncompressed data
+static constexpr size_t sk_numBgzfBlocksPerTask = 64;
+
+/// Size of the header of a BGZF block, whose only extra subfield is BC
+static constexpr size_t sk_bgzfHeaderSize = 18;
+
+/// Size of the gzip trailer, which holds the CRC32 and size of the uncompressed data
+static constexpr size_t sk_gzipTrailerSize = 8;
+
+/// Empty BGZF block that marks the end of a BGZF file
+static constexpr unsigned char sk_bgzfEofBlock[] = {
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+    0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+
+/// A gzip member in BGZF format, whose header records the size of the member
+struct BgzfBlock
+{
+    size_t m_offset; //!< Offset of the member in the compressed data
+    size_t m_size; //!< Size of the member in bytes
+    size_t m_headerSize; //!< Size of the member header, after which the deflated data start
+    size_t m_uncompressedOffset; //!< Offset of the inflated member in the uncompressed data
+    size_t m_uncompressedSize; //!< Size of the inflated member in bytes
+};
+
+
+uint16_t readUInt16LE( const unsigned char* p )
+{
+    return static_cast<uint16_t>( p[0] | ( p[1] << 8 ) );
+}
+
+uint32_t readUInt32LE( const unsigned char* p )
+{
+    return static_cast<uint32_t>( p[0] ) | ( static_cast<uint32_t>( p[1] ) << 8 ) |
+            ( static_cast<uint32_t>( p[2] ) << 16 ) | ( static_cast<uint32_t>( p[3] ) << 24 );
+}
+
+void writeUInt16LE( unsigned char* p, uint16_t value )
+{
+    p[0] = static_cast<unsigned char>( value & 0xff );
+    p[1] = static_cast<unsigned char>( value >> 8 );
+}
+
+void writeUInt32LE( unsigned char* p, uint32_t value )
+{
+    for ( int i = 0; i < 4; ++i )
+    {
+        p[i] = static_cast<unsigned char>( ( value >> ( 8 * i ) ) & 0xff );
+    }
+}
+
+bool hasGzipMagic( const unsigned char* data, size_t size )
+{
+    return ( size >= 2 && sk_gzipId1 == data[0] && sk_gzipId2 == data[1] );
+}
+
+
+/// Data of a file from an offset to its end, which are memory-mapped if possible and are otherwise
+/// read into memory
+class FileData
+{
+public:
+
+    static std::optional<FileData> open( const std::string& fileName, size_t offset )
+    {
+        std::error_code error;
+        const auto fileSize = fs::file_size( fs::path( fileName ), error );
+
+        if ( error || fileSize <= offset )
+        {
+            return std::nullopt;
+        }
+
+        const size_t dataSize = static_cast<size_t>( fileSize ) - offset;
+
+        FileData fileData;
+        fileData.m_mapped = MappedFileBuffer::map( fileName, offset, dataSize );
+
+        if ( ! fileData.m_mapped )
+        {
+            std::ifstream file( fileName, std::ios::in | std::ios::binary );
+            fileData.m_read.resize( dataSize );
+
+            if ( ! file.seekg( static_cast<std::streamoff>( offset ) ) ||
+                 ! file.read( reinterpret_cast<char*>( fileData.m_read.data() ),
+                              static_cast<std::streamsize>( dataSize ) ) )
+            {
+                return std::nullopt;
+            }
+        }
+
+        return fileData;
+    }
+
+    const unsigned char* data() const
+    {
+        return m_mapped ? static_cast<const unsigned char*>( m_mapped->data() ) : m_read.data();
+    }
+
+    size_t size() const
+    {
+        return m_mapped ? m_mapped->sizeInBytes() : m_read.size();
+    }
+
+    /// Are the data paged in from disk as they are accessed?
+    bool isMapped() const
+    {
+        return m_mapped.has_value();
+    }
+
+
+private:
+
+    FileData() = default;
+
+    std::optional<MappedFileBuffer> m_mapped;
+    std::vector<unsigned char> m_read;
+};
+
+
+/**
+ * @brief Touches the pages of memory-mapped compressed data on a separate thread, staying a bounded
+ * distance ahead of the inflater, so that the file is read from disk while data are inflated
+ */
+class ReadAhead
+{
+public:
+
+    ReadAhead( const unsigned char* data, size_t size )
+        :
+          m_data( data ),
+          m_size( size ),
+          m_position( 0 ),
+          m_stop( false ),
+          m_thread( [this] () { run(); } )
+    {}
+
+    ReadAhead( const ReadAhead& ) = delete;
+    ReadAhead& operator=( const ReadAhead& ) = delete;
+
+    ~ReadAhead()
+    {
+        m_stop = true;
+        m_thread.join();
+    }
+
+    /// Set the position up to which the inflater has consumed the data
+    void setPosition( size_t position )
+    {
+        m_position = position;
+    }
+
+
+private:
+
+    void run()
+    {
+        static constexpr size_t sk_pageSize = 4096;
+        static constexpr size_t sk_stepSize = 256 * sk_pageSize;
+
+        // Volatile reads are not optimized away
+        const volatile unsigned char* data = m_data;
+        size_t position = 0;
+
+        while ( ! m_stop && position < m_size )
+        {
+            if ( position > m_position + sk_readAheadSize )
+            {
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+                continue;
+            }
+
+            const size_t end = std::min( position + sk_stepSize, m_size );
+
+            for ( ; position < end; position += sk_pageSize )
+            {
+                static_cast<void>( data[position] );
+            }
+        }
+    }
+
+    const unsigned char* m_data;
+    const size_t m_size;
+    std::atomic<size_t> m_position;
+    std::atomic<bool> m_stop;
+    std::thread m_thread;
+};
+
+
+/// Get the BGZF blocks that make up compressed data.
+/// Returns std::nullopt if the data are not entirely made up of BGZF blocks.
+std::optional< std::vector<BgzfBlock> > findBgzfBlocks( const unsigned char* data, size_t size )
+{
+    static constexpr size_t sk_fixedHeaderSize = 12; // Fields up to and including XLEN
+    static constexpr size_t sk_trailerSize = 8; // CRC32 and ISIZE
+    static constexpr unsigned char sk_deflateMethod = 8;
+    static constexpr unsigned char sk_extraFlag = 0x04;
+
+    std::vector<BgzfBlock> blocks;
+    size_t offset = 0;
+    size_t uncompressedOffset = 0;
+
+    while ( offset < size )
+    {
+        const unsigned char* member = data + offset;
+        const size_t remaining = size - offset;
+
+        if ( remaining < sk_fixedHeaderSize || ! hasGzipMagic( member, remaining ) ||
+             sk_deflateMethod != member[2] || 0 == ( member[3] & sk_extraFlag ) )
+        {
+            return std::nullopt;
+        }
+
+        const size_t headerSize = sk_fixedHeaderSize + readUInt16LE( member + 10 );
+
+        if ( remaining < headerSize )
+        {
+            return std::nullopt;
+        }
+
+        // The BC subfield of the extra field holds the size of the member minus one
+        std::optional<size_t> memberSize;
+
+        for ( size_t i = sk_fixedHeaderSize; i + 4 <= headerSize; )
+        {
+            const size_t subfieldSize = readUInt16LE( member + i + 2 );
+
+            if ( 'B' == member[i] && 'C' == member[i + 1] && 2 == subfieldSize && i + 6 <= headerSize )
+            {
+                memberSize = static_cast<size_t>( readUInt16LE( member + i + 4 ) ) + 1;
+                break;
+            }
+
+            i += 4 + subfieldSize;
+        }
+
+        if ( ! memberSize || *memberSize < headerSize + sk_trailerSize || *memberSize > remaining )
+        {
+            return std::nullopt;
+        }
+
+        const size_t uncompressedSize = readUInt32LE( member + *memberSize - 4 );
+
+        blocks.push_back( BgzfBlock{ offset, *memberSize, headerSize, uncompressedOffset, uncompressedSize } );
+
+        offset += *memberSize;
+        uncompressedOffset += uncompressedSize;
+    }
+
+    return blocks;
+}
+
+
+/// Inflate the parts of BGZF blocks that overlap the uncompressed range [begin, begin + size)
+/// into the buffer that holds the range. The CRC of each block is checked.
+bool inflateBgzfBlocks( const unsigned char* data,
+                        const BgzfBlock* blocks, size_t numBlocks,
+                        size_t begin, size_t size, unsigned char* buffer )
+{
+    z_stream stream;
+    std::memset( &stream, 0, sizeof( stream ) );
+
+    // The deflated data of the blocks are raw, without zlib or gzip wrappers
+    if ( Z_OK != inflateInit2( &stream, -MAX_WBITS ) )
+    {
+        return false;
+    }
+
+    std::vector<unsigned char> scratch;
+    bool success = true;
+
+    for ( size_t b = 0; b < numBlocks && success; ++b )
+    {
+        const BgzfBlock& block = blocks[b];
+
+        const size_t first = std::max( block.m_uncompressedOffset, begin );
+        const size_t last = std::min( block.m_uncompressedOffset + block.m_uncompressedSize, begin + size );
+
+        if ( first >= last )
+        {
+            continue;
+        }
+
+        // Blocks that lie entirely in the range are inflated in place
+        const bool inPlace = ( first == block.m_uncompressedOffset &&
+                               last == block.m_uncompressedOffset + block.m_uncompressedSize );
+
+        if ( ! inPlace )
+        {
+            scratch.resize( block.m_uncompressedSize );
+        }
+
+        unsigned char* out = inPlace ? buffer + ( first - begin ) : scratch.data();
+
+        inflateReset( &stream );
+        stream.next_in = const_cast<Bytef*>( data + block.m_offset + block.m_headerSize );
+        stream.avail_in = static_cast<uInt>( block.m_size - block.m_headerSize - 8 );
+        stream.next_out = out;
+        stream.avail_out = static_cast<uInt>( block.m_uncompressedSize );
+
+        const uint32_t crc = readUInt32LE( data + block.m_offset + block.m_size - 8 );
+
+        success = ( Z_STREAM_END == inflate( &stream, Z_FINISH ) && 0 == stream.avail_out &&
+                    crc == crc32( crc32( 0L, Z_NULL, 0 ), out, static_cast<uInt>( block.m_uncompressedSize ) ) );
+
+        if ( success && ! inPlace )
+        {
+            std::memcpy( buffer + ( first - begin ), out + ( first - block.m_uncompressedOffset ), last - first );
+        }
+    }
+
+    inflateEnd( &stream );
+    return success;
+}
+
+
+/// Inflate the uncompressed range [begin, begin + size) of BGZF blocks on multiple threads
+bool inflateBgzf( const unsigned char* data, const std::vector<BgzfBlock>& blocks,
+                  size_t begin, size_t size, unsigned char* buffer,
+                  const FileLoadProgress* progress )
+{
+    // Only the blocks that overlap the range are inflated
+    const auto firstBlock = std::find_if( std::begin( blocks ), std::end( blocks ), [begin] ( const BgzfBlock& block )
+    {
+        return block.m_uncompressedOffset + block.m_uncompressedSize > begin;
+    } );
+
+    const auto lastBlock = std::find_if( firstBlock, std::end( blocks ), [begin, size] ( const BgzfBlock& block )
+    {
+        return block.m_uncompressedOffset >= begin + size;
+    } );
+
+    const size_t numBlocks = static_cast<size_t>( std::distance( firstBlock, lastBlock ) );
+
+    if ( 0 == numBlocks || ( std::prev( lastBlock )->m_uncompressedOffset +
+                             std::prev( lastBlock )->m_uncompressedSize < begin + size ) )
+    {
+        spdlog::error( "Compressed data hold fewer than the {} bytes requested", begin + size );
+        return false;
+    }
+
+    const size_t numThreads = ThreadPool::defaultNumThreads( numBlocks );
+    const size_t numGroups = std::min( numBlocks, numThreads * sk_numBlockGroupsPerThread );
+    const size_t numBlocksPerGroup = ( numBlocks + numGroups - 1 ) / numGroups;
+
+    std::atomic<bool> failed( false );
+    std::atomic<size_t> numBlocksDone( 0 );
+
+    {
+        ThreadPool pool( numThreads );
+        std::vector< std::future<void> > futures;
+
+        for ( size_t g = 0; g * numBlocksPerGroup < numBlocks; ++g )
+        {
+            const BgzfBlock* groupBlocks = &( *firstBlock ) + g * numBlocksPerGroup;
+            const size_t numGroupBlocks = std::min( numBlocksPerGroup, numBlocks - g * numBlocksPerGroup );
+
+            futures.emplace_back( pool.submit( [&, groupBlocks, numGroupBlocks] ()
+            {
+                if ( failed || ( progress && progress->isCancelled() ) )
+                {
+                    failed = true;
+                    return;
+                }
+
+                if ( ! inflateBgzfBlocks( data, groupBlocks, numGroupBlocks, begin, size, buffer ) )
+                {
+                    failed = true;
+                    return;
+                }
+
+                const size_t numDone = ( numBlocksDone += numGroupBlocks );
+
+                if ( progress )
+                {
+                    progress->setFraction( static_cast<double>( numDone ) / static_cast<double>( numBlocks ) );
+                }
+            } ) );
+        }
+
+        for ( auto& future : futures )
+        {
+            future.get();
+        }
+    }
+
+    return ! failed;
+}
+
+
+/// Inflate the uncompressed range [begin, begin + size) of gzip data as a single stream,
+/// which may be made up of concatenated gzip members
+bool inflateStream( const FileData& compressed,
+                    size_t begin, size_t size, unsigned char* buffer,
+                    const FileLoadProgress* progress )
+{
+    const unsigned char* data = compressed.data();
+    const size_t dataSize = compressed.size();
+
+    z_stream stream;
+    std::memset( &stream, 0, sizeof( stream ) );
+
+    // Expect a gzip wrapper, whose CRC is checked by zlib
+    if ( Z_OK != inflateInit2( &stream, 16 + MAX_WBITS ) )
+    {
+        return false;
+    }
+
+    // Data that were read into memory are not read ahead
+    std::optional<ReadAhead> readAhead;
+
+    if ( compressed.isMapped() )
+    {
+        readAhead.emplace( data, dataSize );
+    }
+
+    // Bytes before the range are inflated into scratch space
+    std::vector<unsigned char> scratch( size_t( 1 ) << 16 );
+
+    size_t inOffset = 0; // Offset of the compressed data that have been passed to zlib
+    size_t outOffset = 0; // Number of uncompressed bytes that have been inflated
+    size_t nextProgressOffset = sk_progressInterval;
+    bool success = true;
+
+    while ( success && outOffset < begin + size )
+    {
+        if ( 0 == stream.avail_in )
+        {
+            if ( inOffset >= dataSize )
+            {
+                spdlog::error( "Compressed data hold fewer than the {} bytes requested", begin + size );
+                success = false;
+                break;
+            }
+
+            stream.next_in = const_cast<Bytef*>( data + inOffset );
+            stream.avail_in = static_cast<uInt>( std::min( dataSize - inOffset, sk_maxZlibChunkSize ) );
+            inOffset += stream.avail_in;
+        }
+
+        const bool beforeRange = ( outOffset < begin );
+
+        const size_t outSize = beforeRange
+                ? std::min( scratch.size(), begin - outOffset )
+                : std::min( begin + size - outOffset, sk_maxZlibChunkSize );
+
+        stream.next_out = beforeRange ? scratch.data() : buffer + ( outOffset - begin );
+        stream.avail_out = static_cast<uInt>( outSize );
+
+        const int result = inflate( &stream, Z_NO_FLUSH );
+
+        outOffset += outSize - stream.avail_out;
+
+        const size_t consumed = inOffset - stream.avail_in;
+
+        if ( readAhead )
+        {
+            readAhead->setPosition( consumed );
+        }
+
+        if ( Z_STREAM_END == result )
+        {
+            // Another gzip member may follow the end of this one
+            if ( ! hasGzipMagic( data + consumed, dataSize - consumed ) )
+            {
+                success = ( outOffset >= begin + size );
+                break;
+            }
+
+            inflateReset( &stream );
+        }
+        else if ( Z_OK != result && ! ( Z_BUF_ERROR == result && 0 == stream.avail_in ) )
+        {
+            spdlog::error( "Error inflating compressed data: {}", stream.msg ? stream.msg : "unknown error" );
+            success = false;
+        }
+
+        if ( progress && outOffset >= nextProgressOffset )
+        {
+            progress->setFraction( static_cast<double>( consumed ) / static_cast<double>( dataSize ) );
+            nextProgressOffset = outOffset + sk_progressInterval;
+
+            if ( progress->isCancelled() )
+            {
+                success = false;
+            }
+        }
+    }
+
+    inflateEnd( &stream );
+    return success;
+}
+
+
+/// Deflate data into consecutive BGZF blocks, which are appended to the output
+bool deflateBgzfBlocks( const unsigned char* data, size_t size, std::vector<unsigned char>& output )
+{
+    static constexpr size_t sk_maxBlockSize = size_t( 1 ) << 16;
+
+    z_stream stream;
+    std::memset( &stream, 0, sizeof( stream ) );
+
+    // The deflated data of the blocks are raw, since the gzip wrapper is written here
+    if ( Z_OK != deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY ) )
+    {
+        return false;
+    }
+
+    bool success = true;
+
+    for ( size_t offset = 0; offset < size && success; offset += sk_bgzfBlockDataSize )
+    {
+        const size_t blockDataSize = std::min( sk_bgzfBlockDataSize, size - offset );
+        const size_t bound = deflateBound( &stream, static_cast<uLong>( blockDataSize ) );
+        const size_t start = output.size();
+
+        output.resize( start + sk_bgzfHeaderSize + bound + sk_gzipTrailerSize );
+        unsigned char* block = output.data() + start;
+
+        deflateReset( &stream );
+        stream.next_in = const_cast<Bytef*>( data + offset );
+        stream.avail_in = static_cast<uInt>( blockDataSize );
+        stream.next_out = block + sk_bgzfHeaderSize;
+        stream.avail_out = static_cast<uInt>( bound );
+
+        const int result = deflate( &stream, Z_FINISH );
+
+        const size_t deflatedSize = bound - stream.avail_out;
+        const size_t memberSize = sk_bgzfHeaderSize + deflatedSize + sk_gzipTrailerSize;
+
+        success = ( Z_STREAM_END == result && memberSize <= sk_maxBlockSize );
+
+        if ( ! success )
+        {
+            break;
+        }
+
+        // Gzip header with the BC subfield, which holds the size of the member minus one
+        const unsigned char header[] = {
+            sk_gzipId1, sk_gzipId2, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 'B', 'C', 0x02, 0x00 };
+
+        std::memcpy( block, header, sizeof( header ) );
+        writeUInt16LE( block + 16, static_cast<uint16_t>( memberSize - 1 ) );
+
+        const uLong crc = crc32( crc32( 0L, Z_NULL, 0 ), data + offset, static_cast<uInt>( blockDataSize ) );
+        writeUInt32LE( block + sk_bgzfHeaderSize + deflatedSize, static_cast<uint32_t>( crc ) );
+        writeUInt32LE( block + sk_bgzfHeaderSize + deflatedSize + 4, static_cast<uint32_t>( blockDataSize ) );
+
+        output.resize( start + memberSize );
+    }
+
+    deflateEnd( &stream );
+    return success;
+}
+
+} // anonymous
+
+
+bool isGzipFile( const std::string& fileName, size_t offset )
+{
+    std::ifstream file( fileName, std::ios::in | std::ios::binary );
+
+    unsigned char magic[2] = { 0, 0 };
+
+    if ( ! file.seekg( static_cast<std::streamoff>( offset ) ) ||
+         ! file.read( reinterpret_cast<char*>( magic ), 2 ) )
+    {
+        return false;
+    }
+
+    return hasGzipMagic( magic, 2 );
+}
+
+
+std::vector<char> inflateGzipFileHead( const std::string& fileName, size_t offset, size_t size )
+{
+    static constexpr size_t sk_chunkSize = 16384;
+
+    std::vector<char> head( size );
+
+    std::ifstream file( fileName, std::ios::in | std::ios::binary );
+
+    if ( ! file.seekg( static_cast<std::streamoff>( offset ) ) )
+    {
+        return {};
+    }
+
+    z_stream stream;
+    std::memset( &stream, 0, sizeof( stream ) );
+
+    if ( Z_OK != inflateInit2( &stream, 16 + MAX_WBITS ) )
+    {
+        return {};
+    }
+
+    std::vector<char> chunk( sk_chunkSize );
+
+    stream.next_out = reinterpret_cast<Bytef*>( head.data() );
+    stream.avail_out = static_cast<uInt>( size );
+
+    while ( stream.avail_out > 0 )
+    {
+        if ( 0 == stream.avail_in )
+        {
+            file.read( chunk.data(), static_cast<std::streamsize>( chunk.size() ) );
+
+            if ( file.gcount() <= 0 )
+            {
+                break;
+            }
+
+            stream.next_in = reinterpret_cast<Bytef*>( chunk.data() );
+            stream.avail_in = static_cast<uInt>( file.gcount() );
+        }
+
+        const int result = inflate( &stream, Z_NO_FLUSH );
+
+        if ( Z_OK != result )
+        {
+            break;
+        }
+    }
+
+    head.resize( size - stream.avail_out );
+    inflateEnd( &stream );
+    return head;
+}
+
+
+bool inflateGzipFile( const std::string& fileName,
+                      size_t compressedOffset,
+                      size_t uncompressedOffset,
+                      void* buffer, size_t size,
+                      const FileLoadProgress* progress )
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    const std::optional<FileData> compressed = FileData::open( fileName, compressedOffset );
+
+    if ( ! compressed || ! hasGzipMagic( compressed->data(), compressed->size() ) )
+    {
+        spdlog::error( "File {} does not hold gzip-compressed data at offset {}", fileName, compressedOffset );
+        return false;
+    }
+
+    unsigned char* out = static_cast<unsigned char*>( buffer );
+    bool success = false;
+
+    if ( const auto blocks = findBgzfBlocks( compressed->data(), compressed->size() ) )
+    {
+        spdlog::debug( "Inflating {} BGZF blocks of file {} in parallel", blocks->size(), fileName );
+        success = inflateBgzf( compressed->data(), *blocks, uncompressedOffset, size, out, progress );
+    }
+    else
+    {
+        spdlog::debug( "Inflating file {} as a single stream with read-ahead", fileName );
+        success = inflateStream( *compressed, uncompressedOffset, size, out, progress );
+    }
+
+    if ( success )
+    {
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        spdlog::debug( "Inflated {} bytes of file {} in {:.3f} s", size, fileName, elapsed.count() );
+    }
+
+    return success;
+}
+
+
+bool deflateGzipFile( const std::string& sourceFileName, const std::string& fileName )
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    const std::optional<FileData> source = FileData::open( sourceFileName, 0 );
+
+    if ( ! source )
+    {
+        spdlog::error( "Unable to read file {} to compress it", sourceFileName );
+        return false;
+    }
+
+    std::ofstream file( fileName, std::ios::out | std::ios::binary | std::ios::trunc );
+
+    if ( ! file )
+    {
+        spdlog::error( "Unable to open file {} for writing", fileName );
+        return false;
+    }
+
+    const unsigned char* data = source->data();
+    const size_t size = source->size();
+
+    static constexpr size_t sk_taskDataSize = sk_numBgzfBlocksPerTask * sk_bgzfBlockDataSize;
+    const size_t numTasks = ( size + sk_taskDataSize - 1 ) / sk_taskDataSize;
+
+    std::atomic<bool> failed( false );
+    bool written = true;
+
+    {
+        ThreadPool pool( ThreadPool::defaultNumThreads( numTasks ) );
+        std::vector< std::future< std::vector<unsigned char> > > futures;
+
+        for ( size_t t = 0; t < numTasks; ++t )
+        {
+            futures.emplace_back( pool.submit( [&failed, data, size, t] ()
+            {
+                std::vector<unsigned char> blocks;
+
+                const size_t begin = t * sk_taskDataSize;
+
+                if ( ! failed && ! deflateBgzfBlocks( data + begin, std::min( sk_taskDataSize, size - begin ), blocks ) )
+                {
+                    failed = true;
+                }
+
+                return blocks;
+            } ) );
+        }
+
+        // Blocks are written in order as soon as they are deflated
+        for ( auto& future : futures )
+        {
+            const std::vector<unsigned char> blocks = future.get();
+
+            if ( failed || ! written )
+            {
+                // Stop the remaining tasks early
+                failed = true;
+                continue;
+            }
+
+            written = static_cast<bool>( file.write( reinterpret_cast<const char*>( blocks.data() ),
+                                                     static_cast<std::streamsize>( blocks.size() ) ) );
+        }
+    }
+
+    if ( failed || ! written ||
+         ! file.write( reinterpret_cast<const char*>( sk_bgzfEofBlock ), sizeof( sk_bgzfEofBlock ) ) ||
+         ! file.flush() )
+    {
+        spdlog::error( "Error compressing file {} into file {}", sourceFileName, fileName );
+        return false;
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    spdlog::debug( "Compressed {} bytes of file {} into {} BGZF blocks of file {} in {:.3f} s",
+                   size, sourceFileName, ( size + sk_bgzfBlockDataSize - 1 ) / sk_bgzfBlockDataSize,
+                   fileName, elapsed.count() );
+
+    return true;
+}
+
+
+std::vector<char> deflateBuffer( const void* data, size_t size )
+{
+    uLongf compressedSize = compressBound( static_cast<uLong>( size ) );
+    std::vector<char> compressed( compressedSize );
+
+    if ( Z_OK != compress2( reinterpret_cast<Bytef*>( compressed.data() ), &compressedSize,
+                            static_cast<const Bytef*>( data ), static_cast<uLong>( size ), Z_BEST_SPEED ) )
+    {
+        return {};
+    }
+
+    compressed.resize( compressedSize );
+    return compressed;
+}
+
+
+bool inflateBuffer( const void* compressed, size_t compressedSize, void* buffer, size_t size )
+{
+    uLongf uncompressedSize = static_cast<uLongf>( size );
+
+    return ( Z_OK == uncompress( static_cast<Bytef*>( buffer ), &uncompressedSize,
+                                 static_cast<const Bytef*>( compressed ), static_cast<uLong>( compressedSize ) ) &&
+             size == uncompressedSize );
+}
+
+
+uint32_t computeCrc32( const void* data, size_t size )
+{
+    uLong crc = crc32( 0L, Z_NULL, 0 );
+    const Bytef* bytes = static_cast<const Bytef*>( data );
+
+    // zlib sizes are 32-bit
+    for ( size_t offset = 0; offset < size; offset += sk_maxZlibChunkSize )
+    {
+        crc = crc32( crc, bytes + offset, static_cast<uInt>( std::min( size - offset, sk_maxZlibChunkSize ) ) );
+    }
+
+    return static_cast<uint32_t>( crc );
+}
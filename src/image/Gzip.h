@@ -0,0 +1,78 @@
+#ifndef GZIP_H
+#define GZIP_H
+
+#include "common/LoadProgress.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Does the data at an offset of a file start with the gzip magic bytes?
+ * @param[in] fileName Path to the file
+ * @param[in] offset Offset in bytes of the data in the file
+ */
+bool isGzipFile( const std::string& fileName, size_t offset = 0 );
+
+/**
+ * @brief Inflate the first bytes of gzip-compressed data in a file, e.g. to read the header of an
+ * image that is compressed along with its voxels
+ * @param[in] fileName Path to the file
+ * @param[in] offset Offset in bytes of the compressed data in the file
+ * @param[in] size Number of uncompressed bytes to inflate
+ * @return The inflated bytes, which are fewer than requested if the data are shorter or invalid
+ */
+std::vector<char> inflateGzipFileHead( const std::string& fileName, size_t offset, size_t size );
+
+/**
+ * @brief Inflate a range of the gzip-compressed data in a file into a buffer.
+ *
+ * Data made up of BGZF blocks (gzip members whose headers record their compressed size, as written by
+ * bgzip) are inflated block-parallel on multiple threads. Other data are inflated as a single stream,
+ * while another thread reads the compressed data from disk ahead of the inflater. Concatenated gzip
+ * members are inflated as one stream.
+ *
+ * @param[in] fileName Path to the file
+ * @param[in] compressedOffset Offset in bytes of the compressed data in the file
+ * @param[in] uncompressedOffset Offset in bytes of the range in the uncompressed data
+ * @param[out] buffer Buffer of at least size bytes into which the range is inflated
+ * @param[in] size Size in bytes of the range
+ * @param[in] progress If not null, then the fraction of compressed data that has been inflated is
+ * reported to it and inflating stops if loading has been cancelled
+ * @return True iff the whole range was inflated; false if the data are invalid or too short or if
+ * inflating was cancelled
+ */
+bool inflateGzipFile( const std::string& fileName,
+                      size_t compressedOffset,
+                      size_t uncompressedOffset,
+                      void* buffer, size_t size,
+                      const FileLoadProgress* progress = nullptr );
+
+/**
+ * @brief Compress a file into a gzip file made up of BGZF blocks, which are deflated in parallel on
+ * multiple threads. The compressed file can be read by any gzip reader, and its blocks are inflated
+ * in parallel by inflateGzipFile.
+ * @param[in] sourceFileName Path to the file to compress
+ * @param[in] fileName Path to the compressed file, which is overwritten if it exists
+ * @return True iff the file was compressed and written
+ */
+bool deflateGzipFile( const std::string& sourceFileName, const std::string& fileName );
+
+/**
+ * @brief Compress a buffer into a zlib stream, favoring speed over compression ratio
+ * @return The compressed data; empty if compression failed
+ */
+std::vector<char> deflateBuffer( const void* data, size_t size );
+
+/**
+ * @brief Decompress a zlib stream that holds exactly size bytes of uncompressed data
+ * @return True iff the stream was valid and held exactly size bytes
+ */
+bool inflateBuffer( const void* compressed, size_t compressedSize, void* buffer, size_t size );
+
+/// @brief Compute the CRC-32 checksum of a buffer, as used by gzip
+uint32_t computeCrc32( const void* data, size_t size );
+
+#endif // GZIP_H
@@ -2,275 +2,475 @@
 #include "image/ImageUtility.h"
 #include "image/ImageUtility.tpp"
 
+#include "image/DicomSeries.h"
+#include "image/Gzip.h"
+
 #include "common/Exception.hpp"
 
+#include <glm/gtc/epsilon.hpp>
+
 #include <spdlog/spdlog.h>
 
+#include <itkByteSwapper.h>
+#include <itkImageFileReader.h>
+
+// On Apple platforms, we must use the alternative ghc::filesystem,
+// because it is not fully implemented or supported prior to macOS 10.15.
+#if !defined(__APPLE__)
+#if defined(__cplusplus) && __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<filesystem>)
+#define GHC_USE_STD_FS
+#include <filesystem>
+namespace fs = std::filesystem;
+#endif
+#endif
+#endif
+
+#ifndef GHC_USE_STD_FS
+#include <ghc/filesystem.hpp>
+namespace fs = ghc::filesystem;
+#endif
+
 #include <algorithm>
 #include <array>
-#include <memory>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <new>
 #include <sstream>
+#include <system_error>
+#include <type_traits>
+#include <utility>
 
 
-Image::Image(
-        const std::string& fileName,
-        ImageRepresentation imageRep,
-        MultiComponentBufferType bufferType )
-    :
-      m_data_int8(),
-      m_data_uint8(),
-      m_data_int16(),
-      m_data_uint16(),
-      m_data_int32(),
-      m_data_uint32(),
-      m_data_float32(),
+namespace
+{
 
-      m_imageRep( std::move(imageRep) ),
-      m_bufferType( std::move(bufferType) ),
+/// Maximum number of pixels per component that are sampled to estimate the provisional statistics
+/// of an image when it is loaded from file
+static constexpr size_t sk_maxNumProvisionalStatsSamples = 1u << 18;
 
-      m_ioInfoOnDisk(),
-      m_ioInfoInMemory()
-{
-    // Read all data from disk to an ITK image with float32 pixel components
-    using ReadComponentType = float;
-    using ComponentImageType = itk::Image<ReadComponentType, 3>;
+/// Maximum number of pixels that are sampled to estimate the statistics of a bricked image
+static constexpr size_t sk_maxNumBrickedStatsSamples = 1u << 24;
 
-    // Statistics per component are stored as double
-    using StatsType = double;
+/// The voxels of images that would take more than 1/sk_contiguousMemoryDivisor of physical memory
+/// are held in bricks on disk, of which at most 1/sk_residentBricksMemoryDivisor of physical memory
+/// is resident
+static constexpr size_t sk_contiguousMemoryDivisor = 2;
+static constexpr size_t sk_residentBricksMemoryDivisor = 8;
 
-    // Maximum number of components to load for images with interleaved buffer components
-    static constexpr size_t MAX_COMPS = 4;
 
-    try
+/// Get the maximum size in bytes of the resident bricks of an image whose voxels take a given number
+/// of bytes in memory, if the voxels are to be held in bricks rather than in contiguous buffers
+std::optional<size_t> maxResidentBricksSize( uint64_t memorySizeInBytes )
+{
+    const std::optional<size_t> physicalMemorySize = physicalMemorySizeInBytes();
+
+    if ( ! physicalMemorySize || memorySizeInBytes <= *physicalMemorySize / sk_contiguousMemoryDivisor )
     {
-        const itk::ImageIOBase::Pointer imageIo = createStandardImageIo( fileName.c_str() );
+        return std::nullopt;
+    }
 
-        if ( ! imageIo || imageIo.IsNull() )
-        {
-            spdlog::error( "Error creating ImageIOBase for image {}", fileName );
-            throw_debug( "Error creating ImageIOBase" )
-        }
+    return *physicalMemorySize / sk_residentBricksMemoryDivisor;
+}
 
-        if ( ! m_ioInfoOnDisk.set( imageIo ) )
+
+/// Get the component type in which the voxels of an image or segmentation with a given component
+/// type on disk are held in memory, if they are not quantized. This matches the casts done by
+/// Image::loadImageBuffer and Image::loadSegBuffer.
+itk::IOComponentEnum memoryComponentType( itk::IOComponentEnum fileType, bool isSegmentation )
+{
+    using CType = itk::IOComponentEnum;
+
+    if ( isSegmentation )
+    {
+        switch ( fileType )
         {
-            spdlog::error( "Error setting image IO information for image {}", fileName );
-            throw_debug( "Error setting image IO information" )
+        case CType::UCHAR:
+        case CType::CHAR: return CType::UCHAR;
+        case CType::USHORT:
+        case CType::SHORT: return CType::USHORT;
+        default: return CType::UINT;
         }
+    }
 
-        // The image information in memory may not match the information on disk
-        m_ioInfoInMemory = m_ioInfoOnDisk;
+    switch ( fileType )
+    {
+    case CType::ULONG:
+    case CType::ULONGLONG: return CType::UINT;
+    case CType::LONG:
+    case CType::LONGLONG: return CType::INT;
+    case CType::DOUBLE:
+    case CType::LDOUBLE: return CType::FLOAT;
+    default: return fileType;
+    }
+}
 
-        const size_t numPixels = m_ioInfoOnDisk.m_sizeInfo.m_imageSizeInPixels;
-        const size_t numComps = m_ioInfoOnDisk.m_pixelInfo.m_numComponents;
-        const bool isVectorImage = ( numComps > 1 );
 
-        spdlog::info( "Attempting to load image {} with {} pixels and {} components per pixel",
-                      fileName, numPixels, numComps );
+/// Get the size in bytes of a component type that is held in memory
+uint32_t memoryComponentSizeInBytes( itk::IOComponentEnum memoryType )
+{
+    using CType = itk::IOComponentEnum;
 
-        // Extract statistics of each image component into a vector
-        std::vector< ComponentStats<StatsType> > componentStats;
+    switch ( memoryType )
+    {
+    case CType::UCHAR:
+    case CType::CHAR: return 1;
+    case CType::USHORT:
+    case CType::SHORT: return 2;
+    default: return 4;
+    }
+}
 
-        if ( isVectorImage )
-        {
-            // Load multi-component image
 
-            typename itk::ImageBase<3>::Pointer baseImage =
-                    readImage<ReadComponentType, 3, true>( fileName );
+/// Get the pixel dimensions of an image from its IO information
+glm::uvec3 pixelDimensions( const ImageIoInfo& ioInfo )
+{
+    glm::uvec3 dims{ 1u };
 
-            if ( ! baseImage )
-            {
-                spdlog::error( "Unable to read vector image {}", fileName );
-                throw_debug( "Unable to read vector image" )
-            }
+    for ( size_t i = 0; i < std::min<size_t>( 3, ioInfo.m_spaceInfo.m_dimensions.size() ); ++i )
+    {
+        dims[static_cast<glm::length_t>( i )] = static_cast<uint32_t>( ioInfo.m_spaceInfo.m_dimensions[i] );
+    }
 
-            // Split the base image into component images. Load a maximum of MAX_COMPS components
-            // for an image with interleaved component buffers.
-            size_t numCompsToLoad = numComps;
+    return dims;
+}
 
-            if ( MultiComponentBufferType::InterleavedImage == m_bufferType )
-            {
-                numCompsToLoad = std::min( numCompsToLoad, MAX_COMPS );
 
-                if ( numComps > MAX_COMPS )
-                {
-                    spdlog::warn( "The number of image components ({}) exceeds that maximum that will be loaded ({}) "
-                                  "because this image uses interleaved buffer format", numComps, MAX_COMPS );
-                }
-            }
+/// Estimate the statistics of an image from a sample of its pixels. The sum and histogram
+/// frequencies are scaled up to the number of pixels in the image.
+template< typename T >
+ComponentStats<double> estimateImageStatistics( const std::vector<T>& samples, size_t numPixels )
+{
+    ComponentStats<double> stats = computeImageStatistics<T, double>( samples.data(), samples.size() );
 
-            std::vector< typename ComponentImageType::Pointer > componentImages =
-                splitImageIntoComponents<ReadComponentType, 3>( baseImage );
+    if ( samples.empty() )
+    {
+        return stats;
+    }
 
-            if ( componentImages.size() < numCompsToLoad )
-            {
-                spdlog::error( "Only {} component images were loaded, but {} components were expected",
-                               componentImages.size(), numCompsToLoad );
+    const double scale = static_cast<double>( numPixels ) / static_cast<double>( samples.size() );
 
-                numCompsToLoad = componentImages.size();
-            }
+    stats.m_sum *= scale;
 
-            if ( ImageRepresentation::Segmentation == m_imageRep )
-            {
-                spdlog::warn( "Loading a segmentation image {} with {} components. "
-                              "Only the first component of the segmentation will be used",
-                              fileName, numComps );
-                numCompsToLoad = 1;
-            }
+    for ( double& frequency : stats.m_histogram )
+    {
+        frequency *= scale;
+    }
 
-            if ( 0 == numCompsToLoad )
-            {
-                spdlog::error( "No components to load for image {}", fileName );
-                throw_debug( "No components to load for image" )
-            }
+    return stats;
+}
+
+/// Throw if loading of a file has been cancelled
+void throwIfLoadCancelled( const FileLoadProgress* progress, const std::string& fileName )
+{
+    if ( progress && progress->isCancelled() )
+    {
+        spdlog::info( "Loading image {} was cancelled", fileName );
+        throw_debug( "Image loading was cancelled" )
+    }
+}
 
-            // If interleaving vector components, then create a single buffer
-            std::unique_ptr<ReadComponentType[]> allComponentBuffers = nullptr;
+/// Voxels of an image file that were read by ITK, which owns their buffer. The buffer of a time
+/// series holds its 3D frames one after the other.
+template< typename T >
+struct ReadVoxels
+{
+    itk::LightObject::Pointer m_owner; //!< ITK image that owns the buffer
+    const T* m_buffer = nullptr; //!< Pixels with interleaved components; null if the file was not read
+    size_t m_numComponents = 0; //!< Number of components per pixel in the buffer
+};
+
+/// Read the voxels of an image file with ITK as an image of dimension NDim
+template< typename T, uint32_t NDim, bool PixelIsVector >
+ReadVoxels<T> readVoxels( const std::string& fileName, const DicomSeries* dicomSeries, const FileLoadProgress* progress )
+{
+    ReadVoxels<T> voxels;
 
-            if ( MultiComponentBufferType::InterleavedImage == m_bufferType )
-            {
-                allComponentBuffers = std::make_unique<ReadComponentType[]>( numPixels * numCompsToLoad );
+    const typename itk::ImageBase<NDim>::Pointer baseImage =
+            readImage<T, NDim, PixelIsVector>( fileName, progress, dicomSeries );
 
-                if ( ! allComponentBuffers )
-                {
-                    spdlog::error( "Null buffer holding all components of image {}", fileName );
-                    throw_debug( "Null image buffer" )
-                }
-            }
+    if ( ! baseImage )
+    {
+        return voxels;
+    }
 
-            // Load the buffers from the component images
-            for ( size_t i = 0; i < numCompsToLoad; ++i )
-            {
-                if ( ! componentImages[i] )
-                {
-                    spdlog::error( "Null vector image component {} for image {}", i, fileName );
-                    throw_debug( "Null vector component for image" )
-                }
+    if constexpr ( PixelIsVector )
+    {
+        if ( auto image = downcastImageBaseToVectorImage<T, NDim>( baseImage ) )
+        {
+            voxels.m_buffer = image->GetBufferPointer();
+            voxels.m_numComponents = image->GetVectorLength();
+            voxels.m_owner = image.GetPointer();
+        }
+    }
+    else
+    {
+        if ( auto image = downcastImageBaseToImage<T, NDim>( baseImage ) )
+        {
+            voxels.m_buffer = image->GetBufferPointer();
+            voxels.m_numComponents = 1;
+            voxels.m_owner = image.GetPointer();
+        }
+    }
 
-                const ReadComponentType* buffer = componentImages[i]->GetBufferPointer();
+    return voxels;
+}
 
-                if ( ! buffer )
-                {
-                    spdlog::error( "Null buffer of vector image component {} for image {}", i, fileName );
-                    throw_debug( "Null buffer of vector image component" )
-                }
+/// Read the voxels of a 3D image file or of a time series of 3D frames. The voxels of a DICOM series
+/// are read from the given series, which was found at the file path (see findDicomSeries).
+template< typename T, bool PixelIsVector >
+ReadVoxels<T> readVoxels( const std::string& fileName, bool isTimeSeries, const DicomSeries* dicomSeries,
+                          const FileLoadProgress* progress )
+{
+    return isTimeSeries ? readVoxels<T, 4, PixelIsVector>( fileName, nullptr, progress )
+                        : readVoxels<T, 3, PixelIsVector>( fileName, dicomSeries, progress );
+}
 
-                switch ( m_bufferType )
-                {
-                case MultiComponentBufferType::SeparateImages:
-                {
-                    if ( ImageRepresentation::Segmentation == m_imageRep )
-                    {
-                        loadSegBuffer( buffer, numPixels );
-                    }
-                    else
-                    {
-                        loadImageBuffer( buffer, numPixels );
-                    }
-                    break;
-                }
-                case MultiComponentBufferType::InterleavedImage:
-                {
-                    // Fill the interleaved buffer
-                    for ( size_t p = 0; p < numPixels; ++p )
-                    {
-                        allComponentBuffers[numComps*p + i] = buffer[p];
-                    }
-                    break;
-                }
-                }
+/// Append the components of a buffer with interleaved components to copy-on-write component buffers
+template< class DestType, class SourceType >
+void appendComponentBuffers(
+        std::vector< CopyOnWrite< std::vector<DestType> > >& buffers,
+        const SourceType* source,
+        size_t numPixels,
+        size_t numSourceComponents,
+        size_t numComponents,
+        bool interleave )
+{
+    std::vector< std::vector<DestType> > newBuffers;
 
-                componentStats.emplace_back( computeImageStatistics<ReadComponentType, StatsType, 3>(
-                                                 componentImages[i] ) );
-            }
+    ::appendComponentBuffers( newBuffers, source, numPixels, numSourceComponents, numComponents, interleave );
 
-            if ( MultiComponentBufferType::InterleavedImage == m_bufferType )
-            {
-                const size_t numElements = numPixels * numComps;
+    for ( auto& buffer : newBuffers )
+    {
+        buffers.emplace_back( std::move( buffer ) );
+    }
+}
 
-                if ( ImageRepresentation::Segmentation == m_imageRep )
-                {
-                    loadSegBuffer( allComponentBuffers.get(), numElements );
-                }
-                else
-                {
-                    loadImageBuffer( allComponentBuffers.get(), numElements );
-                }
-            }
+
+/// Extension of compressed NIfTI files, which are compressed on multiple threads
+static const std::string sk_compressedNiftiExtension( ".nii.gz" );
+
+/// Extensions of image formats that are written to a single file, which is saved atomically.
+/// Compressed NIfTI is listed before NIfTI, so that the longest matching extension is found first.
+static const std::array< std::string, 4 > sk_singleFileExtensions{
+    sk_compressedNiftiExtension, ".nii", ".nrrd", ".mha" };
+
+/// Get the lower-case extension of a file name if it is of a single-file image format
+std::optional<std::string> singleFileExtension( const std::string& fileName )
+{
+    std::string lowerFileName = fileName;
+
+    std::transform( std::begin( lowerFileName ), std::end( lowerFileName ), std::begin( lowerFileName ),
+                    [] ( unsigned char c ) { return static_cast<char>( std::tolower( c ) ); } );
+
+    for ( const auto& ext : sk_singleFileExtensions )
+    {
+        if ( lowerFileName.size() > ext.size() &&
+             0 == lowerFileName.compare( lowerFileName.size() - ext.size(), ext.size(), ext ) )
+        {
+            return ext;
         }
-        else
+    }
+
+    return std::nullopt;
+}
+
+/**
+ * @brief Write an image file with a function that writes to a given file name.
+ *
+ * Files of single-file formats are written atomically: they are written to a temporary file in the
+ * same directory, which is then renamed to the file, so that a save that fails or is interrupted
+ * never leaves a partial file in place of an existing one. Compressed NIfTI files are written
+ * uncompressed and are then compressed into BGZF blocks on multiple threads, rather than by ITK
+ * on a single thread.
+ */
+bool writeFileAtomically( const std::string& fileName,
+                          const std::function< bool ( const std::string& ) >& write )
+{
+    static const std::string sk_tempSuffix( ".saving" );
+    static const std::string sk_gzipExtension( ".gz" );
+
+    const std::optional<std::string> ext = singleFileExtension( fileName );
+
+    if ( ! ext )
+    {
+        return write( fileName );
+    }
+
+    // The temporary file keeps the extension, by which ITK selects the format
+    const std::string tempFileName = fileName.substr( 0, fileName.size() - ext->size() ) +
+            sk_tempSuffix + fileName.substr( fileName.size() - ext->size() );
+
+    const bool compress = ( sk_compressedNiftiExtension == *ext );
+
+    const std::string writtenFileName = compress
+            ? tempFileName.substr( 0, tempFileName.size() - sk_gzipExtension.size() )
+            : tempFileName;
+
+    bool success = write( writtenFileName );
+
+    std::error_code error;
+
+    if ( compress )
+    {
+        success = success && deflateGzipFile( writtenFileName, tempFileName );
+        fs::remove( writtenFileName, error );
+    }
+
+    if ( success )
+    {
+        fs::rename( tempFileName, fileName, error );
+
+        if ( error )
         {
-            // Load scalar, single-component image
+            spdlog::error( "Unable to rename file {} to {}: {}", tempFileName, fileName, error.message() );
+            success = false;
+        }
+    }
+
+    if ( ! success )
+    {
+        fs::remove( tempFileName, error );
+    }
 
-            typename itk::ImageBase<3>::Pointer baseImage =
-                    readImage<ReadComponentType, 3, false>( fileName );
+    return success;
+}
 
-            if ( ! baseImage )
-            {
-                spdlog::error( "Unable to read image {}", fileName );
-                throw_debug( "Unable to read image" )
-            }
+/// Write voxels with components of type T to an image file with ITK. The components are either held
+/// in one buffer per component or are interleaved in a single buffer.
+template< class T >
+bool writeImageBuffers( const ImageHeader& header,
+                        const std::vector<const void*>& buffers,
+                        const std::string& fileName )
+{
+    constexpr uint32_t DIM = 3;
+
+    std::array< uint32_t, DIM > dims;
+    std::array< double, DIM > origin;
+    std::array< double, DIM > spacing;
+    std::array< std::array<double, DIM>, DIM > directions;
 
-            typename ComponentImageType::Pointer image =
-                    downcastImageBaseToImage<ReadComponentType, 3>( baseImage );
+    for ( uint32_t i = 0; i < DIM; ++i )
+    {
+        dims[i] = header.pixelDimensions()[i];
+        origin[i] = header.origin()[i];
+        spacing[i] = header.spacing()[i];
 
-            if ( ! image )
-            {
-                spdlog::error( "Null image for {}", fileName );
-                throw_debug( "Null image" )
-            }
+        directions[i] = {
+            header.directions()[i].x,
+            header.directions()[i].y,
+            header.directions()[i].z
+        };
+    }
 
-            const ReadComponentType* buffer = image->GetBufferPointer();
+    const uint32_t numComps = header.numComponentsPerPixel();
 
-            if ( ! buffer )
-            {
-                spdlog::error( "Null buffer of scalar image {}", fileName );
-                throw_debug( "Null buffer of scalar image" )
-            }
+    if ( 1 == numComps )
+    {
+        auto image = makeScalarImage( dims, origin, spacing, directions, static_cast<const T*>( buffers[0] ) );
+        return writeImage<T, DIM, false>( image, fileName );
+    }
 
-            if ( ImageRepresentation::Segmentation == m_imageRep )
-            {
-                loadSegBuffer( buffer, numPixels );
-            }
-            else
+    // ITK writes vector images from a buffer with interleaved components
+    std::vector<T> interleaved;
+    const T* data = static_cast<const T*>( buffers[0] );
+
+    if ( buffers.size() > 1 )
+    {
+        const size_t numPixels = header.numPixels();
+
+        try
+        {
+            interleaved.resize( numPixels * numComps );
+        }
+        catch ( const std::bad_alloc& )
+        {
+            spdlog::error( "Insufficient memory to interleave the components of image {} for saving", fileName );
+            return false;
+        }
+
+        for ( uint32_t c = 0; c < numComps; ++c )
+        {
+            const T* comp = static_cast<const T*>( buffers[c] );
+
+            for ( size_t p = 0; p < numPixels; ++p )
             {
-                loadImageBuffer( buffer, numPixels );
+                interleaved[p * numComps + c] = comp[p];
             }
-
-            componentStats.emplace_back( computeImageStatistics<ReadComponentType, StatsType, 3>( image ) );
         }
 
-        m_header = ImageHeader( m_ioInfoOnDisk, m_ioInfoInMemory );
+        data = interleaved.data();
+    }
 
-        m_tx = ImageTransformations(
-                    m_header.pixelDimensions(),
-                    m_header.spacing(),
-                    m_header.origin(),
-                    m_header.directions() );
+    auto image = makeVectorImage( dims, origin, spacing, directions, numComps, data );
+    return writeImage<T, DIM, true>( image, fileName );
+}
 
-        m_settings = ImageSettings(
-                    getFileName( fileName, false ),
-                    m_header.numComponentsPerPixel(),
-                    m_header.memoryComponentType(),
-                    std::move( componentStats ) );
+/**
+ * @brief Overwrite the raw voxels that are stored after the header of an image file with the voxels
+ * of bricks. The voxels are copied one slab of bricks at a time, so that the image never needs to
+ * fit in memory.
+ */
+bool writeBrickedVoxels( const BrickedBuffer& bricks, const std::string& fileName )
+{
+    static constexpr uint32_t sk_slabSize = BrickedBuffer::sk_brickSize;
+
+    const std::optional<size_t> offset = findRawVoxelDataOffset( fileName );
+
+    if ( ! offset )
+    {
+        spdlog::error( "Bricked image can only be saved to a format with uncompressed voxels "
+                       "after its header (NIfTI, NRRD, or MetaImage), not to {}", fileName );
+        return false;
     }
-    catch ( const std::exception& e )
+
+    std::fstream file( fileName, std::ios::in | std::ios::out | std::ios::binary );
+
+    if ( ! file.is_open() )
     {
-        spdlog::error( "Exception while constructing image {}: {}", fileName, e.what() );
-        throw_debug( "Exception while constructing image" )
+        spdlog::error( "Unable to open file {} to write voxels of bricked image", fileName );
+        return false;
     }
-    catch ( ... )
+
+    const glm::uvec3& dims = bricks.dims();
+    const size_t sliceSizeInBytes = static_cast<size_t>( dims.x ) * dims.y * bricks.voxelSizeInBytes();
+
+    std::vector<char> slab( sliceSizeInBytes * std::min( sk_slabSize, dims.z ) );
+
+    file.seekp( static_cast<std::streamoff>( *offset ) );
+
+    for ( uint32_t z = 0; z < dims.z; z += sk_slabSize )
     {
-        spdlog::error( "Exception while constructing image {}", fileName );
-        throw_debug( "Exception while constructing image" )
+        const uint32_t depth = std::min( sk_slabSize, dims.z - z );
+
+        if ( ! bricks.readBlock( glm::uvec3{ 0, 0, z }, glm::uvec3{ dims.x, dims.y, depth }, slab.data() ) )
+        {
+            return false;
+        }
+
+        if ( ! file.write( slab.data(), static_cast<std::streamsize>( depth * sliceSizeInBytes ) ) )
+        {
+            spdlog::error( "Unable to write voxels of bricked image to file {}", fileName );
+            return false;
+        }
     }
+
+    return true;
 }
 
+} // anonymous
+
 
 Image::Image(
-        const ImageHeader& header,
-        std::string displayName,
+        const std::string& fileName,
         ImageRepresentation imageRep,
-        MultiComponentBufferType bufferType )
+        MultiComponentBufferType bufferType,
+        FloatStorageType floatStorage,
+        const FileLoadProgress* progress,
+        ThreadPool* statsPool )
     :
       m_data_int8(),
       m_data_uint8(),
@@ -279,26 +479,216 @@ Image::Image(
       m_data_int32(),
       m_data_uint32(),
       m_data_float32(),
+      m_mappedBuffer( std::nullopt ),
+      m_brickedBuffer( std::nullopt ),
 
       m_imageRep( std::move(imageRep) ),
       m_bufferType( std::move(bufferType) ),
+      m_floatStorage( std::move(floatStorage) ),
 
       m_ioInfoOnDisk(),
       m_ioInfoInMemory(),
-
-      m_header( header )
+      m_numComponentsLoaded( 0 ),
+      m_voxelsFromFile( true ),
+      m_cacheKey( std::nullopt ),
+      m_dicomSeries( nullptr )
 {
-    // Temporary buffer component type
-    using TempComponentType = float;
+    using CType = ::itk::ImageIOBase::IOComponentType;
 
-    // Statistics per component are stored as double
-    using StatsType = double;
+    try
+    {
+        throwIfLoadCancelled( progress, fileName );
 
-    // Maximum number of components to create for images with interleaved buffers
-    static constexpr size_t MAX_COMPS = 4;
+        // A path that may hold a DICOM series is scanned for it once. The series that is found is
+        // then used to create the image IO and to read the voxels.
+        const bool isDicomPath = isDicomSeriesPath( fileName );
 
-    // Default buffer value
-    static constexpr TempComponentType DEFAULT_VALUE = 0;
+        if ( isDicomPath )
+        {
+            if ( std::optional<DicomSeries> series = findDicomSeries( fileName ) )
+            {
+                m_dicomSeries = std::make_shared<const DicomSeries>( std::move( *series ) );
+            }
+        }
+
+        // Reuse the header information and statistics of the file that were cached when it was
+        // last opened, provided that the file has not changed since then. DICOM series are not cached
+        // this way, since their slices can change independently of the file that names the series.
+        m_cacheKey = isDicomPath ? std::nullopt : cache::makeImageFileKey( fileName );
+
+        const std::optional<cache::ImageFileInfo> cachedInfo =
+                m_cacheKey ? cache::loadImageFileInfo( *m_cacheKey ) : std::nullopt;
+
+        if ( cachedInfo )
+        {
+            m_ioInfoOnDisk = cachedInfo->m_ioInfoOnDisk;
+            m_ioInfoOnDisk.m_fileInfo.m_fileName = fileName;
+        }
+        else
+        {
+            const itk::ImageIOBase::Pointer imageIo = createStandardImageIo( fileName.c_str(), m_dicomSeries.get() );
+
+            if ( ! imageIo || imageIo.IsNull() )
+            {
+                spdlog::error( "Error creating ImageIOBase for image {}", fileName );
+                throw_debug( "Error creating ImageIOBase" )
+            }
+
+            if ( ! m_ioInfoOnDisk.set( imageIo ) )
+            {
+                spdlog::error( "Error setting image IO information for image {}", fileName );
+                throw_debug( "Error setting image IO information" )
+            }
+        }
+
+        // The image information in memory may not match the information on disk
+        m_ioInfoInMemory = m_ioInfoOnDisk;
+
+        spdlog::info( "Attempting to load image {} with {} pixels and {} components per pixel",
+                      fileName, m_ioInfoOnDisk.m_sizeInfo.m_imageSizeInPixels,
+                      m_ioInfoOnDisk.m_pixelInfo.m_numComponents );
+
+        // Read the image from disk with the component type that is stored on disk,
+        // so that ITK does not convert the pixel buffer to an intermediate type.
+        // Components are only cast after reading if the in-memory type is narrower.
+        std::vector< ComponentStats<double> > componentStats;
+
+        const std::vector< ComponentStats<double> >* cachedStats =
+                cachedInfo ? &cachedInfo->m_componentStats : nullptr;
+
+        switch ( m_ioInfoOnDisk.m_componentInfo.m_componentType )
+        {
+        case CType::UCHAR:     componentStats = loadFromFile<uint8_t>( fileName, cachedStats, progress, statsPool ); break;
+        case CType::CHAR:      componentStats = loadFromFile<int8_t>( fileName, cachedStats, progress, statsPool ); break;
+        case CType::USHORT:    componentStats = loadFromFile<uint16_t>( fileName, cachedStats, progress, statsPool ); break;
+        case CType::SHORT:     componentStats = loadFromFile<int16_t>( fileName, cachedStats, progress, statsPool ); break;
+        case CType::UINT:      componentStats = loadFromFile<uint32_t>( fileName, cachedStats, progress, statsPool ); break;
+        case CType::INT:       componentStats = loadFromFile<int32_t>( fileName, cachedStats, progress, statsPool ); break;
+        case CType::ULONG:     componentStats = loadFromFile<unsigned long>( fileName, cachedStats, progress, statsPool ); break;
+        case CType::LONG:      componentStats = loadFromFile<long>( fileName, cachedStats, progress, statsPool ); break;
+        case CType::ULONGLONG: componentStats = loadFromFile<unsigned long long>( fileName, cachedStats, progress, statsPool ); break;
+        case CType::LONGLONG:  componentStats = loadFromFile<long long>( fileName, cachedStats, progress, statsPool ); break;
+        case CType::FLOAT:     componentStats = loadFromFile<float>( fileName, cachedStats, progress, statsPool ); break;
+
+        // ITK does not read long double pixels, so these are read as double
+        case CType::DOUBLE:
+        case CType::LDOUBLE:   componentStats = loadFromFile<double>( fileName, cachedStats, progress, statsPool ); break;
+
+        case CType::UNKNOWNCOMPONENTTYPE:
+        default:
+        {
+            spdlog::error( "Unknown component type in image {}", fileName );
+            throw_debug( "Unknown component type in image" )
+        }
+        }
+
+        // Cached statistics were used if they cover all of the loaded components. Otherwise,
+        // statistics that were computed exactly from the file are cached for the next time.
+        const bool usedCachedStats = ( cachedStats && cachedStats->size() >= componentStats.size() );
+        const bool provisionalStats = ( defersStatistics() && ! usedCachedStats );
+
+        // The statistics of bricked images are estimated from samples, so they are not cached
+        if ( m_cacheKey && ! usedCachedStats && ! provisionalStats && ! m_brickedBuffer )
+        {
+            cache::saveImageFileInfo( *m_cacheKey, { m_ioInfoOnDisk, componentStats } );
+        }
+
+        // The quantization of the values (if any) was set in the header when they were loaded
+        const std::optional<ValueQuantization> quantization = m_header.quantization();
+
+        m_header = ImageHeader( m_ioInfoOnDisk, m_ioInfoInMemory );
+        m_header.setQuantization( quantization );
+
+        m_tx = ImageTransformations(
+                    m_header.pixelDimensions(),
+                    m_header.spacing(),
+                    m_header.origin(),
+                    m_header.directions() );
+
+        m_numComponentsLoaded = componentStats.size();
+
+        m_settings = ImageSettings(
+                    getFileName( fileName, false ),
+                    m_header.numComponentsPerPixel(),
+                    m_header.memoryComponentType(),
+                    std::move( componentStats ),
+                    provisionalStats,
+                    quantization,
+                    m_header.numFrames() );
+
+        if ( m_header.numFrames() > 1 )
+        {
+            spdlog::info( "Loaded image {} as a time series of {} frames", fileName, m_header.numFrames() );
+        }
+
+        if ( progress )
+        {
+            progress->setFraction( 1.0 );
+        }
+    }
+    catch ( const std::exception& e )
+    {
+        if ( progress )
+        {
+            progress->setFraction( 1.0 );
+        }
+
+        spdlog::error( "Exception while constructing image {}: {}", fileName, e.what() );
+        throw_debug( "Exception while constructing image" )
+    }
+    catch ( ... )
+    {
+        if ( progress )
+        {
+            progress->setFraction( 1.0 );
+        }
+
+        spdlog::error( "Exception while constructing image {}", fileName );
+        throw_debug( "Exception while constructing image" )
+    }
+}
+
+
+Image::Image(
+        const ImageHeader& header,
+        std::string displayName,
+        ImageRepresentation imageRep,
+        MultiComponentBufferType bufferType )
+    :
+      m_data_int8(),
+      m_data_uint8(),
+      m_data_int16(),
+      m_data_uint16(),
+      m_data_int32(),
+      m_data_uint32(),
+      m_data_float32(),
+      m_mappedBuffer( std::nullopt ),
+      m_brickedBuffer( std::nullopt ),
+
+      m_imageRep( std::move(imageRep) ),
+      m_bufferType( std::move(bufferType) ),
+      m_floatStorage( FloatStorageType::Float32 ),
+
+      m_ioInfoOnDisk(),
+      m_ioInfoInMemory(),
+      m_numComponentsLoaded( 0 ),
+      m_voxelsFromFile( false ),
+      m_cacheKey( std::nullopt ),
+      m_dicomSeries( nullptr ),
+
+      m_header( header )
+{
+    // Temporary buffer component type, which matches the UCHAR component type set below
+    using TempComponentType = uint8_t;
+
+    // Statistics per component are stored as double
+    using StatsType = double;
+
+    // Maximum number of components to create for images with interleaved buffers
+    static constexpr size_t MAX_COMPS = 4;
+
+    // Default buffer value
+    static constexpr TempComponentType DEFAULT_VALUE = 0;
 
     /// @todo cleanup
     m_ioInfoOnDisk.m_fileInfo.m_fileName = m_header.fileName();
@@ -366,16 +756,15 @@ Image::Image(
         case MultiComponentBufferType::InterleavedImage:
         {
             // Create a single buffer with interleaved components and load it once:
-            const size_t N = numPixels * numComps;
-            const std::vector<TempComponentType> allComponentBuffers( N, DEFAULT_VALUE );
+            const std::vector<TempComponentType> allComponentBuffers( numPixels * numCompsToLoad, DEFAULT_VALUE );
 
             if ( ImageRepresentation::Segmentation == m_imageRep )
             {
-                loadSegBuffer( allComponentBuffers.data(), N );
+                loadSegBuffer( allComponentBuffers.data(), numPixels, numCompsToLoad, numCompsToLoad );
             }
             else
             {
-                loadImageBuffer( allComponentBuffers.data(), N );
+                loadImageBuffer( allComponentBuffers.data(), numPixels, numCompsToLoad, numCompsToLoad );
             }
             break;
         }
@@ -388,6 +777,27 @@ Image::Image(
                                              DEFAULT_VALUE, numPixels ) );
         }
     }
+    else if ( const auto maxResidentSize = maxResidentBricksSize( numPixels * sizeof( TempComponentType ) ) )
+    {
+        // Create a scalar image that is too large for memory in bricks on disk, which are zero
+        std::optional<BrickedBuffer> bricks = BrickedBuffer::create(
+                    m_header.pixelDimensions(), sizeof( TempComponentType ), *maxResidentSize );
+
+        if ( ! bricks )
+        {
+            spdlog::error( "Unable to create bricks for image {}", m_header.fileName() );
+            throw_debug( "Unable to create bricks for image" )
+        }
+
+        m_brickedBuffer.emplace( std::move( *bricks ) );
+
+        spdlog::info( "Created image {} in {} bytes of bricks on disk, of which at most {} bytes are resident",
+                      m_header.fileName(), m_brickedBuffer->value().sizeInBytes(),
+                      m_brickedBuffer->value().maxResidentSizeInBytes() );
+
+        componentStats.emplace_back( createDefaultImageStatistics<TempComponentType, StatsType, 3>(
+                                         DEFAULT_VALUE, numPixels ) );
+    }
     else
     {
         // Create a scalar, single-component image
@@ -402,46 +812,692 @@ Image::Image(
             loadImageBuffer( buffer.data(), numPixels );
         }
 
-        // Create default image statistics
-        componentStats.emplace_back( createDefaultImageStatistics<TempComponentType, StatsType, 3>(
-                                         DEFAULT_VALUE, numPixels ) );
+        // Create default image statistics
+        componentStats.emplace_back( createDefaultImageStatistics<TempComponentType, StatsType, 3>(
+                                         DEFAULT_VALUE, numPixels ) );
+    }
+
+    m_tx = ImageTransformations(
+                m_header.pixelDimensions(),
+                m_header.spacing(),
+                m_header.origin(),
+                m_header.directions() );
+
+    m_numComponentsLoaded = componentStats.size();
+
+    m_settings = ImageSettings(
+                std::move( displayName ),
+                m_header.numComponentsPerPixel(),
+                m_header.memoryComponentType(),
+                std::move( componentStats ) );
+}
+
+
+template< typename T >
+std::vector< ComponentStats<double> > Image::loadFromFile(
+        const std::string& fileName,
+        const std::vector< ComponentStats<double> >* cachedStats,
+        const FileLoadProgress* progress,
+        ThreadPool* statsPool )
+{
+    // Statistics per component are stored as double
+    using StatsType = double;
+
+    // Maximum number of components to load for images with interleaved buffer components
+    static constexpr size_t MAX_COMPS = 4;
+
+    const size_t numPixels = m_ioInfoOnDisk.m_sizeInfo.m_imageSizeInPixels;
+    const size_t numComps = m_ioInfoOnDisk.m_pixelInfo.m_numComponents;
+    const bool isVectorImage = ( numComps > 1 );
+
+    // DICOM slices are decoded into memory, since they can be neither mapped nor read in slabs
+    const bool isDicom = static_cast<bool>( m_dicomSeries );
+
+    // The frames of a time series are read as a 4D image, whose buffer holds them one after the other.
+    // They are not bricked, since bricks are 3D.
+    const bool isTimeSeries = ( m_ioInfoOnDisk.m_spaceInfo.m_numDimensions > 3 );
+
+    // Extract statistics of each image component into a vector
+    std::vector< ComponentStats<StatsType> > componentStats;
+
+    // Large images are loaded with provisional statistics that are estimated from a subsample of
+    // pixels, so that they can be displayed before their exact statistics are computed
+    const size_t maxNumStatsSamples = defersStatistics() ? sk_maxNumProvisionalStatsSamples : 0;
+
+    // Cached statistics of the file are used instead of computing them if they cover all components to load
+    auto hasCachedStats = [cachedStats] ( size_t numCompsToLoad )
+    {
+        return ( cachedStats && cachedStats->size() >= numCompsToLoad );
+    };
+
+    if ( isVectorImage )
+    {
+        // Load multi-component image
+
+        ReadVoxels<T> vectorImage;
+
+        {
+            LoadStageTimer timer( progress, LoadStage::Read );
+            vectorImage = readVoxels<T, true>( fileName, isTimeSeries, m_dicomSeries.get(), progress );
+        }
+
+        throwIfLoadCancelled( progress, fileName );
+
+        if ( ! vectorImage.m_owner )
+        {
+            spdlog::error( "Unable to read vector image {}", fileName );
+            throw_debug( "Unable to read vector image" )
+        }
+
+        // Load a maximum of MAX_COMPS components for an image with interleaved component buffers
+        const size_t numCompsInImage = vectorImage.m_numComponents;
+        size_t numCompsToLoad = numComps;
+
+        if ( MultiComponentBufferType::InterleavedImage == m_bufferType )
+        {
+            numCompsToLoad = std::min( numCompsToLoad, MAX_COMPS );
+
+            if ( numComps > MAX_COMPS )
+            {
+                spdlog::warn( "The number of image components ({}) exceeds that maximum that will be loaded ({}) "
+                              "because this image uses interleaved buffer format", numComps, MAX_COMPS );
+            }
+        }
+
+        if ( numCompsInImage < numCompsToLoad )
+        {
+            spdlog::error( "Only {} component images were loaded, but {} components were expected",
+                           numCompsInImage, numCompsToLoad );
+
+            numCompsToLoad = numCompsInImage;
+        }
+
+        if ( ImageRepresentation::Segmentation == m_imageRep )
+        {
+            spdlog::warn( "Loading a segmentation image {} with {} components. "
+                          "Only the first component of the segmentation will be used",
+                          fileName, numComps );
+            numCompsToLoad = 1;
+        }
+
+        if ( 0 == numCompsToLoad )
+        {
+            spdlog::error( "No components to load for image {}", fileName );
+            throw_debug( "No components to load for image" )
+        }
+
+        const T* buffer = vectorImage.m_buffer;
+
+        if ( ! buffer )
+        {
+            spdlog::error( "Null buffer of vector image {}", fileName );
+            throw_debug( "Null buffer of vector image" )
+        }
+
+        // Compute statistics of each component from the interleaved buffer
+        {
+            LoadStageTimer timer( progress, LoadStage::Statistics );
+
+            for ( size_t i = 0; i < numCompsToLoad; ++i )
+            {
+                componentStats.emplace_back( hasCachedStats( numCompsToLoad )
+                                             ? ( *cachedStats )[i]
+                                             : computeSubsampledImageStatistics<T, StatsType>(
+                                                   buffer + i, numPixels, numCompsInImage, maxNumStatsSamples, statsPool ) );
+            }
+        }
+
+        // De-interleave the components directly into the separate component buffers, or re-interleave
+        // them into the single interleaved buffer, without intermediate component images
+        {
+            LoadStageTimer timer( progress, LoadStage::Cast );
+
+            if ( ImageRepresentation::Segmentation == m_imageRep )
+            {
+                loadSegBuffer( buffer, numPixels, numCompsInImage, numCompsToLoad );
+            }
+            else
+            {
+                loadImageBuffer( buffer, numPixels, numCompsInImage, numCompsToLoad );
+            }
+        }
+
+        // Release the ITK image now that its components have been loaded
+        vectorImage = ReadVoxels<T>();
+    }
+    else if ( ! isDicom && mapFile<T>( fileName ) )
+    {
+        // Scalar image backed by a memory map of the file
+        LoadStageTimer statsTimer( progress, LoadStage::Statistics );
+
+        componentStats.emplace_back( hasCachedStats( 1 )
+                                     ? cachedStats->front()
+                                     : computeSubsampledImageStatistics<T, StatsType>(
+                                           static_cast<const T*>( m_mappedBuffer->value().data() ),
+                                           numPixels, 1, maxNumStatsSamples, statsPool ) );
+    }
+    else if ( const auto maxResidentSize = maxResidentBricksSize( numPixels * scalarMemoryComponentSize() );
+              ! isDicom && ! isTimeSeries && maxResidentSize )
+    {
+        // Scalar image that is too large for memory, held in bricks on disk
+        componentStats = loadBricksFromFile<T>( fileName, *maxResidentSize,
+                                                hasCachedStats( 1 ) ? cachedStats : nullptr, progress );
+    }
+    else
+    {
+        // Load scalar, single-component image
+
+        ReadVoxels<T> image;
+
+        {
+            LoadStageTimer timer( progress, LoadStage::Read );
+            image = readVoxels<T, false>( fileName, isTimeSeries, m_dicomSeries.get(), progress );
+        }
+
+        throwIfLoadCancelled( progress, fileName );
+
+        if ( ! image.m_owner )
+        {
+            spdlog::error( "Unable to read image {}", fileName );
+            throw_debug( "Unable to read image" )
+        }
+
+        const T* buffer = image.m_buffer;
+
+        if ( ! buffer )
+        {
+            spdlog::error( "Null buffer of scalar image {}", fileName );
+            throw_debug( "Null buffer of scalar image" )
+        }
+
+        {
+            LoadStageTimer timer( progress, LoadStage::Cast );
+
+            if ( ImageRepresentation::Segmentation == m_imageRep )
+            {
+                loadSegBuffer( buffer, numPixels );
+            }
+            else
+            {
+                loadImageBuffer( buffer, numPixels );
+            }
+        }
+
+        LoadStageTimer statsTimer( progress, LoadStage::Statistics );
+
+        componentStats.emplace_back( hasCachedStats( 1 )
+                                     ? cachedStats->front()
+                                     : computeSubsampledImageStatistics<T, StatsType>(
+                                           buffer, numPixels, 1, maxNumStatsSamples, statsPool ) );
+    }
+
+    return componentStats;
+}
+
+
+template< typename T >
+std::vector< ComponentStats<double> > Image::loadBricksFromFile(
+        const std::string& fileName, size_t maxResidentSize,
+        const std::vector< ComponentStats<double> >* cachedStats,
+        const FileLoadProgress* progress )
+{
+    using CType = ::itk::ImageIOBase::IOComponentType;
+
+    const CType memoryType = memoryComponentType(
+                m_ioInfoOnDisk.m_componentInfo.m_componentType,
+                ImageRepresentation::Segmentation == m_imageRep );
+
+    if ( std::is_floating_point_v<T> && quantizesFloatValues() )
+    {
+        spdlog::warn( "Floating-point values of image {} are not quantized, since it is held in bricks", fileName );
+    }
+
+    std::optional< ComponentStats<double> > sampledStats;
+
+    visitComponentType( fromItkComponentType( memoryType ), [&] ( auto zero )
+    {
+        // Reading, casting, and sampling are interleaved per slab, so they are all timed as reading
+        LoadStageTimer timer( progress, LoadStage::Read );
+        sampledStats = readFileIntoBricks<T, decltype( zero )>( fileName, maxResidentSize, progress );
+    } );
+
+    if ( ! sampledStats )
+    {
+        spdlog::error( "Unsupported component type in memory for image {}", fileName );
+        throw_debug( "Unsupported component type in memory for image" )
+    }
+
+    m_ioInfoInMemory.m_componentInfo.m_componentType = memoryType;
+    m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = memoryComponentSizeInBytes( memoryType );
+    m_ioInfoInMemory.m_componentInfo.m_componentTypeString = itk::ImageIOBase::GetComponentTypeAsString( memoryType );
+
+    m_ioInfoInMemory.m_sizeInfo.m_imageSizeInBytes =
+            m_ioInfoOnDisk.m_sizeInfo.m_imageSizeInPixels * m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes;
+
+    if ( memoryType != m_ioInfoOnDisk.m_componentInfo.m_componentType )
+    {
+        spdlog::info( "Cast image pixel component from type {} to {}",
+                      m_ioInfoOnDisk.m_componentInfo.m_componentTypeString,
+                      m_ioInfoInMemory.m_componentInfo.m_componentTypeString );
+    }
+
+    spdlog::info( "Loaded image {} into {} bytes of bricks on disk, of which at most {} bytes are resident",
+                  fileName, m_brickedBuffer->value().sizeInBytes(),
+                  m_brickedBuffer->value().maxResidentSizeInBytes() );
+
+    return { cachedStats ? cachedStats->front() : *sampledStats };
+}
+
+
+template< typename T, typename U >
+ComponentStats<double> Image::readFileIntoBricks(
+        const std::string& fileName, size_t maxResidentSize, const FileLoadProgress* progress )
+{
+    using ImageType = itk::Image<T, 3>;
+    using ReaderType = itk::ImageFileReader<ImageType>;
+
+    static constexpr uint32_t sk_slabSize = BrickedBuffer::sk_brickSize;
+
+    const glm::uvec3 dims = pixelDimensions( m_ioInfoOnDisk );
+    const size_t numPixels = m_ioInfoOnDisk.m_sizeInfo.m_imageSizeInPixels;
+    const size_t sliceSize = static_cast<size_t>( dims.x ) * dims.y;
+
+    std::optional<BrickedBuffer> bricks = BrickedBuffer::create( dims, sizeof( U ), maxResidentSize );
+
+    if ( ! bricks )
+    {
+        spdlog::error( "Unable to create bricks for image {}", fileName );
+        throw_debug( "Unable to create bricks for image" )
+    }
+
+    typename ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName( fileName );
+    reader->UpdateOutputInformation();
+
+    if ( ! reader->GetImageIO()->CanStreamRead() )
+    {
+        spdlog::warn( "Image {} cannot be read in slabs, so it is read whole before it is divided into bricks",
+                      fileName );
+    }
+
+    ImageType* image = reader->GetOutput();
+
+    // Pixels are sampled at an odd stride to estimate the statistics of the image
+    const size_t sampleStride = ( ( numPixels + sk_maxNumBrickedStatsSamples - 1 ) / sk_maxNumBrickedStatsSamples ) | 1u;
+
+    std::vector<U> samples;
+    samples.reserve( numPixels / sampleStride + 1 );
+
+    std::vector<U> castSlab( std::is_same_v<T, U> ? 0 : sliceSize * std::min( sk_slabSize, dims.z ) );
+
+    for ( uint32_t z = 0; z < dims.z; z += sk_slabSize )
+    {
+        throwIfLoadCancelled( progress, fileName );
+
+        const uint32_t numSlices = std::min( sk_slabSize, dims.z - z );
+
+        typename ImageType::IndexType slabIndex;
+        slabIndex[0] = 0;
+        slabIndex[1] = 0;
+        slabIndex[2] = z;
+
+        typename ImageType::SizeType slabSize;
+        slabSize[0] = dims.x;
+        slabSize[1] = dims.y;
+        slabSize[2] = numSlices;
+
+        const typename ImageType::RegionType slab( slabIndex, slabSize );
+
+        // Request only this slab from the reader. ImageIOs that cannot stream read the whole
+        // image once, which then also contains all of the following slabs.
+        image->SetRequestedRegion( slab );
+        image->PropagateRequestedRegion();
+        image->UpdateOutputData();
+
+        const typename ImageType::RegionType& bufferedRegion = image->GetBufferedRegion();
+
+        if ( bufferedRegion.GetSize( 0 ) != dims.x ||
+             bufferedRegion.GetSize( 1 ) != dims.y ||
+             ! bufferedRegion.IsInside( slab ) )
+        {
+            spdlog::error( "Unable to read slices {} to {} of image {}", z, z + numSlices - 1, fileName );
+            throw_debug( "Unable to read slab of image" )
+        }
+
+        const T* sourceSlab = image->GetBufferPointer() + image->ComputeOffset( slabIndex );
+        const size_t slabPixels = numSlices * sliceSize;
+        const U* slab = nullptr;
+
+        if constexpr ( std::is_same_v<T, U> )
+        {
+            slab = sourceSlab;
+        }
+        else
+        {
+            detail::copyComponents<U, T>( sourceSlab, slabPixels, 1, { castSlab.data() }, 1 );
+            slab = castSlab.data();
+        }
+
+        // The slab is one layer of bricks, which is written at once, so that each brick is
+        // filled while it is resident even if the layer exceeds the resident set
+        if ( ! bricks->writeBlock( glm::uvec3{ 0, 0, z }, glm::uvec3{ dims.x, dims.y, numSlices }, slab ) )
+        {
+            spdlog::error( "Unable to write slices {} to {} of image {} to bricks", z, z + numSlices - 1, fileName );
+            throw_debug( "Unable to write slab of image to bricks" )
+        }
+
+        if ( progress )
+        {
+            ImageSlab imageSlab;
+            imageSlab.m_componentType = fromItkComponentType( itk::ImageIOBase::MapPixelType<U>::CType );
+            imageSlab.m_voxels = slab;
+            imageSlab.m_imageDims = { { dims.x, dims.y, dims.z } };
+            imageSlab.m_firstSlice = z;
+            imageSlab.m_numSlices = numSlices;
+
+            for ( uint32_t i = 0; i < 3; ++i )
+            {
+                imageSlab.m_imageSpacing[i] = image->GetSpacing()[i];
+            }
+
+            progress->addSlab( imageSlab );
+        }
+
+        const size_t slabStart = z * sliceSize;
+
+        for ( size_t p = ( sampleStride - slabStart % sampleStride ) % sampleStride; p < slabPixels; p += sampleStride )
+        {
+            samples.push_back( slab[p] );
+        }
+
+        if ( progress )
+        {
+            progress->setFraction( static_cast<double>( z + numSlices ) / dims.z );
+        }
+    }
+
+    m_brickedBuffer.emplace( std::move( *bricks ) );
+
+    return estimateImageStatistics( samples, numPixels );
+}
+
+
+uint32_t Image::scalarMemoryComponentSize() const
+{
+    using CType = ::itk::ImageIOBase::IOComponentType;
+
+    const CType fileType = m_ioInfoOnDisk.m_componentInfo.m_componentType;
+
+    const bool isFloat = ( CType::FLOAT == fileType || CType::DOUBLE == fileType || CType::LDOUBLE == fileType );
+
+    if ( isFloat && quantizesFloatValues() )
+    {
+        return sizeof( uint16_t );
+    }
+
+    return memoryComponentSizeInBytes(
+                memoryComponentType( fileType, ImageRepresentation::Segmentation == m_imageRep ) );
+}
+
+
+bool Image::quantizesFloatValues() const
+{
+    return ( ImageRepresentation::Image == m_imageRep &&
+             FloatStorageType::QuantizedUInt16 == m_floatStorage );
+}
+
+
+bool Image::defersStatistics() const
+{
+    // The statistics of bricked images are already estimated from samples when they are loaded
+    return ( ImageRepresentation::Image == m_imageRep && ! m_brickedBuffer &&
+             m_ioInfoOnDisk.m_sizeInfo.m_imageSizeInPixels > sk_maxNumProvisionalStatsSamples );
+}
+
+
+bool Image::saveStatisticsToCache( const std::vector< ComponentStats<double> >& componentStats ) const
+{
+    // Only exact statistics of the values as they are stored in the file are cached
+    if ( ! m_cacheKey || m_header.quantization() || m_brickedBuffer ||
+         m_header.memoryComponentType() != m_header.fileComponentType() )
+    {
+        return false;
+    }
+
+    return cache::saveImageFileInfo( *m_cacheKey, { m_ioInfoOnDisk, componentStats } );
+}
+
+
+std::vector< ComponentStats<double> > Image::computeStatistics( ThreadPool* pool ) const
+{
+    std::vector< ComponentStats<double> > componentStats;
+
+    switch ( m_header.memoryComponentType() )
+    {
+    case ComponentType::Int8:    componentStats = computeComponentStatistics<int8_t>( pool ); break;
+    case ComponentType::UInt8:   componentStats = computeComponentStatistics<uint8_t>( pool ); break;
+    case ComponentType::Int16:   componentStats = computeComponentStatistics<int16_t>( pool ); break;
+    case ComponentType::UInt16:  componentStats = computeComponentStatistics<uint16_t>( pool ); break;
+    case ComponentType::Int32:   componentStats = computeComponentStatistics<int32_t>( pool ); break;
+    case ComponentType::UInt32:  componentStats = computeComponentStatistics<uint32_t>( pool ); break;
+    case ComponentType::Float32: componentStats = computeComponentStatistics<float>( pool ); break;
+    default:
+    {
+        spdlog::error( "Unsupported component type in memory for image {}", m_header.fileName() );
+        return {};
+    }
+    }
+
+    if ( const auto& quantization = m_header.quantization() )
+    {
+        // Statistics of the quantized values in memory are mapped back to image values
+        for ( auto& stats : componentStats )
+        {
+            stats = dequantizeImageStatistics( std::move( stats ), *quantization, m_header.numPixels() );
+        }
+    }
+
+    return componentStats;
+}
+
+
+template< typename T >
+std::vector< ComponentStats<double> > Image::computeComponentStatistics( ThreadPool* pool ) const
+{
+    const size_t numPixels = m_header.numPixels();
+
+    std::vector< ComponentStats<double> > componentStats;
+
+    if ( m_brickedBuffer )
+    {
+        // Bricked images are too large for a pass over all pixels, so their statistics are
+        // estimated from pixels that are sampled brick by brick
+        const size_t sampleStride =
+                ( ( numPixels + sk_maxNumBrickedStatsSamples - 1 ) / sk_maxNumBrickedStatsSamples ) | 1u;
+
+        std::vector<T> samples;
+        samples.reserve( numPixels / sampleStride + 1 );
+
+        size_t count = 0;
+
+        visitBlocks( 0, [&samples, &count, sampleStride] ( const auto& view, const glm::uvec3& )
+        {
+            view.forEachVoxel( [&] ( const auto& value, uint32_t, uint32_t, uint32_t )
+            {
+                if ( 0 == count++ % sampleStride )
+                {
+                    samples.push_back( static_cast<T>( value ) );
+                }
+            } );
+        } );
+
+        componentStats.emplace_back( estimateImageStatistics( samples, numPixels ) );
+        return componentStats;
+    }
+
+    for ( size_t i = 0; i < m_numComponentsLoaded; ++i )
+    {
+        switch ( m_bufferType )
+        {
+        case MultiComponentBufferType::SeparateImages:
+        {
+            componentStats.emplace_back( computeImageStatistics<T, double>(
+                                             static_cast<const T*>( componentBuffer( i ) ), numPixels, 1, pool ) );
+            break;
+        }
+        case MultiComponentBufferType::InterleavedImage:
+        {
+            const T* buffer = static_cast<const T*>( componentBuffer( 0 ) );
+
+            componentStats.emplace_back( computeImageStatistics<T, double>(
+                                             buffer ? buffer + i : nullptr, numPixels, m_numComponentsLoaded, pool ) );
+            break;
+        }
+        }
+    }
+
+    return componentStats;
+}
+
+
+template< typename T >
+bool Image::mapFile( const std::string& fileName )
+{
+    static constexpr bool sk_isImageType =
+            std::is_same_v<T, int8_t> || std::is_same_v<T, uint8_t> ||
+            std::is_same_v<T, int16_t> || std::is_same_v<T, uint16_t> ||
+            std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> ||
+            std::is_same_v<T, float>;
+
+    // The file must not be truncated or rewritten in place while it is mapped, since unwritten pages of
+    // the mapping read the current file. Files that are saved by Image::saveToDisk are safe, since they are
+    // replaced by renaming; a file that is truncated by another process reads as zero past its new end
+    // (see MappedFileBuffer).
+    //
+    // Segmentations are not mapped: they are edited and saved back to the file that they are loaded from,
+    // which must not be rewritten while its pages back the voxels
+    if ( ImageRepresentation::Segmentation == m_imageRep )
+    {
+        return false;
+    }
+
+    // Only components that are used in memory without a cast can be mapped
+    if ( ! sk_isImageType )
+    {
+        return false;
+    }
+
+    if ( 1 != m_ioInfoOnDisk.m_pixelInfo.m_numComponents )
+    {
+        return false;
+    }
+
+    // Floating-point values that are quantized in memory are not used directly from the file
+    if ( std::is_floating_point_v<T> && quantizesFloatValues() )
+    {
+        return false;
+    }
+
+    const bool nativeByteOrder =
+            ( 1 == sizeof( T ) ) ||
+            ( itk::ByteSwapper<T>::SystemIsBigEndian()
+              ? ( itk::IOByteOrderEnum::BigEndian == m_ioInfoOnDisk.m_fileInfo.m_byteOrder )
+              : ( itk::IOByteOrderEnum::LittleEndian == m_ioInfoOnDisk.m_fileInfo.m_byteOrder ) );
+
+    if ( ! nativeByteOrder )
+    {
+        return false;
+    }
+
+    const std::optional<size_t> offset = findRawVoxelDataOffset( fileName );
+
+    // The voxels must be aligned to their component size in the mapping
+    if ( ! offset || 0 != ( *offset % sizeof( T ) ) )
+    {
+        return false;
     }
 
-    m_tx = ImageTransformations(
-                m_header.pixelDimensions(),
-                m_header.spacing(),
-                m_header.origin(),
-                m_header.directions() );
+    const size_t sizeInBytes = m_ioInfoOnDisk.m_sizeInfo.m_imageSizeInPixels * sizeof( T );
 
-    m_settings = ImageSettings(
-                std::move( displayName ),
-                m_header.numComponentsPerPixel(),
-                m_header.memoryComponentType(),
-                std::move( componentStats ) );
+    if ( auto mappedBuffer = MappedFileBuffer::map( fileName, *offset, sizeInBytes ) )
+    {
+        m_mappedBuffer.emplace( std::move( *mappedBuffer ) );
+
+        spdlog::info( "Memory mapped {} bytes of voxel data at offset {} of image {}",
+                      sizeInBytes, *offset, fileName );
+    }
+
+    return m_mappedBuffer.has_value();
 }
 
 
-void Image::loadImageBuffer( const float* buffer, size_t numElements )
+template< typename T >
+void Image::loadImageBuffer( const T* buffer, size_t numPixels, size_t numComps, size_t numCompsToLoad )
 {
     using CType = ::itk::ImageIOBase::IOComponentType;
 
+    const bool interleave = ( MultiComponentBufferType::InterleavedImage == m_bufferType );
+    const size_t numElements = interleave ? numPixels * numCompsToLoad : numPixels;
+
     bool didCast = false;
     bool warnSizeConversion = false;
 
+    const bool isFloat = ( CType::FLOAT == m_ioInfoOnDisk.m_componentInfo.m_componentType ||
+                           CType::DOUBLE == m_ioInfoOnDisk.m_componentInfo.m_componentType ||
+                           CType::LDOUBLE == m_ioInfoOnDisk.m_componentInfo.m_componentType );
+
+    if ( isFloat && quantizesFloatValues() && 1 < numCompsToLoad )
+    {
+        // A single quantization is recorded per image, which would not suit components with different ranges
+        spdlog::warn( "Floating-point values of image {} are not quantized, since it has {} components",
+                      m_ioInfoOnDisk.m_fileInfo.m_fileName, numCompsToLoad );
+    }
+    else if ( isFloat && quantizesFloatValues() )
+    {
+        // Hold the floating-point values as 16-bit integers that are scaled to the value range
+        std::vector< std::vector<uint16_t> > newBuffers;
+
+        const ValueQuantization quantization = appendQuantizedComponentBuffers(
+                    newBuffers, buffer, numPixels, numComps, numCompsToLoad, interleave );
+
+        for ( auto& newBuffer : newBuffers )
+        {
+            m_data_uint16.emplace_back( std::move( newBuffer ) );
+        }
+
+        m_header.setQuantization( quantization );
+
+        m_ioInfoInMemory.m_componentInfo.m_componentType = CType::USHORT;
+        m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 2;
+        m_ioInfoInMemory.m_componentInfo.m_componentTypeString =
+                itk::ImageIOBase::GetComponentTypeAsString( CType::USHORT );
+
+        m_ioInfoInMemory.m_sizeInfo.m_imageSizeInBytes =
+                numElements * m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes;
+
+        spdlog::info( "Quantized image pixel component from type {} to {} with slope {} and intercept {} "
+                      "(maximum error {}, RMS error {})",
+                      m_ioInfoOnDisk.m_componentInfo.m_componentTypeString,
+                      m_ioInfoInMemory.m_componentInfo.m_componentTypeString,
+                      quantization.m_slope, quantization.m_intercept,
+                      quantization.m_maxError, quantization.m_rmsError );
+        return;
+    }
+
     switch ( m_ioInfoOnDisk.m_componentInfo.m_componentType )
     {
-    case CType::UCHAR:  m_data_uint8.emplace_back( createBuffer<uint8_t>( buffer, numElements ) ); break;
-    case CType::CHAR:   m_data_int8.emplace_back( createBuffer<int8_t>( buffer, numElements ) ); break;
-    case CType::USHORT: m_data_uint16.emplace_back( createBuffer<uint16_t>( buffer, numElements ) ); break;
-    case CType::SHORT:  m_data_int16.emplace_back( createBuffer<int16_t>( buffer, numElements ) ); break;
-    case CType::UINT:   m_data_uint32.emplace_back( createBuffer<uint32_t>( buffer, numElements ) ); break;
-    case CType::INT:    m_data_int32.emplace_back( createBuffer<int32_t>( buffer, numElements ) ); break;
-    case CType::FLOAT:  m_data_float32.emplace_back( createBuffer<float>( buffer, numElements ) ); break;
+    case CType::UCHAR:  appendComponentBuffers( m_data_uint8, buffer, numPixels, numComps, numCompsToLoad, interleave ); break;
+    case CType::CHAR:   appendComponentBuffers( m_data_int8, buffer, numPixels, numComps, numCompsToLoad, interleave ); break;
+    case CType::USHORT: appendComponentBuffers( m_data_uint16, buffer, numPixels, numComps, numCompsToLoad, interleave ); break;
+    case CType::SHORT:  appendComponentBuffers( m_data_int16, buffer, numPixels, numComps, numCompsToLoad, interleave ); break;
+    case CType::UINT:   appendComponentBuffers( m_data_uint32, buffer, numPixels, numComps, numCompsToLoad, interleave ); break;
+    case CType::INT:    appendComponentBuffers( m_data_int32, buffer, numPixels, numComps, numCompsToLoad, interleave ); break;
+    case CType::FLOAT:  appendComponentBuffers( m_data_float32, buffer, numPixels, numComps, numCompsToLoad, interleave ); break;
 
     case CType::ULONG:
     case CType::ULONGLONG:
     {
-        m_data_uint32.emplace_back( createBuffer<uint32_t>( buffer, numElements ) );
+        appendComponentBuffers( m_data_uint32, buffer, numPixels, numComps, numCompsToLoad, interleave );
         m_ioInfoInMemory.m_componentInfo.m_componentType = CType::UINT;
         m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
 
@@ -453,7 +1509,7 @@ void Image::loadImageBuffer( const float* buffer, size_t numElements )
     case CType::LONG:
     case CType::LONGLONG:
     {
-        m_data_int32.emplace_back( createBuffer<int32_t>( buffer, numElements ) );
+        appendComponentBuffers( m_data_int32, buffer, numPixels, numComps, numCompsToLoad, interleave );
         m_ioInfoInMemory.m_componentInfo.m_componentType = CType::INT;
         m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
 
@@ -465,7 +1521,7 @@ void Image::loadImageBuffer( const float* buffer, size_t numElements )
     case CType::DOUBLE:
     case CType::LDOUBLE:
     {
-        m_data_float32.emplace_back( createBuffer<float>( buffer, numElements ) );
+        appendComponentBuffers( m_data_float32, buffer, numPixels, numComps, numCompsToLoad, interleave );
         m_ioInfoInMemory.m_componentInfo.m_componentType = CType::FLOAT;
         m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
 
@@ -504,10 +1560,14 @@ void Image::loadImageBuffer( const float* buffer, size_t numElements )
 }
 
 
-void Image::loadSegBuffer( const float* buffer, size_t numElements )
+template< typename T >
+void Image::loadSegBuffer( const T* buffer, size_t numPixels, size_t numComps, size_t numCompsToLoad )
 {
     using CType = ::itk::ImageIOBase::IOComponentType;
 
+    const bool interleave = ( MultiComponentBufferType::InterleavedImage == m_bufferType );
+    const size_t numElements = interleave ? numPixels * numCompsToLoad : numPixels;
+
     bool didCast = false;
     bool warnFloatConversion = false;
     bool warnSizeConversion = false;
@@ -518,24 +1578,24 @@ void Image::loadSegBuffer( const float* buffer, size_t numElements )
     // No casting is needed for the cases of unsigned integers with 8, 16, or 32 bytes:
     case CType::UCHAR:
     {
-        m_data_uint8.emplace_back( createBuffer<uint8_t>( buffer, numElements ) );
+        appendComponentBuffers( m_data_uint8, buffer, numPixels, numComps, numCompsToLoad, interleave );
         break;
     }
     case CType::USHORT:
     {
-        m_data_uint16.emplace_back( createBuffer<uint16_t>( buffer, numElements ) );
+        appendComponentBuffers( m_data_uint16, buffer, numPixels, numComps, numCompsToLoad, interleave );
         break;
     }
     case CType::UINT:
     {
-        m_data_uint32.emplace_back( createBuffer<uint32_t>( buffer, numElements ) );
+        appendComponentBuffers( m_data_uint32, buffer, numPixels, numComps, numCompsToLoad, interleave );
         break;
     }
 
     // Signed 8-, 16-, and 32-bit integers are cast to unsigned 8-, 16-, and 32-bit integers:
     case CType::CHAR:
     {
-        m_data_uint8.emplace_back( createBuffer<uint8_t>( buffer, numElements ) );
+        appendComponentBuffers( m_data_uint8, buffer, numPixels, numComps, numCompsToLoad, interleave );
         m_ioInfoInMemory.m_componentInfo.m_componentType = CType::UCHAR;
         m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 1;
 
@@ -545,7 +1605,7 @@ void Image::loadSegBuffer( const float* buffer, size_t numElements )
     }
     case CType::SHORT:
     {
-        m_data_uint16.emplace_back( createBuffer<uint16_t>( buffer, numElements ) );
+        appendComponentBuffers( m_data_uint16, buffer, numPixels, numComps, numCompsToLoad, interleave );
         m_ioInfoInMemory.m_componentInfo.m_componentType = CType::USHORT;
         m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 2;
 
@@ -555,7 +1615,7 @@ void Image::loadSegBuffer( const float* buffer, size_t numElements )
     }
     case CType::INT:
     {
-        m_data_uint32.emplace_back( createBuffer<uint32_t>( buffer, numElements ) );
+        appendComponentBuffers( m_data_uint32, buffer, numPixels, numComps, numCompsToLoad, interleave );
         m_ioInfoInMemory.m_componentInfo.m_componentType = CType::UINT;
         m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
 
@@ -568,7 +1628,7 @@ void Image::loadSegBuffer( const float* buffer, size_t numElements )
     case CType::ULONG:
     case CType::ULONGLONG:
     {
-        m_data_uint32.emplace_back( createBuffer<uint32_t>( buffer, numElements ) );
+        appendComponentBuffers( m_data_uint32, buffer, numPixels, numComps, numCompsToLoad, interleave );
         m_ioInfoInMemory.m_componentInfo.m_componentType = CType::UINT;
         m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
 
@@ -581,7 +1641,7 @@ void Image::loadSegBuffer( const float* buffer, size_t numElements )
     case CType::LONG:
     case CType::LONGLONG:
     {
-        m_data_uint32.emplace_back( createBuffer<uint32_t>( buffer, numElements ) );
+        appendComponentBuffers( m_data_uint32, buffer, numPixels, numComps, numCompsToLoad, interleave );
         m_ioInfoInMemory.m_componentInfo.m_componentType = CType::UINT;
         m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
 
@@ -596,7 +1656,7 @@ void Image::loadSegBuffer( const float* buffer, size_t numElements )
     case CType::DOUBLE:
     case CType::LDOUBLE:
     {
-        m_data_uint32.emplace_back( createBuffer<uint32_t>( buffer, numElements ) );
+        appendComponentBuffers( m_data_uint32, buffer, numPixels, numComps, numCompsToLoad, interleave );
         m_ioInfoInMemory.m_componentInfo.m_componentType = CType::UINT;
         m_ioInfoInMemory.m_componentInfo.m_componentSizeInBytes = 4;
 
@@ -650,96 +1710,143 @@ void Image::loadSegBuffer( const float* buffer, size_t numElements )
 }
 
 
-bool Image::saveToDisk( const std::optional<std::string>& newFileName )
+bool Image::saveToDisk( const std::optional<std::string>& newFileName ) const
 {
-    constexpr uint32_t DIM = 3;
-    constexpr bool s_isVectorImage = false;
-
     const std::string fileName = ( newFileName ) ? *newFileName : m_header.fileName();
 
-    if ( m_header.numComponentsPerPixel() > 1 )
+    if ( m_header.numFrames() > 1 )
     {
-        // Saving is only supported for scalar types right now
+        spdlog::error( "Image {} is a time series with {} frames, which cannot be saved",
+                       fileName, m_header.numFrames() );
         return false;
     }
 
-    std::array< uint32_t, DIM > dims;
-    std::array< double, DIM > origin;
-    std::array< double, DIM > spacing;
-    std::array< std::array<double, DIM>, DIM > directions;
+    // A bricked image does not fit in memory. Its file is written by ITK from zero pages that take
+    // no memory, after which the zero voxels in the file are overwritten from the bricks.
+    std::optional<MappedFileBuffer> zeroBuffer;
+    std::vector<const void*> buffers;
 
-    for ( uint32_t i = 0; i < DIM; ++i )
+    if ( m_brickedBuffer )
     {
-        dims[i] = m_header.pixelDimensions()[i];
-        origin[i] = m_header.origin()[i];
-        spacing[i] = m_header.spacing()[i];
-
-        directions[i] = {
-            m_header.directions()[i].x,
-            m_header.directions()[i].y,
-            m_header.directions()[i].z
-        };
-    }
+        zeroBuffer = MappedFileBuffer::zeros( m_header.memoryImageSizeInBytes() );
 
-    bool saved = false;
+        if ( ! zeroBuffer )
+        {
+            spdlog::error( "Unable to map memory for writing the header of bricked image {}", fileName );
+            return false;
+        }
 
-    switch ( m_header.memoryComponentType() )
-    {
-    case ComponentType::Int8:
-    {
-        auto image = makeScalarImage( dims, origin, spacing, directions, m_data_int8[0].data() );
-        saved = writeImage<int8_t, DIM, s_isVectorImage>( image, fileName );
-        break;
+        buffers.push_back( zeroBuffer->data() );
     }
-    case ComponentType::UInt8:
+    else
     {
-        auto image = makeScalarImage( dims, origin, spacing, directions, m_data_uint8[0].data() );
-        saved = writeImage<uint8_t, DIM, s_isVectorImage>( image, fileName );
-        break;
+        const uint32_t numBuffers = ( MultiComponentBufferType::InterleavedImage == m_bufferType )
+                ? 1 : m_header.numComponentsPerPixel();
+
+        for ( uint32_t c = 0; c < numBuffers; ++c )
+        {
+            buffers.push_back( bufferAsVoid( c ) );
+        }
     }
-    case ComponentType::Int16:
+
+    if ( buffers.empty() || std::count( std::begin( buffers ), std::end( buffers ), nullptr ) > 0 )
     {
-        auto image = makeScalarImage( dims, origin, spacing, directions, m_data_int16[0].data() );
-        saved = writeImage<int16_t, DIM, s_isVectorImage>( image, fileName );
-        break;
+        spdlog::error( "Voxels of image {} are not in memory and cannot be saved", fileName );
+        return false;
     }
-    case ComponentType::UInt16:
+
+    const auto writeBuffers = [this, &buffers] ( const std::string& writtenFileName ) -> bool
     {
-        auto image = makeScalarImage( dims, origin, spacing, directions, m_data_uint16[0].data() );
-        saved = writeImage<uint16_t, DIM, s_isVectorImage>( image, fileName );
-        break;
-    }
-    case ComponentType::Int32:
+        switch ( m_header.memoryComponentType() )
+        {
+        case ComponentType::Int8: return writeImageBuffers<int8_t>( m_header, buffers, writtenFileName );
+        case ComponentType::UInt8: return writeImageBuffers<uint8_t>( m_header, buffers, writtenFileName );
+        case ComponentType::Int16: return writeImageBuffers<int16_t>( m_header, buffers, writtenFileName );
+        case ComponentType::UInt16: return writeImageBuffers<uint16_t>( m_header, buffers, writtenFileName );
+        case ComponentType::Int32: return writeImageBuffers<int32_t>( m_header, buffers, writtenFileName );
+        case ComponentType::UInt32: return writeImageBuffers<uint32_t>( m_header, buffers, writtenFileName );
+        case ComponentType::Float32: return writeImageBuffers<float>( m_header, buffers, writtenFileName );
+        default: return false;
+        }
+    };
+
+    const auto write = [this, &writeBuffers] ( const std::string& writtenFileName ) -> bool
     {
-        auto image = makeScalarImage( dims, origin, spacing, directions, m_data_int32[0].data() );
-        saved = writeImage<int32_t, DIM, s_isVectorImage>( image, fileName );
-        break;
-    }
-    case ComponentType::UInt32:
+        return writeBuffers( writtenFileName ) &&
+                ( ! m_brickedBuffer || writeBrickedVoxels( m_brickedBuffer->value(), writtenFileName ) );
+    };
+
+    return writeFileAtomically( fileName, write );
+}
+
+
+Image Image::snapshot() const
+{
+    Image copy( *this );
+
+    if ( m_brickedBuffer )
     {
-        auto image = makeScalarImage( dims, origin, spacing, directions, m_data_uint32[0].data() );
-        saved = writeImage<uint32_t, DIM, s_isVectorImage>( image, fileName );
-        break;
+        copy.m_brickedBuffer.emplace( m_brickedBuffer->value().snapshot() );
     }
-    case ComponentType::Float32:
+
+    return copy;
+}
+
+
+std::optional<Image> Image::shareVoxelsOf( const Image& image, FloatStorageType floatStorage )
+{
+    using CType = ::itk::ImageIOBase::IOComponentType;
+
+    const CType fileType = image.m_ioInfoOnDisk.m_componentInfo.m_componentType;
+    const bool isFloat = ( CType::FLOAT == fileType || CType::DOUBLE == fileType || CType::LDOUBLE == fileType );
+
+    // The float storage only affects the voxels of floating-point images
+    if ( ! image.m_voxelsFromFile || ! image.hasVoxels() ||
+         ( isFloat && floatStorage != image.m_floatStorage ) )
     {
-        auto image = makeScalarImage( dims, origin, spacing, directions, m_data_float32[0].data() );
-        saved = writeImage<float, DIM, s_isVectorImage>( image, fileName );
-        break;
+        return std::nullopt;
     }
-    default:
+
+    // The copy shares the voxel buffers, whereas its header, settings, and transformations are
+    // created from the file information as in the constructor that reads the file
+    Image newImage( image );
+
+    std::vector< ComponentStats<double> > componentStats;
+
+    for ( uint32_t c = 0; c < image.m_numComponentsLoaded; ++c )
     {
-        saved = false;
-        break;
-    }
+        componentStats.push_back( image.m_settings.componentStatistics( c ) );
     }
 
-    return saved;
+    const std::optional<ValueQuantization> quantization = image.m_header.quantization();
+
+    newImage.m_floatStorage = floatStorage;
+
+    newImage.m_header = ImageHeader( image.m_ioInfoOnDisk, image.m_ioInfoInMemory );
+    newImage.m_header.setQuantization( quantization );
+
+    newImage.m_tx = ImageTransformations(
+                newImage.m_header.pixelDimensions(),
+                newImage.m_header.spacing(),
+                newImage.m_header.origin(),
+                newImage.m_header.directions() );
+
+    newImage.m_settings = ImageSettings(
+                getFileName( image.m_ioInfoOnDisk.m_fileInfo.m_fileName, false ),
+                newImage.m_header.numComponentsPerPixel(),
+                newImage.m_header.memoryComponentType(),
+                std::move( componentStats ),
+                image.m_settings.hasProvisionalStatistics(),
+                quantization,
+                newImage.m_header.numFrames() );
+
+    return newImage;
 }
 
 
 const Image::ImageRepresentation& Image::imageRep() const { return m_imageRep; }
 const Image::MultiComponentBufferType& Image::bufferType() const { return m_bufferType; }
+const Image::FloatStorageType& Image::floatStorage() const { return m_floatStorage; }
 
 const ImageHeader& Image::header() const { return m_header; }
 ImageHeader& Image::header() { return m_header; }
@@ -753,21 +1860,6 @@ ImageSettings& Image::settings() { return m_settings; }
 
 const void* Image::bufferAsVoid( uint32_t comp ) const
 {
-    auto F = [this] (uint32_t i) -> const void*
-    {
-        switch ( m_header.memoryComponentType() )
-        {
-        case ComponentType::Int8:    return static_cast<const void*>( m_data_int8.at(i).data() );
-        case ComponentType::UInt8:   return static_cast<const void*>( m_data_uint8.at(i).data() );
-        case ComponentType::Int16:   return static_cast<const void*>( m_data_int16.at(i).data() );
-        case ComponentType::UInt16:  return static_cast<const void*>( m_data_uint16.at(i).data() );
-        case ComponentType::Int32:   return static_cast<const void*>( m_data_int32.at(i).data() );
-        case ComponentType::UInt32:  return static_cast<const void*>( m_data_uint32.at(i).data() );
-        case ComponentType::Float32: return static_cast<const void*>( m_data_float32.at(i).data() );
-        default: return static_cast<const void*>( nullptr );
-        }
-    };
-
     switch ( m_bufferType )
     {
     case MultiComponentBufferType::SeparateImages:
@@ -776,7 +1868,7 @@ const void* Image::bufferAsVoid( uint32_t comp ) const
         {
             return nullptr;
         }
-        return F( comp );
+        return componentBuffer( comp );
     }
     case MultiComponentBufferType::InterleavedImage:
     {
@@ -784,7 +1876,7 @@ const void* Image::bufferAsVoid( uint32_t comp ) const
         {
             return nullptr;
         }
-        return F( 0 );
+        return componentBuffer( 0 );
     }
     }
 
@@ -794,42 +1886,231 @@ const void* Image::bufferAsVoid( uint32_t comp ) const
 
 void* Image::bufferAsVoid( uint32_t comp )
 {
-    auto F = [this] (uint32_t i) -> void*
+    if ( ! std::as_const( *this ).bufferAsVoid( comp ) )
     {
-        switch ( m_header.memoryComponentType() )
-        {
-        case ComponentType::Int8:    return static_cast<void*>( m_data_int8.at(i).data() );
-        case ComponentType::UInt8:   return static_cast<void*>( m_data_uint8.at(i).data() );
-        case ComponentType::Int16:   return static_cast<void*>( m_data_int16.at(i).data() );
-        case ComponentType::UInt16:  return static_cast<void*>( m_data_uint16.at(i).data() );
-        case ComponentType::Int32:   return static_cast<void*>( m_data_int32.at(i).data() );
-        case ComponentType::UInt32:  return static_cast<void*>( m_data_uint32.at(i).data() );
-        case ComponentType::Float32: return static_cast<void*>( m_data_float32.at(i).data() );
-        default: return static_cast<void*>( nullptr );
-        }
-    };
+        return nullptr;
+    }
 
-    switch ( m_bufferType )
+    // Interleaved components are all held in buffer 0
+    return componentBuffer( ( MultiComponentBufferType::SeparateImages == m_bufferType ) ? comp : 0 );
+}
+
+
+const void* Image::frameBufferAsVoid( uint32_t comp, uint32_t frame ) const
+{
+    const void* buffer = bufferAsVoid( comp );
+
+    if ( ! buffer || frame >= m_header.numFrames() )
     {
-    case MultiComponentBufferType::SeparateImages:
+        return nullptr;
+    }
+
+    return static_cast<const char*>( buffer ) +
+            frame * frameStride() * m_header.memoryComponentSizeInBytes();
+}
+
+
+size_t Image::frameSizeInBytes() const
+{
+    return frameStride() * m_header.memoryComponentSizeInBytes();
+}
+
+
+size_t Image::frameStride() const
+{
+    // Interleaved components are all held in one buffer
+    const size_t numBufferComps = ( MultiComponentBufferType::InterleavedImage == m_bufferType )
+            ? std::max<size_t>( m_numComponentsLoaded, 1 ) : 1;
+
+    return m_header.numPixelsPerFrame() * numBufferComps;
+}
+
+
+bool Image::isBricked() const
+{
+    return m_brickedBuffer.has_value();
+}
+
+
+uint64_t Image::residentSizeInBytes() const
+{
+    return m_brickedBuffer ? m_brickedBuffer->value().residentSizeInBytes()
+                           : m_header.memoryImageSizeInBytes();
+}
+
+
+std::vector< std::pair<const void*, uint64_t> > Image::residentBuffers() const
+{
+    std::vector< std::pair<const void*, uint64_t> > buffers;
+
+    if ( ! hasVoxels() )
     {
-        if ( m_header.numComponentsPerPixel() <= comp )
-        {
-            return nullptr;
-        }
-        return F( comp );
+        return buffers;
     }
-    case MultiComponentBufferType::InterleavedImage:
+
+    if ( m_brickedBuffer )
     {
-        if ( 1 <= comp )
+        buffers.emplace_back( &m_brickedBuffer->value(), m_brickedBuffer->value().residentSizeInBytes() );
+        return buffers;
+    }
+
+    // A mapped file or an interleaved buffer holds all components; otherwise, each component has a buffer
+    const size_t numBuffers = ( m_mappedBuffer || MultiComponentBufferType::InterleavedImage == m_bufferType )
+            ? 1 : m_numComponentsLoaded;
+
+    const uint64_t bufferSize = m_header.memoryImageSizeInBytes() / numBuffers;
+
+    for ( size_t i = 0; i < numBuffers; ++i )
+    {
+        if ( const void* buffer = componentBuffer( i ) )
         {
-            return nullptr;
+            buffers.emplace_back( buffer, bufferSize );
         }
-        return F( 0 );
     }
+
+    return buffers;
+}
+
+
+bool Image::hasVoxels() const
+{
+    return ( m_numComponentsLoaded > 0 );
+}
+
+
+bool Image::canReleaseVoxels() const
+{
+    return ( ImageRepresentation::Image == m_imageRep &&
+             m_voxelsFromFile && hasVoxels() && ! m_brickedBuffer &&
+             ! m_settings.hasProvisionalStatistics() );
+}
+
+
+bool Image::releaseVoxels()
+{
+    if ( ! canReleaseVoxels() )
+    {
+        return false;
+    }
+
+    // Buffers that are shared with copies of this image stay alive in the copies
+    m_data_int8.clear();
+    m_data_uint8.clear();
+    m_data_int16.clear();
+    m_data_uint16.clear();
+    m_data_int32.clear();
+    m_data_uint32.clear();
+    m_data_float32.clear();
+    m_mappedBuffer = std::nullopt;
+
+    m_numComponentsLoaded = 0;
+    return true;
+}
+
+
+bool Image::restoreVoxels( Image&& loaded )
+{
+    if ( hasVoxels() )
+    {
+        spdlog::warn( "Voxels of image {} are already held in memory", m_header.fileName() );
+        return false;
+    }
+
+    const auto& quantization = m_header.quantization();
+    const auto& loadedQuantization = loaded.header().quantization();
+
+    // Quantization is deterministic, so reloaded values match the statistics of this image iff
+    // they are quantized identically
+    const bool quantizationMatches =
+            ( quantization.has_value() == loadedQuantization.has_value() ) &&
+            ( ! quantization ||
+              ( glm::epsilonEqual( quantization->m_slope, loadedQuantization->m_slope, glm::epsilon<double>() ) &&
+                glm::epsilonEqual( quantization->m_intercept, loadedQuantization->m_intercept, glm::epsilon<double>() ) ) );
+
+    if ( ! loaded.hasVoxels() || loaded.isBricked() ||
+         loaded.m_bufferType != m_bufferType ||
+         loaded.header().pixelDimensions() != m_header.pixelDimensions() ||
+         loaded.header().numFrames() != m_header.numFrames() ||
+         loaded.header().memoryComponentType() != m_header.memoryComponentType() ||
+         loaded.header().numComponentsPerPixel() != m_header.numComponentsPerPixel() ||
+         ! quantizationMatches )
+    {
+        spdlog::error( "Voxels loaded from file {} do not match image header", m_header.fileName() );
+        return false;
     }
 
-    return nullptr;
+    m_data_int8 = std::move( loaded.m_data_int8 );
+    m_data_uint8 = std::move( loaded.m_data_uint8 );
+    m_data_int16 = std::move( loaded.m_data_int16 );
+    m_data_uint16 = std::move( loaded.m_data_uint16 );
+    m_data_int32 = std::move( loaded.m_data_int32 );
+    m_data_uint32 = std::move( loaded.m_data_uint32 );
+    m_data_float32 = std::move( loaded.m_data_float32 );
+    m_mappedBuffer = std::move( loaded.m_mappedBuffer );
+
+    m_numComponentsLoaded = loaded.m_numComponentsLoaded;
+    loaded.m_numComponentsLoaded = 0;
+    return true;
+}
+
+
+const void* Image::readBrickedVoxel( size_t comp, int i, int j, int k, void* voxel ) const
+{
+    if ( ! m_brickedBuffer || 0 != comp || i < 0 || j < 0 || k < 0 )
+    {
+        return nullptr;
+    }
+
+    const glm::uvec3 index{ static_cast<uint32_t>( i ), static_cast<uint32_t>( j ), static_cast<uint32_t>( k ) };
+
+    return m_brickedBuffer->value().readBlock( index, glm::uvec3{ 1 }, voxel ) ? voxel : nullptr;
+}
+
+
+const void* Image::componentBuffer( size_t i ) const
+{
+    if ( m_mappedBuffer )
+    {
+        // A memory-mapped file backs the single component buffer
+        return ( 0 == i ) ? m_mappedBuffer->value().data() : nullptr;
+    }
+
+    switch ( m_header.memoryComponentType() )
+    {
+    case ComponentType::Int8:    return ( i < m_data_int8.size() ) ? m_data_int8[i].value().data() : nullptr;
+    case ComponentType::UInt8:   return ( i < m_data_uint8.size() ) ? m_data_uint8[i].value().data() : nullptr;
+    case ComponentType::Int16:   return ( i < m_data_int16.size() ) ? m_data_int16[i].value().data() : nullptr;
+    case ComponentType::UInt16:  return ( i < m_data_uint16.size() ) ? m_data_uint16[i].value().data() : nullptr;
+    case ComponentType::Int32:   return ( i < m_data_int32.size() ) ? m_data_int32[i].value().data() : nullptr;
+    case ComponentType::UInt32:  return ( i < m_data_uint32.size() ) ? m_data_uint32[i].value().data() : nullptr;
+    case ComponentType::Float32: return ( i < m_data_float32.size() ) ? m_data_float32[i].value().data() : nullptr;
+    default: return nullptr;
+    }
+}
+
+
+void* Image::componentBuffer( size_t i )
+{
+    // Voxels that may be written to can no longer be read again from the file
+    m_voxelsFromFile = false;
+
+    // Write access detaches the buffer from copies of this image that share it
+    if ( m_mappedBuffer )
+    {
+        return ( 0 == i ) ? m_mappedBuffer->mutableValue().data() : nullptr;
+    }
+
+    switch ( m_header.memoryComponentType() )
+    {
+    case ComponentType::Int8:    return ( i < m_data_int8.size() ) ? m_data_int8[i].mutableValue().data() : nullptr;
+    case ComponentType::UInt8:   return ( i < m_data_uint8.size() ) ? m_data_uint8[i].mutableValue().data() : nullptr;
+    case ComponentType::Int16:   return ( i < m_data_int16.size() ) ? m_data_int16[i].mutableValue().data() : nullptr;
+    case ComponentType::UInt16:  return ( i < m_data_uint16.size() ) ? m_data_uint16[i].mutableValue().data() : nullptr;
+    case ComponentType::Int32:   return ( i < m_data_int32.size() ) ? m_data_int32[i].mutableValue().data() : nullptr;
+    case ComponentType::UInt32:  return ( i < m_data_uint32.size() ) ? m_data_uint32[i].mutableValue().data() : nullptr;
+    case ComponentType::Float32: return ( i < m_data_float32.size() ) ? m_data_float32[i].mutableValue().data() : nullptr;
+    default: return nullptr;
+    }
 }
 
 
@@ -885,35 +2166,57 @@ Image::getComponentAndOffsetForBuffer( uint32_t comp, int i, int j, int k ) cons
     return ret;
 }
 
-std::optional<double> Image::valueAsDouble( uint32_t comp, int i, int j, int k ) const
+std::optional<double> Image::valueAsDouble( uint32_t comp, int i, int j, int k, uint32_t frame ) const
 {
     const auto compAndOffset = getComponentAndOffsetForBuffer( comp, i, j, k );
-    if ( ! compAndOffset )
+    if ( ! compAndOffset || frame >= m_header.numFrames() )
     {
         // Invalid input
         return std::nullopt;
     }
 
-    const size_t c = compAndOffset->first;
-    const size_t offset = compAndOffset->second;
+    // A voxel of a bricked image is read from its brick into local storage
+    alignas( 8 ) std::array<uint8_t, 8> voxel{};
+
+    const void* buffer = m_brickedBuffer ? readBrickedVoxel( compAndOffset->first, i, j, k, voxel.data() )
+                                         : componentBuffer( compAndOffset->first );
+    if ( ! buffer )
+    {
+        return std::nullopt;
+    }
+
+    const size_t offset = m_brickedBuffer ? 0 : compAndOffset->second + frame * frameStride();
+
+    double value = 0.0;
 
     switch ( m_header.memoryComponentType() )
     {
-    case ComponentType::Int8:    return static_cast<double>( m_data_int8.at(c)[offset] );
-    case ComponentType::UInt8:   return static_cast<double>( m_data_uint8.at(c)[offset] );
-    case ComponentType::Int16:   return static_cast<double>( m_data_int16.at(c)[offset] );
-    case ComponentType::UInt16:  return static_cast<double>( m_data_uint16.at(c)[offset] );
-    case ComponentType::Int32:   return static_cast<double>( m_data_int32.at(c)[offset] );
-    case ComponentType::UInt32:  return static_cast<double>( m_data_uint32.at(c)[offset] );
-    case ComponentType::Float32: return static_cast<double>( m_data_float32.at(c)[offset] );
+    case ComponentType::Int8:    value = static_cast<double>( static_cast<const int8_t*>( buffer )[offset] ); break;
+    case ComponentType::UInt8:   value = static_cast<double>( static_cast<const uint8_t*>( buffer )[offset] ); break;
+    case ComponentType::Int16:   value = static_cast<double>( static_cast<const int16_t*>( buffer )[offset] ); break;
+    case ComponentType::UInt16:  value = static_cast<double>( static_cast<const uint16_t*>( buffer )[offset] ); break;
+    case ComponentType::Int32:   value = static_cast<double>( static_cast<const int32_t*>( buffer )[offset] ); break;
+    case ComponentType::UInt32:  value = static_cast<double>( static_cast<const uint32_t*>( buffer )[offset] ); break;
+    case ComponentType::Float32: value = static_cast<double>( static_cast<const float*>( buffer )[offset] ); break;
     default: return std::nullopt;
     }
 
-    return std::nullopt;
+    if ( const auto& quantization = m_header.quantization() )
+    {
+        value = quantization->m_slope * value + quantization->m_intercept;
+    }
+
+    return value;
 }
 
 std::optional<int64_t> Image::valueAsInt64( uint32_t comp, int i, int j, int k ) const
 {
+    if ( m_header.quantization() )
+    {
+        const std::optional<double> value = valueAsDouble( comp, i, j, k );
+        return value ? std::optional<int64_t>( static_cast<int64_t>( *value ) ) : std::nullopt;
+    }
+
     const auto compAndOffset = getComponentAndOffsetForBuffer( comp, i, j, k );
     if ( ! compAndOffset )
     {
@@ -921,18 +2224,27 @@ std::optional<int64_t> Image::valueAsInt64( uint32_t comp, int i, int j, int k )
         return std::nullopt;
     }
 
-    const size_t c = compAndOffset->first;
-    const size_t offset = compAndOffset->second;
+    // A voxel of a bricked image is read from its brick into local storage
+    alignas( 8 ) std::array<uint8_t, 8> voxel{};
+
+    const void* buffer = m_brickedBuffer ? readBrickedVoxel( compAndOffset->first, i, j, k, voxel.data() )
+                                         : componentBuffer( compAndOffset->first );
+    if ( ! buffer )
+    {
+        return std::nullopt;
+    }
+
+    const size_t offset = m_brickedBuffer ? 0 : compAndOffset->second;
 
     switch ( m_header.memoryComponentType() )
     {
-    case ComponentType::Int8:    return static_cast<int64_t>( m_data_int8.at(c)[offset] );
-    case ComponentType::UInt8:   return static_cast<int64_t>( m_data_uint8.at(c)[offset] );
-    case ComponentType::Int16:   return static_cast<int64_t>( m_data_int16.at(c)[offset] );
-    case ComponentType::UInt16:  return static_cast<int64_t>( m_data_uint16.at(c)[offset] );
-    case ComponentType::Int32:   return static_cast<int64_t>( m_data_int32.at(c)[offset] );
-    case ComponentType::UInt32:  return static_cast<int64_t>( m_data_uint32.at(c)[offset] );
-    case ComponentType::Float32: return static_cast<int64_t>( m_data_float32.at(c)[offset] );
+    case ComponentType::Int8:    return static_cast<int64_t>( static_cast<const int8_t*>( buffer )[offset] );
+    case ComponentType::UInt8:   return static_cast<int64_t>( static_cast<const uint8_t*>( buffer )[offset] );
+    case ComponentType::Int16:   return static_cast<int64_t>( static_cast<const int16_t*>( buffer )[offset] );
+    case ComponentType::UInt16:  return static_cast<int64_t>( static_cast<const uint16_t*>( buffer )[offset] );
+    case ComponentType::Int32:   return static_cast<int64_t>( static_cast<const int32_t*>( buffer )[offset] );
+    case ComponentType::UInt32:  return static_cast<int64_t>( static_cast<const uint32_t*>( buffer )[offset] );
+    case ComponentType::Float32: return static_cast<int64_t>( static_cast<const float*>( buffer )[offset] );
     default: return std::nullopt;
     }
 
@@ -942,6 +2254,11 @@ std::optional<int64_t> Image::valueAsInt64( uint32_t comp, int i, int j, int k )
 
 bool Image::setValue( uint32_t component, int i, int j, int k, int64_t value )
 {
+    if ( m_header.quantization() )
+    {
+        return setValue( component, i, j, k, static_cast<double>( value ) );
+    }
+
     const auto compAndOffset = getComponentAndOffsetForBuffer( component, i, j, k );
     if ( ! compAndOffset )
     {
@@ -949,26 +2266,47 @@ bool Image::setValue( uint32_t component, int i, int j, int k, int64_t value )
         return false;
     }
 
-    const size_t c = compAndOffset->first;
-    const size_t offset = compAndOffset->second;
+    // A voxel of a bricked image is set in local storage and then written to its brick
+    alignas( 8 ) std::array<uint8_t, 8> voxel{};
+
+    void* buffer = m_brickedBuffer ? ( 0 == compAndOffset->first ? voxel.data() : nullptr )
+                                   : componentBuffer( compAndOffset->first );
+    if ( ! buffer )
+    {
+        return false;
+    }
+
+    const size_t offset = m_brickedBuffer ? 0 : compAndOffset->second;
 
     switch ( m_header.memoryComponentType() )
     {
-    case ComponentType::Int8: m_data_int8.at(c)[offset] = static_cast<int8_t>( value ); return true;
-    case ComponentType::UInt8: m_data_uint8.at(c)[offset] = static_cast<uint8_t>( value ); return true;
-    case ComponentType::Int16: m_data_int16.at(c)[offset] = static_cast<int16_t>( value ); return true;
-    case ComponentType::UInt16: m_data_uint16.at(c)[offset] = static_cast<uint16_t>( value ); return true;
-    case ComponentType::Int32: m_data_int32.at(c)[offset] = static_cast<int32_t>( value ); return true;
-    case ComponentType::UInt32: m_data_uint32.at(c)[offset] = static_cast<uint32_t>( value ); return true;
-    case ComponentType::Float32: m_data_float32.at(c)[offset] = static_cast<float>( value ); return true;
+    case ComponentType::Int8: static_cast<int8_t*>( buffer )[offset] = static_cast<int8_t>( value ); break;
+    case ComponentType::UInt8: static_cast<uint8_t*>( buffer )[offset] = static_cast<uint8_t>( value ); break;
+    case ComponentType::Int16: static_cast<int16_t*>( buffer )[offset] = static_cast<int16_t>( value ); break;
+    case ComponentType::UInt16: static_cast<uint16_t*>( buffer )[offset] = static_cast<uint16_t>( value ); break;
+    case ComponentType::Int32: static_cast<int32_t*>( buffer )[offset] = static_cast<int32_t>( value ); break;
+    case ComponentType::UInt32: static_cast<uint32_t*>( buffer )[offset] = static_cast<uint32_t>( value ); break;
+    case ComponentType::Float32: static_cast<float*>( buffer )[offset] = static_cast<float>( value ); break;
     default: return false;
     }
 
-    return false;
+    if ( m_brickedBuffer )
+    {
+        return m_brickedBuffer->mutableValue().writeBlock(
+                    glm::uvec3( i, j, k ), glm::uvec3{ 1 }, buffer );
+    }
+
+    return true;
 }
 
 bool Image::setValue( uint32_t component, int i, int j, int k, double value )
 {
+    if ( const auto& quantization = m_header.quantization() )
+    {
+        value = std::clamp( std::round( ( value - quantization->m_intercept ) / quantization->m_slope ),
+                            0.0, static_cast<double>( std::numeric_limits<uint16_t>::max() ) );
+    }
+
     const auto compAndOffset = getComponentAndOffsetForBuffer( component, i, j, k );
     if ( ! compAndOffset )
     {
@@ -976,22 +2314,37 @@ bool Image::setValue( uint32_t component, int i, int j, int k, double value )
         return false;
     }
 
-    const size_t c = compAndOffset->first;
-    const size_t offset = compAndOffset->second;
+    // A voxel of a bricked image is set in local storage and then written to its brick
+    alignas( 8 ) std::array<uint8_t, 8> voxel{};
+
+    void* buffer = m_brickedBuffer ? ( 0 == compAndOffset->first ? voxel.data() : nullptr )
+                                   : componentBuffer( compAndOffset->first );
+    if ( ! buffer )
+    {
+        return false;
+    }
+
+    const size_t offset = m_brickedBuffer ? 0 : compAndOffset->second;
 
     switch ( m_header.memoryComponentType() )
     {
-    case ComponentType::Int8: m_data_int8.at(c)[offset] = static_cast<int8_t>( value ); return true;
-    case ComponentType::UInt8: m_data_uint8.at(c)[offset] = static_cast<uint8_t>( value ); return true;
-    case ComponentType::Int16: m_data_int16.at(c)[offset] = static_cast<int16_t>( value ); return true;
-    case ComponentType::UInt16: m_data_uint16.at(c)[offset] = static_cast<uint16_t>( value ); return true;
-    case ComponentType::Int32: m_data_int32.at(c)[offset] = static_cast<int32_t>( value ); return true;
-    case ComponentType::UInt32: m_data_uint32.at(c)[offset] = static_cast<uint32_t>( value ); return true;
-    case ComponentType::Float32: m_data_float32.at(c)[offset] = static_cast<float>( value ); return true;
+    case ComponentType::Int8: static_cast<int8_t*>( buffer )[offset] = static_cast<int8_t>( value ); break;
+    case ComponentType::UInt8: static_cast<uint8_t*>( buffer )[offset] = static_cast<uint8_t>( value ); break;
+    case ComponentType::Int16: static_cast<int16_t*>( buffer )[offset] = static_cast<int16_t>( value ); break;
+    case ComponentType::UInt16: static_cast<uint16_t*>( buffer )[offset] = static_cast<uint16_t>( value ); break;
+    case ComponentType::Int32: static_cast<int32_t*>( buffer )[offset] = static_cast<int32_t>( value ); break;
+    case ComponentType::UInt32: static_cast<uint32_t*>( buffer )[offset] = static_cast<uint32_t>( value ); break;
+    case ComponentType::Float32: static_cast<float*>( buffer )[offset] = static_cast<float>( value ); break;
     default: return false;
     }
 
-    return false;
+    if ( m_brickedBuffer )
+    {
+        return m_brickedBuffer->mutableValue().writeBlock(
+                    glm::uvec3( i, j, k ), glm::uvec3{ 1 }, buffer );
+    }
+
+    return true;
 }
 
 
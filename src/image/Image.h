@@ -1,19 +1,42 @@
 #ifndef IMAGE_H
 #define IMAGE_H
 
+#include "common/CopyOnWrite.h"
+#include "common/LoadProgress.h"
+
+#include "image/BrickedBuffer.h"
 #include "image/ImageHeader.h"
+#include "image/ImageInfoCache.h"
 #include "image/ImageIoInfo.h"
 #include "image/ImageSettings.h"
 #include "image/ImageTransformations.h"
+#include "image/ImageView.tpp"
+#include "image/MappedFileBuffer.h"
 
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <ostream>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 
+class ThreadPool;
+struct DicomSeries;
+
+
 /**
  * @brief Encapsulates a 3D medical image with one or more components per pixel
+ *
+ * @note An image with a time axis (a 4D image) is held as a time series of 3D frames. The frames
+ * follow one another in each component buffer, so that each frame can be uploaded as a 3D texture
+ * on its own (see frameBufferAsVoid). Unless noted otherwise, voxel accessors address the first frame.
+ *
+ * @note The voxels of a scalar image that is too large to be held in memory are held in bricks
+ * in a cache file on disk, which are paged into memory on demand (see BrickedBuffer). Such bricked
+ * images have no contiguous buffers: their voxels are accessed by value or by block.
  */
 class Image
 {
@@ -33,6 +56,13 @@ public:
         InterleavedImage //!< Interleave all components in a single image
     };
 
+    /// How should Image hold the values of floating-point images in memory?
+    enum class FloatStorageType
+    {
+        Float32, //!< Hold 32-bit floating-point values
+        QuantizedUInt16 //!< Hold 16-bit unsigned integers scaled to the value range (scalar images only)
+    };
+
 
     /**
      * @brief Construct Image from file on disk
@@ -40,10 +70,19 @@ public:
      * @param[in] imageType Indicates whether this is an image or a segmentation
      * @param[in] bufferType Indicates whether multi-component images are leaded as
      * multiple buffers or as a single buffer with interleaved pixel components
+     * @param[in] floatStorage Indicates how the values of floating-point images are held in memory.
+     * Quantized values halve the memory used by the image and its textures, at the cost of precision.
+     * @param[in] progress If not null, then loading progress and stage times are reported to it,
+     * and loading throws if it is cancelled
+     * @param[in] statsPool If not null, then the statistics pass over the loaded voxels is split
+     * across the threads of this pool. It must not be the pool that runs the constructor.
      */
     Image( const std::string& fileName,
            ImageRepresentation imageRep,
-           MultiComponentBufferType bufferType );
+           MultiComponentBufferType bufferType,
+           FloatStorageType floatStorage = FloatStorageType::Float32,
+           const FileLoadProgress* progress = nullptr,
+           ThreadPool* statsPool = nullptr );
 
     Image( const ImageHeader& header,
            std::string displayName,
@@ -59,18 +98,45 @@ public:
     ~Image() = default;
 
 
-    /** @brief Save the image to disk. If the image is successfully saved and a
-     * new file name is provided, then the image file name is set to the new file name.
+    /** @brief Save the image to disk. Images with multiple components are saved as vector images.
+     * Files of single-file formats (NIfTI, NRRD, MetaImage) are replaced atomically, via a temporary
+     * file in the same directory, and compressed NIfTI files are compressed on multiple threads.
+     * The image file name is not changed. Bricked images are streamed to disk a slab of bricks at
+     * a time, so they can only be saved to these single-file formats.
+     *
+     * @note A snapshot of an image can be saved on a worker thread while the original is modified.
+     *
      * @param[in] newFileName Optional new file name at which to save the image
      * @return True iff the image was saved successfully
      */
-    bool saveToDisk( const std::optional<std::string>& newFileName );
+    bool saveToDisk( const std::optional<std::string>& newFileName ) const;
+
+    /** @brief Get a read-only copy of the image as it is now, which shares the voxel buffers of the
+     * image. A buffer of the image is copied when the image is first modified, except for bricks:
+     * only the bricks that are modified are copied into the snapshot, rather than the whole brick
+     * cache file of the image. The snapshot must not be modified.
+     */
+    Image snapshot() const;
+
+    /** @brief Create an image of the file of a loaded image without reading the file again. The new
+     * image shares the voxel buffers (copy-on-write) and statistics of the loaded image, but has its
+     * own header, settings, and transformations, as if the file had just been read.
+     *
+     * @param[in] image Loaded image
+     * @param[in] floatStorage How to hold floating-point values of the new image in memory
+     * @return The new image; std::nullopt if the voxels of the loaded image are not in memory,
+     * are not those of its file, or are held with a different float storage. The file must then be read.
+     */
+    static std::optional<Image> shareVoxelsOf( const Image& image, FloatStorageType floatStorage );
 
     const ImageRepresentation& imageRep() const;
     const MultiComponentBufferType& bufferType() const;
+    const FloatStorageType& floatStorage() const;
 
     /// @brief Get a const void pointer to the raw buffer data of an image component.
     ///
+    /// @note Bricked images have no contiguous buffer, so this returns null for them.
+    ///
     /// @note If MultiComponentBufferType::InterleavedImage, then the image has only one component (0)
     ///
     /// @note The component must be in the range [0, header().numComponentsPerPixel() - 1].
@@ -81,10 +147,22 @@ public:
     const void* bufferAsVoid( uint32_t component ) const;
 
     /// @brief Get a non-const void pointer to the raw buffer data of an image component.
+    ///
+    /// @note Voxel buffers are shared by copies of an image. If this buffer is shared, then this
+    /// image first gets its own copy of it, so that writing to the buffer does not affect the copies.
     void* bufferAsVoid( uint32_t component );
 
-    /// @brief Get the value of the buffer at image index (i, j, k) as a double type
-    std::optional<double> valueAsDouble( uint32_t component, int i, int j, int k ) const;
+    /// @brief Get a const void pointer to the raw buffer data of a time frame of an image component.
+    /// This is bufferAsVoid( component ) offset by the frame. Frame 0 is the only frame of a 3D image.
+    /// @return Pointer to frameSizeInBytes() bytes; null if the buffer or frame does not exist
+    const void* frameBufferAsVoid( uint32_t component, uint32_t frame ) const;
+
+    /// @brief Get the size in bytes of one time frame of a component buffer
+    size_t frameSizeInBytes() const;
+
+    /// @brief Get the value of the buffer at image index (i, j, k) of a time frame as a double type.
+    /// Values of quantized images are mapped to image values.
+    std::optional<double> valueAsDouble( uint32_t component, int i, int j, int k, uint32_t frame = 0 ) const;
 
     /// @brief Get the value of the buffer at image index (i, j, k) as a int64_t type
     std::optional<int64_t> valueAsInt64( uint32_t component, int i, int j, int k ) const;
@@ -92,9 +170,100 @@ public:
     /// @brief Set the value of the buffer at image index (i, j, k) as a int64_t type
     bool setValue( uint32_t component, int i, int j, int k, int64_t value );
 
-    /// @brief Set the value of the buffer at image index (i, j, k) as a double type
+    /// @brief Set the value of the buffer at image index (i, j, k) as a double type.
+    /// Values of quantized images are quantized before they are set.
     bool setValue( uint32_t component, int i, int j, int k, double value );
 
+    /**
+     * @brief Call a kernel with a typed view of an image component. The kernel is a generic
+     * callable that takes an ImageView<const T> for each component type T held in memory, so that
+     * it is instantiated once per type and runs over the voxels without per-voxel type switches.
+     *
+     * @note The view holds the values stored in memory. For a quantized image, these map to image
+     * values as value = slope * storedValue + intercept, using header().quantization().
+     *
+     * @param[in] component Image component
+     * @param[in] func Kernel called as func( const ImageView<const T>& view )
+     * @return True iff the component is valid and held in a contiguous buffer and the kernel was called.
+     * This is false for bricked images, which are visited with visitBlocks instead.
+     */
+    template< class Func >
+    bool visit( uint32_t component, Func&& func ) const;
+
+    /// @brief Call a kernel with a typed, writable view of an image component.
+    /// The kernel is called as func( const ImageView<T>& view ).
+    /// @note This detaches the component buffer from copies of the image that share it.
+    template< class Func >
+    bool visit( uint32_t component, Func&& func );
+
+    /**
+     * @brief Call a kernel with a typed view of a block of voxels of an image component.
+     * The kernel is called as func( const ImageView<const T>& view ), where voxel (i, j, k) of the
+     * view is voxel offset + (i, j, k) of the image. The voxels of a bricked image are copied out
+     * of the bricks that intersect the block.
+     *
+     * @param[in] component Image component
+     * @param[in] offset Voxel offset of the block
+     * @param[in] size Size of the block in voxels. The block must lie within the image.
+     * @param[in] func Kernel
+     * @return True iff the component and block are valid and the kernel was called
+     */
+    template< class Func >
+    bool visitBlock( uint32_t component, const glm::uvec3& offset, const glm::uvec3& size, Func&& func ) const;
+
+    /// @brief Call a kernel with a typed, writable view of a block of voxels of an image component.
+    /// The kernel is called as func( const ImageView<T>& view ). The voxels of a bricked image are
+    /// written back to its bricks after the kernel returns.
+    template< class Func >
+    bool visitBlock( uint32_t component, const glm::uvec3& offset, const glm::uvec3& size, Func&& func );
+
+    /**
+     * @brief Call a kernel with typed views of blocks of voxels that together cover an image component.
+     * The kernel is called as func( const ImageView<const T>& view, const glm::uvec3& offset ) for each
+     * block, where offset is the voxel offset of the block. An image that is held in memory is visited
+     * as a single block, whereas a bricked image is visited brick by brick.
+     *
+     * @return True iff the component is valid and the kernel was called for all blocks
+     */
+    template< class Func >
+    bool visitBlocks( uint32_t component, Func&& func ) const;
+
+    /// @brief Call a kernel with typed, writable views of blocks of voxels that together cover an
+    /// image component. The kernel is called as func( const ImageView<T>& view, const glm::uvec3& offset ).
+    template< class Func >
+    bool visitBlocks( uint32_t component, Func&& func );
+
+    /// @brief Are the voxels of this image held in bricks on disk rather than in memory?
+    bool isBricked() const;
+
+    /// @brief Get the size in bytes of the voxels of this image that are resident in memory.
+    /// This is less than header().memoryImageSizeInBytes() for bricked images.
+    uint64_t residentSizeInBytes() const;
+
+    /// @brief Get the buffers that hold the voxels of this image in memory, each with its size in bytes.
+    /// Images that share voxel buffers (such as copies of an image, see CopyOnWrite) return the same
+    /// buffer addresses, so that memory that is shared by images can be counted once.
+    std::vector< std::pair<const void*, uint64_t> > residentBuffers() const;
+
+    /// @brief Are the voxels of this image held in memory? They are not after releaseVoxels().
+    bool hasVoxels() const;
+
+    /// @brief Can the voxels of this image be released from memory and read again from its file?
+    /// This is true for images (not segmentations) with a file on disk whose voxels are held in
+    /// contiguous or memory-mapped buffers and whose statistics are exact, so that no worker thread
+    /// is reading the voxels.
+    bool canReleaseVoxels() const;
+
+    /// @brief Release the voxels of this image, keeping its header, transformations, and settings
+    /// (including statistics). Voxel accessors fail until the voxels are restored.
+    /// @return True iff the voxels were released
+    bool releaseVoxels();
+
+    /// @brief Restore the voxels of an image whose voxels were released, taking them from an image
+    /// that was loaded again from the same file with the same representation and storage types.
+    /// @return True iff the voxels of the loaded image match the header of this image and were taken
+    bool restoreVoxels( Image&& loaded );
+
     /// @brief Get the image header
     const ImageHeader& header() const;
     ImageHeader& header();
@@ -110,14 +279,108 @@ public:
     /// @brief Get the image meta data
     std::ostream& metaData( std::ostream& os ) const;
 
+    /// @brief Compute exact statistics of all loaded image components from the buffers in memory.
+    /// Large images are constructed with provisional statistics, which are estimated from a
+    /// subsample of their pixels, so that they can be displayed sooner. This function can be called
+    /// on a worker thread while the image buffers are not being modified, and its result is then
+    /// applied with settings().setExactStatistics().
+    /// @param[in] pool Pool across whose threads the pass over each component is split; if null,
+    /// then the pass runs on the calling thread
+    std::vector< ComponentStats<double> > computeStatistics( ThreadPool* pool = nullptr ) const;
+
+    /// @brief Save exact statistics of the loaded components to the on-disk cache of the image file,
+    /// so that they are not computed again the next time that the file is opened. Statistics are only
+    /// cached if the component values in memory are those of the file (i.e. not cast or quantized).
+    /// @return True iff the statistics were cached
+    bool saveStatisticsToCache( const std::vector< ComponentStats<double> >& componentStats ) const;
 
-private:
 
-    /// Load a buffer as an image component
-    void loadImageBuffer( const float* buffer, size_t numElements );
+private:
 
-    /// Load a buffer as a segmentation component
-    void loadSegBuffer( const float* buffer, size_t numElements );
+    /// Read the image file with native component type T and load all of its components.
+    /// Returns the statistics of each loaded component, which are taken from the cached
+    /// statistics of the file if these are provided for all loaded components.
+    template< typename T >
+    std::vector< ComponentStats<double> > loadFromFile(
+            const std::string& fileName,
+            const std::vector< ComponentStats<double> >* cachedStats,
+            const FileLoadProgress* progress,
+            ThreadPool* statsPool );
+
+    /// Load the voxels of a scalar image file with native component type T into bricks, of which
+    /// at most maxResidentSize bytes are held in memory. Returns the statistics of the image, which
+    /// are taken from the cached statistics if provided and are otherwise estimated from a sample.
+    template< typename T >
+    std::vector< ComponentStats<double> > loadBricksFromFile(
+            const std::string& fileName, size_t maxResidentSize,
+            const std::vector< ComponentStats<double> >* cachedStats,
+            const FileLoadProgress* progress );
+
+    /// Read the voxels of a scalar image file with native component type T in slabs of slices,
+    /// cast them to the in-memory component type U, and write them into the bricks.
+    /// Returns the statistics of the image as estimated from a sample of its voxels.
+    template< typename T, typename U >
+    ComponentStats<double> readFileIntoBricks( const std::string& fileName, size_t maxResidentSize,
+                                               const FileLoadProgress* progress );
+
+    /// Compute exact statistics of all loaded components with in-memory component type T.
+    /// The statistics of bricked images are estimated from a sample of their voxels.
+    template< typename T >
+    std::vector< ComponentStats<double> > computeComponentStatistics( ThreadPool* pool ) const;
+
+    /// Get the size in bytes of a component of a scalar image file once it is held in memory
+    uint32_t scalarMemoryComponentSize() const;
+
+    /// Are floating-point values of this image quantized in memory?
+    bool quantizesFloatValues() const;
+
+    /// Are the statistics of this image estimated when it is loaded from file and computed
+    /// exactly later on?
+    bool defersStatistics() const;
+
+    /// Memory map the voxels of a scalar image file with native component type T, if their layout
+    /// on disk matches their layout in memory. Segmentations are never mapped. Returns true iff the file was mapped.
+    template< typename T >
+    bool mapFile( const std::string& fileName );
+
+    /// Load the first numCompsToLoad components of a buffer of native component type T that has
+    /// numComps interleaved components per pixel as image components. The components are written
+    /// directly into either separate or interleaved component buffers, depending on m_bufferType.
+    template< typename T >
+    void loadImageBuffer( const T* buffer, size_t numPixels,
+                          size_t numComps = 1, size_t numCompsToLoad = 1 );
+
+    /// Load the first numCompsToLoad components of a buffer of native component type T that has
+    /// numComps interleaved components per pixel as segmentation components
+    template< typename T >
+    void loadSegBuffer( const T* buffer, size_t numPixels,
+                        size_t numComps = 1, size_t numCompsToLoad = 1 );
+
+    /// Number of buffer elements from a voxel of one time frame to the same voxel of the next frame
+    size_t frameStride() const;
+
+    /// Get a pointer to the i'th component buffer, which is either held in memory or memory-mapped.
+    /// The non-const overload first gives this image its own copy of the buffer if it is shared.
+    const void* componentBuffer( size_t i ) const;
+    void* componentBuffer( size_t i );
+
+    /// Call func( T{} ) with a value of the type T of a component type that is held in memory.
+    /// Returns false if components of this type are not held in memory.
+    template< class Func >
+    static bool visitComponentType( const ComponentType& componentType, Func&& func );
+
+    /// Implementation of visitBlock for const and non-const images
+    template< class ImageType, class Func >
+    static bool visitBlockImpl( ImageType& image, uint32_t component,
+                                const glm::uvec3& offset, const glm::uvec3& size, Func&& func );
+
+    /// Implementation of visitBlocks for const and non-const images
+    template< class ImageType, class Func >
+    static bool visitBlocksImpl( ImageType& image, uint32_t component, Func&& func );
+
+    /// Read voxel (i, j, k) of component comp of a bricked image into storage of at least 8 bytes.
+    /// Returns the storage; null if the voxel is not in the image.
+    const void* readBrickedVoxel( size_t comp, int i, int j, int k, void* voxel ) const;
 
     /// For a given image component and indices, return a pair consisting of:
     /// 1) component buffer to index
@@ -134,23 +397,278 @@ private:
      * where c is the desired component.
     */
 
-    std::vector< std::vector<int8_t> > m_data_int8;
-    std::vector< std::vector<uint8_t> > m_data_uint8;
-    std::vector< std::vector<int16_t> > m_data_int16;
-    std::vector< std::vector<uint16_t> > m_data_uint16;
-    std::vector< std::vector<int32_t> > m_data_int32;
-    std::vector< std::vector<uint32_t> > m_data_uint32;
-    std::vector< std::vector<float> > m_data_float32;
+    /// Component buffers are reference-counted and copy-on-write: copies of an image share their
+    /// voxels until one of the copies is written to through a non-const buffer accessor.
+    std::vector< CopyOnWrite< std::vector<int8_t> > > m_data_int8;
+    std::vector< CopyOnWrite< std::vector<uint8_t> > > m_data_uint8;
+    std::vector< CopyOnWrite< std::vector<int16_t> > > m_data_int16;
+    std::vector< CopyOnWrite< std::vector<uint16_t> > > m_data_uint16;
+    std::vector< CopyOnWrite< std::vector<int32_t> > > m_data_int32;
+    std::vector< CopyOnWrite< std::vector<uint32_t> > > m_data_uint32;
+    std::vector< CopyOnWrite< std::vector<float> > > m_data_float32;
+
+    /// Memory-mapped file that backs the buffer of a scalar image in place of the buffers above.
+    /// It is also shared by copies of the image until one of them is written to.
+    std::optional< CopyOnWrite<MappedFileBuffer> > m_mappedBuffer;
+
+    /// Bricks on disk that hold the voxels of a scalar image that is too large to be held in memory,
+    /// in place of the buffers above. They are also shared by copies of the image until one of them
+    /// is written to.
+    std::optional< CopyOnWrite<BrickedBuffer> > m_brickedBuffer;
 
     ImageRepresentation m_imageRep; //!< Is this an image or a segmentation?
     MultiComponentBufferType m_bufferType; //!< How to represent multi-component images?
+    FloatStorageType m_floatStorage; //!< How to hold floating-point values in memory?
 
     ImageIoInfo m_ioInfoOnDisk; //!< Info about image as stored on disk
     ImageIoInfo m_ioInfoInMemory; //!< Info about image as loaded into memory
 
+    size_t m_numComponentsLoaded; //!< Number of pixel components loaded into memory
+
+    /// Are the voxels in memory those read from the image file? They are not for images that were
+    /// constructed from a header or that have been written to.
+    bool m_voxelsFromFile;
+
+    /// Key of the image file in the on-disk cache of file information and statistics
+    std::optional<cache::ImageFileKey> m_cacheKey;
+
+    /// DICOM series that the image file holds, which is found once when the file is loaded and
+    /// then read from; null if the file is not a DICOM series
+    std::shared_ptr<const DicomSeries> m_dicomSeries;
+
     ImageHeader m_header;
     ImageTransformations m_tx;
     ImageSettings m_settings;
 };
 
+
+template< class Func >
+bool Image::visit( uint32_t component, Func&& func ) const
+{
+    // Interleaved components are all held in buffer 0, offset by the component index
+    const bool interleaved = ( MultiComponentBufferType::InterleavedImage == m_bufferType );
+
+    if ( component >= m_numComponentsLoaded )
+    {
+        return false;
+    }
+
+    const void* buffer = componentBuffer( interleaved ? 0 : component );
+
+    if ( ! buffer )
+    {
+        return false;
+    }
+
+    const size_t offset = interleaved ? component : 0;
+    const size_t stride = interleaved ? m_numComponentsLoaded : 1;
+    const glm::uvec3 dims = m_header.pixelDimensions();
+
+    switch ( m_header.memoryComponentType() )
+    {
+    case ComponentType::Int8:    func( ImageView<const int8_t>( static_cast<const int8_t*>( buffer ) + offset, dims, stride ) ); return true;
+    case ComponentType::UInt8:   func( ImageView<const uint8_t>( static_cast<const uint8_t*>( buffer ) + offset, dims, stride ) ); return true;
+    case ComponentType::Int16:   func( ImageView<const int16_t>( static_cast<const int16_t*>( buffer ) + offset, dims, stride ) ); return true;
+    case ComponentType::UInt16:  func( ImageView<const uint16_t>( static_cast<const uint16_t*>( buffer ) + offset, dims, stride ) ); return true;
+    case ComponentType::Int32:   func( ImageView<const int32_t>( static_cast<const int32_t*>( buffer ) + offset, dims, stride ) ); return true;
+    case ComponentType::UInt32:  func( ImageView<const uint32_t>( static_cast<const uint32_t*>( buffer ) + offset, dims, stride ) ); return true;
+    case ComponentType::Float32: func( ImageView<const float>( static_cast<const float*>( buffer ) + offset, dims, stride ) ); return true;
+    default: return false;
+    }
+}
+
+
+template< class Func >
+bool Image::visit( uint32_t component, Func&& func )
+{
+    const bool interleaved = ( MultiComponentBufferType::InterleavedImage == m_bufferType );
+
+    if ( component >= m_numComponentsLoaded )
+    {
+        return false;
+    }
+
+    void* buffer = componentBuffer( interleaved ? 0 : component );
+
+    if ( ! buffer )
+    {
+        return false;
+    }
+
+    const size_t offset = interleaved ? component : 0;
+    const size_t stride = interleaved ? m_numComponentsLoaded : 1;
+    const glm::uvec3 dims = m_header.pixelDimensions();
+
+    switch ( m_header.memoryComponentType() )
+    {
+    case ComponentType::Int8:    func( ImageView<int8_t>( static_cast<int8_t*>( buffer ) + offset, dims, stride ) ); return true;
+    case ComponentType::UInt8:   func( ImageView<uint8_t>( static_cast<uint8_t*>( buffer ) + offset, dims, stride ) ); return true;
+    case ComponentType::Int16:   func( ImageView<int16_t>( static_cast<int16_t*>( buffer ) + offset, dims, stride ) ); return true;
+    case ComponentType::UInt16:  func( ImageView<uint16_t>( static_cast<uint16_t*>( buffer ) + offset, dims, stride ) ); return true;
+    case ComponentType::Int32:   func( ImageView<int32_t>( static_cast<int32_t*>( buffer ) + offset, dims, stride ) ); return true;
+    case ComponentType::UInt32:  func( ImageView<uint32_t>( static_cast<uint32_t*>( buffer ) + offset, dims, stride ) ); return true;
+    case ComponentType::Float32: func( ImageView<float>( static_cast<float*>( buffer ) + offset, dims, stride ) ); return true;
+    default: return false;
+    }
+}
+
+template< class Func >
+bool Image::visitBlock( uint32_t component, const glm::uvec3& offset, const glm::uvec3& size, Func&& func ) const
+{
+    return visitBlockImpl( *this, component, offset, size, std::forward<Func>( func ) );
+}
+
+
+template< class Func >
+bool Image::visitBlock( uint32_t component, const glm::uvec3& offset, const glm::uvec3& size, Func&& func )
+{
+    return visitBlockImpl( *this, component, offset, size, std::forward<Func>( func ) );
+}
+
+
+template< class Func >
+bool Image::visitBlocks( uint32_t component, Func&& func ) const
+{
+    return visitBlocksImpl( *this, component, std::forward<Func>( func ) );
+}
+
+
+template< class Func >
+bool Image::visitBlocks( uint32_t component, Func&& func )
+{
+    return visitBlocksImpl( *this, component, std::forward<Func>( func ) );
+}
+
+
+template< class Func >
+bool Image::visitComponentType( const ComponentType& componentType, Func&& func )
+{
+    switch ( componentType )
+    {
+    case ComponentType::Int8:    func( int8_t{} ); return true;
+    case ComponentType::UInt8:   func( uint8_t{} ); return true;
+    case ComponentType::Int16:   func( int16_t{} ); return true;
+    case ComponentType::UInt16:  func( uint16_t{} ); return true;
+    case ComponentType::Int32:   func( int32_t{} ); return true;
+    case ComponentType::UInt32:  func( uint32_t{} ); return true;
+    case ComponentType::Float32: func( float{} ); return true;
+    default: return false;
+    }
+}
+
+
+template< class ImageType, class Func >
+bool Image::visitBlockImpl( ImageType& image, uint32_t component,
+                            const glm::uvec3& offset, const glm::uvec3& size, Func&& func )
+{
+    static constexpr bool sk_isConst = std::is_const_v<ImageType>;
+
+    const glm::uvec3 dims = image.m_header.pixelDimensions();
+
+    if ( component >= image.m_numComponentsLoaded ||
+         static_cast<uint64_t>( offset.x ) + size.x > dims.x ||
+         static_cast<uint64_t>( offset.y ) + size.y > dims.y ||
+         static_cast<uint64_t>( offset.z ) + size.z > dims.z )
+    {
+        return false;
+    }
+
+    if ( image.m_brickedBuffer )
+    {
+        // Copy the block out of the bricks into a dense buffer
+        bool visited = false;
+
+        visitComponentType( image.m_header.memoryComponentType(), [&] ( auto zero )
+        {
+            using T = decltype( zero );
+
+            std::vector<T> block( static_cast<size_t>( size.x ) * size.y * size.z );
+
+            if ( ! image.m_brickedBuffer->value().readBlock( offset, size, block.data() ) )
+            {
+                return;
+            }
+
+            if constexpr ( sk_isConst )
+            {
+                func( ImageView<const T>( block.data(), size ) );
+                visited = true;
+            }
+            else
+            {
+                func( ImageView<T>( block.data(), size ) );
+                visited = image.m_brickedBuffer->mutableValue().writeBlock( offset, size, block.data() );
+            }
+        } );
+
+        return visited;
+    }
+
+    // Interleaved components are all held in buffer 0, offset by the component index
+    const bool interleaved = ( MultiComponentBufferType::InterleavedImage == image.m_bufferType );
+
+    auto* buffer = image.componentBuffer( interleaved ? 0 : component );
+
+    if ( ! buffer )
+    {
+        return false;
+    }
+
+    const size_t pixelStride = interleaved ? image.m_numComponentsLoaded : 1;
+    const size_t rowStride = pixelStride * dims.x;
+    const size_t sliceStride = rowStride * dims.y;
+
+    const size_t first = ( interleaved ? component : 0 ) +
+            pixelStride * offset.x + rowStride * offset.y + sliceStride * offset.z;
+
+    return visitComponentType( image.m_header.memoryComponentType(), [&] ( auto zero )
+    {
+        using T = std::conditional_t< sk_isConst, const decltype( zero ), decltype( zero ) >;
+
+        func( ImageView<T>( static_cast<T*>( buffer ) + first, size, pixelStride, rowStride, sliceStride ) );
+    } );
+}
+
+
+template< class ImageType, class Func >
+bool Image::visitBlocksImpl( ImageType& image, uint32_t component, Func&& func )
+{
+    const glm::uvec3 dims = image.m_header.pixelDimensions();
+
+    if ( ! image.m_brickedBuffer )
+    {
+        return visitBlockImpl( image, component, glm::uvec3{ 0 }, dims, [&func] ( const auto& view )
+        {
+            func( view, glm::uvec3{ 0 } );
+        } );
+    }
+
+    // Visit the bricks in the order in which they are laid out in the cache file
+    static constexpr uint32_t sk_brickSize = BrickedBuffer::sk_brickSize;
+
+    for ( uint32_t k = 0; k < dims.z; k += sk_brickSize )
+    {
+        for ( uint32_t j = 0; j < dims.y; j += sk_brickSize )
+        {
+            for ( uint32_t i = 0; i < dims.x; i += sk_brickSize )
+            {
+                const glm::uvec3 offset{ i, j, k };
+                const glm::uvec3 size = glm::min( dims - offset, glm::uvec3{ sk_brickSize } );
+
+                const bool visited = visitBlockImpl( image, component, offset, size, [&func, &offset] ( const auto& view )
+                {
+                    func( view, offset );
+                } );
+
+                if ( ! visited )
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
 #endif // IMAGE_H
@@ -11,6 +11,8 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+
 
 ImageHeader::ImageHeader( const ImageIoInfo& ioInfoOnDisk, const ImageIoInfo& ioInfoInMemory )
     :
@@ -18,6 +20,8 @@ ImageHeader::ImageHeader( const ImageIoInfo& ioInfoOnDisk, const ImageIoInfo& io
       m_fileName( ioInfoOnDisk.m_fileInfo.m_fileName ),
       m_numComponentsPerPixel( ioInfoOnDisk.m_pixelInfo.m_numComponents ),
       m_numPixels( ioInfoOnDisk.m_sizeInfo.m_imageSizeInPixels ),
+      m_numFrames( 1 ),
+      m_frameSpacing( 1.0f ),
 
       m_fileImageSizeInBytes( ioInfoOnDisk.m_sizeInfo.m_imageSizeInBytes ),
       m_memoryImageSizeInBytes( ioInfoInMemory.m_sizeInfo.m_imageSizeInBytes ),
@@ -31,7 +35,9 @@ ImageHeader::ImageHeader( const ImageIoInfo& ioInfoOnDisk, const ImageIoInfo& io
 
       m_memoryComponentType( fromItkComponentType( ioInfoInMemory.m_componentInfo.m_componentType ) ),
       m_memoryComponentTypeAsString( ioInfoInMemory.m_componentInfo.m_componentTypeString ),
-      m_memoryComponentSizeInBytes( ioInfoInMemory.m_componentInfo.m_componentSizeInBytes )
+      m_memoryComponentSizeInBytes( ioInfoInMemory.m_componentInfo.m_componentSizeInBytes ),
+
+      m_quantization( std::nullopt )
 {
     if ( ComponentType::Undefined == m_memoryComponentType )
     {
@@ -53,12 +59,34 @@ ImageHeader::ImageHeader( const ImageIoInfo& ioInfoOnDisk, const ImageIoInfo& io
 
 void ImageHeader::setSpace( const ImageIoInfo& ioInfo )
 {
-    const uint32_t numDim = ioInfo.m_spaceInfo.m_numDimensions;
+    uint32_t numDim = ioInfo.m_spaceInfo.m_numDimensions;
     std::vector<size_t> dims = ioInfo.m_spaceInfo.m_dimensions;
     std::vector<double> orig = ioInfo.m_spaceInfo.m_origin;
     std::vector<double> space = ioInfo.m_spaceInfo.m_spacing;
     std::vector< std::vector<double> > dirs = ioInfo.m_spaceInfo.m_directions;
 
+    m_numFrames = 1;
+    m_frameSpacing = 1.0f;
+
+    if ( numDim == 4 && orig.size() == 4 && space.size() == 4 && dims.size() == 4 && dirs.size() == 4 )
+    {
+        // The image is a time series of 3D frames: the fourth axis is time
+        m_numFrames = static_cast<uint32_t>( std::max<size_t>( dims[3], 1 ) );
+        m_frameSpacing = static_cast<float>( space[3] );
+
+        orig.resize( 3 );
+        space.resize( 3 );
+        dims.resize( 3 );
+        dirs.resize( 3 );
+
+        for ( auto& dir : dirs )
+        {
+            dir.resize( 3 );
+        }
+
+        numDim = 3;
+    }
+
     // Expect a 3D image
     if ( numDim != 3 || orig.size() != 3 || space.size() != 3 || dims.size() != 3 || dirs.size() != 3 )
     {
@@ -85,7 +113,7 @@ void ImageHeader::setSpace( const ImageIoInfo& ioInfo )
         }
         else
         {
-            throw_debug( "Image must have dimension of 2 or 3" )
+            throw_debug( "Image must have dimension of 2, 3, or 4" )
         }
     }
 
@@ -140,6 +168,13 @@ void ImageHeader::adjustToScalarUCharFormat()
     m_memoryComponentTypeAsString = "uchar";
     m_memoryComponentSizeInBytes = 1;
 
+    m_quantization = std::nullopt;
+
+    // Segmentations of time series are 3D, like a single frame
+    m_numPixels = numPixelsPerFrame();
+    m_numFrames = 1;
+    m_frameSpacing = 1.0f;
+
     m_fileImageSizeInBytes = m_fileComponentSizeInBytes * m_numComponentsPerPixel * m_numPixels;
     m_memoryImageSizeInBytes = m_memoryComponentSizeInBytes * m_numComponentsPerPixel * m_numPixels;
 }
@@ -153,6 +188,10 @@ void ImageHeader::setFileName( std::string fileName ) { m_fileName = std::move(
 
 uint32_t ImageHeader::numComponentsPerPixel() const { return m_numComponentsPerPixel; }
 uint64_t ImageHeader::numPixels() const { return m_numPixels; }
+uint64_t ImageHeader::numPixelsPerFrame() const { return m_numPixels / m_numFrames; }
+
+uint32_t ImageHeader::numFrames() const { return m_numFrames; }
+float ImageHeader::frameSpacing() const { return m_frameSpacing; }
 
 uint64_t ImageHeader::fileImageSizeInBytes() const { return m_fileImageSizeInBytes; }
 uint64_t ImageHeader::memoryImageSizeInBytes() const { return m_memoryImageSizeInBytes; }
@@ -168,6 +207,9 @@ ComponentType ImageHeader::memoryComponentType() const { return m_memoryComponen
 std::string ImageHeader::memoryComponentTypeAsString() const { return m_memoryComponentTypeAsString; }
 uint32_t ImageHeader::memoryComponentSizeInBytes() const { return m_memoryComponentSizeInBytes; }
 
+const std::optional<ValueQuantization>& ImageHeader::quantization() const { return m_quantization; }
+void ImageHeader::setQuantization( std::optional<ValueQuantization> quantization ) { m_quantization = std::move( quantization ); }
+
 const glm::uvec3& ImageHeader::pixelDimensions() const { return m_pixelDimensions; }
 const glm::vec3& ImageHeader::origin() const { return m_origin; }
 const glm::vec3& ImageHeader::spacing() const { return m_spacing; }
@@ -194,13 +236,23 @@ std::ostream& operator<< ( std::ostream& os, const ImageHeader& header )
        << "\nComponent size (bytes, disk): "   << header.m_fileComponentSizeInBytes
 
        << "\nComponent type (memory): "        << header.m_memoryComponentTypeAsString
-       << "\nComponent size (bytes, memory): " << header.m_memoryComponentSizeInBytes
+       << "\nComponent size (bytes, memory): " << header.m_memoryComponentSizeInBytes;
+
+    if ( header.m_quantization )
+    {
+        os << "\nQuantization slope: "          << header.m_quantization->m_slope
+           << "\nQuantization intercept: "      << header.m_quantization->m_intercept
+           << "\nQuantization error (max): "    << header.m_quantization->m_maxError
+           << "\nQuantization error (RMS): "    << header.m_quantization->m_rmsError;
+    }
 
-       << "\n\nImage size (pixels): "          << header.m_numPixels
+    os << "\n\nImage size (pixels): "          << header.m_numPixels
        << "\nImage size (bytes, disk): "       << header.m_fileImageSizeInBytes
        << "\nImage size (bytes, memory): "     << header.m_memoryImageSizeInBytes
 
        << "\n\nDimensions (pixels): "          << glm::to_string( header.m_pixelDimensions )
+       << "\nTime frames: "                    << header.m_numFrames
+       << "\nTime frame spacing: "             << header.m_frameSpacing
        << "\nOrigin (mm): "                    << glm::to_string( header.m_origin )
        << "\nSpacing (mm): "                   << glm::to_string( header.m_spacing )
        << "\nDirections: "                     << glm::to_string( header.m_directions )
@@ -8,6 +8,7 @@
 #include <glm/vec3.hpp>
 
 #include <array>
+#include <optional>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -41,7 +42,13 @@ public:
     void setFileName( std::string fileName );
 
     uint32_t numComponentsPerPixel() const; //!< Number of components per pixel
-    uint64_t numPixels() const; //!< Number of pixels in the image
+    uint64_t numPixels() const; //!< Number of pixels in the image, over all time frames
+    uint64_t numPixelsPerFrame() const; //!< Number of pixels in one 3D time frame of the image
+
+    /// Number of time frames of an image with a time axis (its fourth dimension); 1 for a 3D image.
+    /// The frames of a time series are held one after the other in each component buffer.
+    uint32_t numFrames() const;
+    float frameSpacing() const; //!< Spacing of time frames, in the time units of the file
 
     uint64_t fileImageSizeInBytes() const; //!< Image size in bytes (in file)
     uint64_t memoryImageSizeInBytes() const; //!< Image size in bytes (in memory)
@@ -57,6 +64,11 @@ public:
     std::string memoryComponentTypeAsString() const;
     uint32_t memoryComponentSizeInBytes() const; //!< Size of component in bytes in memory
 
+    /// Quantization of floating-point values that are stored as integers in memory,
+    /// or std::nullopt if the values in memory are the native image values
+    const std::optional<ValueQuantization>& quantization() const;
+    void setQuantization( std::optional<ValueQuantization> quantization );
+
 
     const glm::uvec3& pixelDimensions() const; //!< Pixel dimensions (i.e. pixel matrix size)
     const glm::vec3& origin() const; //!< Origin in physical Subject space
@@ -100,7 +112,10 @@ private:
     std::string m_fileName; //!< File name
 
     uint32_t m_numComponentsPerPixel; //!< Number of components per pixel
-    uint64_t m_numPixels; //!< Number of pixels in the image
+    uint64_t m_numPixels; //!< Number of pixels in the image, over all time frames
+
+    uint32_t m_numFrames; //!< Number of time frames
+    float m_frameSpacing; //!< Spacing of time frames
 
     uint64_t m_fileImageSizeInBytes; //!< Image size in bytes (in file on disk)
     uint64_t m_memoryImageSizeInBytes; //!< Image size in bytes (in memory)
@@ -116,6 +131,9 @@ private:
     std::string m_memoryComponentTypeAsString;
     uint32_t m_memoryComponentSizeInBytes; //!< Size of component in bytes, as loaded in memory buffer
 
+    /// Quantization of floating-point values stored as integers in memory (if any)
+    std::optional<ValueQuantization> m_quantization;
+
     glm::uvec3 m_pixelDimensions; //!< Pixel dimensions (i.e. pixel matrix size)
     glm::vec3 m_origin; //!< Origin in physical Subject space
     glm::vec3 m_spacing; /// Pixel spacing in physical Subject space
@@ -0,0 +1,503 @@
+#include "image/ImageInfoCache.h"
+
+#include "common/UuidUtility.h"
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+// On Apple platforms, we must use the alternative ghc::filesystem,
+// because it is not fully implemented or supported prior to macOS 10.15.
+#if !defined(__APPLE__)
+#if defined(__cplusplus) && __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<filesystem>)
+#define GHC_USE_STD_FS
+#include <filesystem>
+namespace fs = std::filesystem;
+#endif
+#endif
+#endif
+
+#ifndef GHC_USE_STD_FS
+#include <ghc/filesystem.hpp>
+namespace fs = ghc::filesystem;
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <unordered_set>
+#include <variant>
+
+
+namespace
+{
+
+using json = nlohmann::json;
+
+/// Sub-directory of the local cache directory that holds the entries of image files
+static const std::string sk_imagesSubDirectory( "images" );
+
+/// Version of the cache entry format. Entries with other versions are ignored.
+static constexpr int sk_cacheVersion = 2;
+
+/// Size of each block of file contents that is hashed
+static constexpr size_t sk_hashBlockSize = 64 * 1024;
+
+static constexpr uint64_t sk_fnvOffsetBasis = 14695981039346656037ull;
+static constexpr uint64_t sk_fnvPrime = 1099511628211ull;
+
+
+/// Update a 64-bit FNV-1a hash with a block of bytes
+uint64_t hashBytes( uint64_t hash, const char* bytes, size_t numBytes )
+{
+    for ( size_t i = 0; i < numBytes; ++i )
+    {
+        hash ^= static_cast<uint8_t>( bytes[i] );
+        hash *= sk_fnvPrime;
+    }
+
+    return hash;
+}
+
+
+/// Hash the file size and the blocks at the start, middle, and end of a file
+std::optional<uint64_t> hashFileContents( const std::string& fileName, uint64_t sizeInBytes )
+{
+    std::ifstream file( fileName, std::ios::binary );
+
+    if ( ! file )
+    {
+        return std::nullopt;
+    }
+
+    uint64_t hash = hashBytes( sk_fnvOffsetBasis, reinterpret_cast<const char*>( &sizeInBytes ), sizeof( sizeInBytes ) );
+
+    const uint64_t blockSize = std::min<uint64_t>( sk_hashBlockSize, sizeInBytes );
+
+    const std::array<uint64_t, 3> blockOffsets{
+        0,
+        ( sizeInBytes - blockSize ) / 2,
+        sizeInBytes - blockSize
+    };
+
+    std::vector<char> block( blockSize );
+
+    for ( const uint64_t offset : blockOffsets )
+    {
+        file.seekg( static_cast<std::streamoff>( offset ) );
+        file.read( block.data(), static_cast<std::streamsize>( blockSize ) );
+
+        if ( ! file )
+        {
+            return std::nullopt;
+        }
+
+        hash = hashBytes( hash, block.data(), block.size() );
+    }
+
+    return hash;
+}
+
+
+/// Get the path of the cache entry for a file path
+std::optional<fs::path> entryPath( const std::string& path )
+{
+    const auto dir = cache::cacheDirectory( sk_imagesSubDirectory );
+
+    if ( ! dir )
+    {
+        return std::nullopt;
+    }
+
+    std::ostringstream name;
+    name << std::hex << std::setw( 16 ) << std::setfill( '0' )
+         << hashBytes( sk_fnvOffsetBasis, path.data(), path.size() ) << ".json";
+
+    return fs::path( *dir ) / name.str();
+}
+
+
+json toJson( const ImageIoInfo& info )
+{
+    const FileInfo& f = info.m_fileInfo;
+    const ComponentInfo& c = info.m_componentInfo;
+    const PixelInfo& p = info.m_pixelInfo;
+    const SizeInfo& s = info.m_sizeInfo;
+    const SpaceInfo& sp = info.m_spaceInfo;
+
+    json metaData = json::array();
+
+    for ( const auto& entry : info.m_metaData )
+    {
+        json value;
+        std::visit( [&value] ( const auto& v ) { value = v; }, entry.second );
+
+        metaData.push_back( { { "key", entry.first }, { "type", entry.second.index() }, { "value", value } } );
+    }
+
+    return json
+    {
+        { "file", {
+              { "fileName", f.m_fileName },
+              { "byteOrder", static_cast<int>( f.m_byteOrder ) },
+              { "byteOrderString", f.m_byteOrderString },
+              { "useCompression", f.m_useCompression },
+              { "fileType", static_cast<int>( f.m_fileType ) },
+              { "fileTypeString", f.m_fileTypeString },
+              { "supportedReadExtensions", f.m_supportedReadExtensions },
+              { "supportedWriteExtensions", f.m_supportedWriteExtensions } } },
+        { "component", {
+              { "componentType", static_cast<int>( c.m_componentType ) },
+              { "componentTypeString", c.m_componentTypeString },
+              { "componentSizeInBytes", c.m_componentSizeInBytes } } },
+        { "pixel", {
+              { "pixelType", static_cast<int>( p.m_pixelType ) },
+              { "pixelTypeString", p.m_pixelTypeString },
+              { "numComponents", p.m_numComponents },
+              { "pixelStrideInBytes", p.m_pixelStrideInBytes } } },
+        { "size", {
+              { "imageSizeInComponents", s.m_imageSizeInComponents },
+              { "imageSizeInPixels", s.m_imageSizeInPixels },
+              { "imageSizeInBytes", s.m_imageSizeInBytes } } },
+        { "space", {
+              { "numDimensions", sp.m_numDimensions },
+              { "dimensions", sp.m_dimensions },
+              { "origin", sp.m_origin },
+              { "spacing", sp.m_spacing },
+              { "directions", sp.m_directions } } },
+        { "metaData", metaData }
+    };
+}
+
+
+/// Set a meta data value from JSON, given the index of its type in the MetaDataMap variant
+template< size_t Index >
+void setMetaDataValue( MetaDataMap& metaData, const std::string& key, const json& j )
+{
+    using T = std::variant_alternative_t< Index, MetaDataMap::mapped_type >;
+    metaData[key] = j.get<T>();
+}
+
+
+void fromJson( const json& j, ImageIoInfo& info )
+{
+    const json& f = j.at( "file" );
+    info.m_fileInfo.m_fileName = f.at( "fileName" ).get<std::string>();
+    info.m_fileInfo.m_byteOrder = static_cast<itk::IOByteOrderEnum>( f.at( "byteOrder" ).get<int>() );
+    info.m_fileInfo.m_byteOrderString = f.at( "byteOrderString" ).get<std::string>();
+    info.m_fileInfo.m_useCompression = f.at( "useCompression" ).get<bool>();
+    info.m_fileInfo.m_fileType = static_cast<itk::IOFileEnum>( f.at( "fileType" ).get<int>() );
+    info.m_fileInfo.m_fileTypeString = f.at( "fileTypeString" ).get<std::string>();
+    f.at( "supportedReadExtensions" ).get_to( info.m_fileInfo.m_supportedReadExtensions );
+    f.at( "supportedWriteExtensions" ).get_to( info.m_fileInfo.m_supportedWriteExtensions );
+
+    const json& c = j.at( "component" );
+    info.m_componentInfo.m_componentType = static_cast<itk::IOComponentEnum>( c.at( "componentType" ).get<int>() );
+    info.m_componentInfo.m_componentTypeString = c.at( "componentTypeString" ).get<std::string>();
+    c.at( "componentSizeInBytes" ).get_to( info.m_componentInfo.m_componentSizeInBytes );
+
+    const json& p = j.at( "pixel" );
+    info.m_pixelInfo.m_pixelType = static_cast<itk::IOPixelEnum>( p.at( "pixelType" ).get<int>() );
+    info.m_pixelInfo.m_pixelTypeString = p.at( "pixelTypeString" ).get<std::string>();
+    p.at( "numComponents" ).get_to( info.m_pixelInfo.m_numComponents );
+    p.at( "pixelStrideInBytes" ).get_to( info.m_pixelInfo.m_pixelStrideInBytes );
+
+    const json& s = j.at( "size" );
+    s.at( "imageSizeInComponents" ).get_to( info.m_sizeInfo.m_imageSizeInComponents );
+    s.at( "imageSizeInPixels" ).get_to( info.m_sizeInfo.m_imageSizeInPixels );
+    s.at( "imageSizeInBytes" ).get_to( info.m_sizeInfo.m_imageSizeInBytes );
+
+    const json& sp = j.at( "space" );
+    sp.at( "numDimensions" ).get_to( info.m_spaceInfo.m_numDimensions );
+    sp.at( "dimensions" ).get_to( info.m_spaceInfo.m_dimensions );
+    sp.at( "origin" ).get_to( info.m_spaceInfo.m_origin );
+    sp.at( "spacing" ).get_to( info.m_spaceInfo.m_spacing );
+    sp.at( "directions" ).get_to( info.m_spaceInfo.m_directions );
+
+    info.m_metaData.clear();
+
+    for ( const json& entry : j.at( "metaData" ) )
+    {
+        const std::string key = entry.at( "key" ).get<std::string>();
+        const json& value = entry.at( "value" );
+
+        switch ( entry.at( "type" ).get<size_t>() )
+        {
+        case 0:  setMetaDataValue<0>( info.m_metaData, key, value ); break;
+        case 1:  setMetaDataValue<1>( info.m_metaData, key, value ); break;
+        case 2:  setMetaDataValue<2>( info.m_metaData, key, value ); break;
+        case 3:  setMetaDataValue<3>( info.m_metaData, key, value ); break;
+        case 4:  setMetaDataValue<4>( info.m_metaData, key, value ); break;
+        case 5:  setMetaDataValue<5>( info.m_metaData, key, value ); break;
+        case 6:  setMetaDataValue<6>( info.m_metaData, key, value ); break;
+        case 7:  setMetaDataValue<7>( info.m_metaData, key, value ); break;
+        case 8:  setMetaDataValue<8>( info.m_metaData, key, value ); break;
+        case 9:  setMetaDataValue<9>( info.m_metaData, key, value ); break;
+        case 10: setMetaDataValue<10>( info.m_metaData, key, value ); break;
+        default: break;
+        }
+    }
+}
+
+
+json toJson( const ComponentStats<double>& stats )
+{
+    return json
+    {
+        { "minimum", stats.m_minimum },
+        { "maximum", stats.m_maximum },
+        { "mean", stats.m_mean },
+        { "stdDeviation", stats.m_stdDeviation },
+        { "variance", stats.m_variance },
+        { "sum", stats.m_sum },
+        { "histogram", stats.m_histogram },
+        { "quantiles", stats.m_quantiles }
+    };
+}
+
+
+void fromJson( const json& j, ComponentStats<double>& stats )
+{
+    j.at( "minimum" ).get_to( stats.m_minimum );
+    j.at( "maximum" ).get_to( stats.m_maximum );
+    j.at( "mean" ).get_to( stats.m_mean );
+    j.at( "stdDeviation" ).get_to( stats.m_stdDeviation );
+    j.at( "variance" ).get_to( stats.m_variance );
+    j.at( "sum" ).get_to( stats.m_sum );
+    j.at( "histogram" ).get_to( stats.m_histogram );
+    j.at( "quantiles" ).get_to( stats.m_quantiles );
+}
+
+} // anonymous
+
+
+namespace cache
+{
+
+std::optional<std::string> cacheDirectory( const std::string& subDirectory )
+{
+    fs::path dir;
+
+    if ( const char* xdgCacheHome = std::getenv( "XDG_CACHE_HOME" ) )
+    {
+        dir = fs::path( xdgCacheHome ) / "antropy";
+    }
+    else if ( const char* localAppData = std::getenv( "LOCALAPPDATA" ) )
+    {
+        dir = fs::path( localAppData ) / "antropy" / "cache";
+    }
+    else if ( const char* home = std::getenv( "HOME" ) )
+    {
+        dir = fs::path( home ) / ".cache" / "antropy";
+    }
+    else
+    {
+        return std::nullopt;
+    }
+
+    dir /= subDirectory;
+    return dir.string();
+}
+
+
+std::optional<std::string> createCacheDirectory( const std::string& subDirectory )
+{
+    // Directories that have been created by this process
+    static std::mutex s_mutex;
+    static std::unordered_set<std::string> s_createdDirs;
+
+    const std::optional<std::string> dir = cacheDirectory( subDirectory );
+
+    if ( ! dir )
+    {
+        return std::nullopt;
+    }
+
+    std::lock_guard<std::mutex> lock( s_mutex );
+
+    if ( 0 != s_createdDirs.count( *dir ) )
+    {
+        return dir;
+    }
+
+    std::error_code error;
+    fs::create_directories( *dir, error );
+
+    if ( error )
+    {
+        spdlog::debug( "Unable to create cache directory {}: {}", *dir, error.message() );
+        return std::nullopt;
+    }
+
+    s_createdDirs.insert( *dir );
+    return dir;
+}
+
+
+std::optional<ImageFileKey> makeImageFileKey( const std::string& fileName )
+{
+    std::error_code error;
+
+    const fs::path path = fs::absolute( fs::path( fileName ), error );
+
+    if ( error || ! fs::is_regular_file( path, error ) )
+    {
+        return std::nullopt;
+    }
+
+    ImageFileKey key;
+    key.m_path = path.lexically_normal().string();
+    key.m_sizeInBytes = static_cast<uint64_t>( fs::file_size( path, error ) );
+
+    if ( error )
+    {
+        return std::nullopt;
+    }
+
+    const auto modifiedTime = fs::last_write_time( path, error );
+
+    if ( error )
+    {
+        return std::nullopt;
+    }
+
+    key.m_modifiedTime = static_cast<int64_t>( modifiedTime.time_since_epoch().count() );
+
+    const auto hash = hashFileContents( fileName, key.m_sizeInBytes );
+
+    if ( ! hash )
+    {
+        return std::nullopt;
+    }
+
+    key.m_contentHash = *hash;
+    return key;
+}
+
+
+std::optional<ImageFileInfo> loadImageFileInfo( const ImageFileKey& key )
+{
+    const auto path = entryPath( key.m_path );
+
+    if ( ! path )
+    {
+        return std::nullopt;
+    }
+
+    std::ifstream file( *path );
+
+    if ( ! file )
+    {
+        return std::nullopt;
+    }
+
+    try
+    {
+        const json j = json::parse( file );
+
+        if ( sk_cacheVersion != j.at( "version" ).get<int>() ||
+             key.m_path != j.at( "path" ).get<std::string>() ||
+             key.m_sizeInBytes != j.at( "sizeInBytes" ).get<uint64_t>() ||
+             key.m_modifiedTime != j.at( "modifiedTime" ).get<int64_t>() ||
+             key.m_contentHash != j.at( "contentHash" ).get<uint64_t>() )
+        {
+            spdlog::debug( "Cached information for image {} is out of date", key.m_path );
+            return std::nullopt;
+        }
+
+        ImageFileInfo info;
+        fromJson( j.at( "ioInfo" ), info.m_ioInfoOnDisk );
+
+        for ( const json& stats : j.at( "componentStats" ) )
+        {
+            fromJson( stats, info.m_componentStats.emplace_back() );
+        }
+
+        spdlog::debug( "Loaded cached information for image {} from {}", key.m_path, path->string() );
+        return info;
+    }
+    catch ( const std::exception& e )
+    {
+        spdlog::warn( "Invalid image cache entry {}: {}", path->string(), e.what() );
+        return std::nullopt;
+    }
+}
+
+
+bool saveImageFileInfo( const ImageFileKey& key, const ImageFileInfo& info )
+{
+    const auto path = entryPath( key.m_path );
+
+    if ( ! path || ! createCacheDirectory( sk_imagesSubDirectory ) )
+    {
+        return false;
+    }
+
+    json componentStats = json::array();
+
+    for ( const auto& stats : info.m_componentStats )
+    {
+        componentStats.push_back( toJson( stats ) );
+    }
+
+    const json j
+    {
+        { "version", sk_cacheVersion },
+        { "path", key.m_path },
+        { "sizeInBytes", key.m_sizeInBytes },
+        { "modifiedTime", key.m_modifiedTime },
+        { "contentHash", key.m_contentHash },
+        { "ioInfo", toJson( info.m_ioInfoOnDisk ) },
+        { "componentStats", componentStats }
+    };
+
+    // Write to a uniquely named temporary file that replaces the entry, so that other instances of
+    // the application neither read a partially written entry nor write to the same temporary file
+    fs::path tempPath = *path;
+    tempPath += "." + uuids::to_string( generateRandomUuid() ) + ".tmp";
+
+    try
+    {
+        std::error_code error;
+
+        {
+            std::ofstream file( tempPath );
+
+            if ( ! file )
+            {
+                return false;
+            }
+
+            file << j;
+
+            if ( ! file )
+            {
+                file.close();
+                fs::remove( tempPath, error );
+                return false;
+            }
+        }
+
+        fs::rename( tempPath, *path, error );
+
+        if ( error )
+        {
+            fs::remove( tempPath, error );
+            return false;
+        }
+    }
+    catch ( const std::exception& e )
+    {
+        spdlog::warn( "Exception saving image cache entry {}: {}", path->string(), e.what() );
+        return false;
+    }
+
+    spdlog::debug( "Saved information for image {} to cache {}", key.m_path, path->string() );
+    return true;
+}
+
+} // namespace cache
@@ -0,0 +1,63 @@
+#ifndef IMAGE_INFO_CACHE_H
+#define IMAGE_INFO_CACHE_H
+
+#include "common/Types.h"
+#include "image/ImageIoInfo.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief On-disk cache of image file information and component statistics, so that images that
+ * are opened again do not have their headers parsed twice or their statistics recomputed.
+ * Entries are stored as JSON files in a local cache directory. An entry is only used if the file
+ * path, size, modification time, and a hash of sampled file contents all match those of the file.
+ */
+namespace cache
+{
+
+/// Key that identifies the contents of an image file
+struct ImageFileKey
+{
+    std::string m_path; //!< Absolute file path
+    uint64_t m_sizeInBytes = 0; //!< File size
+    int64_t m_modifiedTime = 0; //!< File modification time, as a count since the file clock epoch
+    uint64_t m_contentHash = 0; //!< Hash of blocks sampled from the start, middle, and end of the file
+};
+
+/// Information about an image file that is held in the cache
+struct ImageFileInfo
+{
+    ImageIoInfo m_ioInfoOnDisk; //!< Image IO information read from the file header
+    std::vector< ComponentStats<double> > m_componentStats; //!< Exact statistics of the file's components
+};
+
+
+/// @brief Get a sub-directory of the local cache directory, which may not exist yet.
+/// Files are only read from it; see createCacheDirectory before writing to it.
+/// @return Path to the directory, or std::nullopt if there is no local cache directory
+std::optional<std::string> cacheDirectory( const std::string& subDirectory );
+
+/// @brief Create a sub-directory of the local cache directory if it does not exist. Call this before
+/// writing to the directory. Each directory is created at most once per process.
+/// @return Path to the directory, or std::nullopt if it cannot be created
+std::optional<std::string> createCacheDirectory( const std::string& subDirectory );
+
+/// @brief Create the key of an image file.
+/// @return The key, or std::nullopt if the file cannot be read
+std::optional<ImageFileKey> makeImageFileKey( const std::string& fileName );
+
+/// @brief Load the cached information of an image file.
+/// @return The information, or std::nullopt if no valid entry matches the key
+std::optional<ImageFileInfo> loadImageFileInfo( const ImageFileKey& key );
+
+/// @brief Save the information of an image file to the cache, replacing any existing entry for its path.
+/// @return True iff the entry was saved
+bool saveImageFileInfo( const ImageFileKey& key, const ImageFileInfo& info );
+
+} // namespace cache
+
+#endif // IMAGE_INFO_CACHE_H
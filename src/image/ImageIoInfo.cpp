@@ -339,7 +339,8 @@ bool SpaceInfo::set( const itk::ImageIOBase::Pointer imageIo )
 
     m_numDimensions = static_cast< uint32_t >( imageIo->GetNumberOfDimensions() );
 
-    if ( 3 < m_numDimensions )
+    // The fourth dimension of an image is time, whose frames are loaded as a series of 3D images
+    if ( 4 < m_numDimensions )
     {
         return false;
     }
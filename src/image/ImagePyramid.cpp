@@ -0,0 +1,127 @@
+#include "image/ImagePyramid.h"
+
+#include <algorithm>
+#include <limits>
+
+
+uint32_t imagePyramidFactor( const glm::uvec3& imageDims, uint32_t minFactor, size_t maxNumVoxels )
+{
+    uint32_t factor = std::max( minFactor, 1u );
+
+    auto numLevelVoxels = [&imageDims] ( uint32_t f )
+    {
+        const glm::uvec3 dims = ( imageDims + glm::uvec3{ f - 1 } ) / f;
+        return static_cast<size_t>( dims.x ) * dims.y * dims.z;
+    };
+
+    while ( numLevelVoxels( factor ) > maxNumVoxels &&
+            factor < std::max( std::max( imageDims.x, imageDims.y ), imageDims.z ) )
+    {
+        factor *= 2;
+    }
+
+    return factor;
+}
+
+
+ImagePyramidBuilder::ImagePyramidBuilder(
+        const glm::uvec3& imageDims, const glm::vec3& imageSpacing, uint32_t factor )
+    :
+      m_imageDims( imageDims ),
+      m_factor( std::max( factor, 1u ) ),
+      m_levelDims( ( imageDims + glm::uvec3{ m_factor - 1 } ) / m_factor ),
+      m_levelSpacing( imageSpacing * static_cast<float>( m_factor ) ),
+      m_sums( static_cast<size_t>( m_levelDims.x ) * m_levelDims.y * m_levelDims.z, 0.0 ),
+      m_numSlicesAdded( 0 )
+{}
+
+
+bool ImagePyramidBuilder::addSlab(
+        const ComponentType& componentType, const void* voxels, uint32_t firstSlice, uint32_t numSlices )
+{
+    if ( ! voxels || firstSlice != m_numSlicesAdded || numSlices > m_imageDims.z - firstSlice )
+    {
+        return false;
+    }
+
+    switch ( componentType )
+    {
+    case ComponentType::Int8: addSlab( static_cast<const int8_t*>( voxels ), numSlices ); break;
+    case ComponentType::UInt8: addSlab( static_cast<const uint8_t*>( voxels ), numSlices ); break;
+    case ComponentType::Int16: addSlab( static_cast<const int16_t*>( voxels ), numSlices ); break;
+    case ComponentType::UInt16: addSlab( static_cast<const uint16_t*>( voxels ), numSlices ); break;
+    case ComponentType::Int32: addSlab( static_cast<const int32_t*>( voxels ), numSlices ); break;
+    case ComponentType::UInt32: addSlab( static_cast<const uint32_t*>( voxels ), numSlices ); break;
+    case ComponentType::Float32: addSlab( static_cast<const float*>( voxels ), numSlices ); break;
+    case ComponentType::Float64: addSlab( static_cast<const double*>( voxels ), numSlices ); break;
+    default: return false;
+    }
+
+    return true;
+}
+
+
+template< class T >
+void ImagePyramidBuilder::addSlab( const T* voxels, uint32_t numSlices )
+{
+    const size_t levelSliceSize = static_cast<size_t>( m_levelDims.x ) * m_levelDims.y;
+
+    // Sum the image voxels of each block, one row of image voxels at a time
+    for ( uint32_t k = m_numSlicesAdded; k < m_numSlicesAdded + numSlices; ++k )
+    {
+        for ( uint32_t j = 0; j < m_imageDims.y; ++j )
+        {
+            double* levelRow = m_sums.data() + levelSliceSize * ( k / m_factor ) +
+                    static_cast<size_t>( m_levelDims.x ) * ( j / m_factor );
+
+            for ( uint32_t i = 0; i < m_imageDims.x; ++i )
+            {
+                levelRow[i / m_factor] += static_cast<double>( *voxels++ );
+            }
+        }
+    }
+
+    m_numSlicesAdded += numSlices;
+}
+
+
+uint32_t ImagePyramidBuilder::numSlicesAdded() const
+{
+    return m_numSlicesAdded;
+}
+
+
+ImagePyramidLevel ImagePyramidBuilder::level() const
+{
+    ImagePyramidLevel level;
+    level.m_factor = m_factor;
+    level.m_dims = m_levelDims;
+    level.m_spacing = m_levelSpacing;
+    level.m_values.resize( m_sums.size(), std::numeric_limits<float>::quiet_NaN() );
+
+    // Number of image voxels along an axis in the block at a level index
+    auto blockLength = [this] ( uint32_t imageLength, uint32_t index )
+    {
+        return static_cast<double>( std::min( m_factor, imageLength - index * m_factor ) );
+    };
+
+    size_t v = 0;
+
+    // Only the slices that have been added count towards the blocks of a level slice
+    for ( uint32_t k = 0; k < m_levelDims.z && k * m_factor < m_numSlicesAdded; ++k )
+    {
+        const double numBlockSlices = blockLength( m_numSlicesAdded, k );
+
+        for ( uint32_t j = 0; j < m_levelDims.y; ++j )
+        {
+            const double numRowBlockVoxels = blockLength( m_imageDims.y, j ) * numBlockSlices;
+
+            for ( uint32_t i = 0; i < m_levelDims.x; ++i, ++v )
+            {
+                level.m_values[v] = static_cast<float>( m_sums[v] / ( blockLength( m_imageDims.x, i ) * numRowBlockVoxels ) );
+            }
+        }
+    }
+
+    return level;
+}
@@ -0,0 +1,82 @@
+#ifndef IMAGE_PYRAMID_H
+#define IMAGE_PYRAMID_H
+
+#include "common/Types.h"
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * @brief Level of a multiresolution pyramid of an image component, in which each voxel is the mean
+ * of a block of factor x factor x factor voxels of the image. Levels are small enough to be shown
+ * before the full image is ready, or to be rendered in zoomed-out views at lower bandwidth.
+ */
+struct ImagePyramidLevel
+{
+    uint32_t m_factor = 1; //!< Downsampling factor along each axis
+    glm::uvec3 m_dims{ 0u }; //!< Dimensions of the level in voxels
+    glm::vec3 m_spacing{ 1.0f }; //!< Voxel spacing of the level (mm)
+    std::vector<float> m_values; //!< Native image values, with the x index varying fastest
+};
+
+
+/**
+ * @brief Get the downsampling factor of the finest pyramid level of an image that is at least
+ * minFactor and that has at most maxNumVoxels voxels. The factor is minFactor times a power of two.
+ */
+uint32_t imagePyramidFactor( const glm::uvec3& imageDims, uint32_t minFactor, size_t maxNumVoxels );
+
+/**
+ * @brief Builds a pyramid level of a scalar image with a box filter from slabs of whole slices as
+ * they are read, so that the level can be shown before the image has been read in full. The slabs
+ * are passed over once, while they are still in memory, so the image is never read again.
+ */
+class ImagePyramidBuilder
+{
+public:
+
+    /**
+     * @param[in] imageDims Dimensions of the image in voxels
+     * @param[in] imageSpacing Voxel spacing of the image (mm)
+     * @param[in] factor Downsampling factor along each axis. Blocks at the far edges of the image
+     * may be partial, in which case they are averaged over the voxels that they contain.
+     */
+    ImagePyramidBuilder( const glm::uvec3& imageDims, const glm::vec3& imageSpacing, uint32_t factor );
+
+    /**
+     * @brief Add the voxels of the next slab of slices of the image. Slabs are added in order of
+     * their slices, starting at slice zero.
+     * @param[in] componentType Type of the voxels
+     * @param[in] voxels Voxels of the slab, with the x index varying fastest
+     * @param[in] firstSlice Index of the first slice of the slab
+     * @param[in] numSlices Number of slices in the slab
+     * @return True iff the slab was added; false if its type is not supported or it is not the next slab
+     */
+    bool addSlab( const ComponentType& componentType, const void* voxels, uint32_t firstSlice, uint32_t numSlices );
+
+    /// @brief Get the number of slices of the image that have been added
+    uint32_t numSlicesAdded() const;
+
+    /// @brief Get the level from the slabs that have been added. Blocks with slices that have been
+    /// added are averaged over those slices; blocks with no slices added are not a number.
+    ImagePyramidLevel level() const;
+
+
+private:
+
+    template< class T >
+    void addSlab( const T* voxels, uint32_t numSlices );
+
+    glm::uvec3 m_imageDims; //!< Dimensions of the image in voxels
+    uint32_t m_factor; //!< Downsampling factor along each axis
+    glm::uvec3 m_levelDims; //!< Dimensions of the level in voxels
+    glm::vec3 m_levelSpacing; //!< Voxel spacing of the level (mm)
+    std::vector<double> m_sums; //!< Sums of the image voxels of the blocks of the level
+    uint32_t m_numSlicesAdded; //!< Number of slices of the image that have been added
+};
+
+#endif // IMAGE_PYRAMID_H
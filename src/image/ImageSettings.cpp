@@ -3,6 +3,8 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+
 #undef min
 #undef max
 
@@ -10,7 +12,10 @@ ImageSettings::ImageSettings(
         std::string displayName,
         uint32_t numComponents,
         ComponentType componentType,
-        std::vector< ComponentStats<double> > componentStats )
+        std::vector< ComponentStats<double> > componentStats,
+        bool provisionalStats,
+        std::optional<ValueQuantization> quantization,
+        uint32_t numFrames )
     :
       m_displayName( std::move( displayName ) ),
       m_globalVisibility( true ),
@@ -19,13 +24,16 @@ ImageSettings::ImageSettings(
       m_numComponents( numComponents ),
       m_componentType( std::move( componentType ) ),
       m_componentStats( std::move( componentStats ) ),
+      m_provisionalStats( provisionalStats ),
+      m_quantization( std::move( quantization ) ),
       m_activeComponent( 0 ),
+      m_numFrames( std::max( numFrames, 1u ) ),
+      m_activeFrame( 0 ),
+      m_frameRate( 10.0 ),
+      m_cinePlaying( false ),
+      m_cineLoop( true ),
       m_dirty( false )
 {
-    // Default window covers 1st to 99th quantile intensity range of the first pixel component
-    static constexpr int qLow = 1;
-    static constexpr int qHigh = 99;
-
     if ( m_componentStats.empty() )
     {
         spdlog::error( "No components in image settings" );
@@ -36,21 +44,9 @@ ImageSettings::ImageSettings(
     {
         ComponentSettings setting;
 
-        // Min/max window, level, and threshold ranges are based on min/max component values
-        const double minValue = stat.m_minimum;
-        const double maxValue = stat.m_maximum;
-
-        setting.m_minMaxWindowRange = std::make_pair( 0.0, maxValue - minValue );
-        setting.m_minMaxLevelRange = std::make_pair( minValue, maxValue );
-        setting.m_minMaxThresholdRange = std::make_pair( minValue, maxValue );
-        setting.m_thresholdLow = minValue;
-        setting.m_thresholdHigh = maxValue;
-
-        // Default window and level are based on low and high quantiles
-        const double quantileLow = stat.m_quantiles[qLow];
-        const double quantileHigh = stat.m_quantiles[qHigh];
-        setting.m_window = quantileHigh - quantileLow;
-        setting.m_level = 0.5 * ( quantileLow + quantileHigh );
+        setRanges( setting, stat );
+        setDefaultWindowLevel( setting, stat );
+        setDefaultThresholds( setting, stat );
 
         // Default to max opacity and nearest neighbor interpolation
         setting.m_opacity = 1.0f;
@@ -79,6 +75,37 @@ ImageSettings::ImageSettings(
     updateInternals();
 }
 
+void ImageSettings::setRanges( ComponentSettings& setting, const ComponentStats<double>& stat )
+{
+    // Min/max window, level, and threshold ranges are based on min/max component values
+    const double minValue = stat.m_minimum;
+    const double maxValue = stat.m_maximum;
+
+    setting.m_minMaxWindowRange = std::make_pair( 0.0, maxValue - minValue );
+    setting.m_minMaxLevelRange = std::make_pair( minValue, maxValue );
+    setting.m_minMaxThresholdRange = std::make_pair( minValue, maxValue );
+}
+
+void ImageSettings::setDefaultWindowLevel( ComponentSettings& setting, const ComponentStats<double>& stat )
+{
+    // Default window covers 1st to 99th quantile intensity range of the component
+    static constexpr int qLow = 1;
+    static constexpr int qHigh = 99;
+
+    const double quantileLow = stat.m_quantiles[qLow];
+    const double quantileHigh = stat.m_quantiles[qHigh];
+    setting.m_window = quantileHigh - quantileLow;
+    setting.m_level = 0.5 * ( quantileLow + quantileHigh );
+    setting.m_defaultWindowLevel = true;
+}
+
+void ImageSettings::setDefaultThresholds( ComponentSettings& setting, const ComponentStats<double>& stat )
+{
+    setting.m_thresholdLow = stat.m_minimum;
+    setting.m_thresholdHigh = stat.m_maximum;
+    setting.m_defaultThresholds = true;
+}
+
 void ImageSettings::setDisplayName( std::string name ) { m_displayName = std::move( name ); }
 const std::string& ImageSettings::displayName() const { return m_displayName; }
 
@@ -94,6 +121,7 @@ void ImageSettings::setLevel( uint32_t i, double level )
          level <= m_settings[i].m_minMaxLevelRange.second )
     {
         m_settings[i].m_level = level;
+        m_settings[i].m_defaultWindowLevel = false;
         updateInternals();
     }
 }
@@ -110,6 +138,7 @@ void ImageSettings::setWindow( uint32_t i, double window )
          window <= m_settings[i].m_minMaxWindowRange.second )
     {
         m_settings[i].m_window = window;
+        m_settings[i].m_defaultWindowLevel = false;
         updateInternals();
     }
 }
@@ -131,6 +160,7 @@ void ImageSettings::setThresholdLow( uint32_t i, double t )
          t <= m_settings[i].m_minMaxThresholdRange.second )
     {
         m_settings[i].m_thresholdLow = t;
+        m_settings[i].m_defaultThresholds = false;
         updateInternals();
     }
 }
@@ -146,6 +176,7 @@ void ImageSettings::setThresholdHigh( uint32_t i, double t )
          t <= m_settings[i].m_minMaxThresholdRange.second )
     {
         m_settings[i].m_thresholdHigh = t;
+        m_settings[i].m_defaultThresholds = false;
         updateInternals();
     }
 }
@@ -304,6 +335,52 @@ const ComponentStats<double>& ImageSettings::componentStatistics( uint32_t i ) c
 
 const ComponentStats<double>& ImageSettings::componentStatistics() const { return componentStatistics( m_activeComponent ); }
 
+void ImageSettings::setExactStatistics( std::vector< ComponentStats<double> > componentStats )
+{
+    if ( componentStats.size() != m_componentStats.size() )
+    {
+        spdlog::error( "Number of exact statistics ({}) does not match number of components ({}) for image {}",
+                       componentStats.size(), m_componentStats.size(), m_displayName );
+        return;
+    }
+
+    m_componentStats = std::move( componentStats );
+
+    for ( size_t i = 0; i < m_settings.size(); ++i )
+    {
+        ComponentSettings& S = m_settings[i];
+        const ComponentStats<double>& stat = m_componentStats[i];
+
+        setRanges( S, stat );
+
+        if ( S.m_defaultWindowLevel )
+        {
+            setDefaultWindowLevel( S, stat );
+        }
+        else
+        {
+            // Keep the window and level chosen by the user within the exact ranges
+            S.m_window = std::clamp( S.m_window, S.m_minMaxWindowRange.first, S.m_minMaxWindowRange.second );
+            S.m_level = std::clamp( S.m_level, S.m_minMaxLevelRange.first, S.m_minMaxLevelRange.second );
+        }
+
+        if ( S.m_defaultThresholds )
+        {
+            setDefaultThresholds( S, stat );
+        }
+        else
+        {
+            S.m_thresholdLow = std::clamp( S.m_thresholdLow, S.m_minMaxThresholdRange.first, S.m_minMaxThresholdRange.second );
+            S.m_thresholdHigh = std::clamp( S.m_thresholdHigh, S.m_minMaxThresholdRange.first, S.m_minMaxThresholdRange.second );
+        }
+    }
+
+    m_provisionalStats = false;
+    updateInternals();
+}
+
+bool ImageSettings::hasProvisionalStatistics() const { return m_provisionalStats; }
+
 
 void ImageSettings::setActiveComponent( uint32_t component )
 {
@@ -320,6 +397,40 @@ void ImageSettings::setActiveComponent( uint32_t component )
 
 uint32_t ImageSettings::activeComponent() const { return m_activeComponent; }
 
+
+uint32_t ImageSettings::numFrames() const { return m_numFrames; }
+
+void ImageSettings::setActiveFrame( uint32_t frame )
+{
+    if ( frame < m_numFrames )
+    {
+        m_activeFrame = frame;
+    }
+    else
+    {
+        spdlog::error( "Attempting to set invalid active frame {} (only {} frames total for image {})",
+                       frame, m_numFrames, m_displayName );
+    }
+}
+
+uint32_t ImageSettings::activeFrame() const { return m_activeFrame; }
+
+void ImageSettings::setFrameRate( double framesPerSecond )
+{
+    static constexpr double sk_minFrameRate = 0.1;
+    static constexpr double sk_maxFrameRate = 120.0;
+
+    m_frameRate = std::clamp( framesPerSecond, sk_minFrameRate, sk_maxFrameRate );
+}
+
+double ImageSettings::frameRate() const { return m_frameRate; }
+
+void ImageSettings::setCinePlaying( bool playing ) { m_cinePlaying = ( playing && m_numFrames > 1 ); }
+bool ImageSettings::cinePlaying() const { return m_cinePlaying; }
+
+void ImageSettings::setCineLoop( bool loop ) { m_cineLoop = loop; }
+bool ImageSettings::cineLoop() const { return m_cineLoop; }
+
 void ImageSettings::updateInternals()
 {
     for ( auto& S : m_settings )
@@ -409,8 +520,12 @@ void ImageSettings::updateInternals()
         case ComponentType::UInt16:
         case ComponentType::UInt32:
         {
-            S.m_slope_texture = M / imageRange;
-            S.m_intercept_texture = -imageMin / imageRange;
+            // Values stored in memory map to image values as value = qSlope * stored + qIntercept
+            const double qSlope = m_quantization ? m_quantization->m_slope : 1.0;
+            const double qIntercept = m_quantization ? m_quantization->m_intercept : 0.0;
+
+            S.m_slope_texture = qSlope * M / imageRange;
+            S.m_intercept_texture = ( qIntercept - imageMin ) / imageRange;
             break;
         }
         case ComponentType::Float32:
@@ -442,6 +557,12 @@ void ImageSettings::updateInternals()
 
 double ImageSettings::mapNativeIntensityToTexture( double nativeImageValue ) const
 {
+    if ( m_quantization )
+    {
+        // Map the image value to the quantized value that is stored in memory
+        nativeImageValue = ( nativeImageValue - m_quantization->m_intercept ) / m_quantization->m_slope;
+    }
+
     switch ( m_componentType )
     {
     case ComponentType::Int8:
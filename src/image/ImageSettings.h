@@ -6,6 +6,7 @@
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
+#include <optional>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -24,11 +25,18 @@ public:
      * @param numComponents Number of components per pixel
      * @param componentType Component type
      * @param componentStats Vector of pixel statistics, one per image component
+     * @param provisionalStats Flag that the statistics are estimates, which are to be
+     * replaced by exact statistics using setExactStatistics
+     * @param quantization Quantization of the image values that are stored in memory (if any)
+     * @param numFrames Number of time frames of the image (1 for a 3D image)
      */
     ImageSettings( std::string displayName,
                    uint32_t numComponents,
                    ComponentType componentType,
-                   std::vector< ComponentStats<double> > componentStats );
+                   std::vector< ComponentStats<double> > componentStats,
+                   bool provisionalStats = false,
+                   std::optional<ValueQuantization> quantization = std::nullopt,
+                   uint32_t numFrames = 1 );
 
     ImageSettings( const ImageSettings& ) = default;
     ImageSettings& operator=( const ImageSettings& ) = default;
@@ -274,14 +282,51 @@ public:
     const ComponentStats<double>& componentStatistics( uint32_t component ) const;
     const ComponentStats<double>& componentStatistics() const;
 
+    /// Replace provisional statistics with the exact statistics of all image components.
+    /// The window, level, and threshold ranges are updated. Window/level and thresholds
+    /// that have not been changed from their defaults are reset to the new defaults.
+    void setExactStatistics( std::vector< ComponentStats<double> > componentStats );
+
+    /// Are the statistics estimates that have not yet been replaced with exact values?
+    bool hasProvisionalStatistics() const;
+
     /// Set the active component
     void setActiveComponent( uint32_t component );
 
     /// Get the active component
     uint32_t activeComponent() const;
 
+
+    /// Get the number of time frames of the image (1 for a 3D image)
+    uint32_t numFrames() const;
+
+    /// Set the active time frame, which is the frame that is displayed
+    void setActiveFrame( uint32_t frame );
+
+    /// Get the active time frame
+    uint32_t activeFrame() const;
+
+    /// Set the cine playback rate in frames per second
+    void setFrameRate( double framesPerSecond );
+
+    /// Get the cine playback rate in frames per second
+    double frameRate() const;
+
+    /// Set whether cine playback of the time frames is running
+    void setCinePlaying( bool playing );
+
+    /// Get whether cine playback of the time frames is running
+    bool cinePlaying() const;
+
+    /// Set whether cine playback loops from the last frame back to the first.
+    /// Otherwise, playback stops at the last frame.
+    void setCineLoop( bool loop );
+
+    /// Get whether cine playback loops
+    bool cineLoop() const;
+
     /// Map a native image value to its representation as an OpenGL texture.
-    /// This mappings accounts for component type.
+    /// This mappings accounts for component type and for the quantization of values in memory.
     /// @see https://www.khronos.org/opengl/wiki/Normalized_Integer
     double mapNativeIntensityToTexture( double nativeImageValue ) const;
 
@@ -340,8 +385,20 @@ private:
         std::pair<double, double> m_minMaxWindowRange; //!< Valid window size range (not-inclusive of the min value)
         std::pair<double, double> m_minMaxLevelRange; //!< Valid level value range
         std::pair<double, double> m_minMaxThresholdRange; //!< Valid threshold range
+
+        bool m_defaultWindowLevel; //!< Are the window and level still set to their defaults?
+        bool m_defaultThresholds; //!< Are the thresholds still set to their defaults?
     };
 
+    /// Set the window, level, and threshold ranges of a component from its statistics
+    static void setRanges( ComponentSettings& setting, const ComponentStats<double>& stat );
+
+    /// Set the default window and level of a component from its statistics
+    static void setDefaultWindowLevel( ComponentSettings& setting, const ComponentStats<double>& stat );
+
+    /// Set the default thresholds of a component from its statistics
+    static void setDefaultThresholds( ComponentSettings& setting, const ComponentStats<double>& stat );
+
     /*** Start settings for all components ***/
     std::string m_displayName; //!< Display name of the image in the UI
     bool m_globalVisibility; //!< Global visibility
@@ -351,10 +408,18 @@ private:
     uint32_t m_numComponents; //!< Number of components per pixel
     ComponentType m_componentType; //!< Component type
     std::vector< ComponentStats<double> > m_componentStats; //!< Per-component statistics
+    bool m_provisionalStats; //!< Flag that the statistics are estimates
+    std::optional<ValueQuantization> m_quantization; //!< Quantization of the values in memory
     std::vector<ComponentSettings> m_settings; //!< Per-component settings
 
     uint32_t m_activeComponent; //!< Active component
 
+    uint32_t m_numFrames; //!< Number of time frames
+    uint32_t m_activeFrame; //!< Active time frame
+    double m_frameRate; //!< Cine playback rate (frames per second)
+    bool m_cinePlaying; //!< Is cine playback running?
+    bool m_cineLoop; //!< Does cine playback loop?
+
     bool m_dirty; //!< Flag that the settings have changed since the image was last saved
 };
 
@@ -3,11 +3,19 @@
 
 #include "common/Exception.hpp"
 
+#include "image/DicomSeries.h"
+#include "image/Gzip.h"
+
 #include <spdlog/spdlog.h>
 
 #include <itkImageIOFactory.h>
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <limits>
 #include <vector>
 
@@ -49,6 +57,213 @@ std::vector<std::string> splitPath( const std::string& pathString, const std::se
 
 #endif
 
+/// Trim leading and trailing whitespace from a string
+std::string trim( const std::string& str )
+{
+    const auto start = str.find_first_not_of( " \t\r" );
+    if ( std::string::npos == start )
+    {
+        return std::string();
+    }
+
+    const auto end = str.find_last_not_of( " \t\r" );
+    return str.substr( start, end - start + 1 );
+}
+
+std::string toLower( std::string str )
+{
+    std::transform( std::begin( str ), std::end( str ), std::begin( str ),
+                    [] ( unsigned char c ) { return static_cast<char>( std::tolower( c ) ); } );
+    return str;
+}
+
+static constexpr int32_t sk_nifti1HeaderSize = 348;
+static constexpr int32_t sk_nifti2HeaderSize = 540;
+
+/// Offset of the voxel data of a single-file NIfTI-1 or NIfTI-2 image from the start of its header
+std::optional<size_t> findNiftiDataOffset( const char* header, std::streamsize numRead )
+{
+    if ( numRead < static_cast<std::streamsize>( sizeof( int32_t ) ) )
+    {
+        return std::nullopt;
+    }
+
+    int32_t headerSize = 0;
+    std::memcpy( &headerSize, header, sizeof( int32_t ) );
+
+    // A byte-swapped or gzipped header does not match either header size
+    if ( sk_nifti1HeaderSize == headerSize && numRead >= sk_nifti1HeaderSize )
+    {
+        float voxOffset, slope, intercept;
+        std::memcpy( &voxOffset, header + 108, sizeof( float ) );
+        std::memcpy( &slope, header + 112, sizeof( float ) );
+        std::memcpy( &intercept, header + 116, sizeof( float ) );
+
+        // Magic "n+1" denotes a single file; "ni1" denotes separate header and image files
+        if ( 0 != std::strncmp( header + 344, "n+1", 3 ) )
+        {
+            return std::nullopt;
+        }
+
+        // Voxels with intensity scaling are rescaled by ITK, so they cannot be used as stored
+        const bool identityScaling =
+                ( std::abs( slope ) < std::numeric_limits<float>::epsilon() ||
+                  std::abs( slope - 1.0f ) < std::numeric_limits<float>::epsilon() ) &&
+                std::abs( intercept ) < std::numeric_limits<float>::epsilon();
+
+        if ( ! identityScaling || voxOffset < static_cast<float>( sk_nifti1HeaderSize ) )
+        {
+            return std::nullopt;
+        }
+
+        return static_cast<size_t>( voxOffset );
+    }
+    else if ( sk_nifti2HeaderSize == headerSize && numRead >= sk_nifti2HeaderSize )
+    {
+        int64_t voxOffset;
+        double slope, intercept;
+        std::memcpy( &voxOffset, header + 168, sizeof( int64_t ) );
+        std::memcpy( &slope, header + 176, sizeof( double ) );
+        std::memcpy( &intercept, header + 184, sizeof( double ) );
+
+        if ( 0 != std::strncmp( header + 4, "n+2", 3 ) )
+        {
+            return std::nullopt;
+        }
+
+        const bool identityScaling =
+                ( std::abs( slope ) < std::numeric_limits<double>::epsilon() ||
+                  std::abs( slope - 1.0 ) < std::numeric_limits<double>::epsilon() ) &&
+                std::abs( intercept ) < std::numeric_limits<double>::epsilon();
+
+        if ( ! identityScaling || voxOffset < sk_nifti2HeaderSize )
+        {
+            return std::nullopt;
+        }
+
+        return static_cast<size_t>( voxOffset );
+    }
+
+    return std::nullopt;
+}
+
+/// Offset of the voxel data of a single-file, uncompressed NIfTI-1 or NIfTI-2 image
+std::optional<size_t> findNiftiDataOffset( std::ifstream& file )
+{
+    char header[sk_nifti2HeaderSize];
+    file.seekg( 0 );
+    file.read( header, sk_nifti2HeaderSize );
+
+    return findNiftiDataOffset( header, file.gcount() );
+}
+
+/// Offset of the voxel data of an NRRD image with attached data that are either raw or gzip-encoded
+std::optional<size_t> findNrrdDataOffset( std::ifstream& file, bool gzipEncoding = false )
+{
+    file.seekg( 0 );
+
+    std::string line;
+    if ( ! std::getline( file, line ) || 0 != line.rfind( "NRRD", 0 ) )
+    {
+        return std::nullopt;
+    }
+
+    bool expectedEncoding = false;
+
+    // The header ends at the first empty line
+    while ( std::getline( file, line ) )
+    {
+        line = trim( line );
+
+        if ( line.empty() )
+        {
+            if ( ! expectedEncoding )
+            {
+                return std::nullopt;
+            }
+
+            const std::streamoff offset = file.tellg();
+            return ( offset > 0 ) ? std::optional<size_t>( static_cast<size_t>( offset ) ) : std::nullopt;
+        }
+
+        if ( '#' == line[0] )
+        {
+            continue;
+        }
+
+        const auto colon = line.find( ':' );
+        if ( std::string::npos == colon )
+        {
+            continue;
+        }
+
+        const std::string field = toLower( trim( line.substr( 0, colon ) ) );
+        const std::string value = trim( line.substr( colon + 1 ) );
+
+        // Skip key/value pairs, which use the ":=" separator
+        if ( ! value.empty() && '=' == value[0] )
+        {
+            continue;
+        }
+
+        if ( "encoding" == field )
+        {
+            const std::string encoding = toLower( value );
+
+            expectedEncoding = gzipEncoding ? ( "gzip" == encoding || "gz" == encoding )
+                                            : ( "raw" == encoding );
+        }
+        else if ( "data file" == field || "datafile" == field ||
+                  "line skip" == field || "lineskip" == field ||
+                  "byte skip" == field || "byteskip" == field )
+        {
+            // Detached data or skipped bytes are not supported
+            return std::nullopt;
+        }
+    }
+
+    return std::nullopt;
+}
+
+/// Offset of the voxel data of a MetaImage with local (attached), uncompressed data
+std::optional<size_t> findMetaImageDataOffset( std::ifstream& file )
+{
+    file.seekg( 0 );
+
+    std::string line;
+
+    // The header ends with the ElementDataFile field
+    while ( std::getline( file, line ) )
+    {
+        const auto equals = line.find( '=' );
+        if ( std::string::npos == equals )
+        {
+            return std::nullopt;
+        }
+
+        const std::string field = toLower( trim( line.substr( 0, equals ) ) );
+        const std::string value = toLower( trim( line.substr( equals + 1 ) ) );
+
+        if ( ( "compresseddata" == field && "true" == value ) || "headersize" == field )
+        {
+            return std::nullopt;
+        }
+
+        if ( "elementdatafile" == field )
+        {
+            if ( "local" != value )
+            {
+                return std::nullopt;
+            }
+
+            const std::streamoff offset = file.tellg();
+            return ( offset > 0 ) ? std::optional<size_t>( static_cast<size_t>( offset ) ) : std::nullopt;
+        }
+    }
+
+    return std::nullopt;
+}
+
 } // anonymous
 
 
@@ -184,8 +399,14 @@ sniffComponentType( const char* fileName )
 }
 
 
-typename itk::ImageIOBase::Pointer createStandardImageIo( const char* fileName )
+typename itk::ImageIOBase::Pointer createStandardImageIo( const char* fileName, const DicomSeries* dicomSeries )
 {
+    // Directories and files of DICOM series are read as a volume of the slices of the series
+    if ( dicomSeries )
+    {
+        return createDicomSeriesImageIo( *dicomSeries, fileName );
+    }
+
     try
     {
         const itk::ImageIOBase::Pointer imageIo =
@@ -229,3 +450,69 @@ std::pair< double, double > componentRange( const ComponentType& componentType )
     default: return { 0.0, 0.0 };
     }
 }
+
+
+std::optional<size_t> findRawVoxelDataOffset( const std::string& fileName )
+{
+    std::ifstream file( fileName, std::ios::in | std::ios::binary );
+
+    if ( ! file.is_open() )
+    {
+        return std::nullopt;
+    }
+
+    char magic[4] = { 0, 0, 0, 0 };
+    file.read( magic, 4 );
+
+    if ( 0 == std::strncmp( magic, "NRRD", 4 ) )
+    {
+        return findNrrdDataOffset( file );
+    }
+    else if ( 0 == std::strncmp( magic, "Obje", 4 ) || 0 == std::strncmp( magic, "NDim", 4 ) )
+    {
+        // MetaImage headers start with the ObjectType or NDims field
+        return findMetaImageDataOffset( file );
+    }
+
+    return findNiftiDataOffset( file );
+}
+
+
+std::optional<GzipVoxelData> findGzipVoxelData( const std::string& fileName )
+{
+    std::ifstream file( fileName, std::ios::in | std::ios::binary );
+
+    if ( ! file.is_open() )
+    {
+        return std::nullopt;
+    }
+
+    char magic[4] = { 0, 0, 0, 0 };
+    file.read( magic, 4 );
+
+    if ( 0 == std::strncmp( magic, "NRRD", 4 ) )
+    {
+        // The header of NRRD is plain text, whereas its attached data may be gzip-encoded
+        if ( const auto offset = findNrrdDataOffset( file, true ) )
+        {
+            return GzipVoxelData{ *offset, 0 };
+        }
+
+        return std::nullopt;
+    }
+
+    if ( ! isGzipFile( fileName ) )
+    {
+        return std::nullopt;
+    }
+
+    // The header of gzipped NIfTI is compressed along with its voxels
+    const std::vector<char> header = inflateGzipFileHead( fileName, 0, sk_nifti2HeaderSize );
+
+    if ( const auto offset = findNiftiDataOffset( header.data(), static_cast<std::streamsize>( header.size() ) ) )
+    {
+        return GzipVoxelData{ 0, *offset };
+    }
+
+    return std::nullopt;
+}
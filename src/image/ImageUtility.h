@@ -8,10 +8,14 @@
 #include <itkImage.h>
 #include <itkImageIOBase.h>
 
+#include <optional>
 #include <string>
 #include <utility>
 
 
+struct DicomSeries;
+
+
 std::string getFileName( const std::string& filePath, bool withExtension = false );
 
 PixelType fromItkPixelType( const ::itk::IOPixelEnum& pixelType );
@@ -21,8 +25,15 @@ ComponentType fromItkComponentType( const ::itk::IOComponentEnum& componentType
 std::pair< itk::CommonEnums::IOComponent, std::string >
 sniffComponentType( const char* fileName );
 
+/**
+ * @brief Create the image IO of a file and read its image information
+ * @param[in] fileName Image file
+ * @param[in] dicomSeries If not null, then the DICOM series that was found at the path (see
+ * findDicomSeries), for which the image IO is created. Otherwise, the IO is created by ITK.
+ * @return The image IO; null if it could not be created
+ */
 typename itk::ImageIOBase::Pointer
-createStandardImageIo( const char* fileName );
+createStandardImageIo( const char* fileName, const DicomSeries* dicomSeries = nullptr );
 
 /**
  * @brief Get the range of values that can be held in components of a given type.
@@ -33,4 +44,32 @@ createStandardImageIo( const char* fileName );
  */
 std::pair< double, double > componentRange( const ComponentType& componentType );
 
+/**
+ * @brief Find the offset of the voxel data in an image file, if the voxels are stored
+ * uncompressed and contiguously in the same file as the header. This is the case for
+ * single-file NIfTI (.nii) without intensity scaling, NRRD with attached raw data, and
+ * MetaImage (.mha) with local uncompressed data.
+ *
+ * @param[in] fileName Path to image file
+ * @return Offset in bytes of the voxel data; std::nullopt if the voxels cannot be used as stored
+ */
+std::optional<size_t> findRawVoxelDataOffset( const std::string& fileName );
+
+/// Location of the gzip-compressed voxel data of an image file
+struct GzipVoxelData
+{
+    size_t m_compressedOffset; //!< Offset in bytes of the compressed data in the file
+    size_t m_uncompressedOffset; //!< Offset in bytes of the voxels in the uncompressed data
+};
+
+/**
+ * @brief Find the voxel data of an image file whose voxels are gzip-compressed, but are otherwise
+ * stored contiguously as they are used. This is the case for single-file gzipped NIfTI (.nii.gz)
+ * without intensity scaling and NRRD with attached, gzip-encoded data.
+ *
+ * @param[in] fileName Path to image file
+ * @return Location of the compressed voxel data; std::nullopt if the file is not such an image
+ */
+std::optional<GzipVoxelData> findGzipVoxelData( const std::string& fileName );
+
 #endif // IMAGE_UTILITY_H
@@ -2,118 +2,613 @@
 #define IMAGE_UTILITY_TPP
 
 #include "common/Exception.hpp"
+#include "common/LoadProgress.h"
+#include "common/ThreadPool.h"
 #include "common/Types.h"
 
+#include "image/DicomSeries.h"
+#include "image/Gzip.h"
+#include "image/ImageUtility.h"
+
+#include <itkByteSwapper.h>
 #include <itkImage.h>
+#include <itkImageAlgorithm.h>
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
-#include <itkImageToHistogramFilter.h>
 #include <itkImportImageFilter.h>
-#include <itkStatisticsImageFilter.h>
 #include <itkVectorImage.h>
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <limits>
 #include <string>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
 
+/// Number of bins in the histogram of image component statistics
+static constexpr size_t sk_numHistogramBins = 1024;
+
+
+template< typename T, typename U, uint32_t NDim >
+ComponentStats<U> createDefaultImageStatistics( T defaultValue, size_t numPixels )
+{
+    ComponentStats<U> stats;
+    stats.m_minimum = static_cast<U>( defaultValue );
+    stats.m_maximum = static_cast<U>( defaultValue );
+    stats.m_mean = static_cast<U>( defaultValue );
+    stats.m_stdDeviation = static_cast<U>( 0 );
+    stats.m_variance = static_cast<U>( 0 );
+    stats.m_sum = static_cast<U>( defaultValue * numPixels );
+    stats.m_histogram.resize( sk_numHistogramBins, 1.0 / sk_numHistogramBins );
+
+    for ( size_t i = 0; i < stats.m_quantiles.size(); ++i )
+    {
+        stats.m_quantiles[i] = defaultValue;
+    }
+
+    return stats;
+}
+
+
+namespace detail
+{
+
+/// Number of pixels processed per tile of the statistics pass. The moments of a tile are
+/// accumulated first and its histogram is then built while the tile is in cache.
+static constexpr size_t sk_statsTileSize = 4096;
+
+/// Number of independent partial sums of the moments of contiguous pixels. Lane l sums every
+/// sk_statsNumLanes-th pixel starting at l, so the lanes can be held in vector registers without
+/// reassociating any floating-point sum (which the compiler may not do without -ffast-math).
+static constexpr size_t sk_statsNumLanes = 8;
+
+/// Minimum number of pixels per thread of the statistics pass
+static constexpr size_t sk_statsMinPixelsPerThread = 1u << 20;
+
+/// Number of high-order bits of the order-preserving float key that index the fine histogram
+/// of components wider than 16 bits. Bins have a relative width of 2^-(sk_keyBits - 9).
+static constexpr uint32_t sk_keyBits = 18;
+
+
+/// Does component type T use one histogram bin per value?
+template< typename T >
+constexpr bool hasExactHistogram()
+{
+    return std::is_integral_v<T> && sizeof( T ) <= 2;
+}
+
+/// Number of bins in the fine histogram accumulated for component type T
+template< typename T >
+constexpr size_t numFineBins()
+{
+    if constexpr ( hasExactHistogram<T>() )
+    {
+        return size_t( 1 ) << ( 8 * sizeof( T ) );
+    }
+    else
+    {
+        return size_t( 1 ) << sk_keyBits;
+    }
+}
+
+/// Map a float to an unsigned integer with the same ordering
+inline uint32_t floatToOrderedBits( float value )
+{
+    uint32_t bits;
+    std::memcpy( &bits, &value, sizeof( float ) );
+    return ( bits & 0x80000000u ) ? ~bits : ( bits | 0x80000000u );
+}
+
+/// Inverse of floatToOrderedBits
+inline float orderedBitsToFloat( uint32_t bits )
+{
+    bits = ( bits & 0x80000000u ) ? ( bits ^ 0x80000000u ) : ~bits;
+    float value;
+    std::memcpy( &value, &bits, sizeof( float ) );
+    return value;
+}
+
+/// Index of the fine histogram bin that holds a value. Components of at most 16 bits have one bin
+/// per value. Wider components are binned by the high-order bits of their order-preserving float
+/// representation, so bins are narrow near zero and have constant relative width elsewhere.
+template< typename T >
+uint32_t fineBin( T value )
+{
+    if constexpr ( hasExactHistogram<T>() )
+    {
+        return static_cast<uint32_t>( static_cast<int32_t>( value ) -
+                                      static_cast<int32_t>( std::numeric_limits<T>::lowest() ) );
+    }
+    else
+    {
+        return floatToOrderedBits( static_cast<float>( value ) ) >> ( 32u - sk_keyBits );
+    }
+}
+
+/// Lower bound of the values held in a fine histogram bin
+template< typename T >
+double fineBinLowerBound( size_t bin )
+{
+    if constexpr ( hasExactHistogram<T>() )
+    {
+        return static_cast<double>( std::numeric_limits<T>::lowest() ) + static_cast<double>( bin );
+    }
+    else
+    {
+        if ( bin >= numFineBins<T>() )
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+
+        const uint32_t key = static_cast<uint32_t>( bin ) << ( 32u - sk_keyBits );
+        const float value = orderedBitsToFloat( key );
+
+        if ( std::isnan( value ) )
+        {
+            // Bins below -inf and above +inf hold NaN bit patterns
+            return ( key & 0x80000000u ) ? std::numeric_limits<double>::infinity()
+                                         : -std::numeric_limits<double>::infinity();
+        }
+
+        return static_cast<double>( value );
+    }
+}
+
+
+/// Partial statistics of a range of pixels
+struct StatsAccumulator
+{
+    explicit StatsAccumulator( size_t numBins )
+        : m_bins( numBins, 0 ) {}
+
+    double m_min = std::numeric_limits<double>::max();
+    double m_max = std::numeric_limits<double>::lowest();
+    double m_sum = 0.0; //!< Sum of (value - shift)
+    double m_sumSquares = 0.0; //!< Sum of (value - shift)^2
+    size_t m_count = 0;
+    std::vector<uint64_t> m_bins;
+};
+
+
+/**
+ * @brief Accumulate the moments of contiguous pixels. The min and max are kept in the component
+ * type and the sums are split over sk_statsNumLanes lanes, so that the loop has no branches and no
+ * loop-carried dependency between consecutive pixels. NaN values fail both comparisons of the
+ * min and max and are masked out of the sums.
+ */
+template< typename T >
+void accumulateContiguousMoments(
+        const T* values, size_t numValues, double shift,
+        double& minValue, double& maxValue, double& sum, double& sumSquares, size_t& count )
+{
+    static constexpr size_t L = sk_statsNumLanes;
+
+    // Infinite floating-point values must not be clamped by the initial min and max
+    static constexpr T sk_highest = std::numeric_limits<T>::has_infinity
+            ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+
+    static constexpr T sk_lowest = std::numeric_limits<T>::has_infinity
+            ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+
+    std::array<T, L> laneMin;
+    std::array<T, L> laneMax;
+    laneMin.fill( sk_highest );
+    laneMax.fill( sk_lowest );
+
+    std::array<double, L> laneSum{};
+    std::array<double, L> laneSumSquares{};
+    std::array<size_t, L> laneCount{};
+
+    auto accumulate = [&] ( size_t l, T v )
+    {
+        laneMin[l] = ( v < laneMin[l] ) ? v : laneMin[l];
+        laneMax[l] = ( laneMax[l] < v ) ? v : laneMax[l];
+
+        if constexpr ( std::is_floating_point_v<T> )
+        {
+            const bool isNumber = ! std::isnan( v );
+            const double d = isNumber ? static_cast<double>( v ) - shift : 0.0;
+            laneSum[l] += d;
+            laneSumSquares[l] += d * d;
+            laneCount[l] += isNumber ? 1u : 0u;
+        }
+        else
+        {
+            const double d = static_cast<double>( v ) - shift;
+            laneSum[l] += d;
+            laneSumSquares[l] += d * d;
+        }
+    };
+
+    const size_t numBlocks = numValues / L;
+
+    for ( size_t b = 0; b < numBlocks; ++b )
+    {
+        const T* block = values + b * L;
+
+        for ( size_t l = 0; l < L; ++l )
+        {
+            accumulate( l, block[l] );
+        }
+    }
+
+    for ( size_t i = numBlocks * L; i < numValues; ++i )
+    {
+        accumulate( i - numBlocks * L, values[i] );
+    }
+
+    size_t numNumbers = numValues;
+
+    if constexpr ( std::is_floating_point_v<T> )
+    {
+        numNumbers = 0;
+        for ( size_t l = 0; l < L; ++l ) { numNumbers += laneCount[l]; }
+    }
+
+    if ( 0 == numNumbers )
+    {
+        return;
+    }
+
+    // Lanes without values hold the initial min and max, which do not affect the result
+    for ( size_t l = 0; l < L; ++l )
+    {
+        minValue = std::min( minValue, static_cast<double>( laneMin[l] ) );
+        maxValue = std::max( maxValue, static_cast<double>( laneMax[l] ) );
+        sum += laneSum[l];
+        sumSquares += laneSumSquares[l];
+    }
+
+    count += numNumbers;
+}
+
+
+/// Accumulate statistics of pixels [begin, end) of a buffer. Moments are computed relative to
+/// a shift value close to the mean in order to limit cancellation in the variance.
+template< typename T >
+void accumulateStatistics(
+        const T* buffer, size_t begin, size_t end, size_t pixelStride,
+        double shift, StatsAccumulator& acc )
+{
+    for ( size_t tileBegin = begin; tileBegin < end; tileBegin += sk_statsTileSize )
+    {
+        const size_t tileEnd = std::min( tileBegin + sk_statsTileSize, end );
+
+        double tileMin = acc.m_min;
+        double tileMax = acc.m_max;
+        double tileSum = 0.0;
+        double tileSumSquares = 0.0;
+        size_t tileCount = 0;
+
+        // Pass over the tile in memory: accumulate moments
+        if ( 1 == pixelStride )
+        {
+            accumulateContiguousMoments<T>( buffer + tileBegin, tileEnd - tileBegin, shift,
+                                            tileMin, tileMax, tileSum, tileSumSquares, tileCount );
+        }
+        else
+        {
+            for ( size_t i = tileBegin; i < tileEnd; ++i )
+            {
+                const double v = static_cast<double>( buffer[i * pixelStride] );
+
+                if constexpr ( std::is_floating_point_v<T> )
+                {
+                    if ( std::isnan( v ) ) continue;
+                }
+
+                const double d = v - shift;
+                tileMin = std::min( tileMin, v );
+                tileMax = std::max( tileMax, v );
+                tileSum += d;
+                tileSumSquares += d * d;
+                ++tileCount;
+            }
+        }
+
+        // Pass over the tile in cache: accumulate the fine histogram
+        for ( size_t i = tileBegin; i < tileEnd; ++i )
+        {
+            const T v = buffer[i * pixelStride];
+
+            if constexpr ( std::is_floating_point_v<T> )
+            {
+                if ( std::isnan( v ) ) continue;
+            }
+
+            ++acc.m_bins[ fineBin<T>( v ) ];
+        }
+
+        acc.m_min = tileMin;
+        acc.m_max = tileMax;
+        acc.m_sum += tileSum;
+        acc.m_sumSquares += tileSumSquares;
+        acc.m_count += tileCount;
+    }
+}
+
+} // namespace detail
+
+
 /**
- * @brief Compute statistics on one component of an image
+ * @brief Compute statistics on one component of an image buffer in a single pass over the data,
+ * which is split across the threads of a pool if one is given. The minimum, maximum, mean, variance, and sum are accumulated together with a
+ * fine histogram (one bin per value for 8- and 16-bit components; bins of about 0.2% relative
+ * width for wider components). Quantiles are interpolated from the fine histogram and, for integer
+ * components, snapped to integer values. The returned
+ * histogram has sk_numHistogramBins bins that span the range [minimum, maximum].
+ * NaN values are ignored.
+ *
  * @tparam T Image component type
  * @tparam U Statistic type
- * @tparam NDim Image dimension
- * @param[in] image Image on which to compute statistics
+ * @param[in] buffer Pointer to the first pixel of the component
+ * @param[in] numPixels Number of pixels
+ * @param[in] pixelStride Stride between consecutive pixels of the component, in elements
+ * @param[in] pool Pool across whose threads the pass is split. If null, then the pass runs on the
+ * calling thread. It must not be the pool that runs the caller, whose tasks it would wait on.
  * @return Statistics
  */
-template< typename T, typename U, uint32_t NDim >
-ComponentStats<U> computeImageStatistics( const typename itk::Image<T, NDim>::Pointer image )
+template< typename T, typename U >
+ComponentStats<U> computeImageStatistics(
+        const T* buffer, size_t numPixels, size_t pixelStride = 1, ThreadPool* pool = nullptr )
 {
-    using ImageType = itk::Image<T, NDim>;
-    using StatisticsFilterType = itk::StatisticsImageFilter<ImageType>;
-    using ImageToHistogramFilterType = itk::Statistics::ImageToHistogramFilter<ImageType>;
-    using HistogramType = typename ImageToHistogramFilterType::HistogramType;
+    ComponentStats<U> stats;
+
+    if ( ! buffer || 0 == numPixels )
+    {
+        return createDefaultImageStatistics<T, U, 3>( T( 0 ), 0 );
+    }
+
+    static constexpr size_t sk_numFineBins = detail::numFineBins<T>();
 
-    auto statsFilter = StatisticsFilterType::New();
-    statsFilter->SetInput( image );
-    statsFilter->Update();
+    const size_t numThreads = pool
+            ? std::max( std::min( pool->numThreads(), numPixels / detail::sk_statsMinPixelsPerThread ), size_t( 1 ) )
+            : 1;
 
-    static constexpr size_t sk_numComponents = 1;
-    static constexpr size_t sk_numBins = 101;
+    const size_t pixelsPerThread = ( numPixels + numThreads - 1 ) / numThreads;
 
-    typename HistogramType::SizeType size( sk_numComponents );
-    size.Fill( sk_numBins );
+    // Shift the moments by the first (non-NaN) value in order to limit cancellation
+    double shift = 0.0;
+    for ( size_t i = 0; i < numPixels; ++i )
+    {
+        const double v = static_cast<double>( buffer[i * pixelStride] );
+        if ( ! std::isnan( v ) )
+        {
+            shift = v;
+            break;
+        }
+    }
 
-    auto histogramFilter = ImageToHistogramFilterType::New();
+    std::vector< detail::StatsAccumulator > accumulators(
+                numThreads, detail::StatsAccumulator( sk_numFineBins ) );
 
-    // Note: this is another way of setting the min and max histogram bounds:
-    // using MeasType = typename ImageToHistogramFilterType::HistogramType::MeasurementVectorType;
-    // MeasType lowerBound( sk_numBins );
-    // MeasType upperBound( sk_numBins );
-    // lowerBound.Fill( statsImageFilter->GetMinimum() );
-    // lowerBound.Fill( statsImageFilter->GetMaximum() );
-    // histogramFilter->SetHistogramBinMinimum( lowerBound );
-    // histogramFilter->SetHistogramBinMaximum( upperBound );
+    auto accumulate = [&] ( size_t t )
+    {
+        const size_t begin = t * pixelsPerThread;
+        const size_t end = std::min( begin + pixelsPerThread, numPixels );
+        detail::accumulateStatistics<T>( buffer, begin, end, pixelStride, shift, accumulators[t] );
+    };
+
+    if ( 1 == numThreads )
+    {
+        accumulate( 0 );
+    }
+    else
+    {
+        std::vector< std::future<void> > futures;
 
-    histogramFilter->SetInput( image );
-    histogramFilter->SetAutoMinimumMaximum( true );
-    histogramFilter->SetHistogramSize( size );
-    histogramFilter->Update();
+        for ( size_t t = 0; t < numThreads; ++t )
+        {
+            futures.emplace_back( pool->submit( [&accumulate, t] () { accumulate( t ); } ) );
+        }
 
-    ComponentStats<U> stats;
-    stats.m_minimum = static_cast<U>( statsFilter->GetMinimum() );
-    stats.m_maximum = static_cast<U>( statsFilter->GetMaximum() );
-    stats.m_mean = static_cast<U>( statsFilter->GetMean() );
-    stats.m_stdDeviation = static_cast<U>( statsFilter->GetSigma() );
-    stats.m_variance = static_cast<U>( statsFilter->GetVariance() );
-    stats.m_sum = static_cast<U>( statsFilter->GetSum() );
+        for ( auto& f : futures )
+        {
+            f.get();
+        }
+    }
 
-    HistogramType* histogram = histogramFilter->GetOutput();
-    if ( ! histogram )
+    // Reduce the partial statistics
+    detail::StatsAccumulator total( sk_numFineBins );
+
+    for ( const auto& acc : accumulators )
+    {
+        total.m_min = std::min( total.m_min, acc.m_min );
+        total.m_max = std::max( total.m_max, acc.m_max );
+        total.m_sum += acc.m_sum;
+        total.m_sumSquares += acc.m_sumSquares;
+        total.m_count += acc.m_count;
+
+        for ( size_t b = 0; b < sk_numFineBins; ++b )
+        {
+            total.m_bins[b] += acc.m_bins[b];
+        }
+    }
+
+    if ( 0 == total.m_count )
     {
-        throw_debug( "Unexpected error computing image histogram" )
+        // All values are NaN
+        return createDefaultImageStatistics<T, U, 3>( T( 0 ), 0 );
     }
 
-    auto itr = histogram->Begin();
-    const auto end = histogram->End();
+    const double n = static_cast<double>( total.m_count );
+    const double mean = shift + total.m_sum / n;
+
+    // Unbiased estimate of the variance, as computed by itk::StatisticsImageFilter
+    const double variance = ( total.m_count > 1 )
+            ? std::max( ( total.m_sumSquares - total.m_sum * total.m_sum / n ) / ( n - 1.0 ), 0.0 )
+            : 0.0;
 
-    stats.m_histogram.reserve( sk_numBins );
+    stats.m_minimum = static_cast<U>( total.m_min );
+    stats.m_maximum = static_cast<U>( total.m_max );
+    stats.m_mean = static_cast<U>( mean );
+    stats.m_variance = static_cast<U>( variance );
+    stats.m_stdDeviation = static_cast<U>( std::sqrt( variance ) );
+    stats.m_sum = static_cast<U>( shift * n + total.m_sum );
 
-    while ( itr != end )
+    // Value interval [low, high] of a fine bin, clamped to the range of the data
+    auto binInterval = [&total] ( size_t b ) -> std::pair<double, double>
     {
-        stats.m_histogram.push_back( static_cast<U>( itr.GetFrequency() ) );
-        ++itr;
+        const double low = detail::fineBinLowerBound<T>( b );
+        const double high = detail::fineBinLowerBound<T>( b + 1 );
+
+        return { std::clamp( low, total.m_min, total.m_max ),
+                 std::clamp( high, total.m_min, total.m_max ) };
+    };
+
+    // Interpolate the quantiles from the cumulative fine histogram
+    const size_t numQuantiles = stats.m_quantiles.size();
+
+    size_t bin = 0;
+    uint64_t cumulativeCount = 0; // Count of all bins before 'bin'
+
+    for ( size_t q = 0; q < numQuantiles; ++q )
+    {
+        const double target = n * static_cast<double>( q ) / static_cast<double>( numQuantiles - 1 );
+
+        while ( bin < sk_numFineBins &&
+                static_cast<double>( cumulativeCount + total.m_bins[bin] ) < target )
+        {
+            cumulativeCount += total.m_bins[bin];
+            ++bin;
+        }
+
+        if ( bin >= sk_numFineBins )
+        {
+            stats.m_quantiles[q] = static_cast<U>( total.m_max );
+            continue;
+        }
+
+        const auto [low, high] = binInterval( bin );
+        const double binCount = static_cast<double>( total.m_bins[bin] );
+        const double fraction = ( binCount > 0.0 )
+                ? std::clamp( ( target - static_cast<double>( cumulativeCount ) ) / binCount, 0.0, 1.0 )
+                : 0.0;
+
+        double quantile = low + fraction * ( high - low );
+
+        // Quantiles of integer components are snapped to values that can be stored. Each bin of an
+        // exact histogram holds a single value; wider integer bins are rounded to the nearest integer.
+        if constexpr ( detail::hasExactHistogram<T>() )
+        {
+            quantile = low;
+        }
+        else if constexpr ( std::is_integral_v<T> )
+        {
+            quantile = std::round( quantile );
+        }
+
+        stats.m_quantiles[q] = static_cast<U>( quantile );
     }
 
-    for ( size_t i = 0; i < sk_numBins; ++i )
+    stats.m_quantiles.front() = static_cast<U>( total.m_min );
+    stats.m_quantiles.back() = static_cast<U>( total.m_max );
+
+    // Redistribute the fine histogram into linear bins that span [min, max],
+    // splitting the count of each fine bin in proportion to its overlap with the linear bins
+    stats.m_histogram.assign( sk_numHistogramBins, 0.0 );
+
+    const double range = total.m_max - total.m_min;
+    const double linearBinWidth = range / static_cast<double>( sk_numHistogramBins );
+
+    auto linearBin = [&] ( double value ) -> size_t
+    {
+        if ( linearBinWidth <= 0.0 ) return 0;
+        const double b = std::floor( ( value - total.m_min ) / linearBinWidth );
+        return static_cast<size_t>( std::clamp( b, 0.0, static_cast<double>( sk_numHistogramBins - 1 ) ) );
+    };
+
+    for ( size_t b = 0; b < sk_numFineBins; ++b )
     {
-        stats.m_quantiles[i] = histogram->Quantile( 0, i / 100.0 );
+        const double count = static_cast<double>( total.m_bins[b] );
+        if ( count <= 0.0 ) continue;
+
+        const auto [low, high] = binInterval( b );
+        const size_t first = linearBin( low );
+        const size_t last = linearBin( high );
+
+        if ( first == last || high <= low )
+        {
+            stats.m_histogram[first] += count;
+            continue;
+        }
+
+        for ( size_t h = first; h <= last; ++h )
+        {
+            const double hLow = total.m_min + static_cast<double>( h ) * linearBinWidth;
+            const double overlap = std::min( high, hLow + linearBinWidth ) - std::max( low, hLow );
+            stats.m_histogram[h] += count * std::max( overlap, 0.0 ) / ( high - low );
+        }
     }
 
     return stats;
 }
 
 
+/**
+ * @brief Compute statistics on one component of an ITK image
+ * @tparam T Image component type
+ * @tparam U Statistic type
+ * @tparam NDim Image dimension
+ * @param[in] image Image on which to compute statistics
+ * @return Statistics
+ */
 template< typename T, typename U, uint32_t NDim >
-ComponentStats<U> createDefaultImageStatistics( T defaultValue, size_t numPixels )
+ComponentStats<U> computeImageStatistics( const typename itk::Image<T, NDim>::Pointer image )
 {
-    static constexpr size_t sk_numBins = 101;
+    if ( ! image )
+    {
+        throw_debug( "Null image on which to compute statistics" )
+    }
 
-    ComponentStats<U> stats;
-    stats.m_minimum = static_cast<U>( defaultValue );
-    stats.m_maximum = static_cast<U>( defaultValue );
-    stats.m_mean = static_cast<U>( defaultValue );
-    stats.m_stdDeviation = static_cast<U>( 0 );
-    stats.m_variance = static_cast<U>( 0 );
-    stats.m_sum = static_cast<U>( defaultValue * numPixels );
-    stats.m_histogram.resize( sk_numBins, static_cast<U>( 1.0 / sk_numBins ) );
+    return computeImageStatistics<T, U>(
+                image->GetBufferPointer(), image->GetBufferedRegion().GetNumberOfPixels() );
+}
+
+
+/**
+ * @brief Estimate statistics on one component of an image buffer from a regularly strided
+ * subsample of at most maxNumSamples pixels. The sum and histogram frequencies are scaled up to
+ * the full number of pixels. Statistics are exact if the buffer has no more than maxNumSamples pixels.
+ *
+ * @tparam T Image component type
+ * @tparam U Statistic type
+ * @param[in] buffer Pointer to the first pixel of the component
+ * @param[in] numPixels Number of pixels
+ * @param[in] pixelStride Stride between consecutive pixels of the component, in elements
+ * @param[in] maxNumSamples Maximum number of pixels to sample
+ * @param[in] pool Pool across whose threads the pass is split (see computeImageStatistics)
+ * @return Estimated statistics
+ */
+template< typename T, typename U >
+ComponentStats<U> computeSubsampledImageStatistics(
+        const T* buffer, size_t numPixels, size_t pixelStride, size_t maxNumSamples, ThreadPool* pool = nullptr )
+{
+    if ( 0 == maxNumSamples || numPixels <= maxNumSamples )
+    {
+        return computeImageStatistics<T, U>( buffer, numPixels, pixelStride, pool );
+    }
+
+    // Use an odd sampling stride, so that samples do not alias with power-of-two row lengths
+    const size_t sampleStride = ( ( numPixels + maxNumSamples - 1 ) / maxNumSamples ) | 1u;
+    const size_t numSamples = ( numPixels + sampleStride - 1 ) / sampleStride;
+
+    ComponentStats<U> stats = computeImageStatistics<T, U>( buffer, numSamples, sampleStride * pixelStride, pool );
+
+    const double scale = static_cast<double>( numPixels ) / static_cast<double>( numSamples );
+
+    stats.m_sum = static_cast<U>( static_cast<double>( stats.m_sum ) * scale );
 
-    for ( size_t i = 0; i < sk_numBins; ++i )
+    for ( double& frequency : stats.m_histogram )
     {
-        stats.m_quantiles[i] = defaultValue;
+        frequency *= scale;
     }
 
     return stats;
@@ -168,7 +663,8 @@ bool isVectorImage( const typename ::itk::ImageBase<NDim>::Pointer& imageBase )
 /**
  * @note Data of multi-component (vector) images gets duplicated by this function:
  * one copy pointed to by base class' \c m_imageBasePtr;
- * the other copy pointed to by this class' \c m_splitImagePtrs
+ * the other copy pointed to by this class' \c m_splitImagePtrs.
+ * Use appendComponentBuffers to split components without the intermediate images.
  */
 template< class ComponentType, uint32_t NDim >
 std::vector< typename itk::Image<ComponentType, NDim>::Pointer >
@@ -309,29 +805,421 @@ makeScalarImage(
 }
 
 
-template< class ComponentType, uint32_t NDim, bool PixelIsVector >
-typename itk::ImageBase<NDim>::Pointer
-readImage( const std::string& fileName )
+/**
+ * @brief Create an ITK vector image that wraps a buffer of pixels with interleaved components.
+ * The image does not own the buffer, which must outlive it.
+ */
+template< class T >
+typename itk::VectorImage<T, 3>::Pointer
+makeVectorImage(
+        const std::array<uint32_t, 3>& imageDims,
+        const std::array<double, 3>& imageOrigin,
+        const std::array<double, 3>& imageSpacing,
+        const std::array< std::array<double, 3>, 3 >&  imageDirection,
+        uint32_t numComponents,
+        const T* imageData )
 {
-    using ImageType = typename std::conditional< PixelIsVector,
-        itk::VectorImage<ComponentType, NDim>,
-        itk::Image<ComponentType, NDim> >::type;
-
-    using ReaderType = itk::ImageFileReader<ImageType>;
+    using ImageType = itk::VectorImage<T, 3>;
 
-    try
+    if ( ! imageData )
     {
-        auto reader = ReaderType::New();
+        spdlog::error( "Null data array provided when creating new vector image" );
+        return nullptr;
+    }
 
-        if ( ! reader )
-        {
-            spdlog::error( "Null ITK ImageFileReader on reading image from {}", fileName );
+    constexpr bool containerOwnsBuffer = false;
+
+    typename ImageType::IndexType start;
+    typename ImageType::SizeType size;
+    typename ImageType::DirectionType direction;
+
+    itk::SpacePrecisionType origin[3];
+    itk::SpacePrecisionType spacing[3];
+
+    for ( uint32_t i = 0; i < 3; ++i )
+    {
+        start[i] = 0;
+        size[i] = imageDims[i];
+        origin[i] = imageOrigin[i];
+        spacing[i] = imageSpacing[i];
+
+        for ( uint32_t j = 0; j < 3; ++j )
+        {
+            direction[i][j] = imageDirection[i][j];
+        }
+    }
+
+    const size_t numPixels = size[0] * size[1] * size[2];
+
+    if ( 0 == numPixels || 0 == numComponents )
+    {
+        spdlog::error( "Cannot create new vector image with size zero" );
+        return nullptr;
+    }
+
+    typename ImageType::RegionType region;
+    region.SetIndex( start );
+    region.SetSize( size );
+
+    try
+    {
+        typename ImageType::Pointer image = ImageType::New();
+        image->SetRegions( region );
+        image->SetOrigin( origin );
+        image->SetSpacing( spacing );
+        image->SetDirection( direction );
+        image->SetNumberOfComponentsPerPixel( numComponents );
+        image->GetPixelContainer()->SetImportPointer(
+                    const_cast<T*>( imageData ), numPixels * numComponents, containerOwnsBuffer );
+
+        return image;
+    }
+    catch ( const std::exception& e )
+    {
+        spdlog::error( "Exception creating new ITK vector image from data array: {}", e.what() );
+        return nullptr;
+    }
+}
+
+
+/**
+ * @brief Read a scalar image whose voxels are gzip-compressed (see findGzipVoxelData) and whose
+ * components are held in the file as type ComponentType. The image information is read by ITK,
+ * whereas the voxels are inflated on multiple threads directly into the image buffer.
+ * @param[in] progress If not null, then the reading progress is reported to it and reading is
+ * stopped if loading has been cancelled
+ * @return The image; null if the file is not such an image or its voxels could not be inflated,
+ * in which case the image can be read by ITK
+ */
+template< class ComponentType, uint32_t NDim >
+typename itk::ImageBase<NDim>::Pointer
+readGzipImage( const std::string& fileName, const FileLoadProgress* progress = nullptr )
+{
+    using ImageType = itk::Image<ComponentType, NDim>;
+    using ReaderType = itk::ImageFileReader<ImageType>;
+
+    const std::optional<GzipVoxelData> voxelData = findGzipVoxelData( fileName );
+
+    if ( ! voxelData )
+    {
+        return nullptr;
+    }
+
+    try
+    {
+        auto reader = ReaderType::New();
+        reader->SetFileName( fileName.c_str() );
+        reader->UpdateOutputInformation();
+
+        // Voxels that ITK would convert when reading are left to ITK
+        const itk::ImageIOBase* imageIo = reader->GetImageIO();
+
+        if ( ! imageIo || 1 != imageIo->GetNumberOfComponents() ||
+             itk::ImageIOBase::MapPixelType<ComponentType>::CType != imageIo->GetComponentType() )
+        {
+            return nullptr;
+        }
+
+        typename ImageType::Pointer image = reader->GetOutput();
+        image->DisconnectPipeline();
+        image->SetBufferedRegion( image->GetLargestPossibleRegion() );
+        image->Allocate();
+
+        const size_t numPixels = image->GetLargestPossibleRegion().GetNumberOfPixels();
+
+        if ( ! inflateGzipFile( fileName, voxelData->m_compressedOffset, voxelData->m_uncompressedOffset,
+                                image->GetBufferPointer(), numPixels * sizeof( ComponentType ), progress ) )
+        {
+            return nullptr;
+        }
+
+        if ( itk::IOByteOrderEnum::BigEndian == imageIo->GetByteOrder() )
+        {
+            itk::ByteSwapper<ComponentType>::SwapRangeFromSystemToBigEndian( image->GetBufferPointer(), numPixels );
+        }
+        else
+        {
+            itk::ByteSwapper<ComponentType>::SwapRangeFromSystemToLittleEndian( image->GetBufferPointer(), numPixels );
+        }
+
+        if ( progress )
+        {
+            progress->setFraction( 1.0 );
+        }
+
+        return static_cast< typename itk::ImageBase<NDim>::Pointer >( image );
+    }
+    catch ( const std::exception& e )
+    {
+        spdlog::warn( "Exception inflating image from {}, which will be read by ITK: {}", fileName, e.what() );
+        return nullptr;
+    }
+}
+
+
+/**
+ * @brief Read an image from a DICOM series (see findDicomSeries), whose slices are decoded on multiple
+ * threads directly into the image buffer
+ * @param[in] series Series that was found at the path
+ * @param[in] path Path of the series, which is used in messages
+ * @param[in] progress If not null, then the reading progress is reported to it and reading is
+ * stopped if loading has been cancelled
+ * @return The image; null if the series does not have components of type ComponentType
+ * or its slices could not be decoded
+ */
+template< class ComponentType, uint32_t NDim, bool PixelIsVector >
+typename itk::ImageBase<NDim>::Pointer
+readDicomSeriesImage( const DicomSeries& series, const std::string& path,
+                      const FileLoadProgress* progress = nullptr )
+{
+    static_assert( 3 == NDim, "DICOM series are read as 3D images" );
+
+    using ImageType = typename std::conditional< PixelIsVector,
+        itk::VectorImage<ComponentType, NDim>,
+        itk::Image<ComponentType, NDim> >::type;
+
+    if ( itk::ImageIOBase::MapPixelType<ComponentType>::CType != series.m_componentType ||
+         PixelIsVector != ( series.m_numComponents > 1 ) )
+    {
+        return nullptr;
+    }
+
+    try
+    {
+        typename ImageType::IndexType start;
+        typename ImageType::SizeType size;
+        typename ImageType::DirectionType direction;
+        typename ImageType::PointType origin;
+        typename ImageType::SpacingType spacing;
+
+        for ( uint32_t i = 0; i < NDim; ++i )
+        {
+            start[i] = 0;
+            size[i] = series.m_dims[i];
+            origin[i] = series.m_origin[i];
+            spacing[i] = series.m_spacing[i];
+
+            for ( uint32_t j = 0; j < NDim; ++j )
+            {
+                direction[j][i] = series.m_directions[i][j];
+            }
+        }
+
+        typename ImageType::Pointer image = ImageType::New();
+        image->SetRegions( typename ImageType::RegionType( start, size ) );
+        image->SetOrigin( origin );
+        image->SetSpacing( spacing );
+        image->SetDirection( direction );
+
+        if constexpr ( PixelIsVector )
+        {
+            image->SetNumberOfComponentsPerPixel( series.m_numComponents );
+        }
+
+        image->Allocate();
+
+        if ( ! readDicomSeries( series, image->GetBufferPointer(), progress ) )
+        {
+            return nullptr;
+        }
+
+        return static_cast< typename itk::ImageBase<NDim>::Pointer >( image );
+    }
+    catch ( const std::exception& e )
+    {
+        spdlog::error( "Exception reading DICOM series from {}: {}", path, e.what() );
+        return nullptr;
+    }
+}
+
+
+/// Number of slabs in which images that ITK can stream are read, so that reading reports its
+/// progress in steps and can be cancelled between slabs
+static constexpr uint32_t sk_numReadSlabs = 64;
+
+
+/**
+ * @brief Read an image with ITK in slabs along its last dimension, which are copied into an image
+ * that holds all of them. Between slabs, the progress is reported and reading stops if loading
+ * has been cancelled. The slabs of scalar 3D images are also passed to the progress. The reader must have updated its output information and its ImageIO must
+ * be able to stream.
+ * @return The image; null if it could not be read or reading was cancelled
+ */
+template< class ImageType, class ReaderType >
+typename ImageType::Pointer readImageInSlabs(
+        ReaderType* reader, const std::string& fileName, const FileLoadProgress& progress )
+{
+    constexpr uint32_t DIM = ImageType::ImageDimension;
+    constexpr uint32_t SLAB_AXIS = DIM - 1;
+
+    ImageType* slabImage = reader->GetOutput();
+
+    const typename ImageType::RegionType largestRegion = slabImage->GetLargestPossibleRegion();
+    const uint32_t numSlices = static_cast<uint32_t>( largestRegion.GetSize( SLAB_AXIS ) );
+    const uint32_t slabDepth = std::max( ( numSlices + sk_numReadSlabs - 1 ) / sk_numReadSlabs, 1u );
+
+    typename ImageType::Pointer image = ImageType::New();
+    image->CopyInformation( slabImage );
+    image->SetRegions( largestRegion );
+    image->Allocate();
+
+    for ( uint32_t z = 0; z < numSlices; z += slabDepth )
+    {
+        if ( progress.isCancelled() )
+        {
+            spdlog::info( "Reading image {} was cancelled", fileName );
+            return nullptr;
+        }
+
+        typename ImageType::RegionType slab = largestRegion;
+        slab.SetIndex( SLAB_AXIS, largestRegion.GetIndex( SLAB_AXIS ) + z );
+        slab.SetSize( SLAB_AXIS, std::min( slabDepth, numSlices - z ) );
+
+        slabImage->SetRequestedRegion( slab );
+        slabImage->PropagateRequestedRegion();
+        slabImage->UpdateOutputData();
+
+        if ( ! slabImage->GetBufferedRegion().IsInside( slab ) )
+        {
+            spdlog::error( "Unable to read slices {} to {} of image {}",
+                           z, z + slab.GetSize( SLAB_AXIS ) - 1, fileName );
+            return nullptr;
+        }
+
+        itk::ImageAlgorithm::Copy( slabImage, image.GetPointer(), slab, slab );
+
+        // Slabs of scalar 3D images are passed on, so that they can be previewed while they are read
+        if constexpr ( 3 == DIM && std::is_arithmetic_v<typename ImageType::PixelType> )
+        {
+            ImageSlab imageSlab;
+            imageSlab.m_componentType = fromItkComponentType(
+                        itk::ImageIOBase::MapPixelType<typename ImageType::PixelType>::CType );
+            imageSlab.m_voxels = image->GetBufferPointer() + image->ComputeOffset( slab.GetIndex() );
+            imageSlab.m_firstSlice = z;
+            imageSlab.m_numSlices = static_cast<uint32_t>( slab.GetSize( SLAB_AXIS ) );
+
+            for ( uint32_t i = 0; i < DIM; ++i )
+            {
+                imageSlab.m_imageDims[i] = static_cast<uint32_t>( largestRegion.GetSize( i ) );
+                imageSlab.m_imageSpacing[i] = image->GetSpacing()[i];
+            }
+
+            progress.addSlab( imageSlab );
+        }
+
+        progress.setFraction( static_cast<double>( z + slab.GetSize( SLAB_AXIS ) ) / numSlices );
+    }
+
+    return image;
+}
+
+
+/**
+ * @brief Read an image from disk. The slices of DICOM series are decoded on multiple threads
+ * (see readDicomSeriesImage) and the gzip-compressed voxels of scalar images are inflated on
+ * multiple threads if possible (see readGzipImage); otherwise, the image is read by ITK.
+ * @param[in] progress If not null, then the reading progress is reported to it and reading is
+ * aborted if loading has been cancelled. ITK then reads the image in slabs (see readImageInSlabs),
+ * unless its ImageIO cannot stream, in which case it is read at once.
+ * @param[in] dicomSeries If not null, then the DICOM series that was found at the file path
+ * (see findDicomSeries), from which the image is read. The path is not scanned for a series again.
+ * @return The image; null if it could not be read or reading was cancelled
+ */
+template< class ComponentType, uint32_t NDim, bool PixelIsVector >
+typename itk::ImageBase<NDim>::Pointer
+readImage( const std::string& fileName, const FileLoadProgress* progress = nullptr,
+           const DicomSeries* dicomSeries = nullptr )
+{
+    using ImageType = typename std::conditional< PixelIsVector,
+        itk::VectorImage<ComponentType, NDim>,
+        itk::Image<ComponentType, NDim> >::type;
+
+    using ReaderType = itk::ImageFileReader<ImageType>;
+
+    if constexpr ( 3 == NDim )
+    {
+        if ( dicomSeries )
+        {
+            if ( auto image = readDicomSeriesImage<ComponentType, NDim, PixelIsVector>( *dicomSeries, fileName, progress ) )
+            {
+                return image;
+            }
+
+            if ( progress && progress->isCancelled() )
+            {
+                spdlog::info( "Reading image {} was cancelled", fileName );
+                return nullptr;
+            }
+        }
+    }
+
+    if constexpr ( ! PixelIsVector )
+    {
+        if ( auto image = readGzipImage<ComponentType, NDim>( fileName, progress ) )
+        {
+            return image;
+        }
+
+        if ( progress && progress->isCancelled() )
+        {
+            spdlog::info( "Reading image {} was cancelled", fileName );
+            return nullptr;
+        }
+    }
+
+    try
+    {
+        auto reader = ReaderType::New();
+
+        if ( ! reader )
+        {
+            spdlog::error( "Null ITK ImageFileReader on reading image from {}", fileName );
             return nullptr;
         }
 
         reader->SetFileName( fileName.c_str() );
+
+        if ( progress )
+        {
+            reader->UpdateOutputInformation();
+
+            // ITK reports the progress of a whole read only at its start and end, so images are read
+            // in slabs if their ImageIO can stream
+            if ( reader->GetImageIO()->CanStreamRead() )
+            {
+                if ( auto image = readImageInSlabs<ImageType>( reader.GetPointer(), fileName, *progress ) )
+                {
+                    return static_cast< typename itk::ImageBase<NDim>::Pointer >( image );
+                }
+
+                return nullptr;
+            }
+
+            spdlog::debug( "Image {} cannot be read in slabs, so its reading cannot be cancelled", fileName );
+
+            // The observer holds a raw pointer, since the reader owns the observer
+            ReaderType* readerPtr = reader.GetPointer();
+
+            reader->AddObserver( itk::ProgressEvent(), [progress, readerPtr] ( const itk::EventObject& )
+            {
+                progress->setFraction( readerPtr->GetProgress() );
+
+                if ( progress->isCancelled() )
+                {
+                    readerPtr->AbortGenerateDataOn();
+                }
+            } );
+        }
+
         reader->Update();
-        return static_cast<itk::ImageBase<3>::Pointer>( reader->GetOutput() );
+
+        if ( progress && progress->isCancelled() )
+        {
+            spdlog::info( "Reading image {} was cancelled", fileName );
+            return nullptr;
+        }
+
+        return static_cast< typename itk::ImageBase<NDim>::Pointer >( reader->GetOutput() );
     }
     catch ( const std::exception& e )
     {
@@ -343,7 +1231,9 @@ readImage( const std::string& fileName )
 
 template< class T, uint32_t NDim, bool PixelIsVector >
 bool writeImage(
-        typename itk::Image<T, NDim>::Pointer image,
+        typename std::conditional< PixelIsVector,
+            itk::VectorImage<T, NDim>,
+            itk::Image<T, NDim> >::type::Pointer image,
         const std::string& fileName )
 {
     using ImageType = typename std::conditional< PixelIsVector,
@@ -381,30 +1271,316 @@ bool writeImage(
 }
 
 
-template< class ComponentType >
-std::vector<ComponentType> createBuffer( const float* buffer, size_t numElements )
+namespace detail
 {
-    std::vector<ComponentType> data;
-    data.resize( numElements );
 
-    if ( std::is_unsigned<ComponentType>() )
+/// Number of pixels per block of the component copy. A block of the source buffer stays in cache
+/// while each of its components is copied out of it.
+static constexpr size_t sk_componentCopyBlockSize = 2048;
+
+/// Cast a component value. Negative values are set to 0 when casting a signed to an unsigned type.
+template< class DestType, class SourceType >
+inline DestType castComponent( SourceType value )
+{
+    if constexpr ( std::is_unsigned_v<DestType> && std::is_signed_v<SourceType> )
     {
-        // If casting to an unsigned integer type,
-        // then set all negative values to 0 prior to casting
-        for ( size_t i = 0; i < numElements; ++i )
+        return static_cast<DestType>( std::max( value, static_cast<SourceType>( 0 ) ) );
+    }
+    else
+    {
+        return static_cast<DestType>( value );
+    }
+}
+
+/// Copy one component of a block of pixels. Strides that are known at compile time (non-zero
+/// SourceStride and DestStride) let the compiler vectorize the strided loads and stores.
+template< size_t SourceStride, size_t DestStride, class DestType, class SourceType >
+void copyComponentBlock( const SourceType* source, size_t sourceStride,
+                         DestType* dest, size_t destStride, size_t numPixels )
+{
+    const size_t srcStride = ( SourceStride > 0 ) ? SourceStride : sourceStride;
+    const size_t dstStride = ( DestStride > 0 ) ? DestStride : destStride;
+
+    for ( size_t p = 0; p < numPixels; ++p )
+    {
+        dest[p * dstStride] = castComponent<DestType>( source[p * srcStride] );
+    }
+}
+
+/// Copy components [0, numDest) of pixels with sourceStride interleaved components into destination
+/// buffers dest[c], in which consecutive pixels are destStride elements apart. The source is
+/// traversed once, in blocks of pixels.
+template< class DestType, class SourceType >
+void copyComponents( const SourceType* source, size_t numPixels, size_t sourceStride,
+                     const std::vector<DestType*>& dest, size_t destStride )
+{
+    if ( std::is_same_v<DestType, SourceType> && 1 == dest.size() &&
+         1 == sourceStride && 1 == destStride )
+    {
+        std::memcpy( dest[0], source, numPixels * sizeof( SourceType ) );
+        return;
+    }
+
+    auto copyBlocks = [&] ( auto copyBlock )
+    {
+        for ( size_t begin = 0; begin < numPixels; begin += sk_componentCopyBlockSize )
         {
-            data[i] = static_cast<ComponentType>( std::max( buffer[i], 0.0f ) );
+            const size_t n = std::min( sk_componentCopyBlockSize, numPixels - begin );
+
+            for ( size_t c = 0; c < dest.size(); ++c )
+            {
+                copyBlock( source + begin * sourceStride + c, sourceStride,
+                           dest[c] + begin * destStride, destStride, n );
+            }
         }
+    };
+
+    if ( 1 != destStride )
+    {
+        copyBlocks( copyComponentBlock<0, 0, DestType, SourceType> );
+        return;
+    }
+
+    // Specialize the common de-interleaving strides of scalar, 2D/3D vector, and RGBA images
+    switch ( sourceStride )
+    {
+    case 1:  copyBlocks( copyComponentBlock<1, 1, DestType, SourceType> ); break;
+    case 2:  copyBlocks( copyComponentBlock<2, 1, DestType, SourceType> ); break;
+    case 3:  copyBlocks( copyComponentBlock<3, 1, DestType, SourceType> ); break;
+    case 4:  copyBlocks( copyComponentBlock<4, 1, DestType, SourceType> ); break;
+    default: copyBlocks( copyComponentBlock<0, 1, DestType, SourceType> ); break;
+    }
+}
+
+} // namespace detail
+
+
+/**
+ * @brief Append buffers of type DestType that hold the first numComponents components of a
+ * buffer of type SourceType with numSourceComponents interleaved components per pixel.
+ * The components are either appended as numComponents separate buffers or as a single buffer
+ * that interleaves them. Components are written directly into the appended buffers in a single,
+ * blocked pass over the source: they are copied if the types match and cast otherwise.
+ *
+ * @tparam DestType Component type of the appended buffers
+ * @tparam SourceType Component type of the source buffer
+ * @param[in,out] buffers Buffers to append to
+ * @param[in] source Source buffer
+ * @param[in] numPixels Number of pixels in the source buffer
+ * @param[in] numSourceComponents Number of interleaved components per pixel in the source buffer
+ * @param[in] numComponents Number of components to append
+ * @param[in] interleave Flag to append a single buffer with interleaved components
+ */
+template< class DestType, class SourceType >
+void appendComponentBuffers(
+        std::vector< std::vector<DestType> >& buffers,
+        const SourceType* source,
+        size_t numPixels,
+        size_t numSourceComponents,
+        size_t numComponents,
+        bool interleave )
+{
+    numComponents = std::min( numComponents, numSourceComponents );
+
+    if ( ! source || 0 == numComponents )
+    {
+        return;
+    }
+
+    std::vector<DestType*> dest;
+
+    if ( interleave )
+    {
+        buffers.emplace_back( numPixels * numComponents );
+
+        for ( size_t c = 0; c < numComponents; ++c )
+        {
+            dest.push_back( buffers.back().data() + c );
+        }
+
+        if ( numComponents == numSourceComponents )
+        {
+            // The interleaved layouts match, so copy the source as a single component
+            detail::copyComponents<DestType, SourceType>( source, numPixels * numComponents, 1, { dest.front() }, 1 );
+            return;
+        }
+
+        detail::copyComponents( source, numPixels, numSourceComponents, dest, numComponents );
     }
     else
     {
-        for ( size_t i = 0; i < numElements; ++i )
+        for ( size_t c = 0; c < numComponents; ++c )
         {
-            data[i] = static_cast<ComponentType>( buffer[i] );
+            buffers.emplace_back( numPixels );
         }
+
+        for ( size_t c = 0; c < numComponents; ++c )
+        {
+            dest.push_back( buffers[buffers.size() - numComponents + c].data() );
+        }
+
+        detail::copyComponents( source, numPixels, numSourceComponents, dest, 1 );
     }
+}
+
+
+/**
+ * @brief Append buffers of 16-bit unsigned integers that linearly quantize the first numComponents
+ * components of a buffer with numSourceComponents interleaved components per pixel. The range of
+ * finite values of all quantized components is mapped onto the full range of the integers, so that
+ * value = slope * storedValue + intercept. Non-finite values are stored as 0. The buffers are laid out
+ * as in appendComponentBuffers.
+ *
+ * @tparam SourceType Component type of the source buffer
+ * @param[in,out] buffers Buffers to append to
+ * @param[in] source Source buffer
+ * @param[in] numPixels Number of pixels in the source buffer
+ * @param[in] numSourceComponents Number of interleaved components per pixel in the source buffer
+ * @param[in] numComponents Number of components to append
+ * @param[in] interleave Flag to append a single buffer with interleaved components
+ * @return Slope and intercept of the quantization, along with its maximum and RMS errors
+ */
+template< class SourceType >
+ValueQuantization appendQuantizedComponentBuffers(
+        std::vector< std::vector<uint16_t> >& buffers,
+        const SourceType* source,
+        size_t numPixels,
+        size_t numSourceComponents,
+        size_t numComponents,
+        bool interleave )
+{
+    static constexpr double sk_maxStoredValue = static_cast<double>( std::numeric_limits<uint16_t>::max() );
+
+    ValueQuantization quantization;
+
+    numComponents = std::min( numComponents, numSourceComponents );
+
+    if ( ! source || 0 == numComponents )
+    {
+        return quantization;
+    }
+
+    double minValue = std::numeric_limits<double>::max();
+    double maxValue = std::numeric_limits<double>::lowest();
+
+    for ( size_t p = 0; p < numPixels; ++p )
+    {
+        for ( size_t c = 0; c < numComponents; ++c )
+        {
+            const double value = static_cast<double>( source[p * numSourceComponents + c] );
+
+            if ( std::isfinite( value ) )
+            {
+                minValue = std::min( minValue, value );
+                maxValue = std::max( maxValue, value );
+            }
+        }
+    }
+
+    if ( minValue > maxValue )
+    {
+        // There are no finite values
+        minValue = 0.0;
+        maxValue = 0.0;
+    }
+
+    quantization.m_intercept = minValue;
+    quantization.m_slope = ( maxValue > minValue ) ? ( maxValue - minValue ) / sk_maxStoredValue : 1.0;
+
+    std::vector<uint16_t*> dest;
+    size_t destStride = 1;
+
+    if ( interleave )
+    {
+        buffers.emplace_back( numPixels * numComponents );
 
-    return data;
+        for ( size_t c = 0; c < numComponents; ++c )
+        {
+            dest.push_back( buffers.back().data() + c );
+        }
+
+        destStride = numComponents;
+    }
+    else
+    {
+        for ( size_t c = 0; c < numComponents; ++c )
+        {
+            buffers.emplace_back( numPixels );
+        }
+
+        for ( size_t c = 0; c < numComponents; ++c )
+        {
+            dest.push_back( buffers[buffers.size() - numComponents + c].data() );
+        }
+    }
+
+    double maxError = 0.0;
+    double sumSquaredError = 0.0;
+
+    for ( size_t p = 0; p < numPixels; ++p )
+    {
+        for ( size_t c = 0; c < numComponents; ++c )
+        {
+            const double value = static_cast<double>( source[p * numSourceComponents + c] );
+
+            if ( ! std::isfinite( value ) )
+            {
+                dest[c][p * destStride] = 0;
+                continue;
+            }
+
+            const double stored = std::clamp(
+                        std::round( ( value - quantization.m_intercept ) / quantization.m_slope ),
+                        0.0, sk_maxStoredValue );
+
+            const double error = std::abs( quantization.m_slope * stored + quantization.m_intercept - value );
+
+            maxError = std::max( maxError, error );
+            sumSquaredError += error * error;
+
+            dest[c][p * destStride] = static_cast<uint16_t>( stored );
+        }
+    }
+
+    const size_t numValues = numPixels * numComponents;
+
+    quantization.m_maxError = maxError;
+    quantization.m_rmsError = ( numValues > 0 ) ? std::sqrt( sumSquaredError / static_cast<double>( numValues ) ) : 0.0;
+
+    return quantization;
+}
+
+
+/**
+ * @brief Map statistics of quantized values that are stored in memory to statistics of the
+ * image values, where value = slope * storedValue + intercept
+ *
+ * @param[in] stats Statistics of the stored values
+ * @param[in] quantization Quantization of the image values
+ * @param[in] numPixels Number of pixels over which the statistics were computed
+ * @return Statistics of the image values
+ */
+template< typename U >
+ComponentStats<U> dequantizeImageStatistics(
+        ComponentStats<U> stats, const ValueQuantization& quantization, size_t numPixels )
+{
+    const U a = static_cast<U>( quantization.m_slope );
+    const U b = static_cast<U>( quantization.m_intercept );
+
+    stats.m_minimum = a * stats.m_minimum + b;
+    stats.m_maximum = a * stats.m_maximum + b;
+    stats.m_mean = a * stats.m_mean + b;
+    stats.m_stdDeviation = a * stats.m_stdDeviation;
+    stats.m_variance = a * a * stats.m_variance;
+    stats.m_sum = a * stats.m_sum + b * static_cast<U>( numPixels );
+
+    for ( U& quantile : stats.m_quantiles )
+    {
+        quantile = a * quantile + b;
+    }
+
+    // The slope is positive, so the histogram bins spanning [minimum, maximum] are unchanged
+    return stats;
 }
 
 #endif // IMAGE_UTILITY_TPP
@@ -0,0 +1,185 @@
+#ifndef IMAGE_VIEW_TPP
+#define IMAGE_VIEW_TPP
+
+#include <glm/common.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vector_relational.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * @brief Typed view of one component of an image buffer. The view does not own the buffer.
+ * Voxels are accessed without bounds checks, type switches, or optional return values, so that
+ * loops over whole volumes, slices, rows, or blocks run at memory bandwidth.
+ *
+ * @note Voxel (i, j, k) of the component is at buffer[pixelStride * i + rowStride * j + sliceStride * k].
+ * The pixel stride is 1 for components held in separate buffers and it is the number of components
+ * for components that are interleaved in a single buffer. The rows and slices of a view of a whole
+ * component are contiguous, whereas those of a view of a block of the component are strided as in
+ * the whole component.
+ *
+ * @tparam T Component type, which is const for a read-only view
+ */
+template< typename T >
+class ImageView
+{
+public:
+
+    using ValueType = T;
+
+    /**
+     * @brief Construct a view of an image component buffer
+     * @param[in] buffer Pointer to the component of the first voxel
+     * @param[in] dims Image dimensions in voxels
+     * @param[in] pixelStride Stride between consecutive voxels of the component, in elements
+     */
+    ImageView( T* buffer, const glm::uvec3& dims, size_t pixelStride = 1 )
+        :
+          m_buffer( buffer ),
+          m_dims( dims ),
+          m_pixelStride( pixelStride ),
+          m_rowStride( pixelStride * dims.x ),
+          m_sliceStride( pixelStride * dims.x * dims.y )
+    {}
+
+    /**
+     * @brief Construct a view of a block of an image component buffer
+     * @param[in] buffer Pointer to the component of the first voxel of the block
+     * @param[in] dims Block dimensions in voxels
+     * @param[in] pixelStride Stride between consecutive voxels of the component, in elements
+     * @param[in] rowStride Stride between consecutive rows of the block, in elements
+     * @param[in] sliceStride Stride between consecutive slices of the block, in elements
+     */
+    ImageView( T* buffer, const glm::uvec3& dims, size_t pixelStride, size_t rowStride, size_t sliceStride )
+        :
+          m_buffer( buffer ),
+          m_dims( dims ),
+          m_pixelStride( pixelStride ),
+          m_rowStride( rowStride ),
+          m_sliceStride( sliceStride )
+    {}
+
+    ImageView( const ImageView& ) = default;
+    ImageView& operator=( const ImageView& ) = default;
+
+    ~ImageView() = default;
+
+    /// @brief Get the image dimensions in voxels
+    const glm::uvec3& dims() const { return m_dims; }
+
+    /// @brief Get the stride between consecutive voxels of the component, in elements
+    size_t pixelStride() const { return m_pixelStride; }
+
+    /// @brief Get the stride between consecutive rows, in elements
+    size_t rowStride() const { return m_rowStride; }
+
+    /// @brief Get the stride between consecutive slices, in elements
+    size_t sliceStride() const { return m_sliceStride; }
+
+    /// @brief Get the number of voxels
+    size_t numPixels() const { return static_cast<size_t>( m_dims.x ) * m_dims.y * m_dims.z; }
+
+    /// @brief Get the value of voxel (i, j, k)
+    T& operator()( uint32_t i, uint32_t j, uint32_t k ) const
+    {
+        return m_buffer[i * m_pixelStride + j * m_rowStride + k * m_sliceStride];
+    }
+
+    /// @brief Get the value of the voxel with linear index p = i + dims.x * (j + dims.y * k).
+    /// @note Only valid for views with contiguous rows and slices.
+    T& operator[]( size_t p ) const { return m_buffer[p * m_pixelStride]; }
+
+    /// @brief Get a pointer to the first voxel of row (j, k). Voxels of the row are pixelStride() apart.
+    T* row( uint32_t j, uint32_t k ) const { return m_buffer + j * m_rowStride + k * m_sliceStride; }
+
+    /// @brief Get a pointer to the first voxel of slice k. Voxels of the slice are pixelStride() apart.
+    T* slice( uint32_t k ) const { return m_buffer + k * m_sliceStride; }
+
+    /// @brief Call func( T* row, j, k ) for each row of the image, in memory order
+    template< class Func >
+    void forEachRow( Func&& func ) const
+    {
+        for ( uint32_t k = 0; k < m_dims.z; ++k )
+        {
+            for ( uint32_t j = 0; j < m_dims.y; ++j )
+            {
+                func( row( j, k ), j, k );
+            }
+        }
+    }
+
+    /// @brief Call func( T* slice, k ) for each slice of the image, in memory order
+    template< class Func >
+    void forEachSlice( Func&& func ) const
+    {
+        for ( uint32_t k = 0; k < m_dims.z; ++k )
+        {
+            func( slice( k ), k );
+        }
+    }
+
+    /// @brief Call func( T& value, i, j, k ) for each voxel of the image, in memory order
+    template< class Func >
+    void forEachVoxel( Func&& func ) const
+    {
+        forEachRow( [this, &func] ( T* r, uint32_t j, uint32_t k )
+        {
+            for ( uint32_t i = 0; i < m_dims.x; ++i )
+            {
+                func( r[i * m_pixelStride], i, j, k );
+            }
+        } );
+    }
+
+    /**
+     * @brief Call func( T& value, i, j, k ) for each voxel of a block, in memory order
+     * @param[in] blockMin Minimum voxel corner of the block (inclusive)
+     * @param[in] blockMax Maximum voxel corner of the block (inclusive)
+     * @note The block is clamped to the image
+     */
+    template< class Func >
+    void forEachVoxelInBlock( const glm::ivec3& blockMin, const glm::ivec3& blockMax, Func&& func ) const
+    {
+        if ( 0 == m_dims.x || 0 == m_dims.y || 0 == m_dims.z )
+        {
+            return;
+        }
+
+        const glm::ivec3 lastVoxel = glm::ivec3{ m_dims } - glm::ivec3{ 1 };
+
+        if ( glm::any( glm::lessThan( blockMax, glm::ivec3{ 0 } ) ) ||
+             glm::any( glm::greaterThan( blockMin, lastVoxel ) ) )
+        {
+            return;
+        }
+
+        const glm::uvec3 lo{ glm::clamp( blockMin, glm::ivec3{ 0 }, lastVoxel ) };
+        const glm::uvec3 hi{ glm::clamp( blockMax, glm::ivec3{ 0 }, lastVoxel ) };
+
+        for ( uint32_t k = lo.z; k <= hi.z; ++k )
+        {
+            for ( uint32_t j = lo.y; j <= hi.y; ++j )
+            {
+                T* r = row( j, k );
+
+                for ( uint32_t i = lo.x; i <= hi.x; ++i )
+                {
+                    func( r[i * m_pixelStride], i, j, k );
+                }
+            }
+        }
+    }
+
+
+private:
+
+    T* m_buffer;
+    glm::uvec3 m_dims;
+    size_t m_pixelStride;
+    size_t m_rowStride;
+    size_t m_sliceStride;
+};
+
+#endif // IMAGE_VIEW_TPP
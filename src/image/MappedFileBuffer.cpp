@@ -0,0 +1,362 @@
+#include "image/MappedFileBuffer.h"
+
+#include <spdlog/spdlog.h>
+
+#if ! defined( _WIN32 )
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <utility>
+
+
+#if ! defined( _WIN32 )
+
+namespace
+{
+
+/// Maximum number of file mappings that are guarded at once. Files are not mapped beyond this.
+static constexpr size_t sk_maxGuardedMappings = 256;
+
+/// Mapping of a file that is guarded against truncation of the file. Its range is
+/// [m_begin, m_end); m_begin is zero if the slot is free.
+struct GuardedMapping
+{
+    std::atomic<bool> m_inUse{ false };
+    std::atomic<uintptr_t> m_begin{ 0 };
+    std::atomic<uintptr_t> m_end{ 0 };
+    std::atomic<uint32_t> m_numTruncatedPages{ 0 };
+};
+
+GuardedMapping s_guardedMappings[sk_maxGuardedMappings];
+
+struct sigaction s_previousSigbusAction;
+uintptr_t s_pageSize = 0;
+
+
+/**
+ * @brief Handle SIGBUS, which is raised when a page of a file mapping lies past the end of the file,
+ * because the file was truncated after it was mapped. The page is replaced with a zero page, so that
+ * the voxels that are no longer in the file read as zero rather than crashing the application.
+ * Faults outside of guarded mappings are passed to the previous handler.
+ */
+void handleSigbus( int signal, siginfo_t* info, void* context )
+{
+    const uintptr_t address = reinterpret_cast<uintptr_t>( info->si_addr );
+
+    for ( GuardedMapping& mapping : s_guardedMappings )
+    {
+        const uintptr_t begin = mapping.m_begin.load();
+
+        if ( 0 == begin || address < begin || address >= mapping.m_end.load() )
+        {
+            continue;
+        }
+
+        void* page = reinterpret_cast<void*>( address & ~( s_pageSize - 1 ) );
+
+        if ( MAP_FAILED != ::mmap( page, s_pageSize, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0 ) )
+        {
+            ++mapping.m_numTruncatedPages;
+            return;
+        }
+
+        break;
+    }
+
+    if ( s_previousSigbusAction.sa_flags & SA_SIGINFO )
+    {
+        s_previousSigbusAction.sa_sigaction( signal, info, context );
+    }
+    else if ( SIG_IGN == s_previousSigbusAction.sa_handler )
+    {
+        return;
+    }
+    else if ( SIG_DFL == s_previousSigbusAction.sa_handler )
+    {
+        // The faulting access is retried on return and then terminates the process as usual
+        ::signal( SIGBUS, SIG_DFL );
+    }
+    else
+    {
+        s_previousSigbusAction.sa_handler( signal );
+    }
+}
+
+
+/// Guard a file mapping against truncation of its file. Returns false if it cannot be guarded.
+bool guardMapping( void* mapping, size_t mappingSize )
+{
+    static std::once_flag s_installed;
+    static bool s_installedHandler = false;
+
+    std::call_once( s_installed, [] ()
+    {
+        s_pageSize = static_cast<uintptr_t>( ::sysconf( _SC_PAGESIZE ) );
+
+        struct sigaction action;
+        std::memset( &action, 0, sizeof( action ) );
+        action.sa_sigaction = handleSigbus;
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset( &action.sa_mask );
+
+        s_installedHandler = ( 0 == ::sigaction( SIGBUS, &action, &s_previousSigbusAction ) );
+    } );
+
+    if ( ! s_installedHandler )
+    {
+        return false;
+    }
+
+    for ( GuardedMapping& slot : s_guardedMappings )
+    {
+        if ( ! slot.m_inUse.exchange( true ) )
+        {
+            slot.m_numTruncatedPages = 0;
+            slot.m_end = reinterpret_cast<uintptr_t>( mapping ) + mappingSize;
+            slot.m_begin = reinterpret_cast<uintptr_t>( mapping );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/// Stop guarding a file mapping before it is unmapped
+void unguardMapping( void* mapping )
+{
+    const uintptr_t begin = reinterpret_cast<uintptr_t>( mapping );
+
+    for ( GuardedMapping& slot : s_guardedMappings )
+    {
+        if ( begin != slot.m_begin.load() )
+        {
+            continue;
+        }
+
+        slot.m_begin = 0;
+        slot.m_end = 0;
+
+        if ( const uint32_t numPages = slot.m_numTruncatedPages.load() )
+        {
+            spdlog::warn( "The file of a memory-mapped buffer was truncated while it was mapped: "
+                          "{} page(s) that were no longer in the file were read as zero", numPages );
+        }
+
+        slot.m_inUse = false;
+        return;
+    }
+}
+
+} // anonymous
+
+#endif
+
+
+std::optional<MappedFileBuffer> MappedFileBuffer::map(
+        const std::string& fileName, size_t offset, size_t sizeInBytes )
+{
+#if defined( _WIN32 )
+    spdlog::debug( "Memory mapping of file {} is not supported on this platform", fileName );
+    return std::nullopt;
+#else
+    if ( 0 == sizeInBytes )
+    {
+        return std::nullopt;
+    }
+
+    const int fd = ::open( fileName.c_str(), O_RDONLY );
+
+    if ( fd < 0 )
+    {
+        spdlog::warn( "Unable to open file {} for memory mapping", fileName );
+        return std::nullopt;
+    }
+
+    struct stat fileStat;
+
+    if ( 0 != ::fstat( fd, &fileStat ) ||
+         static_cast<size_t>( fileStat.st_size ) < offset + sizeInBytes )
+    {
+        spdlog::warn( "File {} is smaller than the region of {} bytes at offset {} to be mapped",
+                      fileName, sizeInBytes, offset );
+        ::close( fd );
+        return std::nullopt;
+    }
+
+    // The mapping offset must be a multiple of the page size, so map from the
+    // start of the page that contains the region
+    const size_t pageSize = static_cast<size_t>( ::sysconf( _SC_PAGESIZE ) );
+    const size_t mappingOffset = ( offset / pageSize ) * pageSize;
+    const size_t dataOffset = offset - mappingOffset;
+    const size_t mappingSize = dataOffset + sizeInBytes;
+
+    // Private mapping: pages are copied on write, so the file is never modified
+    void* mapping = ::mmap( nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                            fd, static_cast<off_t>( mappingOffset ) );
+
+    // The mapping remains valid after the file descriptor is closed
+    ::close( fd );
+
+    if ( MAP_FAILED == mapping )
+    {
+        spdlog::warn( "Unable to memory map {} bytes of file {}", mappingSize, fileName );
+        return std::nullopt;
+    }
+
+    // Accessing a page past the end of a file that was truncated after it was mapped raises SIGBUS,
+    // so files are only mapped if their mappings are guarded against this
+    if ( ! guardMapping( mapping, mappingSize ) )
+    {
+        spdlog::debug( "Unable to guard the memory map of file {} against truncation of the file", fileName );
+        ::munmap( mapping, mappingSize );
+        return std::nullopt;
+    }
+
+    // Voxels are typically read front to back (e.g. for statistics and texture upload)
+    ::madvise( mapping, mappingSize, MADV_SEQUENTIAL );
+
+    return MappedFileBuffer( mapping, mappingSize, dataOffset, sizeInBytes );
+#endif
+}
+
+
+std::optional<MappedFileBuffer> MappedFileBuffer::zeros( size_t sizeInBytes )
+{
+#if defined( _WIN32 )
+    spdlog::debug( "Memory mapping of zero pages is not supported on this platform" );
+    return std::nullopt;
+#else
+    if ( 0 == sizeInBytes )
+    {
+        return std::nullopt;
+    }
+
+    // No swap is reserved, since pages that are only read are never allocated
+    void* mapping = ::mmap( nullptr, sizeInBytes, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+
+    if ( MAP_FAILED == mapping )
+    {
+        spdlog::warn( "Unable to memory map {} bytes of zero pages", sizeInBytes );
+        return std::nullopt;
+    }
+
+    return MappedFileBuffer( mapping, sizeInBytes, 0, sizeInBytes );
+#endif
+}
+
+
+MappedFileBuffer::MappedFileBuffer( void* mapping, size_t mappingSize, size_t dataOffset, size_t dataSize )
+    :
+      m_mapping( mapping ),
+      m_mappingSize( mappingSize ),
+      m_dataOffset( dataOffset ),
+      m_dataSize( dataSize )
+{}
+
+MappedFileBuffer::MappedFileBuffer( const MappedFileBuffer& other )
+    :
+      MappedFileBuffer( copyOf( other ) )
+{}
+
+MappedFileBuffer& MappedFileBuffer::operator=( const MappedFileBuffer& other )
+{
+    if ( this != &other )
+    {
+        *this = copyOf( other );
+    }
+    return *this;
+}
+
+MappedFileBuffer::MappedFileBuffer( MappedFileBuffer&& other ) noexcept
+    :
+      m_mapping( std::exchange( other.m_mapping, nullptr ) ),
+      m_mappingSize( std::exchange( other.m_mappingSize, 0 ) ),
+      m_dataOffset( std::exchange( other.m_dataOffset, 0 ) ),
+      m_dataSize( std::exchange( other.m_dataSize, 0 ) )
+{}
+
+MappedFileBuffer& MappedFileBuffer::operator=( MappedFileBuffer&& other ) noexcept
+{
+    if ( this != &other )
+    {
+        unmap();
+        m_mapping = std::exchange( other.m_mapping, nullptr );
+        m_mappingSize = std::exchange( other.m_mappingSize, 0 );
+        m_dataOffset = std::exchange( other.m_dataOffset, 0 );
+        m_dataSize = std::exchange( other.m_dataSize, 0 );
+    }
+    return *this;
+}
+
+MappedFileBuffer::~MappedFileBuffer()
+{
+    unmap();
+}
+
+void* MappedFileBuffer::data()
+{
+    return ( m_mapping ) ? static_cast<char*>( m_mapping ) + m_dataOffset : nullptr;
+}
+
+const void* MappedFileBuffer::data() const
+{
+    return ( m_mapping ) ? static_cast<const char*>( m_mapping ) + m_dataOffset : nullptr;
+}
+
+size_t MappedFileBuffer::sizeInBytes() const
+{
+    return m_dataSize;
+}
+
+MappedFileBuffer MappedFileBuffer::copyOf( const MappedFileBuffer& other )
+{
+#if defined( _WIN32 )
+    (void) other;
+    return MappedFileBuffer( nullptr, 0, 0, 0 );
+#else
+    if ( ! other.m_mapping || 0 == other.m_dataSize )
+    {
+        return MappedFileBuffer( nullptr, 0, 0, 0 );
+    }
+
+    void* mapping = ::mmap( nullptr, other.m_dataSize, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+    if ( MAP_FAILED == mapping )
+    {
+        spdlog::error( "Unable to allocate {} bytes for copy of memory-mapped buffer", other.m_dataSize );
+        throw std::bad_alloc();
+    }
+
+    std::memcpy( mapping, other.data(), other.m_dataSize );
+    return MappedFileBuffer( mapping, other.m_dataSize, 0, other.m_dataSize );
+#endif
+}
+
+void MappedFileBuffer::unmap()
+{
+#if ! defined( _WIN32 )
+    if ( m_mapping )
+    {
+        unguardMapping( m_mapping );
+        ::munmap( m_mapping, m_mappingSize );
+    }
+#endif
+
+    m_mapping = nullptr;
+    m_mappingSize = 0;
+    m_dataOffset = 0;
+    m_dataSize = 0;
+}
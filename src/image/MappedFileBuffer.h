@@ -0,0 +1,77 @@
+#ifndef MAPPED_FILE_BUFFER_H
+#define MAPPED_FILE_BUFFER_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+
+/**
+ * @brief Buffer that is backed by a private, read-write memory map of a region of a file.
+ * Pages of the file are faulted in lazily and are served from the operating system's page cache.
+ * Since the mapping is private (copy-on-write), writes to the buffer never modify the file.
+ *
+ * @note The file must not be truncated or rewritten in place while it is mapped. Pages of a private
+ * mapping that have not been written still read the current contents of the file, and accessing a
+ * page past the end of a truncated file raises SIGBUS. File mappings are therefore guarded by a
+ * SIGBUS handler that replaces such pages with zero pages, and a warning is logged when the buffer
+ * is unmapped. Files that are replaced by renaming another file over them (as Image::saveToDisk does)
+ * are safe, since the mapping keeps the original file alive.
+ *
+ * @note Copying a MappedFileBuffer creates an anonymous mapping that holds a copy of the data,
+ * so that copies never alias each other.
+ */
+class MappedFileBuffer
+{
+public:
+
+    /**
+     * @brief Map a region of a file into memory
+     * @param[in] fileName Path to the file
+     * @param[in] offset Offset in bytes of the start of the region in the file
+     * @param[in] sizeInBytes Size in bytes of the region
+     * @return The mapped buffer; std::nullopt if the region could not be mapped
+     */
+    static std::optional<MappedFileBuffer> map(
+            const std::string& fileName, size_t offset, size_t sizeInBytes );
+
+    /**
+     * @brief Map anonymous zero pages that are not backed by a file. Pages that are only read
+     * share the operating system's zero page, so the buffer takes no memory until it is written.
+     * @param[in] sizeInBytes Size in bytes of the buffer
+     * @return The zero buffer; std::nullopt if it could not be mapped
+     */
+    static std::optional<MappedFileBuffer> zeros( size_t sizeInBytes );
+
+    MappedFileBuffer( const MappedFileBuffer& );
+    MappedFileBuffer& operator=( const MappedFileBuffer& );
+
+    MappedFileBuffer( MappedFileBuffer&& ) noexcept;
+    MappedFileBuffer& operator=( MappedFileBuffer&& ) noexcept;
+
+    ~MappedFileBuffer();
+
+    /// @brief Get a pointer to the start of the mapped region
+    void* data();
+    const void* data() const;
+
+    /// @brief Get the size in bytes of the mapped region
+    size_t sizeInBytes() const;
+
+
+private:
+
+    MappedFileBuffer( void* mapping, size_t mappingSize, size_t dataOffset, size_t dataSize );
+
+    /// Create an anonymous mapping that holds a copy of the data of another buffer
+    static MappedFileBuffer copyOf( const MappedFileBuffer& other );
+
+    void unmap();
+
+    void* m_mapping; //!< Start of the mapping
+    size_t m_mappingSize; //!< Size of the mapping in bytes
+    size_t m_dataOffset; //!< Offset of the data from the start of the mapping
+    size_t m_dataSize; //!< Size of the data in bytes
+};
+
+#endif // MAPPED_FILE_BUFFER_H
@@ -1,7 +1,8 @@
 #include "image/SegUtil.h"
+#include "image/BrushStencil.h"
 #include "image/Image.h"
 
-#include "common/MathFuncs.h"
+#include "common/ThreadPool.h"
 
 #include "logic/annotation/Annotation.h"
 #include "logic/camera/MathUtility.h"
@@ -11,323 +12,294 @@
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/component_wise.hpp>
-#include <glm/gtx/hash.hpp>
 #include <glm/gtx/string_cast.hpp>
 
 #include <spdlog/spdlog.h>
 #include <spdlog/fmt/ostr.h>
 
-#include <queue>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <memory>
 #include <tuple>
-#include <unordered_set>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 
 namespace
 {
 
-// Does the voxel intersect a plane?
-// The plane is given in Voxel coordinates.
-bool voxelInterectsPlane(
-        const glm::vec4& voxelViewPlane,
-        const glm::vec3& voxelPos )
-{
-    static const glm::vec3 cornerOffset{ 0.5f, 0.5f, 0.5f };
-    return math::testAABBoxPlaneIntersection( voxelPos, voxelPos + cornerOffset, voxelViewPlane );
-}
+/// Minimum number of rows rasterized by each thread of a polygon fill
+constexpr size_t sk_fillMinRowsPerThread = 32;
 
-// Check if the voxel is inside the segmentation
-bool isVoxelInSeg( const glm::ivec3 segDims, const glm::ivec3& voxelPos )
+/// Polygon edge in the (a, b) column coordinates of a polygon fill, oriented so that m_p0.y < m_p1.y
+struct FillEdge
 {
-    return ( voxelPos.x >= 0 && voxelPos.x < segDims.x &&
-             voxelPos.y >= 0 && voxelPos.y < segDims.y &&
-             voxelPos.z >= 0 && voxelPos.z < segDims.z );
-}
-
-
-std::tuple< std::unordered_set< glm::ivec3 >, glm::ivec3, glm::ivec3 >
-paintBrush2d(
-        const glm::vec4& voxelViewPlane,
-        const glm::ivec3& segDims,
-        const glm::ivec3& roundedPixelPos,
-        const std::array<float, 3>& mmToVoxelSpacings,
-        int brushSizeInVoxels,
-        bool brushIsRound )
+    glm::dvec2 m_p0;
+    glm::dvec2 m_p1;
+};
+
+/**
+ * @brief Get the range of integers x such that |coeff * x + offset| <= halfWidth
+ * @return Min/max of the range; min exceeds max if it is empty
+ */
+std::pair<int, int> slabRange( double coeff, double offset, double halfWidth )
 {
-    // Queue of voxels to test for intersection with the view plane
-    std::queue< glm::ivec3 > voxelsToTest;
-
-    // Set of voxels that have been sent off for testing
-    std::unordered_set< glm::ivec3 > voxelsProcessed;
-
-    // Set of voxels that intersect with the view plane and that should be painted
-    std::unordered_set< glm::ivec3 > voxelsToPaint;
-
-    // Set of voxels that do not intersect with view plane or that should not be painted
-    std::unordered_set< glm::ivec3 > voxelsToIgnore;
-
-    // Insert the first voxel as a voxel to test, if it's inside the segmentation.
-    // This voxel should intersect the view plane, since it was clicked by the mouse,
-    // but test it to make sure.
+    static constexpr double sk_eps = 1.0e-9;
+    static constexpr double sk_bound = 1.0e9;
 
-    if ( isVoxelInSeg( segDims, roundedPixelPos ) &&
-         voxelInterectsPlane( voxelViewPlane, roundedPixelPos ) )
+    if ( std::abs( coeff ) < sk_eps )
     {
-        voxelsToTest.push( roundedPixelPos );
-        voxelsProcessed.insert( roundedPixelPos );
+        if ( std::abs( offset ) <= halfWidth ) return { static_cast<int>( -sk_bound ), static_cast<int>( sk_bound ) };
+        return { 1, 0 };
     }
 
-    std::array< glm::ivec3, 6 > neighbors;
+    double lo = ( -halfWidth - offset ) / coeff;
+    double hi = ( halfWidth - offset ) / coeff;
+    if ( lo > hi ) std::swap( lo, hi );
 
-    const float radius = static_cast<float>( brushSizeInVoxels - 1 );
-
-    // Loop over all voxels in the test queue
-    while ( ! voxelsToTest.empty() )
-    {
-        const glm::ivec3 q = voxelsToTest.front();
-        voxelsToTest.pop();
-
-        // Check if the voxel is inside the brush
-        const glm::vec3 d = q - roundedPixelPos;
+    return { static_cast<int>( std::ceil( std::max( lo, -sk_bound ) ) ),
+             static_cast<int>( std::floor( std::min( hi, sk_bound ) ) ) };
+}
 
-        if ( ! brushIsRound )
-        {
-            // Equation for a rectangle:
-            if ( std::max( std::max( std::abs( d.x / mmToVoxelSpacings[0] ),
-                                     std::abs( d.y / mmToVoxelSpacings[1] ) ),
-                           std::abs( d.z / mmToVoxelSpacings[2] ) ) > radius )
-            {
-                voxelsToIgnore.insert( q );
-                continue;
-            }
-        }
-        else
-        {
-            if ( ( d.x * d.x / ( mmToVoxelSpacings[0] * mmToVoxelSpacings[0] ) +
-                   d.y * d.y / ( mmToVoxelSpacings[1] * mmToVoxelSpacings[1] ) +
-                   d.z * d.z / ( mmToVoxelSpacings[2] * mmToVoxelSpacings[2] ) ) > radius * radius )
-            {
-                voxelsToIgnore.insert( q );
-                continue;
-            }
-        }
+/**
+ * @brief Append the spans of a scanline that are inside a polygon by the even-odd rule,
+ * so that the holes of the polygon are excluded.
+ *
+ * @param edges Polygon edges, including those of holes
+ * @param b Coordinate of the scanline
+ * @param crossings Scratch buffer for the crossings of the scanline with the edges
+ * @param[out] spans Spans (min, max) along the scanline
+ */
+void appendScanlineSpans(
+        const std::vector<FillEdge>& edges,
+        double b,
+        std::vector<double>& crossings,
+        std::vector< std::pair<double, double> >& spans )
+{
+    crossings.clear();
 
-        // Mark that voxel intersects the view plane and is inside the brush:
-        voxelsToPaint.insert( q );
+    for ( const FillEdge& edge : edges )
+    {
+        // Each edge spans [p0.y, p1.y), so that a scanline through a vertex where the boundary
+        // passes across it crosses exactly one of the two edges at the vertex
+        if ( b < edge.m_p0.y || b >= edge.m_p1.y ) continue;
 
-        // Test its six neighbors, too:
-        neighbors.fill( q );
+        const double t = ( b - edge.m_p0.y ) / ( edge.m_p1.y - edge.m_p0.y );
+        crossings.push_back( edge.m_p0.x + t * ( edge.m_p1.x - edge.m_p0.x ) );
+    }
 
-        neighbors[0].x -= 1;
-        neighbors[1].x += 1;
-        neighbors[2].y -= 1;
-        neighbors[3].y += 1;
-        neighbors[4].z -= 1;
-        neighbors[5].z += 1;
+    std::sort( std::begin( crossings ), std::end( crossings ) );
 
-        for ( const auto& n : neighbors )
-        {
-            if ( 0 == voxelsProcessed.count( n ) &&
-                 0 == voxelsToIgnore.count( n ) &&
-                 0 == voxelsToPaint.count( n ) &&
-                 voxelInterectsPlane( voxelViewPlane, n ) &&
-                 isVoxelInSeg( segDims, n ) )
-            {
-                voxelsToTest.push( n );
-                voxelsProcessed.insert( n );
-            }
-            else
-            {
-                voxelsToIgnore.insert( n );
-            }
-        }
+    for ( size_t i = 0; i + 1 < crossings.size(); i += 2 )
+    {
+        spans.emplace_back( crossings[i], crossings[i + 1] );
     }
+}
 
-    // Create a unique set of voxels to change:
-    std::unordered_set< glm::ivec3 > voxelsToChange;
 
-    // Min/max corners of the set of voxels to change:
+/**
+ * @brief Get the bounding box of the voxels of a stencil that are inside the segmentation
+ * @return Min/max corners of the box; min exceeds max if no voxel is inside the segmentation
+ */
+std::pair< glm::ivec3, glm::ivec3 > clippedStencilBox(
+        const BrushStencil& stencil,
+        const glm::ivec3& center,
+        const glm::ivec3& segDims )
+{
     glm::ivec3 minVoxel{ std::numeric_limits<int>::max() };
     glm::ivec3 maxVoxel{ std::numeric_limits<int>::lowest() };
 
-    for ( const auto& p : voxelsToPaint )
+    for ( const BrushStencil::Run& run : stencil.m_runs )
     {
-        voxelsToChange.insert( p );
-        minVoxel = glm::min( minVoxel, p );
-        maxVoxel = glm::max( maxVoxel, p );
+        const glm::ivec3 p = center + run.m_start;
+
+        if ( p.y < 0 || p.y >= segDims.y || p.z < 0 || p.z >= segDims.z ) continue;
+
+        const int i0 = std::max( p.x, 0 );
+        const int i1 = std::min( p.x + run.m_length - 1, segDims.x - 1 );
+
+        if ( i0 > i1 ) continue;
+
+        minVoxel = glm::min( minVoxel, glm::ivec3{ i0, p.y, p.z } );
+        maxVoxel = glm::max( maxVoxel, glm::ivec3{ i1, p.y, p.z } );
     }
 
-    return std::make_tuple( voxelsToChange, minVoxel, maxVoxel );
+    return { minVoxel, maxVoxel };
 }
 
 
-std::tuple< std::unordered_set< glm::ivec3 >, glm::ivec3, glm::ivec3 >
-paintBrush3d(
+/// Stencil stamped at a segmentation voxel
+struct StencilStamp
+{
+    std::shared_ptr<const BrushStencil> m_stencil;
+    glm::ivec3 m_center;
+};
+
+
+/**
+ * @brief Get the bricks that contain the voxels of stamped stencils that are inside the segmentation.
+ * Only the bricks that the runs cross are returned, not all bricks of the bounding box of the stamps,
+ * so that a diagonal stroke or a thin polygon does not touch the bricks that it passes by.
+ * @param brickSize Side length of the bricks in voxels
+ * @return 3D indices of the touched bricks, each once
+ */
+std::vector<glm::uvec3> touchedBricks(
+        const std::vector<StencilStamp>& stamps,
         const glm::ivec3& segDims,
-        const glm::ivec3& roundedPixelPos,
-        const std::array<float, 3>& mmToVoxelSpacings,
-        const std::array<int, 3>& mmToVoxelCoeffs,
-        int brushSizeInVoxels,
-        bool brushIsRound )
+        uint32_t brickSize )
 {
-    // Set of unique voxels to change:
-    std::unordered_set< glm::ivec3 > voxelToChange;
+    const int size = static_cast<int>( brickSize );
+    const glm::ivec3 gridSize = ( segDims + glm::ivec3{ size - 1 } ) / size;
 
-    // Min/max corners of the set of voxels to change:
-    glm::ivec3 minVoxel{ std::numeric_limits<int>::max() };
-    glm::ivec3 maxVoxel{ std::numeric_limits<int>::lowest() };
-
-    const int radius_int = brushSizeInVoxels - 1;
-    const float radius_f = static_cast<float>( radius_int );
+    // Linear indices of the touched bricks, in which consecutive runs of a stencil mostly repeat
+    std::vector<size_t> indices;
 
-    for ( int k = -mmToVoxelCoeffs[2] * radius_int; k <= mmToVoxelCoeffs[2] * radius_int; ++k )
+    for ( const StencilStamp& stamp : stamps )
     {
-        const int K = roundedPixelPos.z + k;
-        if ( K < 0 || K >= segDims.z ) continue;
-
-        for ( int j = -mmToVoxelCoeffs[1] * radius_int; j <= mmToVoxelCoeffs[1] * radius_int; ++j )
+        for ( const BrushStencil::Run& run : stamp.m_stencil->m_runs )
         {
-            const int J = roundedPixelPos.y + j;
-            if ( J < 0 || J >= segDims.y ) continue;
+            const glm::ivec3 p = stamp.m_center + run.m_start;
 
-            for ( int i = -mmToVoxelCoeffs[0] * radius_int; i <= mmToVoxelCoeffs[0] * radius_int; ++i )
-            {
-                const int I = roundedPixelPos.x + i;
-                if ( I < 0 || I >= segDims.x ) continue;
+            if ( p.y < 0 || p.y >= segDims.y || p.z < 0 || p.z >= segDims.z ) continue;
 
-                const glm::ivec3 p{ I, J, K };
-                bool changed = false;
+            const int i0 = std::max( p.x, 0 );
+            const int i1 = std::min( p.x + run.m_length - 1, segDims.x - 1 );
 
-                const float ii = static_cast<float>( i );
-                const float jj = static_cast<float>( j );
-                const float kk = static_cast<float>( k );
+            if ( i0 > i1 ) continue;
 
-                if ( ! brushIsRound )
-                {
-                    // Square brush
-                    if ( std::max( std::max( std::abs( ii / mmToVoxelSpacings[0] ),
-                                             std::abs( jj / mmToVoxelSpacings[1] ) ),
-                                   std::abs( kk / mmToVoxelSpacings[2] ) ) <= radius_f )
-                    {
-                        voxelToChange.insert( p );
-                        changed = true;
-                    }
-                }
-                else
-                {
-                    // Round brush: additional check that voxel is inside the sphere of radius N
-                    if ( ( ii * ii / ( mmToVoxelSpacings[0] * mmToVoxelSpacings[0] ) +
-                           jj * jj / ( mmToVoxelSpacings[1] * mmToVoxelSpacings[1] ) +
-                           kk * kk / ( mmToVoxelSpacings[2] * mmToVoxelSpacings[2] ) ) <= radius_f * radius_f )
-                    {
-                        voxelToChange.insert( p );
-                        changed = true;
-                    }
-                }
+            const size_t rowOffset = static_cast<size_t>( gridSize.x ) *
+                    ( static_cast<size_t>( p.y / size ) + static_cast<size_t>( gridSize.y ) * static_cast<size_t>( p.z / size ) );
 
-                if ( changed )
+            for ( int i = i0 / size; i <= i1 / size; ++i )
+            {
+                const size_t index = rowOffset + static_cast<size_t>( i );
+
+                if ( indices.empty() || index != indices.back() )
                 {
-                    minVoxel = glm::min( minVoxel, p );
-                    maxVoxel = glm::max( maxVoxel, p );
+                    indices.push_back( index );
                 }
             }
         }
     }
 
-    return std::make_tuple( voxelToChange, minVoxel, maxVoxel );
+    std::sort( std::begin( indices ), std::end( indices ) );
+    indices.erase( std::unique( std::begin( indices ), std::end( indices ) ), std::end( indices ) );
+
+    std::vector<glm::uvec3> bricks;
+    bricks.reserve( indices.size() );
+
+    const size_t sliceSize = static_cast<size_t>( gridSize.x ) * static_cast<size_t>( gridSize.y );
+
+    for ( const size_t index : indices )
+    {
+        bricks.emplace_back( static_cast<uint32_t>( index % static_cast<size_t>( gridSize.x ) ),
+                             static_cast<uint32_t>( ( index % sliceSize ) / static_cast<size_t>( gridSize.x ) ),
+                             static_cast<uint32_t>( index / sliceSize ) );
+    }
+
+    return bricks;
 }
 
 
-void updateSeg(
-        const std::unordered_set< glm::ivec3 >& voxelsToChange,
-        const glm::ivec3& minVoxel,
-        const glm::ivec3& maxVoxel,
+/**
+ * @brief Stamp stencils into a segmentation. The bounding box of all stamps is visited as one
+ * block, so that a swept brush stroke pages in the bricks of a bricked segmentation only once.
+ * @param writeBrickSize Side length in voxels of the bricks that are passed to beforeSegWrite
+ * @param beforeSegWrite Called with the bricks that the stamps touch, before they are written
+ * @return Min/max corners of the block of voxels covered by the stamps; none if no voxel is covered
+ */
+std::optional< std::pair< glm::ivec3, glm::ivec3 > > stampStencils(
+        const std::vector<StencilStamp>& stamps,
 
         int64_t labelToPaint,
         int64_t labelToReplace,
         bool brushReplacesBgWithFg,
 
         Image* seg,
-        const std::function< void (
-            const ComponentType& memoryComponentType, const glm::uvec3& offset,
-            const glm::uvec3& size, const int64_t* data ) >& updateSegTexture )
+        uint32_t writeBrickSize,
+        const BricksWriteCallback& beforeSegWrite )
 {
-    static constexpr size_t sk_comp = 0;
+    static constexpr uint32_t sk_comp = 0;
     static const glm::ivec3 sk_voxelOne{ 1, 1, 1 };
 
-    // Create a rectangular block of contiguous voxel value data that will be set in the texture:
-    std::vector< glm::ivec3 > voxelPositions;
-    std::vector< int64_t > voxelValues;
+    const glm::ivec3 segDims{ seg->header().pixelDimensions() };
+
+    glm::ivec3 minVoxel{ std::numeric_limits<int>::max() };
+    glm::ivec3 maxVoxel{ std::numeric_limits<int>::lowest() };
 
-    for ( int k = minVoxel.z; k <= maxVoxel.z; ++k )
+    for ( const StencilStamp& stamp : stamps )
     {
-        for ( int j = minVoxel.y; j <= maxVoxel.y; ++j )
-        {
-            for ( int i = minVoxel.x; i <= maxVoxel.x; ++i )
-            {
-                const glm::ivec3 p{ i, j, k };
-                voxelPositions.emplace_back( p );
+        const std::pair< glm::ivec3, glm::ivec3 > box = clippedStencilBox( *stamp.m_stencil, stamp.m_center, segDims );
 
-                if ( voxelsToChange.count( p ) > 0 )
-                {
-                    // Marked to change, so paint it:
-                    if ( brushReplacesBgWithFg )
-                    {
-                        const int64_t currentLabel = seg->valueAsInt64( sk_comp, i, j, k ).value_or( 0 );
-
-                        if ( labelToReplace == currentLabel )
-                        {
-                            voxelValues.emplace_back( labelToPaint );
-                        }
-                        else
-                        {
-                            voxelValues.emplace_back( currentLabel );
-                        }
-                    }
-                    else
-                    {
-                        voxelValues.emplace_back( labelToPaint );
-                    }
-                }
-                else
-                {
-                    // Not marked to change, so replace with the current label:
-                    voxelValues.emplace_back( seg->valueAsInt64( sk_comp, i, j, k ).value_or( 0 ) );
-                }
-            }
+        if ( glm::all( glm::lessThanEqual( box.first, box.second ) ) )
+        {
+            minVoxel = glm::min( minVoxel, box.first );
+            maxVoxel = glm::max( maxVoxel, box.second );
         }
     }
 
-    if ( voxelPositions.empty() )
+    if ( glm::any( glm::greaterThan( minVoxel, maxVoxel ) ) )
     {
-        return;
+        return std::nullopt;
     }
 
     const glm::uvec3 dataOffset{ minVoxel };
     const glm::uvec3 dataSize{ maxVoxel - minVoxel + sk_voxelOne };
 
-    // Safety check:
-    const size_t N = dataSize.x * dataSize.y * dataSize.z;
-
-    if ( N != voxelPositions.size() || N != voxelValues.size() )
+    if ( beforeSegWrite )
     {
-        spdlog::error( "Invalid number of voxels when performing segmentation" );
-        return;
+        beforeSegWrite( touchedBricks( stamps, segDims, writeBrickSize ) );
     }
 
-    // Set values in the segmentation image:
-    for ( size_t i = 0; i < voxelPositions.size(); ++i )
+    seg->visitBlock( sk_comp, dataOffset, dataSize, [&] ( const auto& view )
     {
-        seg->setValue( sk_comp, voxelPositions[i].x, voxelPositions[i].y, voxelPositions[i].z, voxelValues[i] );
-    }
+        using T = typename std::decay_t<decltype( view )>::ValueType;
+
+        const T paintValue = static_cast<T>( labelToPaint );
+
+        // Stamp the runs of the stencils, clipped to the block
+        for ( const StencilStamp& stamp : stamps )
+        {
+            for ( const BrushStencil::Run& run : stamp.m_stencil->m_runs )
+            {
+                const glm::ivec3 p = stamp.m_center + run.m_start - minVoxel;
+
+                if ( p.y < 0 || p.y >= static_cast<int>( dataSize.y ) ||
+                     p.z < 0 || p.z >= static_cast<int>( dataSize.z ) )
+                {
+                    continue;
+                }
+
+                const int i0 = std::max( p.x, 0 );
+                const int i1 = std::min( p.x + run.m_length - 1, static_cast<int>( dataSize.x ) - 1 );
+
+                T* row = view.row( static_cast<uint32_t>( p.y ), static_cast<uint32_t>( p.z ) );
+
+                for ( int i = i0; i <= i1; ++i )
+                {
+                    T& value = row[static_cast<size_t>( i ) * view.pixelStride()];
+
+                    // If the brush only replaces one label, then voxels with other labels are left as they are.
+                    if ( ! brushReplacesBgWithFg || labelToReplace == static_cast<int64_t>( value ) )
+                    {
+                        value = paintValue;
+                    }
+                }
+            }
+        }
+    } );
 
-    updateSegTexture( seg->header().memoryComponentType(), dataOffset, dataSize, voxelValues.data() );
+    return std::make_pair( minVoxel, maxVoxel );
 }
 
 } // anonymous
 
 
-void paintSegmentation(
+std::optional< std::pair< glm::uvec3, glm::uvec3 > > paintSegmentation(
         Image* seg,
 
         int64_t labelToPaint,
@@ -338,13 +310,16 @@ void paintSegmentation(
         bool brushIsIsotropic,
         int brushSizeInVoxels,
 
-        const glm::ivec3& roundedPixelPos,
+        const glm::vec3& startPixelPos,
+        const glm::vec3& endPixelPos,
         const glm::vec4& voxelViewPlane,
 
-        const std::function< void (
-            const ComponentType& memoryComponentType, const glm::uvec3& offset,
-            const glm::uvec3& size, const int64_t* data ) >& updateSegTexture )
+        uint32_t writeBrickSize,
+        const BricksWriteCallback& beforeSegWrite )
 {
+    static const glm::ivec3 sk_voxelZero{ 0, 0, 0 };
+    static const glm::ivec3 sk_voxelOne{ 1, 1, 1 };
+
     // Set the brush radius (not including the central voxel): Radius = (brush width - 1) / 2
     // A single voxel brush has radius zero, a width 3 voxel brush has radius 1,
     // a width 5 voxel brush has radius 2, etc.
@@ -352,9 +327,6 @@ void paintSegmentation(
     // Coefficients that convert mm to voxel spacing:
     std::array<float, 3> mmToVoxelSpacings{ 1.0f, 1.0f, 1.0f };
 
-    // Integer versions of the mm to voxel coefficients:
-    std::array<int, 3> mmToVoxelCoeffs{ 1, 1, 1 };
-
     if ( brushIsIsotropic )
     {
         // Compute factors that account for anisotropic spacing:
@@ -367,40 +339,59 @@ void paintSegmentation(
         for ( uint32_t i = 0; i < 3; ++i )
         {
             mmToVoxelSpacings[i] = spacing / seg->header().spacing()[static_cast<int>(i)];
-            mmToVoxelCoeffs[i] = std::max( static_cast<int>( std::ceil( mmToVoxelSpacings[i] ) ), 1 );
         }
     }
 
-    // Set of unique voxels to change:
-    std::unordered_set< glm::ivec3 > voxelsToChange;
+    const glm::ivec3 segDims{ seg->header().pixelDimensions() };
 
-    // Min/max corners of the set of voxels to change
-    glm::ivec3 maxVoxel{ std::numeric_limits<int>::lowest() };
-    glm::ivec3 minVoxel{ std::numeric_limits<int>::max() };
+    // The stroke is swept by stamping the brush at every voxel step along the segment. The start
+    // was stamped by the previous segment of the stroke, so it is only stamped for a stroke of one point.
+    const glm::ivec3 roundedStart{ glm::round( startPixelPos ) };
+    const glm::ivec3 roundedEnd{ glm::round( endPixelPos ) };
+
+    const int numSteps = ( roundedStart == roundedEnd )
+            ? 0 : static_cast<int>( std::ceil( glm::compMax( glm::abs( endPixelPos - startPixelPos ) ) ) );
+
+    std::vector<StencilStamp> stamps;
+    std::optional<glm::ivec3> lastCenter;
 
-    if ( brushIs3d )
+    for ( int step = ( 0 == numSteps ? 0 : 1 ); step <= numSteps; ++step )
     {
-        std::tie( voxelsToChange, minVoxel, maxVoxel ) = paintBrush3d(
-                    seg->header().pixelDimensions(),
-                    roundedPixelPos, mmToVoxelSpacings, mmToVoxelCoeffs,
-                    brushSizeInVoxels, brushIsRound );
+        const float t = ( 0 == numSteps ) ? 1.0f : static_cast<float>( step ) / static_cast<float>( numSteps );
+        const glm::ivec3 center{ glm::round( glm::mix( startPixelPos, endPixelPos, t ) ) };
+
+        if ( ( lastCenter && center == *lastCenter ) ||
+             glm::any( glm::lessThan( center, sk_voxelZero ) ) ||
+             glm::any( glm::greaterThanEqual( center, segDims ) ) )
+        {
+            continue; // Already stamped or outside the segmentation
+        }
+
+        lastCenter = center;
+
+        // The stencil is cached for the brush configuration. The view plane is given relative to the
+        // center voxel, so that 2D stencils are shared by all voxels with the same plane offset.
+        const glm::vec4 relativeViewPlane{
+            glm::vec3{ voxelViewPlane },
+            glm::dot( voxelViewPlane, glm::vec4{ glm::vec3{ center }, 1.0f } ) };
+
+        stamps.push_back( { brushStencil( brushSizeInVoxels, brushIsRound, brushIs3d,
+                                          mmToVoxelSpacings, relativeViewPlane ), center } );
     }
-    else
+
+    const auto box = stampStencils( stamps, labelToPaint, labelToReplace, brushReplacesBgWithFg, seg, writeBrickSize, beforeSegWrite );
+
+    if ( ! box )
     {
-        std::tie( voxelsToChange, minVoxel, maxVoxel ) = paintBrush2d(
-                    voxelViewPlane, seg->header().pixelDimensions(),
-                    roundedPixelPos, mmToVoxelSpacings,
-                    brushSizeInVoxels, brushIsRound );
+        return std::nullopt;
     }
 
-    updateSeg( voxelsToChange, minVoxel, maxVoxel,
-               labelToPaint, labelToReplace, brushReplacesBgWithFg,
-               seg, updateSegTexture );
+    return std::make_pair( glm::uvec3{ box->first }, glm::uvec3{ box->second - box->first + sk_voxelOne } );
 }
 
 
 /// @todo Implement algorithm for filling smoothed polygons.
-void fillSegmentationWithPolygon(
+std::optional< std::pair< glm::uvec3, glm::uvec3 > > fillSegmentationWithPolygon(
         Image* seg,
         const Annotation* annot,
 
@@ -408,155 +399,285 @@ void fillSegmentationWithPolygon(
         int64_t labelToReplace,
         bool brushReplacesBgWithFg,
 
-        const std::function< void (
-            const ComponentType& memoryComponentType, const glm::uvec3& offset,
-            const glm::uvec3& size, const int64_t* data ) >& updateSegTexture )
+        uint32_t writeBrickSize,
+        const BricksWriteCallback& beforeSegWrite )
 {
+    static const glm::ivec3 sk_voxelOne{ 1, 1, 1 };
     static constexpr size_t OUTER_BOUNDARY = 0;
 
     // Fill based on corners of voxels?
-    // If true, then the test for whether a voxel is in the polygon is based only the voxel center.
-    // If false, then the test is based on all voxel corners.
+    // If true, then a voxel is filled if the polygon overlaps its extent in the annotation plane.
+    // If false, then a voxel is filled only if its center is in the polygon.
     /// @todo Make this a setting
     static constexpr bool sk_fillBasedOnCorners = true;
 
     if ( ! annot->isClosed() || annot->isSmoothed() )
     {
         spdlog::warn( "Cannot fill annotation polygon that is not closed and not smoothed." );
-        return;
+        return std::nullopt;
     }
 
     const glm::mat4& pixel_T_subject = seg->transformations().pixel_T_subject();
-    const glm::mat4& subject_T_pixel = seg->transformations().subject_T_pixel();
 
     // Convert from space of the annotation plane to segmentation pixel coordinates
-    auto convertPointFromAnnotPlaneToRoundedSegPixelCoords =
+    auto convertPointFromAnnotPlaneToSegPixelCoords =
             [&pixel_T_subject, &annot] ( const glm::vec2& annotPlanePos )
     {
         const glm::vec4 subjectPos{ annot->unprojectFromAnnotationPlaneToSubjectPoint( annotPlanePos ), 1.0f };
         const glm::vec4 pixelPos = pixel_T_subject * subjectPos;
-        return glm::ivec3{ glm::round( glm::vec3{ pixelPos / pixelPos.w } ) };
+        return glm::vec3{ pixelPos / pixelPos.w };
     };
 
-    // Convert from segmentation pixel coordinates to the space of the annotation plane
-    auto convertPointFromSegPixelCoordsToAnnotPlane =
-            [&subject_T_pixel, &annot] ( const glm::vec3& pixelPos )
-    {
-        const glm::vec4 subjectPos = subject_T_pixel * glm::vec4{ pixelPos, 1.0f };
-        return annot->projectSubjectPointToAnnotationPlane( glm::vec3{ subjectPos / subjectPos.w } );
-    };
 
+   if ( 0 == annot->numBoundaries() ) return std::nullopt;
 
-   // Min and max corners of the polygon AABB in annotation plane space:
-   const auto aabb = annot->polygon().getAABBox();
-   if ( ! aabb ) return;
+   const std::vector<glm::vec2>& outerVertices = annot->getBoundaryVertices( OUTER_BOUNDARY );
+   if ( outerVertices.empty() ) return std::nullopt;
 
-   const glm::vec2 annotPlaneAabbMinCorner = aabb->first;
-   const glm::vec2 annotPlaneAabbMaxCorner = aabb->second;
 
-   const glm::ivec3 pixelAabbMinCorner =
-           convertPointFromAnnotPlaneToRoundedSegPixelCoords( annotPlaneAabbMinCorner );
+   // Subject plane normal vector transformed into Voxel space:
+   const glm::vec3 pixelAnnotPlaneNormal = glm::normalize(
+               glm::inverseTranspose( glm::mat3( pixel_T_subject ) ) *
+               glm::vec3{ annot->getSubjectPlaneEquation() } );
 
-   const glm::ivec3 pixelAabbMaxCorner =
-           convertPointFromAnnotPlaneToRoundedSegPixelCoords( annotPlaneAabbMaxCorner );
+   // Annotation plane in Pixel space, through the first vertex:
+   const glm::vec4 pixelPlaneEquation = math::makePlane(
+               pixelAnnotPlaneNormal,
+               convertPointFromAnnotPlaneToSegPixelCoords( outerVertices.front() ) );
 
 
-   // Polygon vertices in the space of the annotation plane
-   const std::vector<glm::vec2>& annotPlaneVertices = annot->getBoundaryVertices( OUTER_BOUNDARY );
-   if ( annotPlaneVertices.empty() ) return;
+   // The polygon is rasterized over the columns of voxels along the axis that is most normal to the
+   // annotation plane. The plane crosses each (a, b) column once, so the columns form a 2D grid onto
+   // which the polygon projects without degeneracy. Each column is tested once against the polygon,
+   // and only those voxels of the column that intersect the plane are filled.
+   const glm::dvec3 normal{ pixelPlaneEquation };
+   const double offset = static_cast<double>( pixelPlaneEquation.w );
+   const glm::dvec3 absNormal = glm::abs( normal );
 
+   const int dAxis = ( absNormal.x >= absNormal.y && absNormal.x >= absNormal.z )
+           ? 0 : ( ( absNormal.y >= absNormal.z ) ? 1 : 2 );
+   const int aAxis = ( 0 == dAxis ) ? 1 : 0;
+   const int bAxis = 3 - dAxis - aAxis;
 
-   // Subject plane normal vector transformed into Voxel space:
-   const glm::vec3 pixelAnnotPlaneNormal = glm::normalize(
-               glm::inverseTranspose( glm::mat3( pixel_T_subject ) ) *
-               glm::vec3{ annot->getSubjectPlaneEquation() } );
+   // A voxel intersects the plane iff the distance from its center to the plane is at most this
+   const double halfThickness = 0.5 * ( absNormal.x + absNormal.y + absNormal.z );
 
-   // First vertex in Subject space, then in Pixel space:
-   const glm::vec3 subjectAnnotPlanePoint =
-           annot->unprojectFromAnnotationPlaneToSubjectPoint( annotPlaneVertices.front() );
+   const glm::ivec3 segDims{ seg->header().pixelDimensions() };
 
-   const glm::vec4 pixelAnnotPlanePoint =
-           pixel_T_subject * glm::vec4{ subjectAnnotPlanePoint, 1.0f };
+   // Polygon edges of all boundaries (the outer boundary and its holes) in column coordinates,
+   // sorted by their min b coordinate to form the edge table
+   std::vector<FillEdge> edges;
 
-   // Annotation plane in Pixel space:
-   const glm::vec4 pixelPlaneEquation = math::makePlane(
-               pixelAnnotPlaneNormal,
-               glm::vec3{ pixelAnnotPlanePoint / pixelAnnotPlanePoint.w } );
+   glm::dvec2 columnMin{ std::numeric_limits<double>::max() };
+   glm::dvec2 columnMax{ std::numeric_limits<double>::lowest() };
 
+   std::vector<glm::dvec2> columnVertices;
+
+   for ( size_t boundary = 0; boundary < annot->numBoundaries(); ++boundary )
+   {
+       columnVertices.clear();
+
+       for ( const glm::vec2& annotPlaneVertex : annot->getBoundaryVertices( boundary ) )
+       {
+           const glm::vec3 pixelPos = convertPointFromAnnotPlaneToSegPixelCoords( annotPlaneVertex );
+           columnVertices.emplace_back( pixelPos[aAxis], pixelPos[bAxis] );
+
+           columnMin = glm::min( columnMin, columnVertices.back() );
+           columnMax = glm::max( columnMax, columnVertices.back() );
+       }
 
-   // Loop over the AABB in Pixel/Voxel space. Note that this is inefficient and tests
-   // too many voxels when the annotation plane is oblique in Voxel space.
+       for ( size_t i = 0; i < columnVertices.size(); ++i )
+       {
+           const glm::dvec2& p0 = columnVertices[i];
+           const glm::dvec2& p1 = columnVertices[( i + 1 ) % columnVertices.size()];
 
-   const int minK = std::min( pixelAabbMinCorner.z, pixelAabbMaxCorner.z ) - 1;
-   const int maxK = std::max( pixelAabbMinCorner.z, pixelAabbMaxCorner.z ) + 1;
+           // Edges along a scanline are never crossed
+           if ( p0.y < p1.y ) { edges.push_back( { p0, p1 } ); }
+           else if ( p1.y < p0.y ) { edges.push_back( { p1, p0 } ); }
+       }
+   }
 
-   const int minJ = std::min( pixelAabbMinCorner.y, pixelAabbMaxCorner.y ) - 1;
-   const int maxJ = std::max( pixelAabbMinCorner.y, pixelAabbMaxCorner.y ) + 1;
+   if ( edges.empty() ) return std::nullopt;
 
-   const int minI = std::min( pixelAabbMinCorner.x, pixelAabbMaxCorner.x ) - 1;
-   const int maxI = std::max( pixelAabbMinCorner.x, pixelAabbMaxCorner.x ) + 1;
+   std::sort( std::begin( edges ), std::end( edges ),
+              [] ( const FillEdge& e1, const FillEdge& e2 ) { return e1.m_p0.y < e2.m_p0.y; } );
 
+   // With corner filling, a column is filled if the polygon overlaps its extent, as sampled by scanlines
+   // along the center and both sides of its row. Otherwise, it is filled if its center is in the polygon.
+   static const std::array<double, 3> sk_scanlineOffsets{ { 0.0, -0.5, 0.5 } };
+   const size_t numScanlines = sk_fillBasedOnCorners ? 3 : 1;
+   const double pad = sk_fillBasedOnCorners ? 0.5 : 0.0;
 
-   // Set of unique voxels to change:
-   std::unordered_set< glm::ivec3 > voxelsToChange;
+   const int aMin = std::max( static_cast<int>( std::floor( columnMin.x - pad ) ), 0 );
+   const int aMax = std::min( static_cast<int>( std::ceil( columnMax.x + pad ) ), segDims[aAxis] - 1 );
+   const int bMin = std::max( static_cast<int>( std::floor( columnMin.y - pad ) ), 0 );
+   const int bMax = std::min( static_cast<int>( std::ceil( columnMax.y + pad ) ), segDims[bAxis] - 1 );
 
-   const glm::ivec3 segDims{ seg->header().pixelDimensions() };
+   if ( aMin > aMax || bMin > bMax ) return std::nullopt;
 
-   for ( int k = minK; k <= maxK; ++k )
+   // Voxel at position c along the normal axis of column (a, b)
+   auto columnVoxel = [aAxis, bAxis, dAxis] ( int a, int b, int c )
+   {
+       glm::ivec3 v;
+       v[aAxis] = a;
+       v[bAxis] = b;
+       v[dAxis] = c;
+       return v;
+   };
+
+   // Append the runs of voxels that intersect the plane in columns [aLo, aHi] of row b
+   auto addColumnRuns = [&] ( int aLo, int aHi, int b, std::vector<BrushStencil::Run>& runs )
    {
-       for ( int j = minJ; j <= maxJ; ++j )
+       const double rowOffset = normal[bAxis] * b + offset;
+
+       if ( 0 == dAxis )
        {
-           for ( int i = minI; i <= maxI; ++i )
+           // The columns lie along segmentation rows, so each column is one run
+           for ( int a = aLo; a <= aHi; ++a )
            {
-               const glm::ivec3 roundedPixelPos{ i, j, k };
-               const glm::vec3 pixelPos{ roundedPixelPos };
-
-               if ( ! isVoxelInSeg( segDims, roundedPixelPos ) ) continue;
-
-               // Does the voxel intersect the annotation plane?
-               // This check is needed when the annotation plane is oblique in Pixel space
-               // due to our inefficient algorithm.
-               if ( ! voxelInterectsPlane( pixelPlaneEquation, pixelPos ) ) continue;
-
-               const glm::vec2 annotPlanePos = convertPointFromSegPixelCoordsToAnnotPlane( pixelPos );
-
-               if ( math::pnpoly( annotPlaneVertices, annotPlanePos ) ||
-                    ( sk_fillBasedOnCorners &&
-                      ( math::pnpoly( annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(
-                                          pixelPos + glm::vec3{ 0.5f, 0.5f, 0.5f } ) ) ||
-                        math::pnpoly( annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(
-                                          pixelPos + glm::vec3{ 0.5f, 0.5f, -0.5f } ) ) ||
-                        math::pnpoly( annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(
-                                          pixelPos + glm::vec3{ 0.5f, -0.5f, 0.5f } ) ) ||
-                        math::pnpoly( annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(
-                                          pixelPos + glm::vec3{ 0.5f, -0.5f, -0.5f } ) ) ||
-                        math::pnpoly( annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(
-                                          pixelPos + glm::vec3{ -0.5f, 0.5f, 0.5f } ) ) ||
-                        math::pnpoly( annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(
-                                          pixelPos + glm::vec3{ -0.5f, 0.5f, -0.5f } ) ) ||
-                        math::pnpoly( annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(
-                                          pixelPos + glm::vec3{ -0.5f, -0.5f, 0.5f } ) ) ||
-                        math::pnpoly( annotPlaneVertices, convertPointFromSegPixelCoordsToAnnotPlane(
-                                          pixelPos + glm::vec3{ -0.5f, -0.5f, -0.5f } ) ) ) ) )
+               const auto c = slabRange( normal[dAxis], normal[aAxis] * a + rowOffset, halfThickness );
+               const int cLo = std::max( c.first, 0 );
+               const int cHi = std::min( c.second, segDims[dAxis] - 1 );
+
+               if ( cLo <= cHi ) { runs.push_back( { columnVoxel( a, b, cLo ), cHi - cLo + 1 } ); }
+           }
+           return;
+       }
+
+       // The a axis is the row axis. The bounds of the plane voxels of a column are linear in a,
+       // so for each position c along the normal axis, the voxels that intersect the plane form one run.
+       const auto cStart = slabRange( normal[dAxis], normal[aAxis] * aLo + rowOffset, halfThickness );
+       const auto cEnd = slabRange( normal[dAxis], normal[aAxis] * aHi + rowOffset, halfThickness );
+
+       const int cLo = std::max( std::min( cStart.first, cEnd.first ), 0 );
+       const int cHi = std::min( std::max( cStart.second, cEnd.second ), segDims[dAxis] - 1 );
+
+       for ( int c = cLo; c <= cHi; ++c )
+       {
+           const auto a = slabRange( normal[aAxis], normal[dAxis] * c + rowOffset, halfThickness );
+           const int runLo = std::max( a.first, aLo );
+           const int runHi = std::min( a.second, aHi );
+
+           if ( runLo <= runHi ) { runs.push_back( { columnVoxel( runLo, b, c ), runHi - runLo + 1 } ); }
+       }
+   };
+
+
+   // Rows are rasterized in parallel, each thread into its own runs
+   const size_t numRows = static_cast<size_t>( bMax - bMin + 1 );
+   const size_t numThreads = ThreadPool::defaultNumThreads( numRows / sk_fillMinRowsPerThread );
+   const size_t rowsPerThread = ( numRows + numThreads - 1 ) / numThreads;
+
+   std::vector< std::vector<BrushStencil::Run> > threadRuns( numThreads );
+
+   auto rasterizeRows = [&] ( size_t t )
+   {
+       const int rowBegin = bMin + static_cast<int>( t * rowsPerThread );
+       const int rowEnd = std::min( rowBegin + static_cast<int>( rowsPerThread ) - 1, bMax );
+
+       // Edges of the edge table that can cross the scanlines of these rows
+       std::vector<FillEdge> rowEdges;
+
+       for ( const FillEdge& edge : edges )
+       {
+           if ( edge.m_p0.y > rowEnd + pad ) break;
+           if ( edge.m_p1.y >= rowBegin - pad ) { rowEdges.push_back( edge ); }
+       }
+
+       std::vector<double> crossings;
+       std::vector< std::pair<double, double> > spans;
+       std::vector< std::pair<int, int> > columns;
+
+       for ( int b = rowBegin; b <= rowEnd; ++b )
+       {
+           spans.clear();
+
+           for ( size_t s = 0; s < numScanlines; ++s )
+           {
+               appendScanlineSpans( rowEdges, b + sk_scanlineOffsets[s], crossings, spans );
+           }
+
+           // Ranges of columns that overlap the spans, merged so that no column is filled twice
+           columns.clear();
+
+           for ( const auto& span : spans )
+           {
+               const int lo = std::max( static_cast<int>( std::ceil( span.first - pad ) ), aMin );
+               const int hi = std::min( static_cast<int>( std::floor( span.second + pad ) ), aMax );
+               if ( lo <= hi ) { columns.emplace_back( lo, hi ); }
+           }
+
+           std::sort( std::begin( columns ), std::end( columns ) );
+
+           for ( size_t i = 0; i < columns.size(); )
+           {
+               int hi = columns[i].second;
+               size_t j = i + 1;
+
+               for ( ; j < columns.size() && columns[j].first <= hi + 1; ++j )
                {
-                   voxelsToChange.insert( roundedPixelPos );
-                   continue;
+                   hi = std::max( hi, columns[j].second );
                }
+
+               addColumnRuns( columns[i].first, hi, b, threadRuns[t] );
+               i = j;
            }
        }
+   };
+
+   if ( 1 == numThreads )
+   {
+       rasterizeRows( 0 );
+   }
+   else
+   {
+       ThreadPool pool( numThreads );
+       std::vector< std::future<void> > futures;
+
+       for ( size_t t = 0; t < numThreads; ++t )
+       {
+           futures.emplace_back( pool.submit( [&rasterizeRows, t] () { rasterizeRows( t ); } ) );
+       }
+
+       for ( auto& f : futures )
+       {
+           f.get();
+       }
+   }
+
+
+   // Voxels to change, as runs along rows in segmentation voxel coordinates
+   BrushStencil voxelsToChange;
+
+   for ( const auto& runs : threadRuns )
+   {
+       voxelsToChange.m_runs.insert( std::end( voxelsToChange.m_runs ), std::begin( runs ), std::end( runs ) );
    }
 
-   // Min/max corners of the set of voxels to change
-   glm::ivec3 maxVoxel{ std::numeric_limits<int>::lowest() };
-   glm::ivec3 minVoxel{ std::numeric_limits<int>::max() };
+   std::sort( std::begin( voxelsToChange.m_runs ), std::end( voxelsToChange.m_runs ),
+              [] ( const BrushStencil::Run& r1, const BrushStencil::Run& r2 )
+   {
+       return std::tie( r1.m_start.z, r1.m_start.y, r1.m_start.x ) <
+               std::tie( r2.m_start.z, r2.m_start.y, r2.m_start.x );
+   } );
+
+   for ( const BrushStencil::Run& run : voxelsToChange.m_runs )
+   {
+       voxelsToChange.m_numVoxels += static_cast<size_t>( run.m_length );
+   }
+
+   spdlog::debug( "Filling annotation polygon of {} edges into {} voxels in {} rows",
+                  edges.size(), voxelsToChange.m_numVoxels, numRows );
+
+   // The runs are in segmentation voxel coordinates, so the stencil is centered at the origin
+   const auto box = stampStencils(
+               { { std::make_shared<const BrushStencil>( std::move( voxelsToChange ) ), glm::ivec3{ 0 } } },
+               labelToPaint, labelToReplace, brushReplacesBgWithFg, seg, writeBrickSize, beforeSegWrite );
 
-   for ( const auto& p : voxelsToChange )
+   if ( ! box )
    {
-       minVoxel = glm::min( minVoxel, p );
-       maxVoxel = glm::max( maxVoxel, p );
+       return std::nullopt;
    }
 
-   updateSeg( voxelsToChange, minVoxel, maxVoxel,
-              labelToPaint, labelToReplace, brushReplacesBgWithFg,
-              seg, updateSegTexture );
+   return std::make_pair( glm::uvec3{ box->first }, glm::uvec3{ box->second - box->first + sk_voxelOne } );
 }
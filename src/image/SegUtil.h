@@ -6,29 +6,48 @@
 #include <uuid.h>
 
 #include <glm/fwd.hpp>
+#include <glm/vec3.hpp>
 
 #include <functional>
 #include <optional>
+#include <utility>
+#include <vector>
 
 class Annotation;
 class Image;
 
 
+/// Callback with the bricks of a segmentation that are about to be written, as the 3D indices of
+/// bricks in a grid of cubic bricks of the size that is given with the callback
+using BricksWriteCallback = std::function< void ( const std::vector<glm::uvec3>& bricks ) >;
+
+
 /**
- * @brief paintSegmentation
- * @param seg
- * @param labelToPaint
- * @param labelToReplace
- * @param brushReplacesBgWithFg
- * @param brushIsRound
- * @param brushIs3d
- * @param brushIsIsotropic
- * @param brushSizeInVoxels
- * @param roundedPixelPos
- * @param voxelViewPlane
- * @param updateSegTexture
+ * @brief Paint a segment of a brush stroke into a segmentation. The brush is swept from the start
+ * to the end position by stamping it at every voxel step along the segment. Only the end position
+ * is painted if the start and end positions are in the same voxel, as at the start of a stroke.
+ * The segmentation texture is not updated, so that the blocks painted by a stroke can be merged
+ * and uploaded once per rendered frame.
+ *
+ * @param seg Segmentation to paint
+ * @param labelToPaint Label painted by the brush
+ * @param labelToReplace Label replaced by the brush, if brushReplacesBgWithFg is true
+ * @param brushReplacesBgWithFg Does the brush only replace labelToReplace?
+ * @param brushIsRound Is the brush round (true) or square (false)?
+ * @param brushIs3d Is the brush 3D (true) or 2D in the view plane (false)?
+ * @param brushIsIsotropic Is the brush isotropic in physical space (true) or in voxel space (false)?
+ * @param brushSizeInVoxels Brush width in voxels
+ * @param startPixelPos Start of the stroke segment in segmentation Pixel space
+ * @param endPixelPos End of the stroke segment in segmentation Pixel space
+ * @param voxelViewPlane View plane in segmentation Voxel space
+ * @param writeBrickSize Side length in voxels of the bricks that are passed to beforeSegWrite
+ * @param beforeSegWrite Called with the bricks that contain the voxels about to be painted, before
+ * they are written (e.g. to record them in the undo history)
+ *
+ * @return Offset and size of the block of voxels that the stroke segment covers;
+ * none if it covers no voxel of the segmentation
  */
-void paintSegmentation(
+std::optional< std::pair< glm::uvec3, glm::uvec3 > > paintSegmentation(
         Image* seg,
 
         int64_t labelToPaint,
@@ -40,15 +59,29 @@ void paintSegmentation(
         bool brushIsIsotropic,
         int brushSizeInVoxels,
 
-        const glm::ivec3& roundedPixelPos,
+        const glm::vec3& startPixelPos,
+        const glm::vec3& endPixelPos,
         const glm::vec4& voxelViewPlane,
 
-        const std::function< void (
-            const ComponentType& memoryComponentType, const glm::uvec3& offset,
-            const glm::uvec3& size, const int64_t* data ) >& updateSegTexture );
+        uint32_t writeBrickSize,
+        const BricksWriteCallback& beforeSegWrite );
 
 
-void fillSegmentationWithPolygon(
+/**
+ * @brief Fill a closed annotation polygon into a segmentation, in the plane of the annotation.
+ * The segmentation texture is not updated.
+ *
+ * The polygon is scanline rasterized over the columns of voxels along the segmentation axis that is
+ * most normal to the plane, so that only the voxels that intersect the plane are visited. Holes of
+ * the polygon are not filled. Rows are rasterized in parallel.
+ *
+ * @param writeBrickSize Side length in voxels of the bricks that are passed to beforeSegWrite
+ * @param beforeSegWrite Called with the bricks that contain the voxels about to be filled, before
+ * they are written
+ *
+ * @return Offset and size of the block of voxels that the fill covers; none if it covers no voxel
+ */
+std::optional< std::pair< glm::uvec3, glm::uvec3 > > fillSegmentationWithPolygon(
         Image* seg,
         const Annotation* annot,
 
@@ -56,8 +89,7 @@ void fillSegmentationWithPolygon(
         int64_t labelToReplace,
         bool brushReplacesBgWithFg,
 
-        const std::function< void (
-            const ComponentType& memoryComponentType, const glm::uvec3& offset,
-            const glm::uvec3& size, const int64_t* data ) >& updateSegTexture );
+        uint32_t writeBrickSize,
+        const BricksWriteCallback& beforeSegWrite );
 
 #endif // SEG_UTILITY_H
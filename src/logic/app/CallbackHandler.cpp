@@ -8,6 +8,8 @@
 
 #include "logic/annotation/AnnotPolygon.tpp"
 #include "logic/app/Data.h"
+#include "logic/app/SegHistory.h"
+#include "logic/app/SegJournal.h"
 #include "logic/camera/CameraHelpers.h"
 #include "logic/camera/MathUtility.h"
 #include "logic/states/FsmList.hpp"
@@ -30,6 +32,8 @@
 
 #include <chrono>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 
 namespace
@@ -42,49 +46,58 @@ static constexpr float sk_parallelThreshold_degrees = 0.1f;
 
 static constexpr float sk_imageFrontBackTranslationScaleFactor = 10.0f;
 
+// Maximum distance (in voxels) of the previous hit of a brush stroke from the current view plane,
+// for the stroke to be continued from the previous hit
+static constexpr float sk_strokePlaneTolerance = 0.5f;
+
 }
 
 
 CallbackHandler::CallbackHandler(
         AppData& appData,
         GlfwWrapper& glfwWrapper,
-        Rendering& rendering )
+        Rendering& rendering,
+        SegJournal& segJournal,
+        SegHistory& segHistory )
     :
       m_appData( appData ),
       m_glfw( glfwWrapper ),
-      m_rendering( rendering )
+      m_rendering( rendering ),
+      m_segJournal( segJournal ),
+      m_segHistory( segHistory )
 {
 }
 
 
 bool CallbackHandler::clearSegVoxels( const uuids::uuid& segUid )
 {
-    static constexpr int64_t ZERO_VAL = 0;
+    static constexpr uint32_t sk_comp0 = 0;
 
     Image* seg = m_appData.seg( segUid );
     if ( ! seg ) return false;
 
-    const glm::ivec3 dataSizeInt{ seg->header().pixelDimensions() };
+    const ComponentType compType = seg->header().memoryComponentType();
 
-    for ( int k = 0; k < dataSizeInt.z; ++k )
+    m_segHistory.beginOperation( "Clear segmentation" );
+    m_segHistory.recordWrite( segUid, glm::uvec3{ 0 }, glm::uvec3{ seg->header().pixelDimensions() } );
+
+    // Clear the segmentation and its texture block by block, so that a bricked segmentation
+    // is never resident in full
+    const bool cleared = seg->visitBlocks( sk_comp0, [this, &segUid, &compType] ( const auto& view, const glm::uvec3& dataOffset )
     {
-        for ( int j = 0; j < dataSizeInt.y; ++j )
-        {
-            for ( int i = 0; i < dataSizeInt.x; ++i )
-            {
-                seg->setValue( 0, i, j, k, ZERO_VAL );
-            }
-        }
-    }
+        using T = typename std::decay_t<decltype( view )>::ValueType;
 
-    const glm::uvec3 dataOffset = glm::uvec3{ 0 };
-    const glm::uvec3 dataSize = glm::uvec3{ seg->header().pixelDimensions() };
+        view.forEachVoxel( [] ( T& value, uint32_t, uint32_t, uint32_t )
+        {
+            value = static_cast<T>( 0 );
+        } );
 
-    m_rendering.updateSegTexture(
-                segUid, seg->header().memoryComponentType(),
-                dataOffset, dataSize, seg->bufferAsVoid( 0 ) );
+        m_rendering.updateSegTexture( segUid, compType, dataOffset, view.dims(), view.row( 0, 0 ) );
+        m_segJournal.markDirty( segUid, dataOffset, view.dims() );
+    } );
 
-    return true;
+    m_segHistory.endOperation();
+    return cleared;
 }
 
 
@@ -127,10 +140,25 @@ bool CallbackHandler::executeGridCutSegmentation(
         return false;
     }
 
+    if ( image->isBricked() || seedSeg->isBricked() || resultSeg->isBricked() )
+    {
+        spdlog::error( "GridCuts cannot segment image {}, since it or its segmentations "
+                       "are too large to be held in memory", imageUid );
+        return false;
+    }
+
     spdlog::debug( "Executing GridCuts on image {} with seeds {}", imageUid, seedSegUid );
 
     const glm::ivec3 pixelDims{ image->header().pixelDimensions() };
 
+    if ( glm::ivec3{ seedSeg->header().pixelDimensions() } != pixelDims ||
+         glm::ivec3{ resultSeg->header().pixelDimensions() } != pixelDims )
+    {
+        spdlog::error( "Dimensions of seed segmentation {} and result segmentation {} "
+                       "do not match those of image {}", seedSegUid, resultSegUid, imageUid );
+        return false;
+    }
+
     spdlog::debug( "Start creating grid" );
     auto grid = std::make_unique<Grid>( pixelDims.x, pixelDims.y, pixelDims.z );
     spdlog::debug( "Done creating grid" );
@@ -141,63 +169,70 @@ bool CallbackHandler::executeGridCutSegmentation(
         return false;
     }
 
-    /// @todo Speed up filling by accessing raw array
-
     spdlog::debug( "Start filling grid" );
-    for ( int z = 0; z < pixelDims.z; ++z )
+
+    // Terminal capacities from the seeds: label 2 is the source and label 1 is the sink
+    seedSeg->visit( 0, [&grid] ( const auto& view )
     {
-        for ( int y = 0; y < pixelDims.y; ++y )
+        using T = typename std::decay_t<decltype( view )>::ValueType;
+
+        view.forEachVoxel( [&grid] ( T& value, uint32_t x, uint32_t y, uint32_t z )
+        {
+            const int64_t seed = static_cast<int64_t>( value );
+
+            grid->set_terminal_cap( grid->node_id( static_cast<int>( x ), static_cast<int>( y ), static_cast<int>( z ) ),
+                                    ( seed == 2 ) ? K : 0,
+                                    ( seed == 1 ) ? K : 0 );
+        } );
+    } );
+
+    // Differences of quantized values in memory are scaled to differences of image values
+    const double valueSlope = image->header().quantization() ? image->header().quantization()->m_slope : 1.0;
+
+    // Neighbor capacities from the image intensity differences along rows, columns, and slices
+    image->visit( 0, [&grid, &weight, &pixelDims, valueSlope] ( const auto& view )
+    {
+        using T = typename std::decay_t<decltype( view )>::ValueType;
+
+        const size_t stride = view.pixelStride();
+
+        view.forEachRow( [&] ( T* row, uint32_t j, uint32_t k )
         {
+            const int y = static_cast<int>( j );
+            const int z = static_cast<int>( k );
+
+            const T* nextRow = ( y < pixelDims.y - 1 ) ? view.row( j + 1, k ) : nullptr;
+            const T* nextSliceRow = ( z < pixelDims.z - 1 ) ? view.row( j, k + 1 ) : nullptr;
+
             for ( int x = 0; x < pixelDims.x; ++x )
             {
-                const std::optional<int64_t> optSeed = seedSeg->valueAsInt64( 0, x, y, z );
-                const int64_t seed = ( optSeed ) ? *optSeed : 0;
-
-                grid->set_terminal_cap( grid->node_id( x, y, z ),
-                                        ( seed == 2 ) ? K : 0,
-                                        ( seed == 1 ) ? K : 0 );
+                const double value = static_cast<double>( row[x * stride] );
+                const int node = grid->node_id( x, y, z );
 
                 if ( x < pixelDims.x - 1 )
                 {
-                    const auto optValueX0 = image->valueAsDouble( 0, x, y, z );
-                    const auto optValueX1 = image->valueAsDouble( 0, x + 1, y, z );
-
-                    const double valueX0 = ( optValueX0 ) ? *optValueX0 : 0.0;
-                    const double valueX1 = ( optValueX1 ) ? *optValueX1 : 0.0;
-
-                    const short cap = weight( valueX0 - valueX1 );
-                    grid->set_neighbor_cap( grid->node_id( x, y, z ), +1, 0, 0, cap );
+                    const short cap = weight( valueSlope * ( value - static_cast<double>( row[( x + 1 ) * stride] ) ) );
+                    grid->set_neighbor_cap( node, +1, 0, 0, cap );
                     grid->set_neighbor_cap( grid->node_id( x + 1, y, z ), -1, 0, 0, cap );
                 }
 
-                if ( y < pixelDims.y - 1 )
+                if ( nextRow )
                 {
-                    const auto optValueY0 = image->valueAsDouble( 0, x, y, z );
-                    const auto optValueY1 = image->valueAsDouble( 0, x, y + 1, z );
-
-                    const double valueY0 = ( optValueY0 ) ? *optValueY0 : 0.0;
-                    const double valueY1 = ( optValueY1 ) ? *optValueY1 : 0.0;
-
-                    const short cap = weight( valueY0 - valueY1 );
-                    grid->set_neighbor_cap( grid->node_id( x, y, z ), 0, +1, 0, cap );
+                    const short cap = weight( valueSlope * ( value - static_cast<double>( nextRow[x * stride] ) ) );
+                    grid->set_neighbor_cap( node, 0, +1, 0, cap );
                     grid->set_neighbor_cap( grid->node_id( x, y + 1, z ), 0, -1, 0, cap );
                 }
 
-                if ( z < pixelDims.z - 1 )
+                if ( nextSliceRow )
                 {
-                    const auto optValueZ0 = image->valueAsDouble( 0, x, y, z );
-                    const auto optValueZ1 = image->valueAsDouble( 0, x, y, z + 1 );
-
-                    const double valueZ0 = ( optValueZ0 ) ? *optValueZ0 : 0.0;
-                    const double valueZ1 = ( optValueZ1 ) ? *optValueZ1 : 0.0;
-
-                    const short cap = weight( valueZ0 - valueZ1 );
-                    grid->set_neighbor_cap( grid->node_id( x, y, z ), 0, 0, +1, cap );
+                    const short cap = weight( valueSlope * ( value - static_cast<double>( nextSliceRow[x * stride] ) ) );
+                    grid->set_neighbor_cap( node, 0, 0, +1, cap );
                     grid->set_neighbor_cap( grid->node_id( x, y, z + 1 ), 0, 0, -1, cap );
                 }
             }
-        }
-    }
+        } );
+    } );
+
     spdlog::debug( "Done filling grid" );
 
     spdlog::debug( "Start computing max flow" );
@@ -212,19 +247,21 @@ bool CallbackHandler::executeGridCutSegmentation(
     spdlog::debug( "GridCuts execution time: {} us", duration.count() );
 
     spdlog::debug( "Start reading back segmentation results" );
-    for ( int z = 0; z < pixelDims.z; ++z )
+
+    m_segHistory.beginOperation( "GridCuts" );
+    m_segHistory.recordWrite( resultSegUid, glm::uvec3{ 0 }, glm::uvec3{ resultSeg->header().pixelDimensions() } );
+
+    resultSeg->visit( 0, [&grid] ( const auto& view )
     {
-        for ( int y = 0; y < pixelDims.y; ++y )
+        using T = typename std::decay_t<decltype( view )>::ValueType;
+
+        view.forEachVoxel( [&grid] ( T& value, uint32_t x, uint32_t y, uint32_t z )
         {
-            for ( int x = 0; x < pixelDims.x; ++x )
-            {
-                const int64_t seg = static_cast<int64_t>(
-                            grid->get_segment( grid->node_id( x, y, z) ) ? 1 : 0 );
+            const int node = grid->node_id( static_cast<int>( x ), static_cast<int>( y ), static_cast<int>( z ) );
+            value = static_cast<T>( grid->get_segment( node ) ? 1 : 0 );
+        } );
+    } );
 
-                resultSeg->setValue( 0, x, y, z, seg );
-            }
-        }
-    }
     spdlog::debug( "Done reading back segmentation results" );
 
     const glm::uvec3 dataOffset = glm::uvec3{ 0 };
@@ -237,6 +274,9 @@ bool CallbackHandler::executeGridCutSegmentation(
                 dataOffset, dataSize,
                 resultSeg->bufferAsVoid( 0 ) );
 
+    m_segJournal.markDirty( resultSegUid, dataOffset, dataSize );
+    m_segHistory.endOperation();
+
     spdlog::debug( "Done updating segmentation texture" );
 
     return true;
@@ -338,7 +378,7 @@ void CallbackHandler::doCrosshairsScroll(
     m_appData.state().setWorldCrosshairsPos( glm::vec3{ worldPos } );
 }
 
-void CallbackHandler::doSegment( const ViewHit& hit, bool swapFgAndBg )
+void CallbackHandler::doSegment( const ViewHit& prevHit, const ViewHit& hit, bool swapFgAndBg )
 {
     static const glm::ivec3 sk_voxelZero{ 0, 0, 0 };
 
@@ -395,6 +435,12 @@ void CallbackHandler::doSegment( const ViewHit& hit, bool swapFgAndBg )
 
     const AppSettings& settings = m_appData.settings();
 
+    // The stroke is one step of the undo history, which ends when the mouse button is released
+    if ( ! m_segHistory.inOperation() )
+    {
+        m_segHistory.beginOperation( "Brush stroke" );
+    }
+
     // Paint on each segmentation
     for ( const auto& segUid : segUids )
     {
@@ -423,22 +469,82 @@ void CallbackHandler::doSegment( const ViewHit& hit, bool swapFgAndBg )
         // View plane equation:
         const glm::vec4 voxelViewPlane = math::makePlane( voxelViewPlaneNormal, pixelPos3 );
 
-        auto updateSegTexture = [this, &segUid]
-                ( const ComponentType& memoryComponentType, const glm::uvec3& dataOffset,
-                  const glm::uvec3& dataSize, const int64_t* data )
+        // The stroke is continued from the previous hit if it is in the same view and plane.
+        // Otherwise, the stroke starts again at the current hit.
+        const glm::vec4 prevPixelPos = pixel_T_worldDef * prevHit.worldPos_offsetApplied;
+        glm::vec3 prevPixelPos3 = prevPixelPos / prevPixelPos.w;
+
+        if ( prevHit.viewUid != hit.viewUid ||
+             std::abs( glm::dot( voxelViewPlane, glm::vec4{ prevPixelPos3, 1.0f } ) ) > sk_strokePlaneTolerance )
         {
-            m_rendering.updateSegTexture( segUid, memoryComponentType, dataOffset, dataSize, data );
-        };
+            prevPixelPos3 = pixelPos3;
+        }
 
-        paintSegmentation(
+        const auto dirtyBlock = paintSegmentation(
                     seg, labelToPaint, labelToReplace,
                     settings.replaceBackgroundWithForeground(),
                     settings.useRoundBrush(), settings.use3dBrush(), settings.useIsotropicBrush(),
-                    brushSize, roundedPixelPos,
-                    voxelViewPlane, updateSegTexture );
+                    brushSize, prevPixelPos3, pixelPos3, voxelViewPlane,
+                    SegHistory::sk_brickSize,
+                    [this, &segUid] ( const std::vector<glm::uvec3>& bricks )
+                    {
+                        m_segHistory.recordWrite( segUid, bricks );
+                    } );
+
+        if ( ! dirtyBlock ) continue;
+
+        // Merge the block into the blocks of the segmentation that are uploaded on the next frame
+        const glm::uvec3 blockMin = dirtyBlock->first;
+        const glm::uvec3 blockMax = dirtyBlock->first + dirtyBlock->second - glm::uvec3{ 1 };
+
+        auto it = m_strokeDirtyBoxes.find( segUid );
+
+        if ( std::end( m_strokeDirtyBoxes ) == it )
+        {
+            m_strokeDirtyBoxes.emplace( segUid, std::make_pair( blockMin, blockMax ) );
+        }
+        else
+        {
+            it->second.first = glm::min( it->second.first, blockMin );
+            it->second.second = glm::max( it->second.second, blockMax );
+        }
     }
 }
 
+void CallbackHandler::flushSegStrokes()
+{
+    static const glm::uvec3 sk_voxelOne{ 1, 1, 1 };
+
+    for ( const auto& dirty : m_strokeDirtyBoxes )
+    {
+        const std::pair< glm::uvec3, glm::uvec3 >& box = dirty.second;
+        updateSegBlock( dirty.first, box.first, box.second - box.first + sk_voxelOne );
+    }
+
+    m_strokeDirtyBoxes.clear();
+}
+
+void CallbackHandler::endSegStroke()
+{
+    m_segHistory.endOperation();
+}
+
+bool CallbackHandler::undoSegEdit()
+{
+    return m_segHistory.undo( [this] ( const uuids::uuid& segUid, const glm::uvec3& offset, const glm::uvec3& size )
+    {
+        updateSegBlock( segUid, offset, size );
+    } );
+}
+
+bool CallbackHandler::redoSegEdit()
+{
+    return m_segHistory.redo( [this] ( const uuids::uuid& segUid, const glm::uvec3& offset, const glm::uvec3& size )
+    {
+        updateSegBlock( segUid, offset, size );
+    } );
+}
+
 void CallbackHandler::paintActiveSegmentationWithAnnotation()
 {
     const auto activeImageUid = m_appData.activeImageUid();
@@ -488,20 +594,26 @@ void CallbackHandler::paintActiveSegmentationWithAnnotation()
         return;
     }
 
-    auto updateSegTexture = [this, &activeSegUid]
-            ( const ComponentType& memoryComponentType, const glm::uvec3& dataOffset,
-              const glm::uvec3& dataSize, const int64_t* data )
+    auto recordSegWrite = [this, &activeSegUid] ( const std::vector<glm::uvec3>& bricks )
     {
-        if ( ! activeSegUid ) return;
-        m_rendering.updateSegTexture( *activeSegUid, memoryComponentType, dataOffset, dataSize, data );
+        m_segHistory.recordWrite( *activeSegUid, bricks );
     };
 
-    fillSegmentationWithPolygon(
+    m_segHistory.beginOperation( "Fill annotation" );
+
+    const auto filledBlock = fillSegmentationWithPolygon(
                 seg, annot,
                 static_cast<int64_t>( m_appData.settings().foregroundLabel() ),
                 static_cast<int64_t>( m_appData.settings().backgroundLabel() ),
                 m_appData.settings().replaceBackgroundWithForeground(),
-                updateSegTexture );
+                SegHistory::sk_brickSize, recordSegWrite );
+
+    m_segHistory.endOperation();
+
+    if ( filledBlock )
+    {
+        updateSegBlock( *activeSegUid, filledBlock->first, filledBlock->second );
+    }
 }
 
 void CallbackHandler::doWindowLevel( const ViewHit& prevHit, const ViewHit& currHit )
@@ -1488,32 +1600,46 @@ void CallbackHandler::moveCrosshairsToSegLabelCentroid(
     const auto activeSegUid = m_appData.imageToActiveSegUid( imageUid );
     if ( ! activeSegUid ) return;
 
-    Image* seg = m_appData.seg( *activeSegUid );
+    const Image* seg = m_appData.seg( *activeSegUid );
     if ( ! seg ) return;
 
-    const glm::ivec3 dataSizeInt{ seg->header().pixelDimensions() };
     const int64_t label = static_cast<int64_t>( labelIndex );
 
-    glm::vec3 coordSum{ 0.0f, 0.0f, 0.0f };
+    glm::dvec3 coordSum{ 0.0, 0.0, 0.0 };
     size_t count = 0;
 
-    for ( int k = 0; k < dataSizeInt.z; ++k )
+    seg->visitBlocks( sk_comp0, [label, &coordSum, &count] ( const auto& view, const glm::uvec3& blockOffset )
     {
-        for ( int j = 0; j < dataSizeInt.y; ++j )
+        using T = typename std::decay_t<decltype( view )>::ValueType;
+
+        const size_t stride = view.pixelStride();
+        const uint32_t sizeX = view.dims().x;
+
+        view.forEachRow( [&] ( T* row, uint32_t j, uint32_t k )
         {
-            for ( int i = 0; i < dataSizeInt.x; ++i )
+            // Sum the column indices of the row separately, since they are all that varies in it
+            double rowSumX = 0.0;
+            size_t rowCount = 0;
+
+            for ( uint32_t i = 0; i < sizeX; ++i )
             {
-                if ( auto value = seg->valueAsInt64( sk_comp0, i, j, k ) )
+                if ( label == static_cast<int64_t>( row[i * stride] ) )
                 {
-                    if ( label == *value )
-                    {
-                        coordSum += glm::vec3{ i, j, k };
-                        ++count;
-                    }
+                    rowSumX += static_cast<double>( blockOffset.x + i );
+                    ++rowCount;
                 }
             }
-        }
-    }
+
+            if ( rowCount > 0 )
+            {
+                const double n = static_cast<double>( rowCount );
+                coordSum += glm::dvec3{ rowSumX,
+                                        n * static_cast<double>( blockOffset.y + j ),
+                                        n * static_cast<double>( blockOffset.z + k ) };
+                count += rowCount;
+            }
+        } );
+    } );
 
     if ( 0 == count )
     {
@@ -1523,7 +1649,7 @@ void CallbackHandler::moveCrosshairsToSegLabelCentroid(
     }
 
     glm::vec4 worldCentroid = seg->transformations().worldDef_T_pixel() *
-            glm::vec4{ coordSum / static_cast<float>( count ), 1.0f };
+            glm::vec4{ glm::vec3{ coordSum / static_cast<double>( count ) }, 1.0f };
 
     glm::vec3 worldPos{ worldCentroid / worldCentroid.w };
 
@@ -1613,3 +1739,44 @@ bool CallbackHandler::checkAndSetActiveView( const uuids::uuid& viewUid )
     m_appData.windowData().setActiveViewUid( viewUid );
     return true;
 }
+
+void CallbackHandler::updateSegBlock(
+        const uuids::uuid& segUid,
+        const glm::uvec3& offset,
+        const glm::uvec3& size )
+{
+    static constexpr uint32_t sk_comp0 = 0;
+
+    const Image* seg = m_appData.seg( segUid );
+    if ( ! seg ) return;
+
+    const ComponentType compType = seg->header().memoryComponentType();
+
+    // The block is uploaded straight from the segmentation buffer, whose row length and image height
+    // are given to the texture upload. (For a bricked segmentation, the view is a dense copy of the block.)
+    seg->visitBlock( sk_comp0, offset, size, [&] ( const auto& view )
+    {
+        using T = std::remove_const_t< typename std::decay_t<decltype( view )>::ValueType >;
+
+        if ( 1 == view.pixelStride() )
+        {
+            m_rendering.updateSegTexture( segUid, compType, offset, size, view.row( 0, 0 ),
+                                          static_cast<uint32_t>( view.rowStride() ),
+                                          static_cast<uint32_t>( view.sliceStride() / view.rowStride() ) );
+            return;
+        }
+
+        // Voxels of interleaved components are gathered first, since they are not adjacent
+        std::vector<T> values;
+        values.reserve( view.numPixels() );
+
+        view.forEachVoxel( [&values] ( const T& value, uint32_t, uint32_t, uint32_t )
+        {
+            values.push_back( value );
+        } );
+
+        m_rendering.updateSegTexture( segUid, compType, offset, size, values.data() );
+    } );
+
+    m_segJournal.markDirty( segUid, offset, size );
+}
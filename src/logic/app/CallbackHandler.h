@@ -7,11 +7,17 @@
 #include <uuid.h>
 
 #include <glm/fwd.hpp>
+#include <glm/vec3.hpp>
+
+#include <unordered_map>
+#include <utility>
 
 
 class AppData;
 class GlfwWrapper;
 class Rendering;
+class SegHistory;
+class SegJournal;
 class View;
 
 struct GLFWcursor;
@@ -24,7 +30,7 @@ class CallbackHandler
 {
 public:
 
-    CallbackHandler( AppData&, GlfwWrapper&, Rendering& );
+    CallbackHandler( AppData&, GlfwWrapper&, Rendering&, SegJournal&, SegHistory& );
     ~CallbackHandler() = default;
 
     /**
@@ -61,12 +67,34 @@ public:
     void doCrosshairsScroll( const ViewHit& hit, const glm::vec2& scrollOffset );
 
     /**
-     * @brief Segment the image
-     * @param windowLastPos
-     * @param windowCurrPos
-     * @param leftButton
+     * @brief Segment the image by painting a brush stroke from the previous to the current hit.
+     * The painted blocks are uploaded to the segmentation textures by flushSegStrokes.
+     * @param prevHit Previous hit of the stroke, which equals the current hit at the start of the stroke
+     * @param hit Current hit of the stroke
+     * @param swapFgAndBg Paint the background label over the foreground label
      */
-    void doSegment( const ViewHit& hit, bool swapFgAndBg );
+    void doSegment( const ViewHit& prevHit, const ViewHit& hit, bool swapFgAndBg );
+
+    /**
+     * @brief Upload the blocks of segmentations painted by brush strokes since the last flush
+     * to the segmentation textures, merging the blocks of each segmentation into one upload.
+     * This is called once per rendered frame.
+     */
+    void flushSegStrokes();
+
+    /**
+     * @brief End the brush stroke in progress, so that it is one step of the undo history.
+     * This is called when the mouse button that paints the stroke is released.
+     */
+    void endSegStroke();
+
+    /// @brief Revert the last segmentation edit and update the changed regions of the textures
+    /// @return True iff an edit was reverted
+    bool undoSegEdit();
+
+    /// @brief Apply the last reverted segmentation edit again
+    /// @return True iff an edit was applied
+    bool redoSegEdit();
 
     /**
      * @brief Paint the active segmentation of the active image with the
@@ -285,6 +313,12 @@ private:
     AppData& m_appData;
     GlfwWrapper& m_glfw;
     Rendering& m_rendering;
+    SegJournal& m_segJournal; //!< Journal of segmentation edits, which are marked dirty here
+    SegHistory& m_segHistory; //!< Undo history of segmentation edits, which are recorded here
+
+    /// Min/max voxel corners of the blocks painted by brush strokes that are not yet uploaded
+    /// to the segmentation textures, keyed by segmentation UID
+    std::unordered_map< uuids::uuid, std::pair< glm::uvec3, glm::uvec3 > > m_strokeDirtyBoxes;
 
     /**
      * @brief This function is intended to run prior to cursor callbacks that require an active view.
@@ -295,6 +329,9 @@ private:
      * @param[in] viewUid View UID to check against the active UID.
      */
     bool checkAndSetActiveView( const uuids::uuid& viewUid );
+
+    /// Upload a block of voxels of a segmentation to its texture and mark it dirty in the journal
+    void updateSegBlock( const uuids::uuid& segUid, const glm::uvec3& offset, const glm::uvec3& size );
 };
 
 #endif // CALLBACK_HANDLER_H
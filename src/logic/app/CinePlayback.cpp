@@ -0,0 +1,87 @@
+#include "logic/app/CinePlayback.h"
+#include "logic/app/Data.h"
+
+#include <glm/gtc/epsilon.hpp>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/ostr.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+CinePlayback::CinePlayback( AppData& appData )
+    :
+      m_appData( appData ),
+      m_playbacks()
+{
+}
+
+
+std::optional<double> CinePlayback::update()
+{
+    const Clock::time_point now = Clock::now();
+
+    std::optional<double> secondsToNextFrame;
+
+    for ( const auto& imageUid : m_appData.imageUidsOrdered() )
+    {
+        Image* image = m_appData.image( imageUid );
+        if ( ! image || ! image->settings().cinePlaying() )
+        {
+            m_playbacks.erase( imageUid );
+            continue;
+        }
+
+        ImageSettings& settings = image->settings();
+        const uint32_t numFrames = settings.numFrames();
+        const double frameRate = settings.frameRate();
+
+        auto it = m_playbacks.find( imageUid );
+
+        if ( std::end( m_playbacks ) == it ||
+             glm::epsilonNotEqual( it->second.m_frameRate, frameRate, glm::epsilon<double>() ) ||
+             it->second.m_lastFrame != settings.activeFrame() )
+        {
+            // Start playback, or restart it after the user changed the frame or rate
+            Playback playback;
+            playback.m_startTime = now;
+            playback.m_startFrame = settings.activeFrame();
+            playback.m_lastFrame = settings.activeFrame();
+            playback.m_frameRate = frameRate;
+
+            it = m_playbacks.insert_or_assign( imageUid, playback ).first;
+            spdlog::debug( "Started cine playback of image {} at frame {}", imageUid, playback.m_startFrame );
+        }
+
+        Playback& playback = it->second;
+
+        const double elapsed = std::chrono::duration<double>( now - playback.m_startTime ).count();
+        const uint64_t steps = static_cast<uint64_t>( std::floor( elapsed * frameRate ) );
+        uint64_t frame = playback.m_startFrame + steps;
+
+        if ( frame >= numFrames )
+        {
+            if ( settings.cineLoop() )
+            {
+                frame %= numFrames;
+            }
+            else
+            {
+                // Stop on the last frame
+                settings.setActiveFrame( numFrames - 1 );
+                settings.setCinePlaying( false );
+                m_playbacks.erase( it );
+                continue;
+            }
+        }
+
+        settings.setActiveFrame( static_cast<uint32_t>( frame ) );
+        playback.m_lastFrame = static_cast<uint32_t>( frame );
+
+        const double untilNext = std::max( static_cast<double>( steps + 1 ) / frameRate - elapsed, 0.0 );
+        secondsToNextFrame = std::min( secondsToNextFrame.value_or( untilNext ), untilNext );
+    }
+
+    return secondsToNextFrame;
+}
@@ -0,0 +1,60 @@
+#ifndef CINE_PLAYBACK_H
+#define CINE_PLAYBACK_H
+
+#include <uuid.h>
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+
+class AppData;
+
+
+/**
+ * @brief Plays the time frames of time series images as a cine loop. Frames advance with the time
+ * elapsed since playback started at the frame rate of each image (see ImageSettings), rather than
+ * once per rendered frame, so that playback runs at its set rate regardless of the rendering rate.
+ * Playback restarts from the active frame whenever the frame rate or active frame is changed by
+ * the user.
+ *
+ * @note Functions must be called on the render thread.
+ */
+class CinePlayback
+{
+public:
+
+    explicit CinePlayback( AppData& );
+
+    CinePlayback( const CinePlayback& ) = delete;
+    CinePlayback& operator=( const CinePlayback& ) = delete;
+
+    /**
+     * @brief Advance the active frames of the images that are playing. Call this before rendering each frame.
+     * @return Time in seconds until the next frame of any playing image is due;
+     * none if no image is playing
+     */
+    std::optional<double> update();
+
+
+private:
+
+    using Clock = std::chrono::steady_clock;
+
+    /// Playback of one image
+    struct Playback
+    {
+        Clock::time_point m_startTime; //!< Time at which playback (re)started
+        uint32_t m_startFrame = 0; //!< Active frame when playback (re)started
+        uint32_t m_lastFrame = 0; //!< Frame most recently set by playback
+        double m_frameRate = 0.0; //!< Frame rate (frames per second) when playback (re)started
+    };
+
+    AppData& m_appData;
+
+    // Playback of the images that are playing, keyed by image UID
+    std::unordered_map< uuids::uuid, Playback > m_playbacks;
+};
+
+#endif // CINE_PLAYBACK_H
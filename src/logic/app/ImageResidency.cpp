@@ -0,0 +1,432 @@
+#include "logic/app/ImageResidency.h"
+
+#include "common/ThreadPool.h"
+
+#include "logic/app/Data.h"
+
+#include "rendering/RenderData.h"
+#include "rendering/Rendering.h"
+
+#include "windowing/Layout.h"
+#include "windowing/View.h"
+
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/ostr.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace
+{
+
+/// Textures of images have mipmaps, which add up to 1/7 of the size of the base level.
+/// Time series images have textures for the shown frame and the frames prefetched after it.
+uint64_t textureSizeInBytes( const Image& image )
+{
+    const ImageHeader& header = image.header();
+    const uint64_t numTextureFrames = std::min<uint64_t>( header.numFrames(), 1 + Rendering::NUM_PREFETCHED_FRAMES );
+
+    return header.memoryImageSizeInBytes() / header.numFrames() * numTextureFrames * 8 / 7;
+}
+
+}
+
+
+ImageResidency::ImageResidency(
+        AppData& appData,
+        Rendering& rendering,
+        std::function<void(void)> notifyRenderThread )
+    :
+      m_appData( appData ),
+      m_rendering( rendering ),
+      m_notifyRenderThread( std::move( notifyRenderThread ) ),
+      m_ramBudget( 0 ),
+      m_vramBudget( 0 ),
+      m_frame( 0 ),
+      m_lastUsedFrame(),
+      m_pendingReads(),
+      m_unreadableImages(),
+      m_readProgress( std::make_shared<LoadProgress>() ),
+      m_readPool( nullptr )
+{}
+
+
+ImageResidency::~ImageResidency()
+{
+    // Reads that are in progress stop at their next cancellation check
+    m_readProgress->cancel();
+}
+
+
+void ImageResidency::setBudgets( uint64_t ramBudget, uint64_t vramBudget )
+{
+    m_ramBudget = ramBudget;
+    m_vramBudget = vramBudget;
+
+    spdlog::info( "Image memory budget is {}; image texture budget is {}",
+                  ( 0 == m_ramBudget ) ? std::string( "unlimited" ) : std::to_string( m_ramBudget >> 20 ) + " MiB",
+                  ( 0 == m_vramBudget ) ? std::string( "unlimited" ) : std::to_string( m_vramBudget >> 20 ) + " MiB" );
+}
+
+uint64_t ImageResidency::ramBudget() const { return m_ramBudget; }
+uint64_t ImageResidency::vramBudget() const { return m_vramBudget; }
+
+
+void ImageResidency::touch( const uuids::uuid& imageUid )
+{
+    m_lastUsedFrame[imageUid] = m_frame;
+}
+
+
+void ImageResidency::update()
+{
+    ++m_frame;
+
+    applyReadVoxels();
+    touchUsedImages();
+
+    for ( const auto& imageUid : m_appData.imageUidsOrdered() )
+    {
+        if ( ! isUsedInCurrentFrame( imageUid ) || hasTextures( imageUid ) )
+        {
+            continue;
+        }
+
+        const Image* image = m_appData.image( imageUid );
+        if ( ! image )
+        {
+            continue;
+        }
+
+        if ( image->hasVoxels() )
+        {
+            m_rendering.createImageTextures( imageUid );
+        }
+        else if ( 0 == m_pendingReads.count( imageUid ) && 0 == m_unreadableImages.count( imageUid ) )
+        {
+            readVoxelsAsync( imageUid, *image );
+        }
+    }
+
+    removeTexturesOverBudget();
+    releaseVoxelsOverBudget();
+}
+
+
+void ImageResidency::releaseVoxelsOverBudget()
+{
+    if ( 0 == m_ramBudget )
+    {
+        return;
+    }
+
+    // Images may share voxel buffers (such as images of the same file), so the memory of each buffer
+    // is counted once and is only freed when all of the images that hold it are released
+    struct BufferUse
+    {
+        uint64_t m_sizeInBytes;
+        size_t m_numImages; //!< Number of images that hold the buffer
+    };
+
+    std::unordered_map< const void*, BufferUse > bufferUses;
+    uint64_t ramSize = 0;
+
+    for ( const auto& imageUid : m_appData.imageUidsOrdered() )
+    {
+        const Image* image = m_appData.image( imageUid );
+        if ( ! image )
+        {
+            continue;
+        }
+
+        for ( const auto& [buffer, size] : image->residentBuffers() )
+        {
+            auto it = bufferUses.find( buffer );
+
+            if ( std::end( bufferUses ) == it )
+            {
+                bufferUses.emplace( buffer, BufferUse{ size, 1 } );
+                ramSize += size;
+            }
+            else
+            {
+                ++it->second.m_numImages;
+            }
+        }
+    }
+
+    if ( ramSize <= m_ramBudget )
+    {
+        return;
+    }
+
+    for ( const auto& imageUid : evictionOrder() )
+    {
+        if ( ramSize <= m_ramBudget )
+        {
+            break;
+        }
+
+        Image* image = m_appData.image( imageUid );
+        if ( ! image || ! image->canReleaseVoxels() )
+        {
+            continue;
+        }
+
+        // Memory that is freed by releasing the image: its buffers that no other image holds
+        const auto buffers = image->residentBuffers();
+        uint64_t size = 0;
+
+        for ( const auto& buffer : buffers )
+        {
+            if ( 1 == bufferUses.at( buffer.first ).m_numImages )
+            {
+                size += buffer.second;
+            }
+        }
+
+        // Releasing an image whose buffers are all shared frees no memory, and its voxels would
+        // have to be read again when it is next used
+        if ( 0 == size )
+        {
+            continue;
+        }
+
+        if ( image->releaseVoxels() )
+        {
+            for ( const auto& buffer : buffers )
+            {
+                --bufferUses.at( buffer.first ).m_numImages;
+            }
+
+            ramSize -= size;
+            spdlog::debug( "Released voxels of image {} ({} MiB) from memory", imageUid, size >> 20 );
+        }
+    }
+}
+
+
+void ImageResidency::touchUsedImages()
+{
+    const auto& windowData = m_appData.windowData();
+
+    for ( const auto& viewUid : windowData.currentViewUids() )
+    {
+        if ( const View* view = windowData.getCurrentView( viewUid ) )
+        {
+            for ( const auto& imageUid : view->visibleImages() )
+            {
+                touch( imageUid );
+            }
+        }
+    }
+
+    // Images of lightbox layouts are set on the layout rather than on its views
+    if ( windowData.currentLayout().isLightbox() )
+    {
+        for ( const auto& imageUid : windowData.currentLayout().visibleImages() )
+        {
+            touch( imageUid );
+        }
+    }
+
+    // Tools operate on the reference and active images
+    if ( const auto refUid = m_appData.refImageUid() )
+    {
+        touch( *refUid );
+    }
+
+    if ( const auto activeUid = m_appData.activeImageUid() )
+    {
+        touch( *activeUid );
+    }
+}
+
+
+void ImageResidency::applyReadVoxels()
+{
+    for ( auto it = std::begin( m_pendingReads ); it != std::end( m_pendingReads ); )
+    {
+        auto& [imageUid, futureImage] = *it;
+
+        if ( std::future_status::ready != futureImage.wait_for( std::chrono::seconds( 0 ) ) )
+        {
+            ++it;
+            continue;
+        }
+
+        try
+        {
+            Image loaded = futureImage.get();
+            Image* image = m_appData.image( imageUid );
+
+            // The image may have been removed from the project while its voxels were read
+            if ( image && ! image->hasVoxels() )
+            {
+                if ( image->restoreVoxels( std::move( loaded ) ) )
+                {
+                    spdlog::debug( "Restored voxels of image {} from file {}", imageUid, image->header().fileName() );
+                }
+                else
+                {
+                    m_unreadableImages.insert( imageUid );
+                }
+            }
+        }
+        catch ( const std::exception& e )
+        {
+            spdlog::error( "Unable to read voxels of image {} again: {}", imageUid, e.what() );
+            m_unreadableImages.insert( imageUid );
+        }
+
+        it = m_pendingReads.erase( it );
+    }
+}
+
+
+void ImageResidency::readVoxelsAsync( const uuids::uuid& imageUid, const Image& image )
+{
+    if ( ! m_readPool )
+    {
+        m_readPool = std::make_unique<ThreadPool>();
+    }
+
+    const std::string fileName = image.header().fileName();
+    const Image::ImageRepresentation imageRep = image.imageRep();
+    const Image::MultiComponentBufferType bufferType = image.bufferType();
+    const Image::FloatStorageType floatStorage = image.floatStorage();
+    const size_t file = m_readProgress->addFile( fileName );
+
+    // The render thread is notified after the result is set, so that it is ready when the thread wakes
+    auto promise = std::make_shared< std::promise<Image> >();
+    m_pendingReads.emplace( imageUid, promise->get_future() );
+
+    m_readPool->submit( [=, progress = m_readProgress, notify = m_notifyRenderThread] ()
+    {
+        try
+        {
+            const FileLoadProgress fileProgress( progress, file );
+            promise->set_value( Image( fileName, imageRep, bufferType, floatStorage, &fileProgress ) );
+        }
+        catch ( ... )
+        {
+            promise->set_exception( std::current_exception() );
+        }
+
+        // The progress outlives many reads, so files are removed from it once they are read
+        progress->removeFile( file );
+
+        if ( notify )
+        {
+            notify();
+        }
+    } );
+
+    spdlog::debug( "Reading voxels of image {} from file {}", imageUid, fileName );
+}
+
+
+void ImageResidency::removeTexturesOverBudget()
+{
+    if ( 0 == m_vramBudget )
+    {
+        return;
+    }
+
+    uint64_t vramSize = 0;
+
+    for ( const auto& imageUid : m_appData.imageUidsOrdered() )
+    {
+        const Image* image = m_appData.image( imageUid );
+        if ( image && hasTextures( imageUid ) )
+        {
+            vramSize += textureSizeInBytes( *image );
+        }
+    }
+
+    if ( vramSize <= m_vramBudget )
+    {
+        return;
+    }
+
+    for ( const auto& imageUid : evictionOrder() )
+    {
+        if ( vramSize <= m_vramBudget )
+        {
+            break;
+        }
+
+        const Image* image = m_appData.image( imageUid );
+        if ( ! image || ! hasTextures( imageUid ) )
+        {
+            continue;
+        }
+
+        // Keep the textures of an image whose voxels could not be read again from its file,
+        // since they could not be created again
+        if ( ! image->hasVoxels() && m_unreadableImages.count( imageUid ) > 0 )
+        {
+            continue;
+        }
+
+        const uint64_t size = textureSizeInBytes( *image );
+
+        if ( m_rendering.removeImageTextures( imageUid ) )
+        {
+            vramSize -= size;
+        }
+    }
+}
+
+
+std::vector<uuids::uuid> ImageResidency::evictionOrder() const
+{
+    std::vector< std::pair<uint64_t, size_t> > lastUsedAndIndex;
+    std::vector<uuids::uuid> imageUids;
+
+    for ( const auto& imageUid : m_appData.imageUidsOrdered() )
+    {
+        if ( ! isUsedInCurrentFrame( imageUid ) )
+        {
+            const auto it = m_lastUsedFrame.find( imageUid );
+            const uint64_t lastUsed = ( std::end( m_lastUsedFrame ) != it ) ? it->second : 0;
+
+            lastUsedAndIndex.emplace_back( lastUsed, imageUids.size() );
+            imageUids.push_back( imageUid );
+        }
+    }
+
+    std::sort( std::begin( lastUsedAndIndex ), std::end( lastUsedAndIndex ),
+               [] ( const auto& a, const auto& b )
+    {
+        return ( a.first < b.first ) || ( a.first == b.first && a.second > b.second );
+    } );
+
+    std::vector<uuids::uuid> order;
+    order.reserve( imageUids.size() );
+
+    for ( const auto& p : lastUsedAndIndex )
+    {
+        order.push_back( imageUids[p.second] );
+    }
+
+    return order;
+}
+
+
+bool ImageResidency::isUsedInCurrentFrame( const uuids::uuid& imageUid ) const
+{
+    const auto it = m_lastUsedFrame.find( imageUid );
+    return ( std::end( m_lastUsedFrame ) != it && m_frame == it->second );
+}
+
+
+bool ImageResidency::hasTextures( const uuids::uuid& imageUid ) const
+{
+    return ( m_appData.renderData().m_imageTextures.count( imageUid ) > 0 );
+}
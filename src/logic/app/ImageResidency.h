@@ -0,0 +1,118 @@
+#ifndef IMAGE_RESIDENCY_H
+#define IMAGE_RESIDENCY_H
+
+#include "common/LoadProgress.h"
+#include "image/Image.h"
+
+#include <uuid.h>
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+
+class AppData;
+class Rendering;
+class ThreadPool;
+
+
+/**
+ * @brief Keeps the voxels and textures of only the recently used images of a project resident,
+ * so that projects with many images fit in memory. The header, transformations, settings, and
+ * statistics of all images are always kept. The voxels of an image that was evicted from memory
+ * are read again from its file, and its textures are created again, when it is next used.
+ *
+ * An image is used in a frame if it is rendered or used for a metric in a current view, or if it is
+ * the reference or active image, on which tools operate. When the voxels of images in memory exceed
+ * the RAM budget or their textures exceed the VRAM budget, the least-recently-used images that are
+ * not used in the current frame are evicted. Only images whose voxels can be read again from their
+ * files are evicted from memory (see Image::canReleaseVoxels).
+ *
+ * @note Functions must be called on the render thread, except that releaseVoxelsOverBudget is also
+ * called on the project loading thread before rendering starts.
+ */
+class ImageResidency
+{
+public:
+
+    /// @param[in] notifyRenderThread Called on worker threads when voxels have been read
+    ImageResidency( AppData&, Rendering&, std::function<void(void)> notifyRenderThread );
+
+    ImageResidency( const ImageResidency& ) = delete;
+    ImageResidency& operator=( const ImageResidency& ) = delete;
+
+    /// Reads of voxels that are in progress are cancelled
+    ~ImageResidency();
+
+    /// @brief Set the budgets in bytes for the voxels of images held in memory and in textures.
+    /// A budget of zero is unlimited.
+    void setBudgets( uint64_t ramBudget, uint64_t vramBudget );
+
+    uint64_t ramBudget() const;
+    uint64_t vramBudget() const;
+
+    /**
+     * @brief Mark the images that are used in the current frame, restore voxels that have been read
+     * since the last frame, make the used images resident, and evict least-recently-used images that
+     * exceed the budgets. Call this before rendering each frame, once the textures are initialized.
+     */
+    void update();
+
+    /// @brief Release the voxels of least-recently-used images, other than those used in the
+    /// current frame, until the voxels of images in memory fit in the RAM budget
+    void releaseVoxelsOverBudget();
+
+
+private:
+
+    /// Mark an image as used in the current frame
+    void touch( const uuids::uuid& imageUid );
+
+    /// Mark the images of the current views and the reference and active images as used
+    void touchUsedImages();
+
+    /// Restore the voxels of images that have been read on worker threads
+    void applyReadVoxels();
+
+    /// Start reading the voxels of an image from its file on a worker thread
+    void readVoxelsAsync( const uuids::uuid& imageUid, const Image& image );
+
+    /// Remove the textures of least-recently-used images, other than those used in the
+    /// current frame, until the textures fit in the VRAM budget
+    void removeTexturesOverBudget();
+
+    /// Get the images that are not used in the current frame, least-recently-used first.
+    /// Among images that are equally recent, later images in the project come first.
+    std::vector<uuids::uuid> evictionOrder() const;
+
+    bool isUsedInCurrentFrame( const uuids::uuid& imageUid ) const;
+
+    bool hasTextures( const uuids::uuid& imageUid ) const;
+
+    AppData& m_appData;
+    Rendering& m_rendering;
+    std::function<void(void)> m_notifyRenderThread;
+
+    uint64_t m_ramBudget; //!< Budget in bytes for voxels in memory (zero if unlimited)
+    uint64_t m_vramBudget; //!< Budget in bytes for textures (zero if unlimited)
+
+    uint64_t m_frame; //!< Index of the current frame
+    std::unordered_map< uuids::uuid, uint64_t > m_lastUsedFrame; //!< Frame in which each image was last used
+
+    /// Voxels that are being read from image files, keyed by image
+    std::unordered_map< uuids::uuid, std::future<Image> > m_pendingReads;
+
+    /// Images whose voxels could not be read again, which are not read again
+    std::unordered_set< uuids::uuid > m_unreadableImages;
+
+    /// Used to cancel reads when the residency manager is destroyed
+    std::shared_ptr<LoadProgress> m_readProgress;
+
+    /// Worker threads that read voxels. This is declared last, so that it finishes its tasks first.
+    std::unique_ptr<ThreadPool> m_readPool;
+};
+
+#endif // IMAGE_RESIDENCY_H
@@ -0,0 +1,714 @@
+#include "logic/app/SegHistory.h"
+
+#include "image/Image.h"
+
+#include "logic/app/Data.h"
+
+#include <glm/glm.hpp>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/string_cast.hpp>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/ostr.h>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+
+namespace
+{
+
+static constexpr uint32_t sk_comp0 = 0;
+
+/// Append an unsigned value as a variable-length integer of 7 bits per byte
+void putVarint( std::vector<uint8_t>& bytes, uint64_t value )
+{
+    while ( value >= 0x80 )
+    {
+        bytes.push_back( static_cast<uint8_t>( value | 0x80 ) );
+        value >>= 7;
+    }
+
+    bytes.push_back( static_cast<uint8_t>( value ) );
+}
+
+/// Read a variable-length integer, advancing the data pointer. Reads past the end fail.
+bool getVarint( const uint8_t*& data, const uint8_t* end, uint64_t& value )
+{
+    value = 0;
+
+    for ( uint32_t shift = 0; data < end && shift < 64; shift += 7 )
+    {
+        const uint8_t byte = *data++;
+        value |= static_cast<uint64_t>( byte & 0x7f ) << shift;
+
+        if ( 0 == ( byte & 0x80 ) )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/// Map a signed label to an unsigned value, so that labels of small magnitude have short encodings
+uint64_t zigzag( int64_t value )
+{
+    return ( static_cast<uint64_t>( value ) << 1 ) ^ static_cast<uint64_t>( value >> 63 );
+}
+
+int64_t unzigzag( uint64_t value )
+{
+    return static_cast<int64_t>( value >> 1 ) ^ -static_cast<int64_t>( value & 1 );
+}
+
+
+/// Run-length encode the labels of a view as (count, label) pairs, in memory order
+template< class View >
+std::vector<uint8_t> encodeLabels( const View& view )
+{
+    std::vector<uint8_t> runs;
+    uint64_t length = 0;
+    int64_t label = 0;
+
+    view.forEachVoxel( [&] ( const auto& value, uint32_t, uint32_t, uint32_t )
+    {
+        const int64_t v = static_cast<int64_t>( value );
+
+        if ( length > 0 && v == label )
+        {
+            ++length;
+            return;
+        }
+
+        if ( length > 0 )
+        {
+            putVarint( runs, length );
+            putVarint( runs, zigzag( label ) );
+        }
+
+        label = v;
+        length = 1;
+    } );
+
+    if ( length > 0 )
+    {
+        putVarint( runs, length );
+        putVarint( runs, zigzag( label ) );
+    }
+
+    runs.shrink_to_fit();
+    return runs;
+}
+
+
+/// Reads run-length encoded (count, label) pairs one label at a time
+class LabelReader
+{
+public:
+
+    explicit LabelReader( const std::vector<uint8_t>& runs )
+        : m_data( runs.data() ), m_end( runs.data() + runs.size() ), m_remaining( 0 ), m_label( 0 ) {}
+
+    /// Get the next label
+    /// @return False iff the runs are exhausted or corrupt
+    bool next( int64_t& label )
+    {
+        if ( 0 == m_remaining )
+        {
+            uint64_t encoded = 0;
+
+            if ( ! getVarint( m_data, m_end, m_remaining ) ||
+                 ! getVarint( m_data, m_end, encoded ) || 0 == m_remaining )
+            {
+                return false;
+            }
+
+            m_label = unzigzag( encoded );
+        }
+
+        --m_remaining;
+        label = m_label;
+        return true;
+    }
+
+private:
+
+    const uint8_t* m_data;
+    const uint8_t* m_end;
+    uint64_t m_remaining;
+    int64_t m_label;
+};
+
+
+/// Encodes the changed voxels of a brick as runs of (skip, length, old label, new label), where skip
+/// is the number of unchanged voxels since the end of the previous run
+class DeltaWriter
+{
+public:
+
+    explicit DeltaWriter( std::vector<uint8_t>& runs )
+        : m_runs( runs ), m_start( 0 ), m_length( 0 ), m_oldLabel( 0 ), m_newLabel( 0 ), m_prevEnd( 0 ) {}
+
+    /// Add a changed voxel. Voxels must be added in increasing order of linear index.
+    void add( uint64_t index, int64_t oldLabel, int64_t newLabel )
+    {
+        if ( m_length > 0 && m_start + m_length == index && oldLabel == m_oldLabel && newLabel == m_newLabel )
+        {
+            ++m_length;
+            return;
+        }
+
+        finish();
+
+        m_start = index;
+        m_length = 1;
+        m_oldLabel = oldLabel;
+        m_newLabel = newLabel;
+    }
+
+    /// Write the pending run
+    void finish()
+    {
+        if ( 0 == m_length )
+        {
+            return;
+        }
+
+        putVarint( m_runs, m_start - m_prevEnd );
+        putVarint( m_runs, m_length );
+        putVarint( m_runs, zigzag( m_oldLabel ) );
+        putVarint( m_runs, zigzag( m_newLabel ) );
+
+        m_prevEnd = m_start + m_length;
+        m_length = 0;
+    }
+
+private:
+
+    std::vector<uint8_t>& m_runs;
+
+    uint64_t m_start;
+    uint64_t m_length;
+    int64_t m_oldLabel;
+    int64_t m_newLabel;
+    uint64_t m_prevEnd;
+};
+
+
+/// Write the old (undo) or new (redo) labels of the runs of a brick delta into a view of the brick
+template< class View >
+bool writeDelta( const View& view, const std::vector<uint8_t>& runs, bool undo )
+{
+    using T = typename View::ValueType;
+
+    const uint64_t sizeX = view.dims().x;
+    const uint64_t sizeXY = sizeX * view.dims().y;
+    const uint64_t numPixels = view.numPixels();
+
+    const uint8_t* data = runs.data();
+    const uint8_t* end = runs.data() + runs.size();
+
+    uint64_t index = 0;
+
+    while ( data < end )
+    {
+        uint64_t skip, length, oldLabel, newLabel;
+
+        if ( ! getVarint( data, end, skip ) || ! getVarint( data, end, length ) ||
+             ! getVarint( data, end, oldLabel ) || ! getVarint( data, end, newLabel ) ||
+             index + skip + length > numPixels )
+        {
+            return false;
+        }
+
+        index += skip;
+
+        const T value = static_cast<T>( unzigzag( undo ? oldLabel : newLabel ) );
+
+        // Write the run a row segment at a time
+        while ( length > 0 )
+        {
+            const uint64_t i = index % sizeX;
+            const uint64_t n = std::min( length, sizeX - i );
+
+            T* row = view.row( static_cast<uint32_t>( ( index % sizeXY ) / sizeX ),
+                               static_cast<uint32_t>( index / sizeXY ) );
+
+            for ( uint64_t c = i; c < i + n; ++c )
+            {
+                row[c * view.pixelStride()] = value;
+            }
+
+            index += n;
+            length -= n;
+        }
+    }
+
+    return true;
+}
+
+
+glm::uvec3 numBricks( const glm::uvec3& dims )
+{
+    return ( dims + glm::uvec3{ SegHistory::sk_brickSize - 1 } ) / SegHistory::sk_brickSize;
+}
+
+size_t brickIndex( const glm::uvec3& brick, const glm::uvec3& gridSize )
+{
+    return static_cast<size_t>( brick.x ) + static_cast<size_t>( gridSize.x ) *
+            ( static_cast<size_t>( brick.y ) + static_cast<size_t>( gridSize.y ) * brick.z );
+}
+
+glm::uvec3 brickOffset( size_t index, const glm::uvec3& gridSize )
+{
+    const size_t bricksPerSlice = static_cast<size_t>( gridSize.x ) * gridSize.y;
+
+    const glm::uvec3 brick{
+        static_cast<uint32_t>( index % gridSize.x ),
+        static_cast<uint32_t>( ( index % bricksPerSlice ) / gridSize.x ),
+        static_cast<uint32_t>( index / bricksPerSlice ) };
+
+    return brick * SegHistory::sk_brickSize;
+}
+
+} // anonymous
+
+
+SegHistory::SegHistory( AppData& appData )
+    :
+      m_appData( appData ),
+      m_budgetInBytes( sk_defaultBudgetInBytes ),
+      m_sizeInBytes( 0 ),
+      m_undoOps(),
+      m_redoOps(),
+      m_currentOpName( std::nullopt ),
+      m_captures()
+{
+}
+
+
+void SegHistory::setBudget( size_t budgetInBytes )
+{
+    m_budgetInBytes = budgetInBytes;
+    trimToBudget();
+
+    spdlog::debug( "Segmentation undo history budget is {} bytes", m_budgetInBytes );
+}
+
+
+void SegHistory::beginOperation( const std::string& name )
+{
+    endOperation();
+    m_currentOpName = name;
+}
+
+
+void SegHistory::endOperation()
+{
+    if ( ! m_currentOpName )
+    {
+        return;
+    }
+
+    Operation op;
+    op.m_name = *m_currentOpName;
+    m_currentOpName = std::nullopt;
+
+    for ( const auto& c : m_captures )
+    {
+        const uuids::uuid& segUid = c.first;
+        const SegCapture& capture = c.second;
+
+        const Image* seg = m_appData.seg( segUid );
+        if ( ! seg ) continue;
+
+        if ( seg->header().pixelDimensions() != capture.m_dims ||
+             seg->header().memoryComponentType() != capture.m_componentType )
+        {
+            spdlog::warn( "Segmentation {} changed format during edit '{}', which cannot be undone",
+                          segUid, op.m_name );
+            continue;
+        }
+
+        SegDelta delta;
+        delta.m_segUid = segUid;
+        delta.m_dims = capture.m_dims;
+        delta.m_componentType = capture.m_componentType;
+        delta.m_changedMin = glm::uvec3{ std::numeric_limits<uint32_t>::max() };
+        delta.m_changedMax = glm::uvec3{ 0 };
+
+        const glm::uvec3 bricks = numBricks( capture.m_dims );
+
+        for ( const auto& captured : capture.m_bricks )
+        {
+            BrickDelta brickDelta;
+            brickDelta.m_offset = brickOffset( captured.first, bricks );
+            brickDelta.m_size = glm::min( capture.m_dims - brickDelta.m_offset, glm::uvec3{ sk_brickSize } );
+
+            bool valid = true;
+
+            // Compare the new labels of the brick with the captured old labels
+            seg->visitBlock( sk_comp0, brickDelta.m_offset, brickDelta.m_size, [&] ( const auto& view )
+            {
+                LabelReader oldLabels( captured.second );
+                DeltaWriter writer( brickDelta.m_runs );
+                uint64_t index = 0;
+
+                view.forEachVoxel( [&] ( const auto& value, uint32_t i, uint32_t j, uint32_t k )
+                {
+                    int64_t oldLabel = 0;
+
+                    if ( ! oldLabels.next( oldLabel ) )
+                    {
+                        valid = false;
+                        return;
+                    }
+
+                    const int64_t newLabel = static_cast<int64_t>( value );
+
+                    if ( oldLabel != newLabel )
+                    {
+                        const glm::uvec3 voxel = brickDelta.m_offset + glm::uvec3{ i, j, k };
+                        delta.m_changedMin = glm::min( delta.m_changedMin, voxel );
+                        delta.m_changedMax = glm::max( delta.m_changedMax, voxel );
+
+                        writer.add( index, oldLabel, newLabel );
+                    }
+
+                    ++index;
+                } );
+
+                writer.finish();
+            } );
+
+            if ( ! valid )
+            {
+                spdlog::error( "Invalid capture of brick {} of segmentation {}", captured.first, segUid );
+                continue;
+            }
+
+            if ( brickDelta.m_runs.empty() )
+            {
+                continue; // The brick was not changed
+            }
+
+            brickDelta.m_runs.shrink_to_fit();
+            op.m_sizeInBytes += sizeof( BrickDelta ) + brickDelta.m_runs.size();
+            delta.m_bricks.emplace_back( std::move( brickDelta ) );
+        }
+
+        if ( ! delta.m_bricks.empty() )
+        {
+            op.m_sizeInBytes += sizeof( SegDelta );
+            op.m_segs.emplace_back( std::move( delta ) );
+        }
+    }
+
+    m_captures.clear();
+
+    if ( op.m_segs.empty() )
+    {
+        spdlog::trace( "Segmentation edit '{}' changed no voxels", op.m_name );
+        return;
+    }
+
+    op.m_sizeInBytes += sizeof( Operation );
+
+    // A new operation replaces the operations that were undone
+    for ( const Operation& redoOp : m_redoOps )
+    {
+        m_sizeInBytes -= redoOp.m_sizeInBytes;
+    }
+
+    m_redoOps.clear();
+
+    if ( op.m_sizeInBytes > m_budgetInBytes )
+    {
+        spdlog::warn( "Segmentation edit '{}' of {} bytes exceeds the undo history budget of {} bytes "
+                      "and cannot be undone", op.m_name, op.m_sizeInBytes, m_budgetInBytes );
+    }
+
+    spdlog::debug( "Recorded segmentation edit '{}' of {} bytes", op.m_name, op.m_sizeInBytes );
+
+    m_sizeInBytes += op.m_sizeInBytes;
+    m_undoOps.emplace_back( std::move( op ) );
+
+    trimToBudget();
+}
+
+
+bool SegHistory::inOperation() const
+{
+    return m_currentOpName.has_value();
+}
+
+
+void SegHistory::recordWrite( const uuids::uuid& segUid, const glm::uvec3& offset, const glm::uvec3& size )
+{
+    if ( 0 == size.x || 0 == size.y || 0 == size.z )
+    {
+        return;
+    }
+
+    const Image* seg = nullptr;
+    SegCapture* capture = captureOf( segUid, seg );
+    if ( ! capture ) return;
+
+    const glm::uvec3& dims = capture->m_dims;
+    const glm::uvec3 firstBrick = glm::min( offset, dims - glm::uvec3{ 1 } ) / sk_brickSize;
+    const glm::uvec3 lastBrick = glm::min( offset + size - glm::uvec3{ 1 }, dims - glm::uvec3{ 1 } ) / sk_brickSize;
+
+    for ( uint32_t k = firstBrick.z; k <= lastBrick.z; ++k )
+    {
+        for ( uint32_t j = firstBrick.y; j <= lastBrick.y; ++j )
+        {
+            for ( uint32_t i = firstBrick.x; i <= lastBrick.x; ++i )
+            {
+                captureBrick( *seg, *capture, glm::uvec3{ i, j, k } );
+            }
+        }
+    }
+}
+
+
+void SegHistory::recordWrite( const uuids::uuid& segUid, const std::vector<glm::uvec3>& bricks )
+{
+    if ( bricks.empty() )
+    {
+        return;
+    }
+
+    const Image* seg = nullptr;
+    SegCapture* capture = captureOf( segUid, seg );
+    if ( ! capture ) return;
+
+    const glm::uvec3 gridSize = numBricks( capture->m_dims );
+
+    for ( const glm::uvec3& brick : bricks )
+    {
+        if ( glm::any( glm::greaterThanEqual( brick, gridSize ) ) )
+        {
+            spdlog::warn( "Brick {} is outside of segmentation {}", glm::to_string( brick ), segUid );
+            continue;
+        }
+
+        captureBrick( *seg, *capture, brick );
+    }
+}
+
+
+SegHistory::SegCapture* SegHistory::captureOf( const uuids::uuid& segUid, const Image*& seg )
+{
+    if ( ! m_currentOpName || 0 == m_budgetInBytes )
+    {
+        return nullptr;
+    }
+
+    seg = m_appData.seg( segUid );
+    if ( ! seg ) return nullptr;
+
+    const glm::uvec3 dims = seg->header().pixelDimensions();
+
+    auto it = m_captures.find( segUid );
+
+    if ( std::end( m_captures ) == it )
+    {
+        SegCapture capture;
+        capture.m_dims = dims;
+        capture.m_componentType = seg->header().memoryComponentType();
+
+        it = m_captures.emplace( segUid, std::move( capture ) ).first;
+    }
+
+    if ( dims != it->second.m_dims )
+    {
+        return nullptr;
+    }
+
+    return &( it->second );
+}
+
+
+void SegHistory::captureBrick( const Image& seg, SegCapture& capture, const glm::uvec3& brick )
+{
+    const size_t index = brickIndex( brick, numBricks( capture.m_dims ) );
+
+    // Capture the old labels of a brick only if the operation has not yet written it
+    if ( capture.m_bricks.count( index ) > 0 )
+    {
+        return;
+    }
+
+    const glm::uvec3 brickStart = brick * sk_brickSize;
+    const glm::uvec3 brickSize = glm::min( capture.m_dims - brickStart, glm::uvec3{ sk_brickSize } );
+
+    seg.visitBlock( sk_comp0, brickStart, brickSize, [&capture, &index] ( const auto& view )
+    {
+        capture.m_bricks.emplace( index, encodeLabels( view ) );
+    } );
+}
+
+
+bool SegHistory::undo( const BlockWrittenCallback& onBlockWritten )
+{
+    endOperation();
+
+    if ( m_undoOps.empty() )
+    {
+        return false;
+    }
+
+    Operation op = std::move( m_undoOps.back() );
+    m_undoOps.pop_back();
+
+    apply( op, true, onBlockWritten );
+    spdlog::info( "Undid segmentation edit '{}'", op.m_name );
+
+    m_redoOps.emplace_back( std::move( op ) );
+    return true;
+}
+
+
+bool SegHistory::redo( const BlockWrittenCallback& onBlockWritten )
+{
+    endOperation();
+
+    if ( m_redoOps.empty() )
+    {
+        return false;
+    }
+
+    Operation op = std::move( m_redoOps.back() );
+    m_redoOps.pop_back();
+
+    apply( op, false, onBlockWritten );
+    spdlog::info( "Redid segmentation edit '{}'", op.m_name );
+
+    m_undoOps.emplace_back( std::move( op ) );
+    return true;
+}
+
+
+bool SegHistory::canUndo() const
+{
+    return ( ! m_undoOps.empty() || ( m_currentOpName && ! m_captures.empty() ) );
+}
+
+
+bool SegHistory::canRedo() const
+{
+    return ( ! m_redoOps.empty() );
+}
+
+
+void SegHistory::forget( const uuids::uuid& segUid )
+{
+    m_captures.erase( segUid );
+
+    // Remove the deltas of the segmentation and then the operations that are left empty
+    auto forgetInOp = [this, &segUid] ( Operation& op )
+    {
+        for ( auto it = std::begin( op.m_segs ); it != std::end( op.m_segs ); )
+        {
+            if ( it->m_segUid != segUid )
+            {
+                ++it;
+                continue;
+            }
+
+            size_t deltaSize = sizeof( SegDelta );
+
+            for ( const BrickDelta& brick : it->m_bricks )
+            {
+                deltaSize += sizeof( BrickDelta ) + brick.m_runs.size();
+            }
+
+            op.m_sizeInBytes -= deltaSize;
+            m_sizeInBytes -= deltaSize;
+            it = op.m_segs.erase( it );
+        }
+
+        if ( op.m_segs.empty() )
+        {
+            m_sizeInBytes -= op.m_sizeInBytes;
+        }
+    };
+
+    auto isEmpty = [] ( const Operation& op ) { return op.m_segs.empty(); };
+
+    std::for_each( std::begin( m_undoOps ), std::end( m_undoOps ), forgetInOp );
+    std::for_each( std::begin( m_redoOps ), std::end( m_redoOps ), forgetInOp );
+
+    m_undoOps.erase( std::remove_if( std::begin( m_undoOps ), std::end( m_undoOps ), isEmpty ),
+                     std::end( m_undoOps ) );
+
+    m_redoOps.erase( std::remove_if( std::begin( m_redoOps ), std::end( m_redoOps ), isEmpty ),
+                     std::end( m_redoOps ) );
+}
+
+
+size_t SegHistory::sizeInBytes() const
+{
+    return m_sizeInBytes;
+}
+
+
+void SegHistory::apply( const Operation& op, bool undo, const BlockWrittenCallback& onBlockWritten )
+{
+    static const glm::uvec3 sk_voxelOne{ 1, 1, 1 };
+
+    for ( const SegDelta& delta : op.m_segs )
+    {
+        Image* seg = m_appData.seg( delta.m_segUid );
+        if ( ! seg ) continue;
+
+        if ( seg->header().pixelDimensions() != delta.m_dims ||
+             seg->header().memoryComponentType() != delta.m_componentType )
+        {
+            spdlog::warn( "Segmentation {} changed format since edit '{}', which is skipped",
+                          delta.m_segUid, op.m_name );
+            continue;
+        }
+
+        for ( const BrickDelta& brick : delta.m_bricks )
+        {
+            seg->visitBlock( sk_comp0, brick.m_offset, brick.m_size, [&brick, &delta, undo] ( const auto& view )
+            {
+                if ( ! writeDelta( view, brick.m_runs, undo ) )
+                {
+                    spdlog::error( "Invalid delta of brick at {} of segmentation {}",
+                                   glm::to_string( brick.m_offset ), delta.m_segUid );
+                }
+            } );
+        }
+
+        if ( onBlockWritten )
+        {
+            onBlockWritten( delta.m_segUid, delta.m_changedMin,
+                            delta.m_changedMax - delta.m_changedMin + sk_voxelOne );
+        }
+    }
+}
+
+
+void SegHistory::trimToBudget()
+{
+    // Discard the oldest operations that can be undone, then the operations farthest down the redo stack
+    while ( m_sizeInBytes > m_budgetInBytes && ! m_undoOps.empty() )
+    {
+        spdlog::debug( "Discarding segmentation edit '{}' from the undo history", m_undoOps.front().m_name );
+        m_sizeInBytes -= m_undoOps.front().m_sizeInBytes;
+        m_undoOps.pop_front();
+    }
+
+    while ( m_sizeInBytes > m_budgetInBytes && ! m_redoOps.empty() )
+    {
+        m_sizeInBytes -= m_redoOps.front().m_sizeInBytes;
+        m_redoOps.erase( std::begin( m_redoOps ) );
+    }
+}
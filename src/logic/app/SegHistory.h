@@ -0,0 +1,174 @@
+#ifndef SEG_HISTORY_H
+#define SEG_HISTORY_H
+
+#include "common/Types.h"
+
+#include <glm/vec3.hpp>
+
+#include <uuid.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+class AppData;
+class Image;
+
+
+/**
+ * @brief Undo/redo history of the edits made to segmentations. Each operation (a brush stroke,
+ * polygon fill, GridCut, or clear) is held as a delta of only the voxels that it changed, so that
+ * long editing sessions fit in a small amount of memory.
+ *
+ * Before voxels are written, the blocks that are about to be written are recorded: the old contents
+ * of the cubic bricks that intersect them are captured run-length encoded. When the operation ends,
+ * each captured brick is compared with its new contents and the changed voxels are kept as runs of
+ * (old label, new label) pairs, with the unchanged voxels between them skipped. All counts and labels
+ * are variable-length encoded, so a typical run takes a few bytes. Bricks without changes are dropped.
+ *
+ * The history is capped by a memory budget: the oldest operations are discarded when it is exceeded.
+ * Undoing or redoing an operation writes back only the bricks that it changed and reports the block
+ * of changed voxels of each segmentation, so that only that sub-region of the texture is updated.
+ *
+ * @note Functions must be called on the render thread.
+ */
+class SegHistory
+{
+public:
+
+    /// Number of voxels along each side of a brick
+    static constexpr uint32_t sk_brickSize = 32;
+
+    /// Default memory budget of the history in bytes
+    static constexpr size_t sk_defaultBudgetInBytes = 256 * 1024 * 1024;
+
+    /// Callback for a block of voxels of a segmentation that was written by undo or redo
+    using BlockWrittenCallback = std::function< void (
+        const uuids::uuid& segUid, const glm::uvec3& offset, const glm::uvec3& size ) >;
+
+
+    explicit SegHistory( AppData& );
+
+    SegHistory( const SegHistory& ) = delete;
+    SegHistory& operator=( const SegHistory& ) = delete;
+
+    ~SegHistory() = default;
+
+    /// @brief Set the memory budget of the history in bytes, discarding the oldest operations beyond it
+    void setBudget( size_t budgetInBytes );
+
+    /// @brief Begin an operation, which groups the edits recorded until it ends into one undo step.
+    /// An operation that is in progress is ended first.
+    void beginOperation( const std::string& name );
+
+    /// @brief End the operation in progress, if any, and compute its delta.
+    /// An operation that changed no voxels is not kept.
+    void endOperation();
+
+    /// @brief Is an operation in progress?
+    bool inOperation() const;
+
+    /**
+     * @brief Record a block of voxels of a segmentation that is about to be written by the operation
+     * in progress. Call this before the voxels are written. Nothing is recorded if no operation is
+     * in progress.
+     */
+    void recordWrite( const uuids::uuid& segUid, const glm::uvec3& offset, const glm::uvec3& size );
+
+    /**
+     * @brief Record the bricks of a segmentation that are about to be written by the operation in
+     * progress, given as 3D indices of bricks of sk_brickSize voxels. Only these bricks are captured,
+     * so an edit that touches few bricks of a large bounding box (such as a diagonal stroke) stays small.
+     */
+    void recordWrite( const uuids::uuid& segUid, const std::vector<glm::uvec3>& bricks );
+
+    /// @brief Revert the last operation. An operation that is in progress is ended first.
+    /// @return True iff an operation was reverted
+    bool undo( const BlockWrittenCallback& onBlockWritten );
+
+    /// @brief Apply the last reverted operation again
+    /// @return True iff an operation was applied
+    bool redo( const BlockWrittenCallback& onBlockWritten );
+
+    bool canUndo() const;
+    bool canRedo() const;
+
+    /// @brief Discard the history of a segmentation that is removed from the project
+    void forget( const uuids::uuid& segUid );
+
+    /// @brief Get the memory used by the history in bytes
+    size_t sizeInBytes() const;
+
+
+private:
+
+    /// Changed voxels of a brick, as encoded runs of (skip, length, old label, new label).
+    /// Voxel (i, j, k) of the brick has linear index i + size.x * ( j + size.y * k ).
+    struct BrickDelta
+    {
+        glm::uvec3 m_offset; //!< Voxel offset of the brick in the segmentation
+        glm::uvec3 m_size; //!< Size of the brick in voxels, which is smaller at the segmentation edges
+        std::vector<uint8_t> m_runs;
+    };
+
+    /// Changes made by an operation to one segmentation
+    struct SegDelta
+    {
+        uuids::uuid m_segUid;
+        glm::uvec3 m_dims; //!< Dimensions of the segmentation when the delta was made
+        ComponentType m_componentType; //!< In-memory component type of the segmentation
+        glm::uvec3 m_changedMin; //!< Min voxel corner of the changed voxels
+        glm::uvec3 m_changedMax; //!< Max voxel corner of the changed voxels
+        std::vector<BrickDelta> m_bricks;
+    };
+
+    struct Operation
+    {
+        std::string m_name;
+        std::vector<SegDelta> m_segs;
+        size_t m_sizeInBytes = 0;
+    };
+
+    /// Old contents of the bricks of a segmentation that were captured by the operation in progress
+    struct SegCapture
+    {
+        glm::uvec3 m_dims;
+        ComponentType m_componentType;
+
+        /// Run-length encoded old voxels of the captured bricks, keyed by linear brick index
+        std::map< size_t, std::vector<uint8_t> > m_bricks;
+    };
+
+    /// Get the capture of a segmentation by the operation in progress, creating it on first use.
+    /// Null if no operation is in progress or the segmentation does not exist or changed size.
+    SegCapture* captureOf( const uuids::uuid& segUid, const Image*& seg );
+
+    /// Capture the old labels of a brick, unless the operation in progress already captured it
+    void captureBrick( const Image& seg, SegCapture& capture, const glm::uvec3& brick );
+
+    /// Write the old (undo) or new (redo) labels of an operation into its segmentations
+    void apply( const Operation& op, bool undo, const BlockWrittenCallback& onBlockWritten );
+
+    /// Discard the oldest operations until the history fits in the budget
+    void trimToBudget();
+
+    AppData& m_appData;
+
+    size_t m_budgetInBytes;
+    size_t m_sizeInBytes; //!< Memory used by the undo and redo operations
+
+    std::deque<Operation> m_undoOps; //!< Operations that can be undone, oldest first
+    std::vector<Operation> m_redoOps; //!< Operations that can be redone, most recently undone last
+
+    std::optional<std::string> m_currentOpName; //!< Name of the operation in progress
+    std::unordered_map< uuids::uuid, SegCapture > m_captures; //!< Captures of the operation in progress
+};
+
+#endif // SEG_HISTORY_H
@@ -0,0 +1,920 @@
+#include "logic/app/SegJournal.h"
+
+#include "common/UuidUtility.h"
+
+#include "image/Gzip.h"
+#include "image/Image.h"
+
+#include "logic/app/Data.h"
+
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/ostr.h>
+
+// On Apple platforms, we must use the alternative ghc::filesystem,
+// because it is not fully implemented or supported prior to macOS 10.15.
+#if !defined(__APPLE__)
+#if defined(__cplusplus) && __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<filesystem>)
+#define GHC_USE_STD_FS
+#include <filesystem>
+namespace fs = std::filesystem;
+#endif
+#endif
+#endif
+
+#ifndef GHC_USE_STD_FS
+#include <ghc/filesystem.hpp>
+namespace fs = ghc::filesystem;
+#endif
+
+#if ! defined( _WIN32 )
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+namespace
+{
+
+/// Magic bytes at the start of a journal file, which include the version of its format
+static const std::string sk_fileMagic( "ANTSEGJ1" );
+
+/// Magic number at the start of each record
+static constexpr uint32_t sk_recordMagic = 0x31524a53; // "SJR1"
+
+/// Minimum time between appends to the journal
+static constexpr std::chrono::seconds sk_appendInterval( 10 );
+
+enum class RecordType : uint8_t
+{
+    Bricks = 1, //!< Bricks of a segmentation
+    Discard = 2 //!< Discards the earlier bricks of a segmentation
+};
+
+
+/// Serializes the payload of a record
+class RecordWriter
+{
+public:
+
+    template< class T >
+    void put( T value )
+    {
+        static_assert( std::is_trivially_copyable_v<T> );
+        putBytes( &value, sizeof( T ) );
+    }
+
+    void putString( const std::string& s )
+    {
+        put( static_cast<uint32_t>( s.size() ) );
+        putBytes( s.data(), s.size() );
+    }
+
+    void putBytes( const void* data, size_t size )
+    {
+        const char* bytes = static_cast<const char*>( data );
+        m_payload.insert( std::end( m_payload ), bytes, bytes + size );
+    }
+
+    void putUVec3( const glm::uvec3& v )
+    {
+        put( v.x );
+        put( v.y );
+        put( v.z );
+    }
+
+    void putKey( const SegJournal::SegKey& key )
+    {
+        putString( key.m_imageFileName );
+        putString( key.m_segFileName );
+        putString( key.m_segDisplayName );
+    }
+
+    /// Get the record, which frames the payload with the record magic, payload size, and checksum
+    std::vector<char> record() const
+    {
+        RecordWriter framed;
+        framed.put( sk_recordMagic );
+        framed.put( static_cast<uint64_t>( m_payload.size() ) );
+        framed.putBytes( m_payload.data(), m_payload.size() );
+        framed.put( computeCrc32( m_payload.data(), m_payload.size() ) );
+        return std::move( framed.m_payload );
+    }
+
+
+private:
+
+    std::vector<char> m_payload;
+};
+
+
+/// Deserializes data with bounds checks. Reads past the end of the data fail.
+class RecordReader
+{
+public:
+
+    RecordReader( const char* data, size_t size )
+        : m_data( data ), m_size( size ), m_position( 0 ) {}
+
+    template< class T >
+    bool get( T& value )
+    {
+        static_assert( std::is_trivially_copyable_v<T> );
+        return getBytes( &value, sizeof( T ) );
+    }
+
+    bool getString( std::string& s )
+    {
+        uint32_t length = 0;
+
+        if ( ! get( length ) || length > remaining() )
+        {
+            return false;
+        }
+
+        s.assign( m_data + m_position, length );
+        m_position += length;
+        return true;
+    }
+
+    bool getBytes( void* dest, size_t size )
+    {
+        if ( size > remaining() )
+        {
+            return false;
+        }
+
+        std::memcpy( dest, m_data + m_position, size );
+        m_position += size;
+        return true;
+    }
+
+    bool getUVec3( glm::uvec3& v )
+    {
+        return ( get( v.x ) && get( v.y ) && get( v.z ) );
+    }
+
+    bool getKey( SegJournal::SegKey& key )
+    {
+        return ( getString( key.m_imageFileName ) &&
+                 getString( key.m_segFileName ) &&
+                 getString( key.m_segDisplayName ) );
+    }
+
+    size_t position() const { return m_position; }
+    size_t remaining() const { return m_size - m_position; }
+    const char* current() const { return m_data + m_position; }
+
+    void skip( size_t size ) { m_position += std::min( size, remaining() ); }
+
+
+private:
+
+    const char* m_data;
+    size_t m_size;
+    size_t m_position;
+};
+
+
+glm::uvec3 numBricks( const glm::uvec3& dims )
+{
+    return ( dims + glm::uvec3{ SegJournal::sk_brickSize - 1 } ) / SegJournal::sk_brickSize;
+}
+
+
+std::vector<char> makeBricksRecord(
+        const SegJournal::SegKey& key,
+        const glm::uvec3& dims,
+        ComponentType componentType,
+        const std::vector<SegJournal::Brick>& bricks )
+{
+    RecordWriter writer;
+    writer.put( RecordType::Bricks );
+    writer.putKey( key );
+    writer.putUVec3( dims );
+    writer.put( static_cast<uint32_t>( componentType ) );
+    writer.put( static_cast<uint32_t>( bricks.size() ) );
+
+    for ( const auto& brick : bricks )
+    {
+        writer.putUVec3( brick.m_offset );
+        writer.putUVec3( brick.m_size );
+        writer.put( static_cast<uint64_t>( brick.m_compressedVoxels.size() ) );
+        writer.putBytes( brick.m_compressedVoxels.data(), brick.m_compressedVoxels.size() );
+    }
+
+    return writer.record();
+}
+
+
+std::vector<char> makeDiscardRecord( const SegJournal::SegKey& key )
+{
+    RecordWriter writer;
+    writer.put( RecordType::Discard );
+    writer.putKey( key );
+    return writer.record();
+}
+
+
+/// Edits of a segmentation, merged over the records of a journal
+struct MergedSeg
+{
+    glm::uvec3 m_dims;
+    ComponentType m_componentType;
+    std::map< std::tuple<uint32_t, uint32_t, uint32_t>, SegJournal::Brick > m_bricks; //!< Keyed by brick offset
+};
+
+
+/// Apply a record payload to the merged edits. Returns false if the payload is invalid.
+bool applyRecord( const char* payload, size_t size, std::map< SegJournal::SegKey, MergedSeg >& merged )
+{
+    RecordReader reader( payload, size );
+
+    RecordType type;
+    SegJournal::SegKey key;
+
+    if ( ! reader.get( type ) || ! reader.getKey( key ) )
+    {
+        return false;
+    }
+
+    if ( RecordType::Discard == type )
+    {
+        merged.erase( key );
+        return true;
+    }
+
+    if ( RecordType::Bricks != type )
+    {
+        return false;
+    }
+
+    glm::uvec3 dims;
+    uint32_t componentType = 0;
+    uint32_t numBricksInRecord = 0;
+
+    if ( ! reader.getUVec3( dims ) || ! reader.get( componentType ) || ! reader.get( numBricksInRecord ) )
+    {
+        return false;
+    }
+
+    auto it = merged.find( key );
+
+    // Bricks of a segmentation whose dimensions or type changed replace its earlier bricks
+    if ( std::end( merged ) == it || it->second.m_dims != dims ||
+         static_cast<uint32_t>( it->second.m_componentType ) != componentType )
+    {
+        it = merged.insert_or_assign( key, MergedSeg{ dims, static_cast<ComponentType>( componentType ), {} } ).first;
+    }
+
+    for ( uint32_t b = 0; b < numBricksInRecord; ++b )
+    {
+        SegJournal::Brick brick;
+        uint64_t compressedSize = 0;
+
+        if ( ! reader.getUVec3( brick.m_offset ) || ! reader.getUVec3( brick.m_size ) ||
+             ! reader.get( compressedSize ) || compressedSize > reader.remaining() )
+        {
+            return false;
+        }
+
+        brick.m_compressedVoxels.assign( reader.current(), reader.current() + compressedSize );
+        reader.skip( compressedSize );
+
+        const auto offsetKey = std::make_tuple( brick.m_offset.x, brick.m_offset.y, brick.m_offset.z );
+        it->second.m_bricks.insert_or_assign( offsetKey, std::move( brick ) );
+    }
+
+    return true;
+}
+
+
+/// Read the records of a journal file and merge the edits of each segmentation. Reading stops at
+/// the first record that is incomplete or corrupt, such as one that was being written during a crash.
+std::map< SegJournal::SegKey, MergedSeg > readJournal( const std::string& fileName )
+{
+    std::map< SegJournal::SegKey, MergedSeg > merged;
+
+    std::ifstream file( fileName, std::ios::in | std::ios::binary );
+    const std::vector<char> data{ std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() };
+
+    if ( data.size() < sk_fileMagic.size() ||
+         0 != std::memcmp( data.data(), sk_fileMagic.data(), sk_fileMagic.size() ) )
+    {
+        spdlog::warn( "File {} is not a segmentation journal", fileName );
+        return merged;
+    }
+
+    RecordReader reader( data.data() + sk_fileMagic.size(), data.size() - sk_fileMagic.size() );
+    size_t numRecords = 0;
+
+    while ( reader.remaining() > 0 )
+    {
+        uint32_t magic = 0;
+        uint64_t payloadSize = 0;
+        uint32_t crc = 0;
+
+        if ( ! reader.get( magic ) || sk_recordMagic != magic ||
+             ! reader.get( payloadSize ) || payloadSize + sizeof( crc ) > reader.remaining() )
+        {
+            spdlog::warn( "Ignoring incomplete record at the end of segmentation journal {}", fileName );
+            break;
+        }
+
+        const char* payload = reader.current();
+        reader.skip( payloadSize );
+        reader.get( crc );
+
+        if ( crc != computeCrc32( payload, payloadSize ) || ! applyRecord( payload, payloadSize, merged ) )
+        {
+            spdlog::warn( "Ignoring corrupt records at the end of segmentation journal {}", fileName );
+            break;
+        }
+
+        ++numRecords;
+    }
+
+    spdlog::debug( "Read {} records of segmentation journal {}", numRecords, fileName );
+    return merged;
+}
+
+
+/// Append records to a journal file
+bool appendRecords( const std::string& fileName, const std::vector< std::vector<char> >& records )
+{
+    std::ofstream file( fileName, std::ios::out | std::ios::binary | std::ios::app );
+
+    for ( const auto& record : records )
+    {
+        file.write( record.data(), static_cast<std::streamsize>( record.size() ) );
+    }
+
+    return static_cast<bool>( file.flush() );
+}
+
+
+/// Write records to a new journal file that replaces a journal file. The records are written to a
+/// uniquely named temporary file, so that neither the journal nor the temporary file of another
+/// writer is clobbered if writing fails.
+bool writeJournal( const std::string& fileName, const std::vector< std::vector<char> >& records )
+{
+    const std::string tempFileName = fileName + "." + uuids::to_string( generateRandomUuid() ) + ".tmp";
+    std::error_code error;
+
+    {
+        std::ofstream file( tempFileName, std::ios::out | std::ios::binary | std::ios::trunc );
+        file.write( sk_fileMagic.data(), static_cast<std::streamsize>( sk_fileMagic.size() ) );
+
+        if ( ! file.flush() )
+        {
+            spdlog::error( "Unable to create segmentation journal {}", tempFileName );
+            fs::remove( tempFileName, error );
+            return false;
+        }
+    }
+
+    if ( ! appendRecords( tempFileName, records ) )
+    {
+        spdlog::error( "Unable to write segmentation journal {}", tempFileName );
+        fs::remove( tempFileName, error );
+        return false;
+    }
+
+    fs::rename( tempFileName, fileName, error );
+
+    if ( error )
+    {
+        spdlog::error( "Unable to replace segmentation journal {}: {}", fileName, error.message() );
+        fs::remove( tempFileName, error );
+        return false;
+    }
+
+    return true;
+}
+
+} // anonymous
+
+
+bool SegJournal::SegKey::operator<( const SegKey& other ) const
+{
+    return std::tie( m_imageFileName, m_segFileName, m_segDisplayName ) <
+            std::tie( other.m_imageFileName, other.m_segFileName, other.m_segDisplayName );
+}
+
+bool SegJournal::SegKey::operator==( const SegKey& other ) const
+{
+    return std::tie( m_imageFileName, m_segFileName, m_segDisplayName ) ==
+            std::tie( other.m_imageFileName, other.m_segFileName, other.m_segDisplayName );
+}
+
+
+SegJournal::SegJournal( AppData& appData )
+    :
+      m_appData( appData ),
+      m_fileName( std::nullopt ),
+      m_segs(),
+      m_discardedKeys(),
+      m_recoveredSegs(),
+      m_unreplayedSegs(),
+      m_lockFileName(),
+      m_lockFileDescriptor( -1 ),
+      m_lastAppendTime( std::chrono::steady_clock::now() ),
+      m_append()
+{}
+
+
+SegJournal::~SegJournal()
+{
+    if ( m_append.valid() )
+    {
+        m_append.wait();
+    }
+
+    unlock();
+}
+
+
+bool SegJournal::open( const std::string& fileName )
+{
+    // The journal of a running instance is live: its edits must not be recovered, and the file
+    // must not be compacted while that instance appends to it
+    if ( ! lock( fileName ) )
+    {
+        return false;
+    }
+
+    std::error_code error;
+    std::map< SegKey, MergedSeg > merged;
+
+    if ( fs::exists( fileName, error ) )
+    {
+        merged = readJournal( fileName );
+    }
+
+    // The journal is compacted to the latest version of each brick. The compacted journal is written
+    // to a temporary file that replaces the journal, so that the recovered edits are never lost.
+    std::vector< std::vector<char> > records;
+
+    for ( auto& [key, seg] : merged )
+    {
+        RecoveredSeg recovered{ key, seg.m_dims, seg.m_componentType, {} };
+
+        for ( auto& brick : seg.m_bricks )
+        {
+            recovered.m_bricks.push_back( std::move( brick.second ) );
+        }
+
+        records.push_back( makeBricksRecord( key, recovered.m_dims, recovered.m_componentType, recovered.m_bricks ) );
+        m_recoveredSegs.push_back( std::move( recovered ) );
+    }
+
+    if ( ! writeJournal( fileName, records ) )
+    {
+        spdlog::error( "Unable to compact segmentation journal {}; edits will not be journaled", fileName );
+        m_recoveredSegs.clear();
+        unlock();
+        return false;
+    }
+
+    m_fileName = fileName;
+    m_lastAppendTime = std::chrono::steady_clock::now();
+
+    if ( ! m_recoveredSegs.empty() )
+    {
+        spdlog::info( "Recovered edits of {} segmentation(s) from journal {}", m_recoveredSegs.size(), fileName );
+    }
+
+    spdlog::info( "Journaling segmentation edits to {}", fileName );
+    return true;
+}
+
+
+void SegJournal::close()
+{
+    if ( m_append.valid() )
+    {
+        m_append.wait();
+    }
+
+    if ( m_fileName && m_unreplayedSegs.empty() )
+    {
+        std::error_code error;
+        fs::remove( *m_fileName, error );
+        spdlog::debug( "Removed segmentation journal {}", *m_fileName );
+    }
+    else if ( m_fileName )
+    {
+        // Edits made in this session are saved or abandoned by the user, but recovered edits that were
+        // never replayed have not been seen, so the journal is rewritten to hold only them
+        std::vector< std::vector<char> > records;
+
+        for ( const auto& recovered : m_unreplayedSegs )
+        {
+            records.push_back( makeBricksRecord( recovered.m_key, recovered.m_dims,
+                                                 recovered.m_componentType, recovered.m_bricks ) );
+        }
+
+        if ( writeJournal( *m_fileName, records ) )
+        {
+            spdlog::warn( "Kept recovered edits of {} segmentation(s) that were not replayed in journal {}",
+                          m_unreplayedSegs.size(), *m_fileName );
+        }
+        else
+        {
+            spdlog::warn( "Journal {} was kept with the recovered edits of {} segmentation(s) that were not replayed",
+                          *m_fileName, m_unreplayedSegs.size() );
+        }
+
+        m_unreplayedSegs.clear();
+    }
+
+    m_fileName = std::nullopt;
+    unlock();
+}
+
+
+std::vector<SegJournal::RecoveredSeg> SegJournal::takeRecoveredSegs()
+{
+    return std::move( m_recoveredSegs );
+}
+
+
+void SegJournal::keepUnreplayed( RecoveredSeg recovered )
+{
+    m_unreplayedSegs.push_back( std::move( recovered ) );
+}
+
+
+void SegJournal::setKey( const uuids::uuid& segUid, const SegKey& key )
+{
+    m_segs[segUid].m_key = key;
+}
+
+
+void SegJournal::markDirty( const uuids::uuid& segUid, const glm::uvec3& offset, const glm::uvec3& size )
+{
+    if ( ! m_fileName || 0 == size.x || 0 == size.y || 0 == size.z )
+    {
+        return;
+    }
+
+    const Image* seg = m_appData.seg( segUid );
+    if ( ! seg )
+    {
+        return;
+    }
+
+    const glm::uvec3 counts = numBricks( seg->header().pixelDimensions() );
+    const glm::uvec3 first = offset / sk_brickSize;
+    const glm::uvec3 last = glm::min( ( offset + size - glm::uvec3{ 1 } ) / sk_brickSize, counts - glm::uvec3{ 1 } );
+
+    SegState& state = m_segs[segUid];
+
+    for ( uint32_t k = first.z; k <= last.z; ++k )
+    {
+        for ( uint32_t j = first.y; j <= last.y; ++j )
+        {
+            for ( uint32_t i = first.x; i <= last.x; ++i )
+            {
+                const size_t index = i + static_cast<size_t>( counts.x ) * ( j + static_cast<size_t>( counts.y ) * k );
+
+                state.m_dirtyBricks.insert( index );
+
+                if ( state.m_bricksWrittenDuringSave )
+                {
+                    state.m_bricksWrittenDuringSave->insert( index );
+                }
+            }
+        }
+    }
+}
+
+
+void SegJournal::beginSave( const uuids::uuid& segUid )
+{
+    if ( m_fileName )
+    {
+        m_segs[segUid].m_bricksWrittenDuringSave.emplace();
+    }
+}
+
+
+void SegJournal::endSave( const uuids::uuid& segUid, bool saved )
+{
+    auto it = m_segs.find( segUid );
+    if ( std::end( m_segs ) == it )
+    {
+        return;
+    }
+
+    SegState& state = it->second;
+
+    if ( saved )
+    {
+        // Edits up to the start of the save are in the saved file. Bricks that were written during the
+        // save may have been appended under the old key, so they are appended again under the new key.
+        if ( state.m_key )
+        {
+            m_discardedKeys.push_back( *state.m_key );
+            state.m_key = std::nullopt;
+        }
+
+        state.m_dirtyBricks.clear();
+
+        if ( state.m_bricksWrittenDuringSave )
+        {
+            state.m_dirtyBricks = std::move( *state.m_bricksWrittenDuringSave );
+        }
+    }
+
+    state.m_bricksWrittenDuringSave = std::nullopt;
+}
+
+
+void SegJournal::forget( const uuids::uuid& segUid )
+{
+    auto it = m_segs.find( segUid );
+    if ( std::end( m_segs ) == it )
+    {
+        return;
+    }
+
+    if ( it->second.m_key )
+    {
+        m_discardedKeys.push_back( *it->second.m_key );
+    }
+
+    m_segs.erase( it );
+}
+
+
+void SegJournal::update()
+{
+    if ( ! m_fileName )
+    {
+        return;
+    }
+
+    if ( m_append.valid() )
+    {
+        if ( std::future_status::ready != m_append.wait_for( std::chrono::seconds( 0 ) ) )
+        {
+            return;
+        }
+
+        m_append.get();
+    }
+
+    if ( std::chrono::steady_clock::now() - m_lastAppendTime < sk_appendInterval )
+    {
+        return;
+    }
+
+    appendAsync();
+}
+
+
+std::optional<SegJournal::SegKey> SegJournal::makeKey( const uuids::uuid& segUid ) const
+{
+    const Image* seg = m_appData.seg( segUid );
+    if ( ! seg )
+    {
+        return std::nullopt;
+    }
+
+    for ( const auto& imageUid : m_appData.imageUidsOrdered() )
+    {
+        const auto segUids = m_appData.imageToSegUids( imageUid );
+
+        if ( std::end( segUids ) == std::find( std::begin( segUids ), std::end( segUids ), segUid ) )
+        {
+            continue;
+        }
+
+        if ( const Image* image = m_appData.image( imageUid ) )
+        {
+            return SegKey{ image->header().fileName(), seg->header().fileName(), seg->settings().displayName() };
+        }
+    }
+
+    return std::nullopt;
+}
+
+
+void SegJournal::appendAsync()
+{
+    m_lastAppendTime = std::chrono::steady_clock::now();
+
+    /// Uncompressed voxels of the dirty bricks of a segmentation
+    struct DirtySeg
+    {
+        SegKey m_key;
+        glm::uvec3 m_dims;
+        ComponentType m_componentType;
+        std::vector<Brick> m_bricks;
+    };
+
+    std::vector<DirtySeg> dirtySegs;
+
+    for ( auto it = std::begin( m_segs ); it != std::end( m_segs ); )
+    {
+        auto& [segUid, state] = *it;
+        const Image* seg = m_appData.seg( segUid );
+
+        if ( ! seg )
+        {
+            it = m_segs.erase( it );
+            continue;
+        }
+
+        if ( state.m_dirtyBricks.empty() )
+        {
+            ++it;
+            continue;
+        }
+
+        if ( ! state.m_key )
+        {
+            state.m_key = makeKey( segUid );
+
+            if ( ! state.m_key )
+            {
+                ++it;
+                continue;
+            }
+        }
+
+        const glm::uvec3 dims = seg->header().pixelDimensions();
+        const glm::uvec3 counts = numBricks( dims );
+
+        DirtySeg dirtySeg{ *state.m_key, dims, seg->header().memoryComponentType(), {} };
+
+        // The voxels of the dirty bricks are copied here, since the segmentation may be edited while
+        // they are compressed and appended on the worker thread
+        for ( const size_t index : state.m_dirtyBricks )
+        {
+            const glm::uvec3 brickIndex{
+                static_cast<uint32_t>( index % counts.x ),
+                static_cast<uint32_t>( ( index / counts.x ) % counts.y ),
+                static_cast<uint32_t>( index / ( static_cast<size_t>( counts.x ) * counts.y ) ) };
+
+            Brick brick;
+            brick.m_offset = brickIndex * sk_brickSize;
+            brick.m_size = glm::min( glm::uvec3{ sk_brickSize }, dims - brick.m_offset );
+
+            seg->visitBlock( 0, brick.m_offset, brick.m_size, [&brick] ( const auto& view )
+            {
+                using T = std::remove_const_t< typename std::decay_t<decltype( view )>::ValueType >;
+
+                std::vector<char>& voxels = brick.m_compressedVoxels;
+                voxels.resize( view.numPixels() * sizeof( T ) );
+                T* dest = reinterpret_cast<T*>( voxels.data() );
+
+                view.forEachVoxel( [&dest] ( const T& value, uint32_t, uint32_t, uint32_t )
+                {
+                    *dest++ = value;
+                } );
+            } );
+
+            dirtySeg.m_bricks.push_back( std::move( brick ) );
+        }
+
+        state.m_dirtyBricks.clear();
+        dirtySegs.push_back( std::move( dirtySeg ) );
+        ++it;
+    }
+
+    if ( dirtySegs.empty() && m_discardedKeys.empty() )
+    {
+        return;
+    }
+
+    m_append = std::async( std::launch::async,
+                           [fileName = *m_fileName, discardedKeys = std::move( m_discardedKeys ),
+                           dirtySegs = std::move( dirtySegs )] () mutable
+    {
+        std::vector< std::vector<char> > records;
+        size_t numBricksAppended = 0;
+
+        // Discards precede the bricks that were gathered after them
+        for ( const auto& key : discardedKeys )
+        {
+            records.push_back( makeDiscardRecord( key ) );
+        }
+
+        for ( auto& dirtySeg : dirtySegs )
+        {
+            for ( auto& brick : dirtySeg.m_bricks )
+            {
+                brick.m_compressedVoxels = deflateBuffer( brick.m_compressedVoxels.data(), brick.m_compressedVoxels.size() );
+            }
+
+            records.push_back( makeBricksRecord( dirtySeg.m_key, dirtySeg.m_dims, dirtySeg.m_componentType, dirtySeg.m_bricks ) );
+            numBricksAppended += dirtySeg.m_bricks.size();
+        }
+
+        if ( appendRecords( fileName, records ) )
+        {
+            spdlog::debug( "Appended {} segmentation brick(s) to journal {}", numBricksAppended, fileName );
+        }
+        else
+        {
+            spdlog::error( "Unable to append segmentation edits to journal {}", fileName );
+        }
+    } );
+
+    m_discardedKeys.clear();
+}
+
+
+bool SegJournal::lock( const std::string& fileName )
+{
+#if defined( _WIN32 )
+    // Advisory locks are not supported on this platform, so the journal is not protected from
+    // other instances of the application
+    static_cast<void>( fileName );
+    return true;
+#else
+    const std::string lockFileName = fileName + ".lock";
+
+    // The lock file is removed by the holder when it unlocks, so a lock that is taken on a file that
+    // was removed in the meantime is retaken on the new lock file
+    while ( true )
+    {
+        const int fd = ::open( lockFileName.c_str(), O_RDWR | O_CREAT, 0644 );
+
+        if ( fd < 0 )
+        {
+            spdlog::error( "Unable to create lock file {} of segmentation journal: {}",
+                           lockFileName, std::strerror( errno ) );
+            return false;
+        }
+
+        if ( 0 != ::flock( fd, LOCK_EX | LOCK_NB ) )
+        {
+            const int lockError = errno;
+            ::close( fd );
+
+            if ( EWOULDBLOCK == lockError )
+            {
+                spdlog::warn( "Segmentation journal {} is in use by another instance of the application; "
+                              "its edits are not recovered", fileName );
+            }
+            else
+            {
+                spdlog::error( "Unable to lock segmentation journal {}: {}", fileName, std::strerror( lockError ) );
+            }
+
+            return false;
+        }
+
+        struct stat lockedStat;
+        struct stat currentStat;
+
+        if ( 0 == ::fstat( fd, &lockedStat ) && 0 == ::stat( lockFileName.c_str(), &currentStat ) &&
+             lockedStat.st_dev == currentStat.st_dev && lockedStat.st_ino == currentStat.st_ino )
+        {
+            m_lockFileName = lockFileName;
+            m_lockFileDescriptor = fd;
+            return true;
+        }
+
+        ::close( fd );
+    }
+#endif
+}
+
+
+void SegJournal::unlock()
+{
+#if ! defined( _WIN32 )
+    if ( m_lockFileDescriptor < 0 )
+    {
+        return;
+    }
+
+    // The lock file is removed while it is locked. A process that opened it before then finds that
+    // it locked a removed file, and retakes the lock on a new one (see lock).
+    std::error_code error;
+    fs::remove( m_lockFileName, error );
+
+    ::flock( m_lockFileDescriptor, LOCK_UN );
+    ::close( m_lockFileDescriptor );
+
+    m_lockFileName.clear();
+    m_lockFileDescriptor = -1;
+#endif
+}
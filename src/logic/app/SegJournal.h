@@ -0,0 +1,177 @@
+#ifndef SEG_JOURNAL_H
+#define SEG_JOURNAL_H
+
+#include "common/Types.h"
+
+#include <glm/vec3.hpp>
+
+#include <uuid.h>
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+class AppData;
+
+
+/**
+ * @brief Crash-safe journal of the edits made to segmentations. Segmentations are divided into
+ * cubic bricks. The bricks that are written by painting, clearing, and GridCuts are marked dirty,
+ * and the dirty bricks are periodically appended to a journal file on a worker thread. After a crash,
+ * the journal is replayed onto the original segmentations when the project is opened again.
+ *
+ * Each segmentation is identified in the journal by the file of its image, its own file (if it has
+ * one), and its display name. When a segmentation is saved, its earlier bricks are discarded from the
+ * journal, since the saved file holds them. The journal file is removed when the application exits
+ * normally, unless it holds recovered edits that could not be replayed.
+ *
+ * An open journal is held with an advisory lock on a lock file next to it, so that another instance
+ * of the application that opens the same journal neither recovers nor removes the live edits.
+ *
+ * The journal is an append-only sequence of records, each with a checksum, so a record that was
+ * only partly written when the application crashed is detected and ignored. Values are written in
+ * native byte order, since the journal is only read on the machine that wrote it.
+ *
+ * @note Functions must be called on the render thread.
+ */
+class SegJournal
+{
+public:
+
+    /// Number of voxels along each side of a brick
+    static constexpr uint32_t sk_brickSize = 64;
+
+    /// Identifies a segmentation across sessions
+    struct SegKey
+    {
+        std::string m_imageFileName; //!< File of the image of the segmentation
+        std::string m_segFileName; //!< File of the segmentation; empty if it has none
+        std::string m_segDisplayName; //!< Display name of the segmentation
+
+        bool operator<( const SegKey& ) const;
+        bool operator==( const SegKey& ) const;
+    };
+
+    /// Brick of a segmentation whose voxels, in the in-memory component type of the segmentation,
+    /// are zlib-compressed. Voxel (i, j, k) of the brick is at index i + size.x * ( j + size.y * k ).
+    struct Brick
+    {
+        glm::uvec3 m_offset; //!< Voxel offset of the brick in the segmentation
+        glm::uvec3 m_size; //!< Size of the brick in voxels, which is smaller at the segmentation edges
+        std::vector<char> m_compressedVoxels;
+    };
+
+    /// Edits of a segmentation that were recovered from the journal of an earlier session
+    struct RecoveredSeg
+    {
+        SegKey m_key;
+        glm::uvec3 m_dims; //!< Dimensions of the segmentation in voxels
+        ComponentType m_componentType; //!< In-memory component type of the segmentation
+        std::vector<Brick> m_bricks; //!< Latest version of each edited brick
+    };
+
+
+    explicit SegJournal( AppData& );
+
+    SegJournal( const SegJournal& ) = delete;
+    SegJournal& operator=( const SegJournal& ) = delete;
+
+    /// Waits for the journal to finish appending and releases its lock. The journal file is kept.
+    ~SegJournal();
+
+    /**
+     * @brief Open a journal file. If the file exists, then the segmentation edits in it are recovered
+     * (see takeRecoveredSegs) and the file is compacted to hold only the latest version of each brick.
+     * @return True iff the journal file was opened. False if it is locked by another instance of the
+     * application, in which case nothing is recovered.
+     */
+    bool open( const std::string& fileName );
+
+    /// @brief Finish appending and remove the journal file, when the application exits normally.
+    /// Recovered edits that were returned with keepUnreplayed are kept in the journal file instead.
+    void close();
+
+    /// @brief Take the segmentation edits that were recovered when the journal was opened
+    std::vector<RecoveredSeg> takeRecoveredSegs();
+
+    /// @brief Return recovered edits that could not be replayed onto a segmentation, so that they
+    /// are kept in the journal file when it is closed
+    void keepUnreplayed( RecoveredSeg recovered );
+
+    /// @brief Identify a segmentation of this session with the key of a recovered segmentation,
+    /// so that its edits are journaled under that key
+    void setKey( const uuids::uuid& segUid, const SegKey& key );
+
+    /// @brief Mark the bricks of a segmentation that intersect a written block of voxels as dirty
+    void markDirty( const uuids::uuid& segUid, const glm::uvec3& offset, const glm::uvec3& size );
+
+    /// @brief Mark the start of a save of a segmentation, whose file then holds all of its edits
+    /// that were made so far
+    void beginSave( const uuids::uuid& segUid );
+
+    /// @brief Mark the end of a save of a segmentation. If the save succeeded, then the edits that were
+    /// journaled before the save are discarded and later edits are journaled under the new file name.
+    void endSave( const uuids::uuid& segUid, bool saved );
+
+    /// @brief Discard the edits of a segmentation that is removed from the project
+    void forget( const uuids::uuid& segUid );
+
+    /// @brief Append the dirty bricks to the journal on a worker thread if enough time has passed since
+    /// the last append and the last append is done. Call this before rendering each frame.
+    void update();
+
+
+private:
+
+    /// Journaling state of a segmentation
+    struct SegState
+    {
+        std::optional<SegKey> m_key; //!< Set when the segmentation is first journaled
+        std::unordered_set<size_t> m_dirtyBricks; //!< Linear indices of the dirty bricks
+
+        /// Bricks that have been written since the start of a save that is in progress
+        std::optional< std::unordered_set<size_t> > m_bricksWrittenDuringSave;
+    };
+
+    /// Get the key of a segmentation from its current image, file, and display names
+    std::optional<SegKey> makeKey( const uuids::uuid& segUid ) const;
+
+    /// Start appending the dirty bricks and discarded segmentations to the journal on a worker thread
+    void appendAsync();
+
+    /// Take the lock of a journal file. Returns false if it is held by another process.
+    bool lock( const std::string& fileName );
+
+    /// Release the lock of the journal file and remove the lock file
+    void unlock();
+
+    AppData& m_appData;
+
+    std::optional<std::string> m_fileName; //!< Journal file; not set if the journal is not open
+
+    std::unordered_map< uuids::uuid, SegState > m_segs;
+
+    /// Keys of segmentations whose earlier edits are discarded by the next append
+    std::vector<SegKey> m_discardedKeys;
+
+    std::vector<RecoveredSeg> m_recoveredSegs;
+
+    /// Recovered edits that were not replayed, which are kept in the journal file when it is closed
+    std::vector<RecoveredSeg> m_unreplayedSegs;
+
+    std::string m_lockFileName; //!< Lock file of the journal; empty if the lock is not held
+    int m_lockFileDescriptor; //!< Descriptor of the locked lock file; -1 if the lock is not held
+
+    std::chrono::steady_clock::time_point m_lastAppendTime;
+
+    /// Append that is in progress on a worker thread
+    std::future<void> m_append;
+};
+
+#endif // SEG_JOURNAL_H
@@ -208,6 +208,11 @@ void to_json( json& j, const serialize::Image& image )
     {
         j[ "landmarks" ] = image.m_landmarkGroups;
     }
+
+    if ( image.m_quantizeFloatValues )
+    {
+        j[ "quantize" ] = image.m_quantizeFloatValues;
+    }
 }
 
 void from_json( const json& j, serialize::Image& image )
@@ -238,6 +243,11 @@ void from_json( const json& j, serialize::Image& image )
     {
         j.at( "landmarks" ).get_to( image.m_landmarkGroups );
     }
+
+    if ( j.count( "quantize" ) )
+    {
+        image.m_quantizeFloatValues = j.at( "quantize" ).get<bool>();
+    }
 }
 
 
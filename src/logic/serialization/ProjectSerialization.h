@@ -94,6 +94,9 @@ struct Image
 
     /// Image settings
     serialize::ImageSettings m_settings;
+
+    /// Flag to hold floating-point image values as quantized 16-bit integers in memory
+    bool m_quantizeFloatValues = false;
 };
 
 
@@ -0,0 +1,297 @@
+#include "rendering/FrameTextureRing.h"
+#include "rendering/TextureSetup.h"
+
+#include "common/ThreadPool.h"
+#include "image/Image.h"
+
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/ostr.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+
+FrameTextureRing::FrameTextureRing(
+        const uuids::uuid& imageUid,
+        const Image& image,
+        size_t numSlots,
+        size_t numStagingBuffers )
+    :
+      m_imageUid( imageUid ),
+      m_dims( image.header().pixelDimensions() ),
+      m_format( imageTextureBufferPixelFormat( image ) ),
+      m_type( GLTexture::getBufferPixelDataType( image.header().memoryComponentType() ) ),
+      m_frameSizeInBytes( image.frameSizeInBytes() ),
+      m_shownFrame( image.settings().activeFrame() ),
+      m_slots(),
+      m_stagingBuffers()
+{
+    const size_t numFrames = image.header().numFrames();
+
+    // No more slots are needed than there are frames other than the shown one
+    numSlots = std::min( numSlots, ( numFrames > 0 ) ? numFrames - 1 : 0 );
+
+    for ( size_t i = 0; i < numSlots; ++i )
+    {
+        Slot slot;
+        slot.m_textures = createImageComponentTextures( imageUid, image, std::nullopt );
+
+        if ( slot.m_textures.empty() )
+        {
+            spdlog::warn( "Unable to create frame textures for image {}", imageUid );
+            m_slots.clear();
+            return;
+        }
+
+        m_slots.emplace_back( std::move( slot ) );
+    }
+
+    if ( m_slots.empty() )
+    {
+        return;
+    }
+
+    // Each staging buffer holds one frame for all textures of the image
+    const size_t stagingSize = m_frameSizeInBytes * m_slots.front().m_textures.size();
+
+    for ( size_t i = 0; i < numStagingBuffers; ++i )
+    {
+        GLBufferObject pbo( BufferType::PixelUnpack, BufferUsagePattern::StreamDraw );
+        pbo.generate();
+        pbo.allocate( stagingSize, nullptr );
+        pbo.unbind();
+
+        m_stagingBuffers.emplace_back( std::move( pbo ) );
+    }
+
+    spdlog::debug( "Created ring of {} frame textures and {} staging buffers of {} bytes for image {}",
+                   m_slots.size(), m_stagingBuffers.size(), stagingSize, imageUid );
+}
+
+
+FrameTextureRing::~FrameTextureRing()
+{
+    for ( StagingBuffer& staging : m_stagingBuffers )
+    {
+        if ( staging.m_busy && staging.m_copy.valid() )
+        {
+            staging.m_copy.wait();
+        }
+    }
+}
+
+
+uint32_t FrameTextureRing::shownFrame() const
+{
+    return m_shownFrame;
+}
+
+
+size_t FrameTextureRing::numSlots() const
+{
+    return m_slots.size();
+}
+
+
+void FrameTextureRing::completeUploads()
+{
+    static constexpr GLint sk_mipmapLevel = 0;
+    static const glm::uvec3 sk_origin{ 0, 0, 0 };
+
+    for ( StagingBuffer& staging : m_stagingBuffers )
+    {
+        if ( ! staging.m_busy ||
+             std::future_status::ready != staging.m_copy.wait_for( std::chrono::seconds( 0 ) ) )
+        {
+            continue;
+        }
+
+        Slot& slot = m_slots.at( staging.m_slot );
+        staging.m_busy = false;
+        slot.m_pending = false;
+
+        staging.m_pbo.bind();
+        const bool unmapped = staging.m_pbo.unmap();
+
+        try
+        {
+            staging.m_copy.get();
+        }
+        catch ( const std::exception& e )
+        {
+            spdlog::error( "Error staging frame {} of image {}: {}", staging.m_frame, m_imageUid, e.what() );
+            staging.m_pbo.unbind();
+            continue;
+        }
+
+        if ( ! unmapped )
+        {
+            // The contents of the buffer were lost while it was mapped
+            spdlog::warn( "Staged frame {} of image {} was corrupted", staging.m_frame, m_imageUid );
+            staging.m_pbo.unbind();
+            continue;
+        }
+
+        // With the buffer bound for unpacking, the data pointer is an offset into the buffer
+        for ( size_t t = 0; t < slot.m_textures.size(); ++t )
+        {
+            const GLvoid* offset = reinterpret_cast<const GLvoid*>( t * m_frameSizeInBytes );
+            slot.m_textures[t].setSubData( sk_mipmapLevel, sk_origin, m_dims, m_format, m_type, offset );
+        }
+
+        staging.m_pbo.unbind();
+        slot.m_frame = staging.m_frame;
+
+        spdlog::trace( "Uploaded frame {} of image {}", staging.m_frame, m_imageUid );
+    }
+}
+
+
+bool FrameTextureRing::showFrame( const Image& image, uint32_t frame, std::vector<GLTexture>& shownTextures )
+{
+    static constexpr GLint sk_mipmapLevel = 0;
+    static const glm::uvec3 sk_origin{ 0, 0, 0 };
+
+    for ( Slot& slot : m_slots )
+    {
+        if ( slot.m_frame && frame == *slot.m_frame )
+        {
+            std::swap( slot.m_textures, shownTextures );
+            slot.m_frame = m_shownFrame;
+            m_shownFrame = frame;
+            return true;
+        }
+    }
+
+    for ( size_t t = 0; t < shownTextures.size(); ++t )
+    {
+        const void* data = image.frameBufferAsVoid( static_cast<uint32_t>( t ), frame );
+        if ( ! data )
+        {
+            spdlog::warn( "Frame {} of image {} is not resident", frame, m_imageUid );
+            return false;
+        }
+
+        shownTextures[t].setSubData( sk_mipmapLevel, sk_origin, m_dims, m_format, m_type, data );
+    }
+
+    m_shownFrame = frame;
+    spdlog::trace( "Frame {} of image {} was not prefetched", frame, m_imageUid );
+    return false;
+}
+
+
+void FrameTextureRing::prefetch(
+        const Image& image,
+        const std::vector<uint32_t>& frames,
+        ThreadPool& pool )
+{
+    if ( m_slots.empty() )
+    {
+        return;
+    }
+
+    // Shallow copy of the image that keeps its buffers alive while they are copied
+    std::shared_ptr<const Image> imageCopy;
+
+    const uint32_t numTextures = static_cast<uint32_t>( m_slots.front().m_textures.size() );
+
+    for ( uint32_t frame : frames )
+    {
+        if ( frame == m_shownFrame || frame >= image.header().numFrames() || isHeldOrPending( frame ) )
+        {
+            continue;
+        }
+
+        auto staging = std::find_if( std::begin( m_stagingBuffers ), std::end( m_stagingBuffers ),
+                                     [] ( const StagingBuffer& s ) { return ! s.m_busy; } );
+
+        if ( std::end( m_stagingBuffers ) == staging )
+        {
+            return;
+        }
+
+        // Prefer an empty slot, then one that holds a frame that is not wanted
+        auto isFree = [&frames] ( const Slot& s ) {
+            return ! s.m_pending && ( ! s.m_frame ||
+                    std::end( frames ) == std::find( std::begin( frames ), std::end( frames ), *s.m_frame ) );
+        };
+
+        auto slot = std::find_if( std::begin( m_slots ), std::end( m_slots ),
+                                  [&isFree] ( const Slot& s ) { return ! s.m_frame && isFree( s ); } );
+
+        if ( std::end( m_slots ) == slot )
+        {
+            slot = std::find_if( std::begin( m_slots ), std::end( m_slots ), isFree );
+        }
+
+        if ( std::end( m_slots ) == slot )
+        {
+            return;
+        }
+
+        staging->m_pbo.bind();
+        void* mapped = staging->m_pbo.mapRange(
+                    0, static_cast<GLsizeiptr>( staging->m_pbo.size() ),
+                    { BufferMapRangeAccessFlag::MapWriteBit, BufferMapRangeAccessFlag::InvalidateBufferBit } );
+        staging->m_pbo.unbind();
+
+        if ( ! mapped )
+        {
+            spdlog::warn( "Unable to map staging buffer for frame {} of image {}", frame, m_imageUid );
+            return;
+        }
+
+        slot->m_frame = std::nullopt;
+        slot->m_pending = true;
+
+        staging->m_slot = static_cast<size_t>( std::distance( std::begin( m_slots ), slot ) );
+        staging->m_frame = frame;
+        staging->m_busy = true;
+
+        if ( ! imageCopy )
+        {
+            imageCopy = std::make_shared<const Image>( image );
+        }
+
+        const size_t frameSize = m_frameSizeInBytes;
+
+        staging->m_copy = pool.submit( [image = imageCopy, mapped, frame, numTextures, frameSize] ()
+        {
+            for ( uint32_t t = 0; t < numTextures; ++t )
+            {
+                const void* src = image->frameBufferAsVoid( t, frame );
+                if ( ! src )
+                {
+                    throw std::runtime_error( "Frame buffer is not resident" );
+                }
+
+                std::memcpy( static_cast<char*>( mapped ) + t * frameSize, src, frameSize );
+            }
+        } );
+    }
+}
+
+
+bool FrameTextureRing::isHeldOrPending( uint32_t frame ) const
+{
+    for ( const Slot& slot : m_slots )
+    {
+        if ( slot.m_frame && frame == *slot.m_frame )
+        {
+            return true;
+        }
+    }
+
+    for ( const StagingBuffer& staging : m_stagingBuffers )
+    {
+        if ( staging.m_busy && frame == staging.m_frame )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
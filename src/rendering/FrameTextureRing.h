@@ -0,0 +1,107 @@
+#ifndef FRAME_TEXTURE_RING_H
+#define FRAME_TEXTURE_RING_H
+
+#include "rendering/utility/gl/GLBufferObject.h"
+#include "rendering/utility/gl/GLTexture.h"
+
+#include <uuid.h>
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+#include <vector>
+
+class Image;
+class ThreadPool;
+
+
+/**
+ * @brief Ring of textures that hold the time frames of a time series image that are about to be
+ * shown, so that stepping through the frames (e.g. in cine playback) does not stall on uploads.
+ *
+ * The textures of the shown frame are those of the image in RenderData::m_imageTextures. Frames
+ * are prefetched into the slots of the ring through pixel unpack buffers (PBOs): a worker thread
+ * copies the voxels of a frame into a mapped buffer, after which the render thread uploads the
+ * buffer to the slot's textures. Showing a prefetched frame swaps its textures with the shown ones.
+ *
+ * @note Functions must be called on the render thread with the OpenGL context current.
+ */
+class FrameTextureRing
+{
+public:
+
+    /// @param[in] numSlots Number of frames held in the ring, in addition to the shown frame
+    /// @param[in] numStagingBuffers Number of frames that can be staged in buffers at once
+    FrameTextureRing( const uuids::uuid& imageUid, const Image& image,
+                      size_t numSlots, size_t numStagingBuffers );
+
+    FrameTextureRing( const FrameTextureRing& ) = delete;
+    FrameTextureRing& operator=( const FrameTextureRing& ) = delete;
+
+    /// Waits for copies to staging buffers that are in progress
+    ~FrameTextureRing();
+
+    /// Get the frame held in the shown textures
+    uint32_t shownFrame() const;
+
+    /// Upload the frames whose copies to staging buffers have finished to their slots
+    void completeUploads();
+
+    /**
+     * @brief Show a frame. If a slot holds the frame, its textures are swapped with the shown textures,
+     * after which the slot holds the previously shown frame. Otherwise, the frame is uploaded to the
+     * shown textures directly.
+     * @return True iff the frame was held in a slot
+     */
+    bool showFrame( const Image& image, uint32_t frame, std::vector<GLTexture>& shownTextures );
+
+    /**
+     * @brief Start prefetching frames into slots that do not hold any of them. Frames are prefetched
+     * in order of priority until no staging buffer or slot is free.
+     * @param[in] image Image whose voxels are copied on worker threads. The copies share its buffers,
+     * which are held until the copies finish.
+     * @param[in] frames Frames to prefetch, in order of priority
+     */
+    void prefetch( const Image& image, const std::vector<uint32_t>& frames, ThreadPool& pool );
+
+    /// Number of frames held in the ring, in addition to the shown frame
+    size_t numSlots() const;
+
+
+private:
+
+    struct Slot
+    {
+        std::vector<GLTexture> m_textures;
+        std::optional<uint32_t> m_frame; //!< Frame held, once it is uploaded
+        bool m_pending = false; //!< Is a frame being staged for this slot?
+    };
+
+    struct StagingBuffer
+    {
+        explicit StagingBuffer( GLBufferObject pbo ) : m_pbo( std::move( pbo ) ) {}
+
+        GLBufferObject m_pbo;
+        std::future<void> m_copy; //!< Copy of voxels into the mapped buffer
+        size_t m_slot = 0; //!< Slot that receives the staged frame
+        uint32_t m_frame = 0; //!< Staged frame
+        bool m_busy = false;
+    };
+
+    bool isHeldOrPending( uint32_t frame ) const;
+
+    uuids::uuid m_imageUid;
+
+    glm::uvec3 m_dims;
+    tex::BufferPixelFormat m_format;
+    tex::BufferPixelDataType m_type;
+
+    size_t m_frameSizeInBytes; //!< Size of one frame of one texture
+    uint32_t m_shownFrame;
+
+    std::vector<Slot> m_slots;
+    std::vector<StagingBuffer> m_stagingBuffers;
+};
+
+#endif // FRAME_TEXTURE_RING_H
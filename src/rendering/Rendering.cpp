@@ -3,10 +3,13 @@
 #include "common/DataHelper.h"
 #include "common/DirectionMaps.h"
 #include "common/Exception.hpp"
+#include "common/LoadProgress.h"
 #include "common/MathFuncs.h"
+#include "common/ThreadPool.h"
 #include "common/Types.h"
 
 #include "image/ImageColorMap.h"
+#include "image/ImagePyramid.h"
 
 #include "logic/app/Data.h"
 #include "logic/camera/CameraHelpers.h"
@@ -14,6 +17,7 @@
 #include "logic/states/AnnotationStateHelpers.h"
 #include "logic/states/FsmList.hpp"
 
+#include "rendering/FrameTextureRing.h"
 #include "rendering/ImageDrawing.h"
 #include "rendering/TextureSetup.h"
 #include "rendering/VectorDrawing.h"
@@ -42,7 +46,10 @@
 #include <nanovg_gl.h>
 
 #include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
+#include <iomanip>
 #include <list>
 #include <memory>
 #include <sstream>
@@ -70,6 +77,139 @@ static const glm::ivec2 sk_zeroIVec2{ 0, 0 };
 
 static const std::string ROBOTO_LIGHT( "robotoLight" );
 
+// Number of frames of a time series image that can be staged for upload at once
+static constexpr size_t sk_numFrameStagingBuffers = 2;
+
+/**
+ * @brief Get the frames of a time series image to prefetch, in order of priority. During cine playback,
+ * these are the frames that follow the active frame. Otherwise, they are the neighbors of the active
+ * frame on both sides, which are likely to be shown next when stepping through frames.
+ */
+std::vector<uint32_t> framesToPrefetch( const ImageSettings& settings, size_t numFrames )
+{
+    const int64_t N = static_cast<int64_t>( settings.numFrames() );
+    const int64_t active = static_cast<int64_t>( settings.activeFrame() );
+
+    std::vector<uint32_t> frames;
+
+    if ( settings.cinePlaying() )
+    {
+        for ( int64_t i = 1; i < N && frames.size() < numFrames; ++i )
+        {
+            if ( active + i >= N && ! settings.cineLoop() )
+            {
+                break;
+            }
+
+            frames.push_back( static_cast<uint32_t>( ( active + i ) % N ) );
+        }
+
+        return frames;
+    }
+
+    for ( int64_t i = 1; i < N && frames.size() < numFrames; ++i )
+    {
+        if ( active + i < N )
+        {
+            frames.push_back( static_cast<uint32_t>( active + i ) );
+        }
+
+        if ( active - i >= 0 && frames.size() < numFrames )
+        {
+            frames.push_back( static_cast<uint32_t>( active - i ) );
+        }
+    }
+
+    return frames;
+}
+
+/**
+ * @brief Create gray axial, coronal, and sagittal slices through the center of an image pyramid level
+ * @param[in] level Pyramid level
+ * @param[in] slopeIntercept Slope and intercept that map level values to gray levels in [0, 1]
+ * @return Slices, with rows ordered from top to bottom, such that the highest voxel row is on top
+ */
+std::vector<LoadingPreviewSlice> createLoadingPreviewSlices(
+        const ImagePyramidLevel& level,
+        const std::pair<double, double>& slopeIntercept )
+{
+    const glm::uvec3& d = level.m_dims;
+    const size_t N = static_cast<size_t>( d.x ) * d.y * d.z;
+
+    if ( 0 == N || level.m_values.size() != N )
+    {
+        return {};
+    }
+
+    // Horizontal and vertical axes of the axial, coronal, and sagittal slices
+    static const std::array< glm::ivec2, 3 > sk_sliceAxes{ { { 0, 1 }, { 0, 2 }, { 1, 2 } } };
+
+    std::vector<LoadingPreviewSlice> slices;
+
+    for ( const glm::ivec2& axes : sk_sliceAxes )
+    {
+        LoadingPreviewSlice slice;
+        slice.m_width = static_cast<int>( d[axes.x] );
+        slice.m_height = static_cast<int>( d[axes.y] );
+        slice.m_physicalSize = glm::vec2{ d[axes.x] * level.m_spacing[axes.x],
+                                          d[axes.y] * level.m_spacing[axes.y] };
+        slice.m_rgba.resize( 4 * static_cast<size_t>( slice.m_width ) * slice.m_height );
+
+        glm::uvec3 index = d / 2u;
+        size_t p = 0;
+
+        for ( int y = slice.m_height - 1; y >= 0; --y )
+        {
+            index[axes.y] = static_cast<uint32_t>( y );
+
+            for ( int x = 0; x < slice.m_width; ++x )
+            {
+                index[axes.x] = static_cast<uint32_t>( x );
+
+                const float value = level.m_values[index.x + d.x * ( index.y + static_cast<size_t>( d.y ) * index.z )];
+                const double gray = slopeIntercept.first * value + slopeIntercept.second;
+
+                const uint8_t g = std::isfinite( gray )
+                        ? static_cast<uint8_t>( std::lround( 255.0 * std::clamp( gray, 0.0, 1.0 ) ) ) : 0;
+
+                slice.m_rgba[p++] = g;
+                slice.m_rgba[p++] = g;
+                slice.m_rgba[p++] = g;
+                slice.m_rgba[p++] = 255;
+            }
+        }
+
+        slices.emplace_back( std::move( slice ) );
+    }
+
+    return slices;
+}
+
+/// Get text that describes the progress of loading images, such as "42% of 1024.0 MB at 250.3 MB/s"
+std::string loadProgressText( const LoadProgress* progress )
+{
+    if ( ! progress )
+    {
+        return std::string();
+    }
+
+    const LoadProgress::Summary summary = progress->summary();
+
+    if ( summary.m_cancelled )
+    {
+        return "Cancelling...";
+    }
+
+    static constexpr double sk_bytesPerMegabyte = 1024.0 * 1024.0;
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision( 0 ) << 100.0 * summary.fraction() << "% of "
+       << std::setprecision( 1 ) << summary.m_bytesTotal / sk_bytesPerMegabyte << " MB at "
+       << summary.megabytesPerSecond() << " MB/s (press Esc to cancel)";
+
+    return ss.str();
+}
+
 }
 
 const Uniforms::SamplerIndexVectorType Rendering::msk_imgTexSamplers{ { 0, 1 } };
@@ -98,7 +238,15 @@ Rendering::Rendering( AppData& appData )
       m_simpleProgram( "SimpleProgram" ),
 
       m_isAppDoneLoadingImages( false ),
-      m_showOverlays( true )
+      m_showOverlays( true ),
+
+      m_loadingPreviewSlices(),
+      m_pendingLoadingPreviewSlices( std::nullopt ),
+      m_loadingPreviewMutex(),
+      m_loadProgress( nullptr ),
+
+      m_frameTextureRings(),
+      m_frameStagingPool( nullptr )
 {
     if ( ! m_nvg )
     {
@@ -131,6 +279,11 @@ Rendering::Rendering( AppData& appData )
 
 Rendering::~Rendering()
 {
+    clearLoadingPreview();
+
+    // Rings wait for their staging copies to finish before the staging threads are joined
+    m_frameTextureRings.clear();
+
     if ( m_nvg )
     {
         nvgDeleteGL3( m_nvg );
@@ -190,9 +343,78 @@ void Rendering::initTextures()
     m_appData.renderData().m_imageTextures = createImageTextures( m_appData );
     m_appData.renderData().m_segTextures = createSegTextures( m_appData );
 
+    m_frameTextureRings.clear();
+
+    for ( const auto& imageUid : m_appData.imageUidsOrdered() )
+    {
+        const auto* image = m_appData.image( imageUid );
+
+        if ( image && m_appData.renderData().m_imageTextures.count( imageUid ) > 0 )
+        {
+            createFrameTextureRing( imageUid, *image );
+        }
+    }
+
+    // The full-resolution textures replace the preview
+    clearLoadingPreview();
+
     m_isAppDoneLoadingImages = true;
 }
 
+void Rendering::setLoadingPreview(
+        const ImagePyramidLevel& level,
+        const std::pair<double, double>& slopeIntercept )
+{
+    std::vector<LoadingPreviewSlice> slices = createLoadingPreviewSlices( level, slopeIntercept );
+
+    std::lock_guard<std::mutex> lock( m_loadingPreviewMutex );
+    m_pendingLoadingPreviewSlices = std::move( slices );
+}
+
+void Rendering::setLoadProgress( std::shared_ptr<const LoadProgress> progress )
+{
+    m_loadProgress = std::move( progress );
+}
+
+void Rendering::updateLoadingPreviewImages()
+{
+    std::optional< std::vector<LoadingPreviewSlice> > slices;
+
+    {
+        std::lock_guard<std::mutex> lock( m_loadingPreviewMutex );
+        std::swap( slices, m_pendingLoadingPreviewSlices );
+    }
+
+    if ( ! slices || ! m_nvg )
+    {
+        return;
+    }
+
+    clearLoadingPreview();
+    m_loadingPreviewSlices = std::move( *slices );
+
+    for ( LoadingPreviewSlice& slice : m_loadingPreviewSlices )
+    {
+        slice.m_nvgImage = nvgCreateImageRGBA( m_nvg, slice.m_width, slice.m_height, 0, slice.m_rgba.data() );
+
+        // The pixels are held by the NanoVG image
+        slice.m_rgba = std::vector<uint8_t>();
+    }
+}
+
+void Rendering::clearLoadingPreview()
+{
+    for ( const LoadingPreviewSlice& slice : m_loadingPreviewSlices )
+    {
+        if ( m_nvg && 0 != slice.m_nvgImage )
+        {
+            nvgDeleteImage( m_nvg, slice.m_nvgImage );
+        }
+    }
+
+    m_loadingPreviewSlices.clear();
+}
+
 bool Rendering::createLabelColorTableTexture( const uuids::uuid& labelTableUid )
 {
     static const glm::vec4 sk_border{ 0.0f, 0.0f, 0.0f, 0.0f };
@@ -232,13 +454,117 @@ bool Rendering::createLabelColorTableTexture( const uuids::uuid& labelTableUid )
     return true;
 }
 
+bool Rendering::createImageTextures( const uuids::uuid& imageUid )
+{
+    const auto* image = m_appData.image( imageUid );
+    if ( ! image )
+    {
+        spdlog::warn( "Image {} is invalid", imageUid );
+        return false;
+    }
+
+    if ( m_appData.renderData().m_imageTextures.count( imageUid ) > 0 )
+    {
+        spdlog::warn( "Textures for image {} already exist", imageUid );
+        return false;
+    }
+
+    if ( ! image->hasVoxels() )
+    {
+        spdlog::warn( "Voxels of image {} are not resident", imageUid );
+        return false;
+    }
+
+    std::vector<GLTexture> componentTextures =
+            createImageComponentTextures( imageUid, *image, image->settings().activeFrame() );
+
+    if ( componentTextures.empty() )
+    {
+        return false;
+    }
+
+    m_appData.renderData().m_imageTextures.emplace( imageUid, std::move( componentTextures ) );
+    createFrameTextureRing( imageUid, *image );
+
+    spdlog::debug( "Created texture(s) for image {} ('{}')", imageUid, image->settings().displayName() );
+    return true;
+}
+
+bool Rendering::removeImageTextures( const uuids::uuid& imageUid )
+{
+    m_frameTextureRings.erase( imageUid );
+
+    if ( 0 == m_appData.renderData().m_imageTextures.erase( imageUid ) )
+    {
+        return false;
+    }
+
+    spdlog::debug( "Removed texture(s) of image {}", imageUid );
+    return true;
+}
+
+void Rendering::createFrameTextureRing( const uuids::uuid& imageUid, const Image& image )
+{
+    m_frameTextureRings.erase( imageUid );
+
+    if ( image.header().numFrames() <= 1 )
+    {
+        return;
+    }
+
+    if ( ! m_frameStagingPool )
+    {
+        m_frameStagingPool = std::make_unique<ThreadPool>( sk_numFrameStagingBuffers );
+    }
+
+    m_frameTextureRings.emplace( imageUid, std::make_unique<FrameTextureRing>(
+                                     imageUid, image, NUM_PREFETCHED_FRAMES, sk_numFrameStagingBuffers ) );
+}
+
+void Rendering::updateImageFrames()
+{
+    for ( auto& [imageUid, ring] : m_frameTextureRings )
+    {
+        const auto* image = m_appData.image( imageUid );
+        auto textures = m_appData.renderData().m_imageTextures.find( imageUid );
+
+        if ( ! image || ! ring || std::end( m_appData.renderData().m_imageTextures ) == textures )
+        {
+            continue;
+        }
+
+        ring->completeUploads();
+
+        if ( ! image->hasVoxels() )
+        {
+            continue;
+        }
+
+        const uint32_t frame = image->settings().activeFrame();
+
+        if ( frame != ring->shownFrame() )
+        {
+            ring->showFrame( *image, frame, textures->second );
+
+            // Textures swapped in from the ring may have been created with another interpolation mode
+            updateImageInterpolation( imageUid );
+        }
+
+        ring->prefetch( *image, framesToPrefetch( image->settings(), ring->numSlots() ), *m_frameStagingPool );
+    }
+}
+
+bool Rendering::texturesInitialized() const
+{
+    return m_isAppDoneLoadingImages;
+}
+
 bool Rendering::createSegTexture( const uuids::uuid& segUid )
 {
     // Load the first pixel component of the segmentation.
     // (Segmentations should have only one component.)
     static constexpr uint32_t comp = 0;
 
-    static constexpr GLint sk_mipmapLevel = 0; // Load seg data into first mipmap level
     static constexpr GLint sk_alignment = 1; // Pixel pack/unpack alignment is 1 byte
     static const tex::WrapMode sk_wrapMode = tex::WrapMode::ClampToBorder;
     static const glm::vec4 sk_border{ 0.0f, 0.0f, 0.0f, 0.0f }; // Black border
@@ -276,11 +602,9 @@ bool Rendering::createSegTexture( const uuids::uuid& segUid )
     T.setAutoGenerateMipmaps( true );
     T.setSize( seg->header().pixelDimensions() );
 
-    T.setData( sk_mipmapLevel,
-               GLTexture::getSizedInternalRedFormat( compType ),
-               GLTexture::getBufferPixelRedFormat( compType ),
-               GLTexture::getBufferPixelDataType( compType ),
-               seg->bufferAsVoid( comp ) );
+    setTextureData( T, *seg, comp,
+                    GLTexture::getSizedInternalRedFormat( compType ),
+                    GLTexture::getBufferPixelRedFormat( compType ) );
 
     spdlog::debug( "Created texture for segmentation {} ('{}')",
                    segUid, seg->settings().displayName() );
@@ -349,8 +673,12 @@ void Rendering::updateSegTexture(
         const ComponentType& compType,
         const glm::uvec3& startOffsetVoxel,
         const glm::uvec3& sizeInVoxels,
-        const int64_t* data )
+        const void* data,
+        uint32_t dataRowLength,
+        uint32_t dataImageHeight )
 {
+    static constexpr GLint sk_mipmapLevel = 0;
+
     if ( ! data )
     {
         spdlog::error( "Null segmentation texture data pointer" );
@@ -364,27 +692,22 @@ void Rendering::updateSegTexture(
         return;
     }
 
-    const size_t N = sizeInVoxels.x * sizeInVoxels.y * sizeInVoxels.z;
-
-    switch ( compType )
-    {
-    case ComponentType::UInt8:
-    {
-        const std::vector<uint8_t> castData( data, data + N );
-        return updateSegTexture( segUid, compType, startOffsetVoxel, sizeInVoxels, castData.data() );
-    }
-    case ComponentType::UInt16:
-    {
-        const std::vector<uint16_t> castData( data, data + N );
-        return updateSegTexture( segUid, compType, startOffsetVoxel, sizeInVoxels, castData.data() );
-    }
-    case ComponentType::UInt32:
+    auto it = m_appData.renderData().m_segTextures.find( segUid );
+    if ( std::end( m_appData.renderData().m_segTextures ) == it )
     {
-        const std::vector<uint32_t> castData( data, data + N );
-        return updateSegTexture( segUid, compType, startOffsetVoxel, sizeInVoxels, castData.data() );
-    }
-    default: return;
+        spdlog::error( "Cannot update segmentation {}: texture not found.", segUid );
+        return;
     }
+
+    // The row length and image height of the buffer let the block be read straight out of it
+    it->second.setSubData( sk_mipmapLevel,
+                           startOffsetVoxel,
+                           sizeInVoxels,
+                           GLTexture::getBufferPixelRedFormat( compType ),
+                           GLTexture::getBufferPixelDataType( compType ),
+                           data,
+                           static_cast<GLint>( dataRowLength ),
+                           static_cast<GLint>( dataImageHeight ) );
 }
 
 Rendering::CurrentImages Rendering::getImageAndSegUidsForMetricShaders(
@@ -473,7 +796,14 @@ void Rendering::updateImageInterpolation( const uuids::uuid& imageUid )
     // Modify the active component
     const uint32_t activeComp = image->settings().activeComponent();
 
-    GLTexture& texture = m_appData.renderData().m_imageTextures.at( imageUid ).at( activeComp );
+    // Images whose textures are not resident get the interpolation mode when their textures are created
+    auto it = m_appData.renderData().m_imageTextures.find( imageUid );
+    if ( std::end( m_appData.renderData().m_imageTextures ) == it )
+    {
+        return;
+    }
+
+    GLTexture& texture = it->second.at( activeComp );
 
     tex::MinificationFilter minFilter;
     tex::MagnificationFilter maxFilter;
@@ -555,6 +885,7 @@ void Rendering::render()
 
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
 
+    updateImageFrames();
     renderImageData();
 //    renderOverlays();
     renderVectorOverlays();
@@ -1377,7 +1708,8 @@ void Rendering::renderVectorOverlays()
     }
     else
     {
-        drawLoadingOverlay( m_nvg, windowVP );
+        updateLoadingPreviewImages();
+        drawLoadingOverlay( m_nvg, windowVP, m_loadingPreviewSlices, loadProgressText( m_loadProgress.get() ) );
 
         //            nvgFontSize( m_nvg, 64.0f );
         //            const char* txt = "Text me up.";
@@ -5,6 +5,7 @@
 #include "common/UuidRange.h"
 
 #include "logic/camera/CameraTypes.h"
+#include "rendering/VectorDrawing.h"
 #include "rendering/utility/gl/GLShaderProgram.h"
 
 #include <glm/fwd.hpp>
@@ -13,15 +14,23 @@
 
 #include <array>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 class AppData;
+class FrameTextureRing;
 class GLTexture;
+class Image;
+class ThreadPool;
 class View;
 
+struct ImagePyramidLevel;
+class LoadProgress;
 struct NVGcontext;
 
 namespace camera
@@ -38,15 +47,28 @@ class Rendering
 {
 public:
 
+    /// Number of time frames of a time series image that are prefetched into textures,
+    /// in addition to the textures of the shown frame
+    static constexpr size_t NUM_PREFETCHED_FRAMES = 8;
+
     Rendering( AppData& );
     ~Rendering();
 
     /// Initialization
     void init();
 
-    /// Create image and segmentation textures
+    /// Create image and segmentation textures. This replaces the loading preview.
     void initTextures();
 
+    /// Set a downsampled pyramid level of the reference image to preview while images are loading.
+    /// Values are mapped to gray levels in [0, 1] by slopeIntercept.first * value + slopeIntercept.second.
+    /// Values that are not a number, such as those of blocks that have not been read yet, are black.
+    /// This can be called from any thread.
+    void setLoadingPreview( const ImagePyramidLevel& level, const std::pair<double, double>& slopeIntercept );
+
+    /// Set the progress of loading images, which is shown in the loading overlay
+    void setLoadProgress( std::shared_ptr<const LoadProgress> progress );
+
     /// Render the scene
     void render();
 
@@ -78,15 +100,33 @@ public:
             const glm::uvec3& sizeInVoxels,
             const void* data );
 
+    /**
+     * @brief Updates a block of the texture of a segmentation straight from a larger buffer of voxels
+     * in the in-memory component type of the segmentation (e.g. the segmentation's own buffer)
+     * @param data Pointer to the first voxel of the block
+     * @param dataRowLength Number of voxels between the starts of consecutive rows of the buffer
+     * @param dataImageHeight Number of rows between the starts of consecutive slices of the buffer
+     */
     void updateSegTexture(
             const uuids::uuid& segUid,
             const ComponentType& compType,
             const glm::uvec3& startOffsetVoxel,
             const glm::uvec3& sizeInVoxels,
-            const int64_t* data );
+            const void* data,
+            uint32_t dataRowLength,
+            uint32_t dataImageHeight );
 
     bool createLabelColorTableTexture( const uuids::uuid& labelTableUid );
 
+    /// Create the textures of an image that was added after the textures were initialized
+    bool createImageTextures( const uuids::uuid& imageUid );
+
+    /// Remove the textures of an image, which are created again with createImageTextures
+    bool removeImageTextures( const uuids::uuid& imageUid );
+
+    /// Have the textures been initialized once images were loaded?
+    bool texturesInitialized() const;
+
     bool createSegTexture( const uuids::uuid& segUid );
     bool removeSegTexture( const uuids::uuid& segUid );
 
@@ -116,6 +156,18 @@ private:
     bool createSimpleProgram( GLShaderProgram& program );
     bool createDifferenceProgram( GLShaderProgram& program );
 
+    /// Swap pending loading preview slices in and create their NanoVG images
+    void updateLoadingPreviewImages();
+
+    /// Delete the loading preview slices and their NanoVG images
+    void clearLoadingPreview();
+
+    /// Create the ring of frame textures of an image, if it is a time series
+    void createFrameTextureRing( const uuids::uuid& imageUid, const Image& image );
+
+    /// Show the active time frame of each time series image and prefetch the frames that follow it
+    void updateImageFrames();
+
     void renderImageData();
     void renderOverlays();
     void renderVectorOverlays();
@@ -186,6 +238,24 @@ private:
     bool m_isAppDoneLoadingImages;
 
     bool m_showOverlays;
+
+    /// Slices of the loading preview that are drawn (render thread only)
+    std::vector<LoadingPreviewSlice> m_loadingPreviewSlices;
+
+    /// Slices of the loading preview that have been set, but not yet drawn
+    std::optional< std::vector<LoadingPreviewSlice> > m_pendingLoadingPreviewSlices;
+
+    /// Guards m_pendingLoadingPreviewSlices
+    std::mutex m_loadingPreviewMutex;
+
+    /// Progress of loading images
+    std::shared_ptr<const LoadProgress> m_loadProgress;
+
+    /// Rings of prefetched frame textures of time series images, keyed by image UID
+    std::unordered_map< uuids::uuid, std::unique_ptr<FrameTextureRing> > m_frameTextureRings;
+
+    /// Worker threads that copy frames into staging buffers for upload
+    std::unique_ptr<ThreadPool> m_frameStagingPool;
 };
 
 #endif // RENDERING_H
@@ -1,74 +1,195 @@
 #include "rendering/TextureSetup.h"
 
+#include "image/Image.h"
 #include "logic/app/Data.h"
 
 #include <spdlog/spdlog.h>
 #include <spdlog/fmt/ostr.h>
 
 
-std::unordered_map< uuids::uuid, std::vector<GLTexture> >
-createImageTextures( const AppData& appData )
+void setTextureData(
+        GLTexture& texture,
+        const Image& image,
+        uint32_t component,
+        const tex::SizedInternalFormat& internalFormat,
+        const tex::BufferPixelFormat& format,
+        const std::optional<uint32_t>& frame )
 {
-    static constexpr GLint sk_mipmapLevel = 0; // Load image data into first mipmap level
-    static constexpr GLint sk_alignment = 1; // Pixel pack/unpack alignment is 1 byte
-    static const tex::WrapMode sk_wrapModeClampToEdge = tex::WrapMode::ClampToEdge;
-//    static const tex::WrapMode sk_wrapModeClampToBorder = tex::WrapMode::ClampToBorder;
-    static const glm::vec4 sk_border{ 0.0f, 0.0f, 0.0f, 0.0f }; // Black border
+    static constexpr GLint sk_mipmapLevel = 0;
 
-    // Map from image UID to vector of textures for the image components.
-    // Images with interleaved components will have one component texture.
-    std::unordered_map< uuids::uuid, std::vector<GLTexture> > imageTextures;
+    const tex::BufferPixelDataType type =
+            GLTexture::getBufferPixelDataType( image.header().memoryComponentType() );
 
-    if ( 0 == appData.numImages() )
+    if ( ! frame )
     {
-        spdlog::warn( "No images are loaded for which to create textures" );
-        return imageTextures;
+        texture.setData( sk_mipmapLevel, internalFormat, format, type, nullptr );
+        return;
     }
 
-    spdlog::debug( "Begin creating 3D image textures" );
+    if ( ! image.isBricked() )
+    {
+        texture.setData( sk_mipmapLevel, internalFormat, format, type,
+                         image.frameBufferAsVoid( component, *frame ) );
+        return;
+    }
+
+    // Allocate the texture without data, then fill it with the dense block of each brick
+    texture.setData( sk_mipmapLevel, internalFormat, format, type, nullptr );
+
+    image.visitBlocks( component, [&texture, &format, &type] ( const auto& view, const glm::uvec3& offset )
+    {
+        texture.setSubData( sk_mipmapLevel, offset, view.dims(), format, type, view.row( 0, 0 ) );
+    } );
+
+    spdlog::debug( "Uploaded texture of bricked image '{}' brick by brick", image.settings().displayName() );
+}
+
+
+tex::BufferPixelFormat imageTextureBufferPixelFormat( const Image& image )
+{
+    const ComponentType compType = image.header().memoryComponentType();
+
+    if ( Image::MultiComponentBufferType::SeparateImages == image.bufferType() )
+    {
+        return GLTexture::getBufferPixelNormalizedRedFormat( compType );
+    }
+
+    switch ( image.header().numComponentsPerPixel() )
+    {
+    case 2: return GLTexture::getBufferPixelNormalizedRGFormat( compType );
+    case 3: return GLTexture::getBufferPixelNormalizedRGBFormat( compType );
+    case 4: return GLTexture::getBufferPixelNormalizedRGBAFormat( compType );
+    default: return GLTexture::getBufferPixelNormalizedRedFormat( compType );
+    }
+}
+
+
+std::vector<GLTexture> createImageComponentTextures(
+        const uuids::uuid& imageUid, const Image& image,
+        const std::optional<uint32_t>& frame )
+{
+    static constexpr GLint sk_alignment = 1; // Pixel pack/unpack alignment is 1 byte
+    static const tex::WrapMode sk_wrapModeClampToEdge = tex::WrapMode::ClampToEdge;
+//    static const tex::WrapMode sk_wrapModeClampToBorder = tex::WrapMode::ClampToBorder;
+    static const glm::vec4 sk_border{ 0.0f, 0.0f, 0.0f, 0.0f }; // Black border
 
     GLTexture::PixelStoreSettings pixelPackSettings;
     pixelPackSettings.m_alignment = sk_alignment;
     GLTexture::PixelStoreSettings pixelUnpackSettings = pixelPackSettings;
 
-    for ( const auto& imageUid : appData.imageUidsOrdered() )
+    const ComponentType compType = image.header().memoryComponentType();
+    const uint32_t numComp = image.header().numComponentsPerPixel();
+
+    std::vector<GLTexture> componentTextures;
+
+    switch ( image.bufferType() )
     {
-        spdlog::debug( "Begin creating texture(s) for components of image {}", imageUid );
+    case Image::MultiComponentBufferType::InterleavedImage:
+    {
+        spdlog::debug( "Image {} has {} interleaved components, so one texture will be created.",
+                       imageUid, numComp );
 
-        const auto* image = appData.image( imageUid );
-        if ( ! image )
+        // For images with interleaved components, all components are at index 0
+        constexpr uint32_t k_comp0 = 0;
+
+        if ( 4 < numComp )
         {
-            spdlog::warn( "Image {} is invalid", imageUid );
-            continue;
+            spdlog::warn( "Image {} has {} interleaved components, exceeding the maximum "
+                          "of 4 allowed per texture; it will not be loaded as a texture",
+                          imageUid, numComp );
+            return {};
         }
 
-        const ComponentType compType = image->header().memoryComponentType();
-        const uint32_t numComp = image->header().numComponentsPerPixel();
+        tex::MinificationFilter minFilter;
+        tex::MagnificationFilter maxFilter;
+
+        switch ( image.settings().interpolationMode( k_comp0 ) )
+        {
+        case InterpolationMode::NearestNeighbor:
+        {
+            minFilter = tex::MinificationFilter::Nearest;
+            maxFilter = tex::MagnificationFilter::Nearest;
+            break;
+        }
+        case InterpolationMode::Linear:
+        {
+            minFilter = tex::MinificationFilter::Linear;
+            maxFilter = tex::MagnificationFilter::Linear;
+            break;
+        }
+        }
 
-        std::vector<GLTexture> componentTextures;
+        // The texture pixel format types depend on the number of components
+        tex::SizedInternalFormat sizedInternalNormalizedFormat;
+        tex::BufferPixelFormat bufferPixelNormalizedFormat;
 
-        switch ( image->bufferType() )
+        switch ( numComp )
         {
-        case Image::MultiComponentBufferType::InterleavedImage:
+        case 1:
         {
-            spdlog::debug( "Image {} has {} interleaved components, so one texture will be created.",
-                           imageUid, numComp );
+            // Red:
+            sizedInternalNormalizedFormat = GLTexture::getSizedInternalNormalizedRedFormat( compType );
+            bufferPixelNormalizedFormat = GLTexture::getBufferPixelNormalizedRedFormat( compType );
+            break;
+        }
+        case 2:
+        {
+            // Red, green:
+            sizedInternalNormalizedFormat = GLTexture::getSizedInternalNormalizedRGFormat( compType );
+            bufferPixelNormalizedFormat = GLTexture::getBufferPixelNormalizedRGFormat( compType );
+            break;
+        }
+        case 3:
+        {
+            // Red, green, blue:
+            sizedInternalNormalizedFormat = GLTexture::getSizedInternalNormalizedRGBFormat( compType );
+            bufferPixelNormalizedFormat = GLTexture::getBufferPixelNormalizedRGBFormat( compType );
+            break;
+        }
+        case 4:
+        {
+            // Red, green, blue, alpha:
+            sizedInternalNormalizedFormat = GLTexture::getSizedInternalNormalizedRGBAFormat( compType );
+            bufferPixelNormalizedFormat = GLTexture::getBufferPixelNormalizedRGBAFormat( compType );
+            break;
+        }
+        default:
+        {
+            spdlog::warn( "Image {} has invalid number of components ({}); "
+                          "it will not be loaded as a texture", imageUid, numComp );
+            return {};
+        }
+        }
 
-            // For images with interleaved components, all components are at index 0
-            constexpr uint32_t k_comp0 = 0;
+        GLTexture& T = componentTextures.emplace_back(
+                    tex::Target::Texture3D,
+                    GLTexture::MultisampleSettings(),
+                    pixelPackSettings, pixelUnpackSettings );
 
-            if ( 4 < numComp )
-            {
-                spdlog::warn( "Image {} has {} interleaved components, exceeding the maximum "
-                              "of 4 allowed per texture; it will not be loaded as a texture",
-                              imageUid, numComp );
-                continue;
-            }
+        T.generate();
+        T.setMinificationFilter( minFilter );
+        T.setMagnificationFilter( maxFilter );
+        T.setBorderColor( sk_border );
+        T.setWrapMode( sk_wrapModeClampToEdge );
+        T.setAutoGenerateMipmaps( true );
+        T.setSize( image.header().pixelDimensions() );
 
+        setTextureData( T, image, k_comp0, sizedInternalNormalizedFormat, bufferPixelNormalizedFormat, frame );
+
+        spdlog::debug( "Done creating the texture for all interleaved components of image {}", imageUid );
+        break;
+    }
+    case Image::MultiComponentBufferType::SeparateImages:
+    {
+        spdlog::debug( "Image {} has {} separate components, so {} textures will be created.",
+                       imageUid, numComp, numComp );
+
+        for ( uint32_t comp = 0; comp < numComp; ++comp )
+        {
             tex::MinificationFilter minFilter;
             tex::MagnificationFilter maxFilter;
 
-            switch ( image->settings().interpolationMode( k_comp0 ) )
+            switch ( image.settings().interpolationMode( comp ) )
             {
             case InterpolationMode::NearestNeighbor:
             {
@@ -84,47 +205,12 @@ createImageTextures( const AppData& appData )
             }
             }
 
-            // The texture pixel format types depend on the number of components
-            tex::SizedInternalFormat sizedInternalNormalizedFormat;
-            tex::BufferPixelFormat bufferPixelNormalizedFormat;
+            // Use Red format for each component texture:
+            const tex::SizedInternalFormat sizedInternalNormalizedFormat =
+                    GLTexture::getSizedInternalNormalizedRedFormat( compType );
 
-            switch ( numComp )
-            {
-            case 1:
-            {
-                // Red:
-                sizedInternalNormalizedFormat = GLTexture::getSizedInternalNormalizedRedFormat( compType );
-                bufferPixelNormalizedFormat = GLTexture::getBufferPixelNormalizedRedFormat( compType );
-                break;
-            }
-            case 2:
-            {
-                // Red, green:
-                sizedInternalNormalizedFormat = GLTexture::getSizedInternalNormalizedRGFormat( compType );
-                bufferPixelNormalizedFormat = GLTexture::getBufferPixelNormalizedRGFormat( compType );
-                break;
-            }
-            case 3:
-            {
-                // Red, green, blue:
-                sizedInternalNormalizedFormat = GLTexture::getSizedInternalNormalizedRGBFormat( compType );
-                bufferPixelNormalizedFormat = GLTexture::getBufferPixelNormalizedRGBFormat( compType );
-                break;
-            }
-            case 4:
-            {
-                // Red, green, blue, alpha:
-                sizedInternalNormalizedFormat = GLTexture::getSizedInternalNormalizedRGBAFormat( compType );
-                bufferPixelNormalizedFormat = GLTexture::getBufferPixelNormalizedRGBAFormat( compType );
-                break;
-            }
-            default:
-            {
-                spdlog::warn( "Image {} has invalid number of components ({}); "
-                              "it will not be loaded as a texture", imageUid, numComp );
-                continue;
-            }
-            }
+            const tex::BufferPixelFormat bufferPixelNormalizedFormat =
+                    GLTexture::getBufferPixelNormalizedRedFormat( compType );
 
             GLTexture& T = componentTextures.emplace_back(
                         tex::Target::Texture3D,
@@ -137,74 +223,60 @@ createImageTextures( const AppData& appData )
             T.setBorderColor( sk_border );
             T.setWrapMode( sk_wrapModeClampToEdge );
             T.setAutoGenerateMipmaps( true );
-            T.setSize( image->header().pixelDimensions() );
+            T.setSize( image.header().pixelDimensions() );
+
+            setTextureData( T, image, comp, sizedInternalNormalizedFormat, bufferPixelNormalizedFormat, frame );
+        }
 
-            T.setData( sk_mipmapLevel,
-                       sizedInternalNormalizedFormat,
-                       bufferPixelNormalizedFormat,
-                       GLTexture::getBufferPixelDataType( compType ),
-                       image->bufferAsVoid( k_comp0 ) );
+        spdlog::debug( "Done creating {} image component textures", componentTextures.size() );
+        break;
+    }
+    } // end switch ( image.bufferType() )
 
-            spdlog::debug( "Done creating the texture for all interleaved components of image {}", imageUid );
-            break;
+    return componentTextures;
+}
+
+
+std::unordered_map< uuids::uuid, std::vector<GLTexture> >
+createImageTextures( const AppData& appData )
+{
+    // Map from image UID to vector of textures for the image components.
+    // Images with interleaved components will have one component texture.
+    std::unordered_map< uuids::uuid, std::vector<GLTexture> > imageTextures;
+
+    if ( 0 == appData.numImages() )
+    {
+        spdlog::warn( "No images are loaded for which to create textures" );
+        return imageTextures;
+    }
+
+    spdlog::debug( "Begin creating 3D image textures" );
+
+    for ( const auto& imageUid : appData.imageUidsOrdered() )
+    {
+        spdlog::debug( "Begin creating texture(s) for components of image {}", imageUid );
+
+        const auto* image = appData.image( imageUid );
+        if ( ! image )
+        {
+            spdlog::warn( "Image {} is invalid", imageUid );
+            continue;
         }
-        case Image::MultiComponentBufferType::SeparateImages:
+
+        if ( ! image->hasVoxels() )
         {
-            spdlog::debug( "Image {} has {} separate components, so {} textures will be created.",
-                           imageUid, numComp, numComp );
+            // Textures of images whose voxels are not resident are created once the images are used
+            spdlog::debug( "Voxels of image {} are not resident, so its textures are not created yet", imageUid );
+            continue;
+        }
 
-            for ( uint32_t comp = 0; comp < numComp; ++comp )
-            {
-                tex::MinificationFilter minFilter;
-                tex::MagnificationFilter maxFilter;
-
-                switch ( image->settings().interpolationMode( comp ) )
-                {
-                case InterpolationMode::NearestNeighbor:
-                {
-                    minFilter = tex::MinificationFilter::Nearest;
-                    maxFilter = tex::MagnificationFilter::Nearest;
-                    break;
-                }
-                case InterpolationMode::Linear:
-                {
-                    minFilter = tex::MinificationFilter::Linear;
-                    maxFilter = tex::MagnificationFilter::Linear;
-                    break;
-                }
-                }
-
-                // Use Red format for each component texture:
-                const tex::SizedInternalFormat sizedInternalNormalizedFormat =
-                        GLTexture::getSizedInternalNormalizedRedFormat( compType );
-
-                const tex::BufferPixelFormat bufferPixelNormalizedFormat =
-                        GLTexture::getBufferPixelNormalizedRedFormat( compType );
-
-                GLTexture& T = componentTextures.emplace_back(
-                            tex::Target::Texture3D,
-                            GLTexture::MultisampleSettings(),
-                            pixelPackSettings, pixelUnpackSettings );
-
-                T.generate();
-                T.setMinificationFilter( minFilter );
-                T.setMagnificationFilter( maxFilter );
-                T.setBorderColor( sk_border );
-                T.setWrapMode( sk_wrapModeClampToEdge );
-                T.setAutoGenerateMipmaps( true );
-                T.setSize( image->header().pixelDimensions() );
-
-                T.setData( sk_mipmapLevel,
-                           sizedInternalNormalizedFormat,
-                           bufferPixelNormalizedFormat,
-                           GLTexture::getBufferPixelDataType( compType ),
-                           image->bufferAsVoid( comp ) );
-            }
+        std::vector<GLTexture> componentTextures =
+                createImageComponentTextures( imageUid, *image, image->settings().activeFrame() );
 
-            spdlog::debug( "Done creating {} image component textures", componentTextures.size() );
-            break;
+        if ( componentTextures.empty() )
+        {
+            continue;
         }
-        } // end switch ( image->bufferType() )
 
         imageTextures.emplace( imageUid, std::move( componentTextures ) );
 
@@ -224,7 +296,6 @@ createSegTextures( const AppData& appData )
     // (Segmentations should have only one component.)
     constexpr uint32_t k_comp0 = 0;
 
-    constexpr GLint k_mipmapLevel = 0; // Load seg data into first mipmap level
     constexpr GLint k_alignment = 1; // Pixel pack/unpack alignment is 1 byte
 
     static const tex::WrapMode sk_wrapMode = tex::WrapMode::ClampToBorder;
@@ -277,11 +348,9 @@ createSegTextures( const AppData& appData )
         T.setAutoGenerateMipmaps( true );
         T.setSize( seg->header().pixelDimensions() );
 
-        T.setData( k_mipmapLevel,
-                   GLTexture::getSizedInternalRedFormat( compType ),
-                   GLTexture::getBufferPixelRedFormat( compType ),
-                   GLTexture::getBufferPixelDataType( compType ),
-                   seg->bufferAsVoid( k_comp0 ) );
+        setTextureData( T, *seg, k_comp0,
+                        GLTexture::getSizedInternalRedFormat( compType ),
+                        GLTexture::getBufferPixelRedFormat( compType ) );
 
         spdlog::debug( "Created texture for segmentation {} ('{}')",
                        segUid, seg->settings().displayName() );
@@ -4,9 +4,36 @@
 #include "rendering/utility/gl/GLTexture.h"
 
 #include <uuid.h>
+#include <optional>
 #include <unordered_map>
+#include <vector>
 
 class AppData;
+class Image;
+
+/**
+ * @brief Allocate the first mipmap level of a 3D texture and fill it with the voxels of an image
+ * component. Images held in memory are uploaded in one call, whereas bricked images are uploaded
+ * brick by brick, so that they never need to be resident in memory in full.
+ * @param[in] frame Time frame of the image to upload. If none, the texture is allocated without data.
+ */
+void setTextureData(
+        GLTexture& texture,
+        const Image& image,
+        uint32_t component,
+        const tex::SizedInternalFormat& internalFormat,
+        const tex::BufferPixelFormat& format,
+        const std::optional<uint32_t>& frame = 0 );
+
+/// Create the textures of the components of an image. Images with interleaved components have
+/// one texture. The textures hold the given time frame; they are allocated without data if no
+/// frame is given. @return The textures; empty if the image cannot be loaded as textures
+std::vector<GLTexture> createImageComponentTextures(
+        const uuids::uuid& imageUid, const Image& image,
+        const std::optional<uint32_t>& frame = 0 );
+
+/// Get the buffer pixel format of the voxels uploaded to each texture of an image
+tex::BufferPixelFormat imageTextureBufferPixelFormat( const Image& image );
 
 std::unordered_map< uuids::uuid, std::vector<GLTexture> >
 createImageTextures( const AppData& appData );
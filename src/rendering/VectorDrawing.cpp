@@ -76,13 +76,51 @@ void endNvgFrame( NVGcontext* nvg )
     nvgEndFrame( nvg );
 }
 
-void drawLoadingOverlay( NVGcontext* nvg, const Viewport& windowVP )
+void drawLoadingOverlay(
+        NVGcontext* nvg,
+        const Viewport& windowVP,
+        const std::vector<LoadingPreviewSlice>& previewSlices,
+        const std::string& progressText )
 {
-    /// @todo Progress indicators: https://github.com/ocornut/imgui/issues/1901
-
     static const NVGcolor s_greyTextColor( nvgRGBA( 190, 190, 190, 255 ) );
     static const NVGcolor s_greyShadowColor( nvgRGBA( 64, 64, 64, 255 ) );
 
+    // Fraction of the window height above the loading text in which preview slices are drawn
+    static constexpr float sk_previewHeightFraction = 0.4f;
+    static constexpr float sk_previewPad = 8.0f;
+
+    if ( ! previewSlices.empty() )
+    {
+        // Fit the slices side by side into equal cells, preserving their physical aspect ratios
+        const float cellWidth = windowVP.width() / static_cast<float>( previewSlices.size() );
+        const float cellHeight = sk_previewHeightFraction * windowVP.height();
+
+        for ( size_t s = 0; s < previewSlices.size(); ++s )
+        {
+            const LoadingPreviewSlice& slice = previewSlices[s];
+
+            if ( 0 == slice.m_nvgImage ||
+                 slice.m_physicalSize.x <= 0.0f || slice.m_physicalSize.y <= 0.0f )
+            {
+                continue;
+            }
+
+            const float scale = std::min( ( cellWidth - 2.0f * sk_previewPad ) / slice.m_physicalSize.x,
+                                          ( cellHeight - 2.0f * sk_previewPad ) / slice.m_physicalSize.y );
+
+            const glm::vec2 size = scale * slice.m_physicalSize;
+            const glm::vec2 corner{ ( static_cast<float>( s ) + 0.5f ) * cellWidth - 0.5f * size.x,
+                                    0.5f * cellHeight - 0.5f * size.y };
+
+            const NVGpaint paint = nvgImagePattern( nvg, corner.x, corner.y, size.x, size.y, 0.0f, slice.m_nvgImage, 1.0f );
+
+            nvgBeginPath( nvg );
+            nvgRect( nvg, corner.x, corner.y, size.x, size.y );
+            nvgFillPaint( nvg, paint );
+            nvgFill( nvg );
+        }
+    }
+
     static constexpr float sk_arcAngle = 1.0f / 16.0f * NVG_PI;
     static const std::string sk_loadingText = "Loading images...";
 
@@ -99,6 +137,13 @@ void drawLoadingOverlay( NVGcontext* nvg, const Viewport& windowVP )
     nvgFillColor( nvg, s_greyTextColor );
     nvgText( nvg, 0.5f * windowVP.width(), 0.5f * windowVP.height(), sk_loadingText.c_str(), nullptr );
 
+    if ( ! progressText.empty() )
+    {
+        nvgFontSize( nvg, 24.0f );
+        nvgFillColor( nvg, s_greyTextColor );
+        nvgText( nvg, 0.5f * windowVP.width(), 0.5f * windowVP.height() + 56.0f, progressText.c_str(), nullptr );
+    }
+
     const auto ms = std::chrono::duration_cast< std::chrono::milliseconds >(
                 std::chrono::system_clock::now().time_since_epoch() );
 
@@ -9,9 +9,11 @@
 #include <uuid.h>
 
 #include <array>
+#include <cstdint>
 #include <functional>
 #include <list>
 #include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -24,6 +26,19 @@ struct NVGcontext;
 
 using ImageSegPairs = std::vector< std::pair< std::optional<uuids::uuid>, std::optional<uuids::uuid> > >;
 
+/**
+ * @brief Gray slice through a downsampled preview of the reference image, which is shown while
+ * images are loading
+ */
+struct LoadingPreviewSlice
+{
+    int m_width = 0; //!< Width in pixels
+    int m_height = 0; //!< Height in pixels
+    glm::vec2 m_physicalSize{ 0.0f, 0.0f }; //!< Size (mm), which sets the aspect ratio of the drawn slice
+    std::vector<uint8_t> m_rgba; //!< RGBA pixels, with rows ordered from top to bottom
+    int m_nvgImage = 0; //!< NanoVG image of the pixels, which is 0 until it is created
+};
+
 /**
  * @brief Information needed for positioning a single anatomical label and the crosshair
  * that corresponds to this label.
@@ -56,9 +71,13 @@ void startNvgFrame(
 
 void endNvgFrame( NVGcontext* nvg );
 
+/// Draw the loading text, progress text, and spinner, below the preview slices that have
+/// NanoVG images (if any)
 void drawLoadingOverlay(
         NVGcontext* nvg,
-        const Viewport& windowVP );
+        const Viewport& windowVP,
+        const std::vector<LoadingPreviewSlice>& previewSlices,
+        const std::string& progressText );
 
 void drawWindowOutline(
         NVGcontext* nvg,
@@ -668,6 +668,35 @@ void GLTexture::setSubData(
         const BufferPixelFormat& format,
         const BufferPixelDataType& type,
         const GLvoid* data )
+{
+    subImage( level, offset, size, format, type, data, m_pixelUnpackSettings );
+}
+
+void GLTexture::setSubData(
+        GLint level,
+        const glm::uvec3& offset,
+        const glm::uvec3& size,
+        const BufferPixelFormat& format,
+        const BufferPixelDataType& type,
+        const GLvoid* data,
+        GLint dataRowLength,
+        GLint dataImageHeight )
+{
+    PixelStoreSettings settings = ( m_pixelUnpackSettings ) ? *m_pixelUnpackSettings : getPixelUnpackSettings();
+    settings.m_rowLength = dataRowLength;
+    settings.m_imageHeight = dataImageHeight;
+
+    subImage( level, offset, size, format, type, data, settings );
+}
+
+void GLTexture::subImage(
+        GLint level,
+        const glm::uvec3& offset,
+        const glm::uvec3& size,
+        const BufferPixelFormat& format,
+        const BufferPixelDataType& type,
+        const GLvoid* data,
+        const std::optional<PixelStoreSettings>& unpackSettings )
 {
     if ( Target::Texture2DMultisample == m_target ||
          Target::TextureRectangle == m_target ||
@@ -687,10 +716,10 @@ void GLTexture::setSubData(
 
     std::optional<PixelStoreSettings> oldUnpackSettings = std::nullopt;
 
-    if ( m_pixelUnpackSettings )
+    if ( unpackSettings )
     {
         oldUnpackSettings = getPixelUnpackSettings();
-        applyPixelUnpackSettings( *m_pixelUnpackSettings );
+        applyPixelUnpackSettings( *unpackSettings );
     }
 
     switch ( m_target )
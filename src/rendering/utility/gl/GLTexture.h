@@ -156,6 +156,22 @@ public:
             const tex::BufferPixelDataType& type,
             const GLvoid* data );
 
+    /**
+     * @brief Writes a block of the user's pixel data to some part of the given mipmap of the bound
+     * texture object. The rows and images of the block are laid out as in a larger buffer with the
+     * given row length and image height (in pixels), so that a block of an image is written straight
+     * from the image buffer. The data points to the first pixel of the block.
+     **/
+    void setSubData(
+            GLint level,
+            const glm::uvec3& offset,
+            const glm::uvec3& size,
+            const tex::BufferPixelFormat& format,
+            const tex::BufferPixelDataType& type,
+            const GLvoid* data,
+            GLint dataRowLength,
+            GLint dataImageHeight );
+
     void setCubeMapFaceData(
             const tex::CubeMapFace& face,
             GLint level,
@@ -372,6 +388,16 @@ private:
 
     void applyPixelPackSettings( const PixelStoreSettings& settings );
     void applyPixelUnpackSettings( const PixelStoreSettings& settings );
+
+    /// Write pixel data to part of a mipmap, using the given unpack settings if set
+    void subImage(
+            GLint level,
+            const glm::uvec3& offset,
+            const glm::uvec3& size,
+            const tex::BufferPixelFormat& format,
+            const tex::BufferPixelDataType& type,
+            const GLvoid* data,
+            const std::optional<PixelStoreSettings>& unpackSettings );
 };
 
 #endif // GLTEXTURE_H
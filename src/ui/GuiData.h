@@ -38,6 +38,10 @@ struct GuiData
     bool m_showCorrelationColormapWindow = false; //!< Show correlation colormap window
     bool m_showJointHistogramColormapWindow = false; //!< Show joint histogram colormap window
 
+    /// Map of segmentation uid to the status of its latest save to disk, which is shown next to
+    /// its Save button. (Segmentations are saved in the background.)
+    std::unordered_map< uuids::uuid, std::string > m_segSaveStatus;
+
     void setCoordsPrecisionFormat();
     void setTxPrecisionFormat();
 
@@ -83,10 +83,12 @@ std::pair< ImVec4, ImVec4 > computeHeaderBgAndTextColors( const glm::vec3& color
 
 void renderImageHeaderInformation(
         const AppData& appData,
-        const ImageHeader& imgHeader,
-        const ImageSettings& /*imgSettings*/,
-        const ImageTransformations& imgTx )
+        const Image& image )
 {
+    const ImageHeader& imgHeader = image.header();
+    const ImageSettings& imgSettings = image.settings();
+    const ImageTransformations& imgTx = image.transformations();
+
     const char* txFormat = appData.guiData().m_txPrecisionFormat.c_str();
     const char* coordFormat = appData.guiData().m_coordsPrecisionFormat.c_str();
 
@@ -115,6 +117,21 @@ void renderImageHeaderInformation(
     ImGui::SameLine(); helpMarker( "Voxel spacing (mm)" );
 
 
+    // Time frames:
+    if ( imgHeader.numFrames() > 1 )
+    {
+        uint32_t numFrames = imgHeader.numFrames();
+        ImGui::InputScalar( "Time frames", ImGuiDataType_U32, &numFrames,
+                            nullptr, nullptr, nullptr, ImGuiInputTextFlags_ReadOnly );
+        ImGui::SameLine(); helpMarker( "Number of time frames of the time series image" );
+
+        float frameSpacing = imgHeader.frameSpacing();
+        ImGui::InputScalar( "Frame spacing", ImGuiDataType_Float, &frameSpacing,
+                            nullptr, nullptr, "%0.6f", ImGuiInputTextFlags_ReadOnly );
+        ImGui::SameLine(); helpMarker( "Time between frames, in the units of the image file" );
+    }
+
+
     // Origin:
     glm::vec3 origin = imgHeader.origin();
     ImGui::InputScalarN( "Origin (mm)", ImGuiDataType_Float, glm::value_ptr( origin ), 3,
@@ -252,11 +269,69 @@ void renderImageHeaderInformation(
                         nullptr, nullptr, nullptr, ImGuiInputTextFlags_ReadOnly );
     ImGui::SameLine(); helpMarker( "Image size in mebibytes (MiB)" );
 
+
+    if ( const auto& quantization = imgHeader.quantization() )
+    {
+        ImGui::Spacing();
+        ImGui::Separator();
+        ImGui::Spacing();
+
+        // Memory component type:
+        std::string memoryComponentType = imgHeader.memoryComponentTypeAsString();
+        ImGui::InputText( "Memory type", &memoryComponentType, ImGuiInputTextFlags_ReadOnly );
+        ImGui::SameLine(); helpMarker( "Component type of the quantized image values held in memory" );
+
+
+        // Image size in memory (MiB):
+        double memorySizeMiB = static_cast<double>( imgHeader.memoryImageSizeInBytes() ) / ( 1024.0 * 1024.0 );
+        ImGui::InputScalar( "Memory (MiB)", ImGuiDataType_Double, &memorySizeMiB,
+                            nullptr, nullptr, nullptr, ImGuiInputTextFlags_ReadOnly );
+        ImGui::SameLine(); helpMarker( "Size of the quantized image in memory in mebibytes (MiB)" );
+
+
+        // Quantization slope and intercept:
+        double slopeIntercept[2] = { quantization->m_slope, quantization->m_intercept };
+        ImGui::InputScalarN( "Slope, intercept", ImGuiDataType_Double, slopeIntercept, 2,
+                             nullptr, nullptr, "%g", ImGuiInputTextFlags_ReadOnly );
+        ImGui::SameLine(); helpMarker( "Image value = slope * value in memory + intercept" );
+
+
+        // Quantization error:
+        double errors[2] = { quantization->m_maxError, quantization->m_rmsError };
+        ImGui::InputScalarN( "Error (max, RMS)", ImGuiDataType_Double, errors, 2,
+                             nullptr, nullptr, "%g", ImGuiInputTextFlags_ReadOnly );
+        ImGui::SameLine(); helpMarker( "Maximum and root mean square errors of the quantized image values" );
+    }
+
+    if ( image.isBricked() )
+    {
+        ImGui::Spacing();
+        ImGui::Separator();
+        ImGui::Spacing();
+
+        // Resident and total size of the bricks in memory (MiB):
+        double residentAndTotalMiB[2] = {
+            static_cast<double>( image.residentSizeInBytes() ) / ( 1024.0 * 1024.0 ),
+            static_cast<double>( imgHeader.memoryImageSizeInBytes() ) / ( 1024.0 * 1024.0 ) };
+
+        ImGui::InputScalarN( "Resident, total (MiB)", ImGuiDataType_Double, residentAndTotalMiB, 2,
+                             nullptr, nullptr, "%.1f", ImGuiInputTextFlags_ReadOnly );
+        ImGui::SameLine(); helpMarker( "This image is too large for memory, so it is held in bricks on disk. "
+                                       "Sizes in mebibytes (MiB) of the bricks that are resident in memory "
+                                       "and of all bricks" );
+    }
+
     ImGui::Spacing();
 
 
     if ( ImGui::TreeNode( "Intensity histogram" ) )
     {
+        if ( imgSettings.hasProvisionalStatistics() )
+        {
+            // Statistics are estimated from a subsample of pixels until the exact ones are computed
+            ImGui::TextDisabled( "Computing exact statistics..." );
+        }
+
         // Other plotting tools for ImGui:
         // ImPlot https://github.com/epezent/implot
         // others https://github.com/ocornut/imgui/wiki/Useful-Widgets
@@ -602,6 +677,42 @@ void renderImageHeader(
         }
 
 
+        // Time frame selection and cine playback, shown only for time series images
+        if ( imgSettings.numFrames() > 1 )
+        {
+            int32_t frame = static_cast<int32_t>( imgSettings.activeFrame() );
+            if ( mySliderS32( "Frame", &frame, 0, static_cast<int32_t>( imgSettings.numFrames() ) - 1 ) )
+            {
+                imgSettings.setActiveFrame( static_cast<uint32_t>( frame ) );
+            }
+            ImGui::SameLine(); helpMarker( "Select the time frame to display" );
+
+            if ( ImGui::Button( imgSettings.cinePlaying() ? ICON_FK_PAUSE : ICON_FK_PLAY ) )
+            {
+                imgSettings.setCinePlaying( ! imgSettings.cinePlaying() );
+            }
+            if ( ImGui::IsItemHovered() )
+            {
+                ImGui::SetTooltip( imgSettings.cinePlaying() ? "Pause cine playback" : "Play the time frames as a cine loop" );
+            }
+
+            ImGui::SameLine();
+            bool loop = imgSettings.cineLoop();
+            if ( ImGui::Checkbox( "Loop", &loop ) )
+            {
+                imgSettings.setCineLoop( loop );
+            }
+            ImGui::SameLine(); helpMarker( "Restart playback from the first frame after the last frame" );
+
+            double frameRate = imgSettings.frameRate();
+            if ( mySliderF64( "Frame rate", &frameRate, 1.0, 60.0, "%.1f fps" ) )
+            {
+                imgSettings.setFrameRate( frameRate );
+            }
+            ImGui::SameLine(); helpMarker( "Cine playback rate in frames per second" );
+        }
+
+
         auto activeSegUid = appData.imageToActiveSegUid( imageUid );
         Image* activeSeg = ( activeSegUid ) ? appData.seg( *activeSegUid ) : nullptr;
 
@@ -658,7 +769,8 @@ void renderImageHeader(
 
 
         if ( ComponentType::Float32 == imgHeader.memoryComponentType() ||
-             ComponentType::Float64 == imgHeader.memoryComponentType() )
+             ComponentType::Float64 == imgHeader.memoryComponentType() ||
+             imgHeader.quantization() )
         {
             // Threshold range:
             const float threshMin = static_cast<float>( imgSettings.thresholdRange().first );
@@ -1221,7 +1333,7 @@ void renderImageHeader(
 
     if ( ImGui::TreeNode( "Header Information" ) )
     {
-        renderImageHeaderInformation( appData, imgHeader, imgSettings, imgTx );
+        renderImageHeaderInformation( appData, *image );
         ImGui::TreePop();
     }
 
@@ -1243,7 +1355,8 @@ void renderSegmentationHeader(
         const std::function< void ( size_t labelIndex ) >& moveCrosshairsToSegLabelCentroid,
         const std::function< std::optional<uuids::uuid>( const uuids::uuid& matchingImageUid, const std::string& segDisplayName ) >& createBlankSeg,
         const std::function< bool( const uuids::uuid& segUid ) >& clearSeg,
-        const std::function< bool( const uuids::uuid& segUid ) >& removeSeg )
+        const std::function< bool( const uuids::uuid& segUid ) >& removeSeg,
+        const std::function< bool ( const uuids::uuid& segUid, const std::string& fileName ) >& saveSeg )
 {
     static const std::string sk_addNewSegString = std::string( ICON_FK_FILE_O ) + std::string( " Create" );
     static const std::string sk_clearSegString = std::string( ICON_FK_ERASER ) + std::string( " Clear" );
@@ -1465,17 +1578,22 @@ void renderSegmentationHeader(
 
     if ( selectedFile )
     {
-        if ( activeSeg->saveToDisk( *selectedFile ) )
-        {
-            spdlog::info( "Saved segmentation image to file {}", *selectedFile );
-            activeSeg->header().setFileName( *selectedFile );
-        }
-        else
+        // The segmentation is saved in the background, so that it can be edited while saving
+        if ( ! saveSeg( *activeSegUid, *selectedFile ) )
         {
             spdlog::error( "Error saving segmentation image to file {}", *selectedFile );
         }
     }
 
+    const auto& segSaveStatus = appData.guiData().m_segSaveStatus;
+    const auto saveStatus = segSaveStatus.find( *activeSegUid );
+
+    if ( std::end( segSaveStatus ) != saveStatus )
+    {
+        ImGui::SameLine();
+        ImGui::TextUnformatted( saveStatus->second.c_str() );
+    }
+
     ImGui::Spacing();
     ImGui::Separator();
     ImGui::Spacing();
@@ -1487,8 +1605,6 @@ void renderSegmentationHeader(
         return;
     }
 
-    const auto& segHeader = activeSeg->header();
-    const auto& segTx = activeSeg->transformations();
     auto& segSettings = activeSeg->settings();
 
     // Header is ID'ed only by "seg_" and the image index.
@@ -1551,7 +1667,7 @@ void renderSegmentationHeader(
 
     if ( ImGui::TreeNode( "Header Information" ) )
     {
-        renderImageHeaderInformation( appData, segHeader, segSettings, segTx );
+        renderImageHeaderInformation( appData, *activeSeg );
 
         ImGui::Spacing();
         ImGui::Separator();
@@ -22,19 +22,15 @@ class ParcellationLabelTable;
 
 
 /**
- * @brief Render UI for image header information, including data for pixel and component types
- * and transformations.
+ * @brief Render UI for image header information, including data for pixel and component types,
+ * transformations, and the memory held by bricked images.
  *
  * @param[in] appData App data
- * @param[in] imgHeader Image header data
- * @param[in] imgSettings Image settings data
- * @param[in] imgTx Image transformation data
+ * @param[in] image Image, whose header, settings, and transformations are shown
  */
 void renderImageHeaderInformation(
         const AppData& appData,
-        const ImageHeader& imgHeader,
-        const ImageSettings& imgSettings,
-        const ImageTransformations& imgTx );
+        const Image& image );
 
 
 /**
@@ -88,6 +84,7 @@ void renderImageHeader(
  * @param createBlankSeg
  * @param clearSeg
  * @param removeSeg
+ * @param saveSeg Start saving a segmentation to a file; returns false if it could not be started
  */
 void renderSegmentationHeader(
         AppData& appData,
@@ -101,7 +98,8 @@ void renderSegmentationHeader(
         const std::function< void ( size_t labelIndex ) >& moveCrosshairsToSegLabelCentroid,
         const std::function< std::optional<uuids::uuid> ( const uuids::uuid& matchingImageUid, const std::string& segDisplayName ) >& createBlankSeg,
         const std::function< bool ( const uuids::uuid& segUid ) >& clearSeg,
-        const std::function< bool ( const uuids::uuid& segUid ) >& removeSeg );
+        const std::function< bool ( const uuids::uuid& segUid ) >& removeSeg,
+        const std::function< bool ( const uuids::uuid& segUid, const std::string& fileName ) >& saveSeg );
 
 
 /**
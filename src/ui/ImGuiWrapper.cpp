@@ -68,6 +68,7 @@ ImGuiWrapper::ImGuiWrapper(
       m_createBlankSeg( nullptr ),
       m_clearSeg( nullptr ),
       m_removeSeg( nullptr ),
+      m_saveSeg( nullptr ),
 
       m_executeGridCutsSeg( nullptr ),
       m_setLockManualImageTransformation( nullptr ),
@@ -125,6 +126,7 @@ void ImGuiWrapper::setCallbacks(
         std::function< std::optional<uuids::uuid>( const uuids::uuid& matchingImageUid, const std::string& segDisplayName ) > createBlankSeg,
         std::function< bool ( const uuids::uuid& segUid ) > clearSeg,
         std::function< bool ( const uuids::uuid& segUid ) > removeSeg,
+        std::function< bool ( const uuids::uuid& segUid, const std::string& fileName ) > saveSeg,
         std::function< bool ( const uuids::uuid& imageUid, const uuids::uuid& seedSegUid, const uuids::uuid& resultSegUid ) > executeGridCutsSeg,
         std::function< bool ( const uuids::uuid& imageUid, bool locked ) > setLockManualImageTransformation,
         std::function< void () > paintActiveSegmentationWithActivePolygon )
@@ -148,6 +150,7 @@ void ImGuiWrapper::setCallbacks(
     m_createBlankSeg = createBlankSeg;
     m_clearSeg = clearSeg;
     m_removeSeg = removeSeg;
+    m_saveSeg = saveSeg;
     m_executeGridCutsSeg = executeGridCutsSeg;
     m_setLockManualImageTransformation = setLockManualImageTransformation;
     m_paintActiveSegmentationWithActivePolygon = paintActiveSegmentationWithActivePolygon;
@@ -556,7 +559,8 @@ void ImGuiWrapper::render()
                         m_moveCrosshairsToSegLabelCentroid,
                         m_createBlankSeg,
                         m_clearSeg,
-                        m_removeSeg );
+                        m_removeSeg,
+                        m_saveSeg );
         }
 
         if ( m_appData.guiData().m_showLandmarksWindow )
@@ -42,6 +42,7 @@ public:
             std::function< std::optional<uuids::uuid>( const uuids::uuid& matchingImageUid, const std::string& segDisplayName ) > createBlankSeg,
             std::function< bool ( const uuids::uuid& segUid ) > clearSeg,
             std::function< bool ( const uuids::uuid& segUid ) > removeSeg,
+            std::function< bool ( const uuids::uuid& segUid, const std::string& fileName ) > saveSeg,
             std::function< bool ( const uuids::uuid& imageUid, const uuids::uuid& seedSegUid, const uuids::uuid& resultSegUid ) > m_executeGridCutsSeg,
             std::function< bool ( const uuids::uuid& imageUid, bool locked ) > setLockManualImageTransformation,
             std::function< void () > paintActiveSegmentationWithActivePolygon );
@@ -79,6 +80,7 @@ private:
     std::function< std::optional<uuids::uuid>( const uuids::uuid& matchingImageUid, const std::string& segDisplayName ) > m_createBlankSeg = nullptr;
     std::function< bool ( const uuids::uuid& segUid ) > m_clearSeg = nullptr;
     std::function< bool ( const uuids::uuid& segUid ) > m_removeSeg = nullptr;
+    std::function< bool ( const uuids::uuid& segUid, const std::string& fileName ) > m_saveSeg = nullptr;
     std::function< bool ( const uuids::uuid& imageUid, const uuids::uuid& seedSegUid, const uuids::uuid& resultSegUid ) > m_executeGridCutsSeg = nullptr;
     std::function< bool ( const uuids::uuid& imageUid, bool locked ) > m_setLockManualImageTransformation = nullptr;
     std::function< void () > m_paintActiveSegmentationWithActivePolygon = nullptr;
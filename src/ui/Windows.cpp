@@ -873,7 +873,8 @@ void renderSegmentationPropertiesWindow(
         const std::function< void ( const uuids::uuid& imageUid, size_t labelIndex ) >& moveCrosshairsToSegLabelCentroid,
         const std::function< std::optional<uuids::uuid> ( const uuids::uuid& matchingImageUid, const std::string& segDisplayName ) >& createBlankSeg,
         const std::function< bool ( const uuids::uuid& segUid ) >& clearSeg,
-        const std::function< bool( const uuids::uuid& segUid ) >& removeSeg )
+        const std::function< bool( const uuids::uuid& segUid ) >& removeSeg,
+        const std::function< bool ( const uuids::uuid& segUid, const std::string& fileName ) >& saveSeg )
 {
     if ( ImGui::Begin( "Segmentations##Segmentations",
                        &( appData.guiData().m_showSegmentationsWindow ),
@@ -900,7 +901,8 @@ void renderSegmentationPropertiesWindow(
                             [&imageUid, moveCrosshairsToSegLabelCentroid] ( size_t labelIndex ) { moveCrosshairsToSegLabelCentroid( imageUid, labelIndex ); },
                             createBlankSeg,
                             clearSeg,
-                            removeSeg );
+                            removeSeg,
+                            saveSeg );
             }
         }
 
@@ -1784,7 +1786,8 @@ void renderInspectionWindow(
 
             if ( const auto imageValue = getImageValue( imageIndex ) )
             {
-                if ( isComponentFloatingPoint( image->header().memoryComponentType() ) )
+                if ( isComponentFloatingPoint( image->header().memoryComponentType() ) ||
+                     image->header().quantization() )
                 {
                     if ( image->header().numComponentsPerPixel() > 1 )
                     {
@@ -2125,7 +2128,8 @@ void renderInspectionWindowWithTable(
 
                 if ( imageValue )
                 {
-                    if ( isComponentFloatingPoint( image->header().memoryComponentType() ) )
+                    if ( isComponentFloatingPoint( image->header().memoryComponentType() ) ||
+                         image->header().quantization() )
                     {
                         double a = *imageValue;
                         ImGui::PushItemWidth( -1 );
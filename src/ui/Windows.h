@@ -134,6 +134,7 @@ void renderImagePropertiesWindow(
  * @param createBlankSeg
  * @param clearSeg
  * @param removeSeg
+ * @param saveSeg
  */
 void renderSegmentationPropertiesWindow(
         AppData& appData,
@@ -143,7 +144,8 @@ void renderSegmentationPropertiesWindow(
         const std::function< void ( const uuids::uuid& imageUid, size_t labelIndex ) >& moveCrosshairsToSegLabelCentroid,
         const std::function< std::optional<uuids::uuid> ( const uuids::uuid& matchingImageUid, const std::string& segDisplayName ) >& createBlankSeg,
         const std::function< bool ( const uuids::uuid& segUid ) >& clearSeg,
-        const std::function< bool( const uuids::uuid& segUid ) >& removeSeg );
+        const std::function< bool( const uuids::uuid& segUid ) >& removeSeg,
+        const std::function< bool ( const uuids::uuid& segUid, const std::string& fileName ) >& saveSeg );
 
 
 /**
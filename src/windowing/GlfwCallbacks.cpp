@@ -17,6 +17,8 @@
 #include <GLFW/glfw3.h>
 
 #include <optional>
+#include <string>
+#include <vector>
 
 
 namespace
@@ -188,7 +190,8 @@ void cursorPosCallback( GLFWwindow* window, double mindowCursorPosX, double mind
             }
 
             const bool swapFgAndBg = ( s_mouseButtonState.right );
-            handler.doSegment( *currHit_invalidOutsideView, swapFgAndBg );
+            handler.doSegment( s_prevHit ? *s_prevHit : *currHit_invalidOutsideView,
+                               *currHit_invalidOutsideView, swapFgAndBg );
         }
 
         break;
@@ -370,6 +373,12 @@ void mouseButtonCallback( GLFWwindow* window, int button, int action, int mods )
     s_startHit = std::nullopt;
     s_prevHit = std::nullopt;
 
+    // Releasing the mouse button ends a brush stroke, even outside of the views
+    if ( GLFW_RELEASE == action )
+    {
+        app->callbackHandler().endSegStroke();
+    }
+
     double mindowCursorPosX, mindowCursorPosY;
     glfwGetCursorPos( window, &mindowCursorPosX, &mindowCursorPosY );
 
@@ -491,6 +500,9 @@ void keyCallback( GLFWwindow* window, int key, int /*scancode*/, int action, int
     // Do actions on GLFW_PRESS and GLFW_REPEAT only
     if ( GLFW_RELEASE == action ) return;
 
+    // Escape cancels loading of images, while the loading overlay is shown
+    if ( GLFW_KEY_ESCAPE == key && app->cancelImageLoading() ) return;
+
     double mindowCursorPosX, mindowCursorPosY;
     glfwGetCursorPos( window, &mindowCursorPosX, &mindowCursorPosY );
 
@@ -521,7 +533,34 @@ void keyCallback( GLFWwindow* window, int key, int /*scancode*/, int action, int
     case GLFW_KEY_T: handler.setMouseMode( MouseMode::ImageTranslate ); break;
 //    case GLFW_KEY_Y: handler.setMouseMode( MouseMode::ImageScale ); break;
 
-    case GLFW_KEY_Z: handler.setMouseMode( MouseMode::CameraZoom ); break;
+    case GLFW_KEY_Y:
+    {
+        if ( s_modifierState.control )
+        {
+            handler.redoSegEdit();
+        }
+        break;
+    }
+
+    case GLFW_KEY_Z:
+    {
+        if ( s_modifierState.control )
+        {
+            if ( s_modifierState.shift )
+            {
+                handler.redoSegEdit();
+            }
+            else
+            {
+                handler.undoSegEdit();
+            }
+        }
+        else
+        {
+            handler.setMouseMode( MouseMode::CameraZoom );
+        }
+        break;
+    }
     case GLFW_KEY_X: handler.setMouseMode( MouseMode::CameraTranslate ); break;
 
     case GLFW_KEY_A: handler.decreaseSegOpacity(); break;
@@ -718,15 +757,17 @@ void dropCallback( GLFWwindow* window, int count, const char** paths )
         return;
     }
 
+    std::vector<std::string> fileNames;
+
     for ( int i = 0;  i < count; ++i )
     {
         if ( paths[i] )
         {
             spdlog::info( "Dropped file {}: {}", i, paths[i] );
-
-            serialize::Image serializedImage;
-            serializedImage.m_imageFileName = paths[i];
-            app->loadSerializedImage( serializedImage );
+            fileNames.emplace_back( paths[i] );
         }
     }
+
+    // Read the files in the background, so that the UI does not freeze
+    app->loadImagesAsync( fileNames );
 }
@@ -216,8 +216,9 @@ void GlfwWrapper::renderLoop(
 
         if ( imageLoadFailed )
         {
-            spdlog::critical( "Render loop exiting due to failure to load images" );
-            exit( EXIT_FAILURE );
+            // Return normally, so that the application and its loader threads shut down cleanly
+            spdlog::critical( "Render loop exiting because images were not loaded" );
+            break;
         }
 
         processInput();
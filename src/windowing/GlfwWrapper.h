@@ -82,6 +82,8 @@ public:
      * @brief Execute the render loop
      * @param[in,out] imagesReady True iff images have been loaded into memory.
      * Set to false after onImagesReady is called.
+     * @param[in] imageLoadFailed True iff images failed to load or loading was cancelled,
+     * in which case the loop returns
      * @param[in] onImagesReady Function to call when images are ready
      */
     void renderLoop( std::atomic<bool>& imagesReady,